@@ -0,0 +1,156 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "../include/serc.h"
+
+/*
+ * Writer-count sweep for the concurrent append buffer: every thread
+ * appends the same number of fixed-size records to one ser_cbuff_t,
+ * then the batch is finished into a ser_buff_t and checked (every byte
+ * present, each thread's records in order). Runs once per thread count,
+ * doubling up to the maximum, and reports appends/s, the speedup over
+ * one writer and the scaling efficiency; a linear buffer keeps the
+ * efficiency near 100%.
+ *
+ * usage: cbuff_writers [max threads] [records per thread] [record bytes]
+ */
+
+typedef struct _bench_writer_t {
+  pthread_t thread;
+  ser_cbuff_t* cb;
+  unsigned int id;
+  long records;
+  int record;
+} bench_writer_t;
+
+static atomic_int bench_ready;
+static atomic_int bench_go;
+
+static unsigned long long now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+};
+
+static void* writer_main(void* arg) {
+  bench_writer_t* w = arg;
+  char data[4096];
+  memset(data, 'x', w->record);
+  memcpy(data, &w->id, sizeof(unsigned int));
+
+  // start every writer together so the step measures contention
+  atomic_fetch_add(&bench_ready, 1);
+  while (!atomic_load(&bench_go));
+
+  for (long i = 0; i < w->records; i++) {
+    unsigned int seq = (unsigned int)i;
+    memcpy(data + sizeof(unsigned int), &seq, sizeof(unsigned int));
+    serlib_cbuff_append(w->cb, data, w->record);
+  }
+
+  return NULL;
+};
+
+static int check_batch(ser_buff_t* b, int threads, long records, int record) {
+  if (b->next != (long long)threads * records * record) {
+    printf("cbuff_writers: %d threads: %d bytes finished, expected %lld\n",
+           threads, b->next, (long long)threads * records * record);
+    return -1;
+  }
+
+  unsigned int next_seq[64] = { 0 };
+  for (int pos = 0; pos < b->next; pos += record) {
+    unsigned int id, seq;
+    memcpy(&id, b->buffer + pos, sizeof(unsigned int));
+    memcpy(&seq, b->buffer + pos + sizeof(unsigned int), sizeof(unsigned int));
+
+    if (id >= (unsigned int)threads || seq != next_seq[id]) {
+      printf("cbuff_writers: %d threads: bad record at %d (writer %u, seq %u)\n", threads, pos, id, seq);
+      return -1;
+    }
+    next_seq[id]++;
+  }
+
+  return 0;
+};
+
+static int run_step(ser_cbuff_t* cb, ser_buff_t* out, int threads, long records, int record, double* base_rate) {
+  bench_writer_t writers[64];
+
+  atomic_store(&bench_ready, 0);
+  atomic_store(&bench_go, 0);
+
+  for (int i = 0; i < threads; i++) {
+    writers[i].cb = cb;
+    writers[i].id = i;
+    writers[i].records = records;
+    writers[i].record = record;
+    if (pthread_create(&writers[i].thread, NULL, writer_main, &writers[i]) != 0) {
+      printf("cbuff_writers: failed to start writer %d\n", i);
+      exit(1);
+    }
+  }
+
+  while (atomic_load(&bench_ready) != threads);
+  unsigned long long start = now_ns();
+  atomic_store(&bench_go, 1);
+
+  for (int i = 0; i < threads; i++) {
+    pthread_join(writers[i].thread, NULL);
+  }
+  unsigned long long elapsed = now_ns() - start;
+
+  serlib_reset_buffer(out);
+  serlib_cbuff_finish(cb, out);
+  if (check_batch(out, threads, records, record) < 0) return -1;
+
+  double appends = (double)threads * records;
+  double rate = appends / (elapsed / 1e9);
+  if (threads == 1) *base_rate = rate;
+
+  printf("%7d %14.0f %10.1f %9.2f %10.0f%%\n",
+         threads, rate, appends * record / (elapsed / 1e9) / 1e6,
+         rate / *base_rate, 100.0 * rate / *base_rate / threads);
+  return 0;
+};
+
+int main(int argc, char** argv) {
+  int max_threads = argc > 1 ? atoi(argv[1]) : 32;
+  long records = argc > 2 ? atol(argv[2]) : 50000;
+  int record = argc > 3 ? atoi(argv[3]) : 32;
+
+  if (max_threads < 1 || max_threads > 64 || records < 1 || records > 0x7fffffff ||
+      record < 2 * (int)sizeof(unsigned int) || record > 4096 ||
+      (long long)max_threads * records * record > 0x7fffffff) {
+    printf("usage: cbuff_writers [max threads 1-64] [records per thread] [record bytes 8-4096]\n");
+    printf("       (max threads x records x record bytes must stay under 2 GB)\n");
+    return 1;
+  }
+
+  ser_cbuff_t cb;
+  serlib_cbuff_init(&cb, 64 * 1024);
+
+  ser_buff_t* out;
+  serlib_init_buffer_of_size(&out, SERIALIZE_BUFFER_DEFAULT_SIZE);
+
+  printf("cbuff_writers: %ld records x %d bytes per thread\n", records, record);
+  printf("%7s %14s %10s %9s %11s\n", "threads", "appends/s", "MB/s", "speedup", "efficiency");
+
+  // double the writer count each step; the buffer keeps its segments
+  // across steps, so only the first one pays for faulting them in
+  int rc = 0;
+  double base_rate = 0;
+  for (int threads = 1; threads <= max_threads && rc == 0; threads *= 2) {
+    rc = run_step(&cb, out, threads, records, record, &base_rate);
+  }
+
+  serlib_free_buffer(out);
+  serlib_cbuff_free(&cb);
+  return rc ? 1 : 0;
+};
@@ -0,0 +1,190 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "../include/serc.h"
+#include "../include/serc_numa.h"
+
+/*
+ * NUMA locality benchmark: a producer thread on the first node builds
+ * list_t messages and serializes them, a consumer thread on the last
+ * node deserializes each buffer and walks its list. Run three ways:
+ * with heap memory (placed wherever the producer first touches it),
+ * with buffers and nodes bound to the producer's node (remote for the
+ * consumer), and bound to the consumer's node (local for it).
+ *
+ * On a single-node machine pass a node count to simulate: placement is
+ * then bookkeeping only and all three runs should match, which checks
+ * the pools add no overhead of their own.
+ *
+ * usage: numa_locality [simulated nodes, 0 for real] [messages] [list elements]
+ */
+
+#define BENCH_SLOTS 16
+
+typedef struct _bench_msg_t {
+  ser_buff_t* b;
+  list_t list;
+} bench_msg_t;
+
+typedef struct _bench_t {
+  bench_msg_t msgs[BENCH_SLOTS];
+  _Atomic long produced;
+  _Atomic long consumed;
+  long messages;
+  int elements;
+  int producer_node;
+  int consumer_node;
+  unsigned long long checksum;
+} bench_t;
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+};
+
+static void serialize_elem(void* data, ser_buff_t* b) {
+  serlib_serialize_data(b, (char*)data, sizeof(long));
+};
+
+static void* produce(void* arg) {
+  bench_t* bench = arg;
+  serlib_numa_run_on_node(bench->producer_node);
+
+  for (long i = 0; i < bench->messages; i++) {
+    while (i - atomic_load_explicit(&bench->consumed, memory_order_acquire) >= BENCH_SLOTS) {
+      sched_yield();
+    }
+
+    bench_msg_t* msg = &bench->msgs[i % BENCH_SLOTS];
+
+    // reuse the slot's nodes through the list's node cache
+    list_node_t* node;
+    while ((node = serlib_list_pop_head_node(&msg->list)) != NULL) {
+      serlib_list_release_node(&msg->list, node);
+    }
+    for (long j = 0; j < bench->elements; j++) {
+      long value = i + j;
+      serlib_list_append(&msg->list, &value);
+    }
+
+    serlib_reset_buffer(msg->b);
+    serlib_serialize_list_t(&msg->list, msg->b, serialize_elem);
+
+    atomic_store_explicit(&bench->produced, i + 1, memory_order_release);
+  }
+
+  return NULL;
+};
+
+static void* consume(void* arg) {
+  bench_t* bench = arg;
+  serlib_numa_run_on_node(bench->consumer_node);
+
+  for (long i = 0; i < bench->messages; i++) {
+    while (atomic_load_explicit(&bench->produced, memory_order_acquire) <= i) {
+      sched_yield();
+    }
+
+    bench_msg_t* msg = &bench->msgs[i % BENCH_SLOTS];
+
+    // read the serialized copy, then walk the list it came from
+    long wire = 0;
+    msg->b->next = 0;
+    for (long j = 0; j < bench->elements; j++) {
+      long value;
+      serlib_deserialize_data(msg->b, (char*)&value, sizeof(long));
+      wire += value;
+    }
+
+    long walked = 0;
+    for (list_node_t* node = msg->list.head; node; node = node->next) {
+      walked += *(long*)node->data;
+    }
+
+    if (wire != walked) {
+      printf("consumer: message %ld: buffer sum %ld, list sum %ld\n", i, wire, walked);
+      exit(1);
+    }
+    bench->checksum += wire;
+
+    atomic_store_explicit(&bench->consumed, i + 1, memory_order_release);
+  }
+
+  return NULL;
+};
+
+static void run(const char* name, int placement, long messages, int elements, int producer_node, int consumer_node) {
+  bench_t bench;
+  memset(&bench, 0, sizeof(bench));
+  bench.messages = messages;
+  bench.elements = elements;
+  bench.producer_node = producer_node;
+  bench.consumer_node = consumer_node;
+
+  for (int i = 0; i < BENCH_SLOTS; i++) {
+    serlib_init_buffer_of_size(&bench.msgs[i].b, elements * sizeof(long) + 64);
+    serlib_list_new(&bench.msgs[i].list, sizeof(long), NULL);
+    serlib_list_set_node_cache(&bench.msgs[i].list, elements);
+    if (placement >= 0) {
+      serlib_buffer_set_numa_node(bench.msgs[i].b, placement);
+      serlib_list_set_numa_node(&bench.msgs[i].list, placement);
+    }
+  }
+
+  pthread_t producer;
+  pthread_t consumer;
+  double start = now_sec();
+  pthread_create(&consumer, NULL, consume, &bench);
+  pthread_create(&producer, NULL, produce, &bench);
+  pthread_join(producer, NULL);
+  pthread_join(consumer, NULL);
+  double elapsed = now_sec() - start;
+
+  double bytes = (double)messages * elements * sizeof(long);
+  printf("%-14s %12.0f msg/s %10.1f MB/s (checksum %llu)\n",
+         name, messages / elapsed, bytes / elapsed / 1e6, bench.checksum);
+
+  for (int i = 0; i < BENCH_SLOTS; i++) {
+    serlib_free_buffer(bench.msgs[i].b);
+    serlib_list_destroy(&bench.msgs[i].list);
+  }
+};
+
+int main(int argc, char** argv) {
+  int simulated = argc > 1 ? atoi(argv[1]) : 0;
+  long messages = argc > 2 ? atol(argv[2]) : 200000;
+  int elements = argc > 3 ? atoi(argv[3]) : 512;
+
+  if (elements <= 0 || messages <= 0) {
+    printf("usage: numa_locality [simulated nodes, 0 for real] [messages] [list elements]\n");
+    return 1;
+  }
+
+  int nodes = serlib_numa_init(simulated);
+  if (nodes < 0) {
+    printf("numa_locality: can't simulate %d nodes\n", simulated);
+    return 1;
+  }
+
+  int producer_node = 0;
+  int consumer_node = nodes - 1;
+
+  printf("numa_locality: %d %s node(s), producer on node %d, consumer on node %d, %d elements per message\n",
+         nodes, serlib_numa_is_simulated() ? "simulated" : "real", producer_node, consumer_node, elements);
+  if (nodes == 1) {
+    printf("numa_locality: only one node, local and remote placement are the same memory\n");
+  }
+
+  run("heap", -1, messages, elements, producer_node, consumer_node);
+  run("producer node", producer_node, messages, elements, producer_node, consumer_node);
+  run("consumer node", consumer_node, messages, elements, producer_node, consumer_node);
+  return 0;
+};
@@ -0,0 +1,101 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/wait.h>
+
+#include "../include/serc.h"
+#include "../include/serc_ring.h"
+
+/*
+ * Loopback benchmark for the shared-memory frame ring: a forked consumer
+ * deserializes frames straight out of the ring while the parent
+ * serializes straight into it.
+ *
+ * usage: ring_loopback [messages] [payload bytes] [ring bytes]
+ */
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+};
+
+static void consume(serlib_ring_t* ring, long messages) {
+  serlib_ring_slot_t slot;
+  unsigned long long checksum = 0;
+  char scratch[65536];
+
+  for (long i = 0; i < messages; i++) {
+    while (serlib_ring_peek(ring, &slot) < 0) {
+      serlib_ring_wait(ring, 100);
+    }
+
+    if (slot.header->rpc_call_id != (unsigned int)i) {
+      printf("consumer: out of order frame %u, expected %ld\n", slot.header->rpc_call_id, i);
+      exit(1);
+    }
+
+    serlib_deserialize_data(&slot.buff, scratch, slot.buff.size);
+    checksum += (unsigned char)scratch[0];
+    serlib_ring_release(ring, &slot);
+  }
+
+  printf("consumer: checksum %llu\n", checksum);
+  fflush(stdout);
+};
+
+int main(int argc, char** argv) {
+  long messages = argc > 1 ? atol(argv[1]) : 1000000;
+  int payload = argc > 2 ? atoi(argv[2]) : 64;
+  unsigned long long capacity = argc > 3 ? strtoull(argv[3], NULL, 10) : (1 << 20);
+
+  if (payload <= 0 || payload > 65536) {
+    printf("payload must be between 1 and 65536 bytes\n");
+    return 1;
+  }
+
+  serlib_ring_t ring;
+  if (serlib_ring_create(&ring, NULL, capacity, SERLIB_RING_SPSC) < 0) return 1;
+
+  char* data = malloc(payload);
+  memset(data, 'x', payload);
+
+  double start = now_sec();
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    consume(&ring, messages);
+    _exit(0);
+  }
+
+  serlib_ring_slot_t slot;
+  for (long i = 0; i < messages; i++) {
+    while (serlib_ring_reserve(&ring, payload, &slot) < 0) {
+      sched_yield();
+    }
+
+    slot.header->tid = 0;
+    slot.header->rpc_proc_id = 1;
+    slot.header->rpc_call_id = (unsigned int)i;
+    serlib_serialize_data(&slot.buff, data, payload);
+    serlib_ring_commit(&ring, &slot);
+  }
+
+  int status;
+  waitpid(pid, &status, 0);
+  double elapsed = now_sec() - start;
+
+  printf("ring_loopback: %ld messages x %d bytes in %.3f s\n", messages, payload, elapsed);
+  printf("ring_loopback: %.0f msg/s, %.1f MB/s\n",
+         messages / elapsed, messages * (double)payload / elapsed / 1e6);
+
+  free(data);
+  serlib_ring_close(&ring);
+
+  return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+};
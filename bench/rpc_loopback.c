@@ -0,0 +1,346 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+
+#include "../include/serc.h"
+#include "../include/serc_rpc.h"
+#include "../include/serc_stats.h"
+
+/*
+ * End-to-end RPC benchmark: every client thread builds list_t requests
+ * with serlib_list_append, sends them ser_header_t-framed over its own
+ * socketpair or loopback TCP connection to a server thread that
+ * deserializes the list and echoes it back incremented, and checks the
+ * response. Runs once per thread count and reports throughput, latency
+ * percentiles, and the client's list build/teardown time per request
+ * as a measure of allocator contention. Built with STATS=1 it also
+ * reports allocations per request.
+ *
+ * usage: rpc_loopback [max threads] [requests per step] [list elements]
+ *                     [unix|tcp] [inflight per thread]
+ */
+
+#define BENCH_PROC 1
+
+typedef struct _bench_elem_t {
+  int id;
+  int value;
+} bench_elem_t;
+
+typedef struct _bench_client_t {
+  pthread_t thread;
+  int fd;
+  long requests;
+  int elements;
+  int inflight;
+  unsigned long long* latencies;
+  unsigned long long build_ns;
+  int failed;
+} bench_client_t;
+
+typedef struct _bench_server_t {
+  pthread_t thread;
+  int fd;
+} bench_server_t;
+
+static unsigned long long now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+};
+
+static void serialize_elem(void* data, ser_buff_t* b) {
+  bench_elem_t* elem = data;
+  serlib_serialize_data(b, (char*)&elem->id, sizeof(elem->id));
+  serlib_serialize_data(b, (char*)&elem->value, sizeof(elem->value));
+};
+
+static void deserialize_elem(void* data, ser_buff_t* b) {
+  bench_elem_t* elem = data;
+  serlib_deserialize_data(b, (char*)&elem->id, sizeof(elem->id));
+  serlib_deserialize_data(b, (char*)&elem->value, sizeof(elem->value));
+};
+
+static int echo_handler(ser_header_t* header, ser_buff_t* request, ser_buff_t* response, void* ctx) {
+  list_t* list = serlib_deserialize_list_t(request, sizeof(bench_elem_t), deserialize_elem);
+  if (!list) return -1;
+
+  list_node_t* node = list->head;
+  for (int i = 0; i < list->logical_length; i++, node = node->next) {
+    ((bench_elem_t*)node->data)->value++;
+  }
+
+  serlib_serialize_list_t(list, response, serialize_elem);
+  serlib_list_destroy(list);
+  free(list);
+  return 0;
+};
+
+static void* serve(void* arg) {
+  bench_server_t* server_thread = arg;
+
+  serlib_rpc_server_t server;
+  serlib_rpc_server_init(&server, BENCH_PROC + 1);
+  serlib_rpc_server_register(&server, BENCH_PROC, echo_handler, NULL, 4);
+
+  while (serlib_rpc_server_serve_one(&server, server_thread->fd) == 0);
+
+  serlib_rpc_server_destroy(&server);
+  close(server_thread->fd);
+  return NULL;
+};
+
+static int check_response(ser_buff_t* response, int elements, int base) {
+  list_t* list = serlib_deserialize_list_t(response, sizeof(bench_elem_t), deserialize_elem);
+  if (!list) return -1;
+
+  int ok = list->logical_length == elements;
+  list_node_t* node = list->head;
+  for (int i = 0; ok && i < list->logical_length; i++, node = node->next) {
+    bench_elem_t* elem = node->data;
+    ok = elem->id == i && elem->value == base + i + 1;
+  }
+
+  serlib_list_destroy(list);
+  free(list);
+  return ok ? 0 : -1;
+};
+
+static void* run_client(void* arg) {
+  bench_client_t* bench = arg;
+
+  serlib_rpc_client_t client;
+  serlib_rpc_client_init(&client, bench->fd, 0, bench->inflight, 1024);
+
+  ser_buff_t* request;
+  serlib_init_buffer_of_size(&request, 1024);
+
+  unsigned int* call_ids = malloc(bench->inflight * sizeof(unsigned int));
+  unsigned long long* started = malloc(bench->inflight * sizeof(unsigned long long));
+  int* bases = malloc(bench->inflight * sizeof(int));
+
+  long sent = 0;
+  long done = 0;
+  while (done < bench->requests && !bench->failed) {
+    // keep up to inflight requests outstanding, oldest first
+    while (sent < bench->requests && sent - done < bench->inflight) {
+      int slot = sent % bench->inflight;
+      int base = (int)(sent & 0xFFFF);
+
+      unsigned long long build_start = now_ns();
+      list_t list;
+      serlib_list_new(&list, sizeof(bench_elem_t), NULL);
+      for (int i = 0; i < bench->elements; i++) {
+        bench_elem_t elem = { i, base + i };
+        serlib_list_append(&list, &elem);
+      }
+      serlib_reset_buffer(request);
+      serlib_serialize_list_t(&list, request, serialize_elem);
+      serlib_list_destroy(&list);
+      bench->build_ns += now_ns() - build_start;
+
+      started[slot] = now_ns();
+      bases[slot] = base;
+      if (serlib_rpc_client_send(&client, BENCH_PROC, request, &call_ids[slot]) < 0) {
+        bench->failed = 1;
+        break;
+      }
+      sent++;
+    }
+    if (bench->failed) break;
+
+    int slot = done % bench->inflight;
+    ser_buff_t* response;
+    if (serlib_rpc_client_wait(&client, call_ids[slot], NULL, &response) < 0 ||
+        check_response(response, bench->elements, bases[slot]) < 0
+    ) {
+      bench->failed = 1;
+      break;
+    }
+    bench->latencies[done] = now_ns() - started[slot];
+    serlib_rpc_client_release(&client, call_ids[slot]);
+    done++;
+  }
+
+  free(call_ids);
+  free(started);
+  free(bases);
+  serlib_free_buffer(request);
+  serlib_rpc_client_destroy(&client);
+
+  // closing our end stops the server thread
+  shutdown(bench->fd, SHUT_RDWR);
+  close(bench->fd);
+  return NULL;
+};
+
+static int connect_pair(int tcp, int listener, int fds[2]) {
+  if (!tcp) return socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+
+  struct sockaddr_in addr;
+  socklen_t len = sizeof(addr);
+  if (getsockname(listener, (struct sockaddr*)&addr, &len) < 0) return -1;
+
+  fds[0] = socket(AF_INET, SOCK_STREAM, 0);
+  if (fds[0] < 0 || connect(fds[0], (struct sockaddr*)&addr, len) < 0) return -1;
+  fds[1] = accept(listener, NULL, NULL);
+  if (fds[1] < 0) return -1;
+
+  int one = 1;
+  setsockopt(fds[0], IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  setsockopt(fds[1], IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  return 0;
+};
+
+static int compare_ull(const void* a, const void* b) {
+  unsigned long long x = *(const unsigned long long*)a;
+  unsigned long long y = *(const unsigned long long*)b;
+  return (x > y) - (x < y);
+};
+
+static double percentile_us(unsigned long long* sorted, long count, double p) {
+  long index = (long)(p * (count - 1));
+  return sorted[index] / 1e3;
+};
+
+static long context_switches(void) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_nvcsw + usage.ru_nivcsw;
+};
+
+static int run_step(int threads, long requests, int elements, int tcp, int listener, int inflight) {
+  bench_client_t* clients = calloc(threads, sizeof(bench_client_t));
+  bench_server_t* servers = calloc(threads, sizeof(bench_server_t));
+  long per_thread = requests / threads > 0 ? requests / threads : 1;
+  long total = per_thread * threads;
+  unsigned long long* latencies = malloc(total * sizeof(unsigned long long));
+
+  for (int i = 0; i < threads; i++) {
+    int fds[2];
+    if (connect_pair(tcp, listener, fds) < 0) {
+      perror("rpc_loopback: connect");
+      return -1;
+    }
+    clients[i].fd = fds[0];
+    clients[i].requests = per_thread;
+    clients[i].elements = elements;
+    clients[i].inflight = inflight;
+    clients[i].latencies = latencies + i * per_thread;
+    servers[i].fd = fds[1];
+    pthread_create(&servers[i].thread, NULL, serve, &servers[i]);
+  }
+
+  serlib_stats_t before;
+  serlib_stats_snapshot(&before);
+  long switches = context_switches();
+  unsigned long long start = now_ns();
+
+  for (int i = 0; i < threads; i++) {
+    pthread_create(&clients[i].thread, NULL, run_client, &clients[i]);
+  }
+
+  int failed = 0;
+  unsigned long long build_ns = 0;
+  for (int i = 0; i < threads; i++) {
+    pthread_join(clients[i].thread, NULL);
+    failed |= clients[i].failed;
+    build_ns += clients[i].build_ns;
+  }
+
+  double elapsed = (now_ns() - start) / 1e9;
+  switches = context_switches() - switches;
+
+  for (int i = 0; i < threads; i++) {
+    pthread_join(servers[i].thread, NULL);
+  }
+
+  if (failed) {
+    printf("rpc_loopback: %d threads: request failed or response mismatched\n", threads);
+    return -1;
+  }
+
+  serlib_stats_t after;
+  serlib_stats_snapshot(&after);
+  unsigned long long allocations =
+      (after.counters[SERLIB_STAT_BUFFERS_CREATED] - before.counters[SERLIB_STAT_BUFFERS_CREATED])
+    + (after.counters[SERLIB_STAT_REALLOCS] - before.counters[SERLIB_STAT_REALLOCS])
+    + (after.counters[SERLIB_STAT_LIST_NODES] - before.counters[SERLIB_STAT_LIST_NODES]);
+
+  qsort(latencies, total, sizeof(unsigned long long), compare_ull);
+
+  printf("%7d %12.0f %9.1f %9.1f %9.1f %12.0f %9.2f",
+         threads,
+         total / elapsed,
+         percentile_us(latencies, total, 0.50),
+         percentile_us(latencies, total, 0.99),
+         percentile_us(latencies, total, 0.999),
+         (double)build_ns / total,
+         (double)switches / total);
+#ifdef SERLIB_STATS
+  printf(" %10.1f\n", (double)allocations / total);
+#else
+  (void)allocations;
+  printf(" %10s\n", "-");
+#endif
+
+  free(latencies);
+  free(clients);
+  free(servers);
+  return 0;
+};
+
+int main(int argc, char** argv) {
+  int max_threads = argc > 1 ? atoi(argv[1]) : 64;
+  long requests = argc > 2 ? atol(argv[2]) : 100000;
+  int elements = argc > 3 ? atoi(argv[3]) : 16;
+  int tcp = argc > 4 && strcmp(argv[4], "tcp") == 0;
+  int inflight = argc > 5 ? atoi(argv[5]) : 1;
+
+  if (max_threads < 1 || max_threads > 64 || requests < 1 || elements < 0 || inflight < 1) {
+    printf("usage: rpc_loopback [max threads 1-64] [requests per step] [list elements] [unix|tcp] [inflight]\n");
+    return 1;
+  }
+
+  int listener = -1;
+  if (tcp) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+
+    listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (listener < 0 ||
+        bind(listener, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        listen(listener, 64) < 0
+    ) {
+      perror("rpc_loopback: listen");
+      return 1;
+    }
+  }
+
+  printf("rpc_loopback: %ld requests per step, %d elements per list, %s, %d in flight per thread\n",
+         requests, elements, tcp ? "tcp" : "unix socketpair", inflight);
+  printf("%7s %12s %9s %9s %9s %12s %9s %10s\n",
+         "threads", "req/s", "p50 us", "p99 us", "p999 us", "build ns/req", "csw/req", "allocs/req");
+
+  // double the thread count each step to find scalability cliffs
+  int rc = 0;
+  for (int threads = 1; threads <= max_threads && rc == 0; threads *= 2) {
+    rc = run_step(threads, requests, elements, tcp, listener, inflight);
+  }
+
+  if (listener >= 0) close(listener);
+  return rc ? 1 : 0;
+};
@@ -3,7 +3,33 @@
 
 #define SERIALIZE_BUFFER_DEFAULT_SIZE 100
 
+#define SERLIB_CBUFF_SEGMENTS 32
+
+#define SERLIB_BUFF_AUTO_SHRINK 0x1
+#define SERLIB_BUFF_FIXED       0x2
+#define SERLIB_BUFF_OVERFLOW    0x4
+#define SERLIB_BUFF_LOCKED      0x8
+#define SERLIB_BUFF_NUMA        0x10
+#define SERLIB_SHRINK_WINDOW    64
+#define SERLIB_SHRINK_RATIO     4
+
+#define SERLIB_FIXED_PREFAULT   0x1
+#define SERLIB_FIXED_MLOCK      0x2
+
+#define SERLIB_OK               0
+#define SERLIB_ERR_OVERFLOW     -1
+#define SERLIB_ERR_MLOCK        -2
+
+#define SERLIB_LIST_INDEX_MAGIC  0x58444e49
+#define SERLIB_LIST_INDEX_STRIDE 64
+
+#define SERLIB_LIST_NODE_CACHE 64
+
+#define SERLIB_LIST_IMAGE_MAGIC   0x474d494c
+#define SERLIB_LIST_IMAGE_VERSION 1
+
 #include <ctype.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <time.h>
 
@@ -11,11 +37,48 @@ typedef struct _ser_buff_t {
   char* buffer;
   int size;
   int next;
+  int flags;
+  int high_water;
+  int window_peak;
+  int window_resets;
+  int node;
 } ser_buff_t;
 
+typedef struct _ser_cbuff_segment_t {
+  _Atomic(char*) buffer;
+  long long head_skip;
+  long long used_end;
+} ser_cbuff_segment_t;
+
+typedef struct _ser_cbuff_t {
+  _Alignas(64) _Atomic long long reserved;
+  _Alignas(64) _Atomic long long committed;
+  _Alignas(64) int base_size;
+  ser_cbuff_segment_t segments[SERLIB_CBUFF_SEGMENTS];
+} ser_cbuff_t;
+
+typedef struct _ser_frozen_t {
+  _Atomic int refs;
+  int size;
+  int capacity;
+  int flags;
+  char* buffer;
+} ser_frozen_t;
+
+typedef struct _ser_slice_t {
+  ser_frozen_t* frozen;
+  char* data;
+  int size;
+} ser_slice_t;
+
 typedef struct _list_node_t {
   void* data;
   struct _list_node_t* next;
+  struct _list_node_t* prev;
+  char* encoding;
+  int encoding_size;
+  bool dirty;
+  short numa_node;
 } list_node_t;
 
 typedef struct _list_t {
@@ -24,6 +87,12 @@ typedef struct _list_t {
   list_node_t* head;
   list_node_t* tail;
   void (*freeFn) (void*);
+  long long bytes;
+  long long high_water;
+  list_node_t* free_nodes;
+  int free_count;
+  int max_free_nodes;
+  int numa_node;
 } list_t;
 
 typedef struct _ser_header_t {
@@ -33,6 +102,43 @@ typedef struct _ser_header_t {
   unsigned int payload_size;
 } ser_header_t;
 
+typedef struct _serlib_list_reader_t {
+  char* base;
+  int list_size;
+  unsigned int count;
+  unsigned int stride;
+  unsigned char* deltas;
+  int deltas_size;
+  unsigned char* checkpoints;
+} serlib_list_reader_t;
+
+/*
+ * Header of a list image. base is the address the node and data links
+ * are currently relative to: 0 while they are offsets from the header,
+ * the header's own address once they have been fixed up into pointers.
+ */
+typedef struct _serlib_list_image_t {
+  unsigned int magic;
+  unsigned int version;
+  unsigned int node_size;
+  unsigned int count;
+  int elem_size;
+  unsigned int data_stride;
+  unsigned long long image_size;
+  unsigned long long base;
+} serlib_list_image_t;
+
+typedef struct _serlib_list_chunker_t {
+  list_t* list;
+  list_node_t* node;
+  int index;
+  ser_buff_t* scratch;
+  int scratch_pos;
+  bool sentinel_done;
+  bool finished;
+  void (*serialize_fn_ptr)(void*, ser_buff_t*);
+} serlib_list_chunker_t;
+
 typedef struct _client_param_t {
   unsigned int recv_buff_size;
   ser_buff_t*  recv_ser_b;
@@ -78,6 +184,32 @@ unsigned int serlib_header_get_size(void);
  */
 ser_header_t* serlib_header_init(int tid, int rpc_proc_id, int rpc_call_id, int payload_size);
 
+/*
+ * ------------------------------------------------------
+ * function: serlib_serialize_header_t
+ * ------------------------------------------------------
+ * params  :
+ *         > b      - ser_buff_t*
+ *         > header - ser_header_t*
+ * ------------------------------------------------------
+ * Serializes a header (serlib_header_get_size bytes).
+ * ------------------------------------------------------
+ */
+void serlib_serialize_header_t(ser_buff_t* b, ser_header_t* header);
+
+/*
+ * ------------------------------------------------------
+ * function: serlib_deserialize_header_t
+ * ------------------------------------------------------
+ * params  :
+ *         > b      - ser_buff_t*
+ *         > header - ser_header_t*
+ * ------------------------------------------------------
+ * Deserializes a header.
+ * ------------------------------------------------------
+ */
+void serlib_deserialize_header_t(ser_buff_t* b, ser_header_t* header);
+
 /*
  * --------------------------------------------------------------------
  * function: serlib_buffer_skip
@@ -92,6 +224,51 @@ ser_header_t* serlib_header_init(int tid, int rpc_proc_id, int rpc_call_id, int
  */
 void serlib_buffer_skip(ser_buff_t* b, int skip_size);
 
+/*
+ * --------------------------------------------------------------------
+ * function: serlib_buffer_init_fixed
+ * --------------------------------------------------------------------
+ * params  :
+ *         > b       - ser_buff_t*
+ *         > memory  - char*
+ *         > size    - int
+ *         > options - int (SERLIB_FIXED_PREFAULT | SERLIB_FIXED_MLOCK)
+ * --------------------------------------------------------------------
+ * Initializes a fixed-capacity buffer over caller-provided memory.
+ * A fixed buffer never allocates: a write that does not fit fails
+ * with SERLIB_ERR_OVERFLOW and marks the buffer overflowed instead of
+ * growing it. PREFAULT touches every page up front, MLOCK locks them
+ * in RAM. Returns SERLIB_OK, or SERLIB_ERR_MLOCK if locking failed
+ * (the buffer is still usable). Never pass b to serlib_free_buffer.
+ * --------------------------------------------------------------------
+ */
+int serlib_buffer_init_fixed(ser_buff_t* b, char* memory, int size, int options);
+
+/*
+ * --------------------------------------------------------------------
+ * function: serlib_buffer_release_fixed
+ * --------------------------------------------------------------------
+ * params  : b - ser_buff_t*
+ * --------------------------------------------------------------------
+ * Unlocks a fixed buffer's memory if it was locked. The memory itself
+ * stays owned by the caller.
+ * --------------------------------------------------------------------
+ */
+void serlib_buffer_release_fixed(ser_buff_t* b);
+
+/*
+ * --------------------------------------------------------------------
+ * function: serlib_buffer_error
+ * --------------------------------------------------------------------
+ * params  : b - ser_buff_t*
+ * --------------------------------------------------------------------
+ * Returns SERLIB_ERR_OVERFLOW if a write to a fixed buffer has failed
+ * since its last reset, else SERLIB_OK. Lets composite serializers
+ * check once after writing a whole message.
+ * --------------------------------------------------------------------
+ */
+int serlib_buffer_error(ser_buff_t* b);
+
 /*
  * ---------------------------------------------------
  * function: serlib_reset_buffer
@@ -99,10 +276,70 @@ void serlib_buffer_skip(ser_buff_t* b, int skip_size);
  * params  : b - ser_buff_t*
  * ---------------------------------------------------
  * Resets a buffer. (Sets ->next to 0)
+ * Clears a fixed buffer's overflow error.
+ * With auto shrink on, every SERLIB_SHRINK_WINDOW
+ * resets also applies serlib_buffer_shrink.
  * ---------------------------------------------------
  */
 void serlib_reset_buffer(ser_buff_t* b);
 
+/*
+ * --------------------------------------------------------------------
+ * function: serlib_buffer_high_water
+ * --------------------------------------------------------------------
+ * params  : b - ser_buff_t*
+ * --------------------------------------------------------------------
+ * Returns the most bytes ever serialized into the buffer.
+ * --------------------------------------------------------------------
+ */
+int serlib_buffer_high_water(ser_buff_t* b);
+
+/*
+ * --------------------------------------------------------------------
+ * function: serlib_buffer_set_auto_shrink
+ * --------------------------------------------------------------------
+ * params  :
+ *         > b      - ser_buff_t*
+ *         > enable - bool
+ * --------------------------------------------------------------------
+ * Turns adaptive shrinking on or off for a long-lived heap buffer.
+ * Never enable it on views over memory the buffer does not own.
+ * --------------------------------------------------------------------
+ */
+void serlib_buffer_set_auto_shrink(ser_buff_t* b, bool enable);
+
+/*
+ * --------------------------------------------------------------------
+ * function: serlib_buffer_shrink
+ * --------------------------------------------------------------------
+ * params  : b - ser_buff_t*
+ * --------------------------------------------------------------------
+ * If the peak usage since the last shrink is at most 1/SERLIB_SHRINK_RATIO
+ * of the capacity, reallocs the buffer down to the smallest doubling of
+ * SERIALIZE_BUFFER_DEFAULT_SIZE holding twice that peak, then starts a
+ * new window. Returns the number of bytes released.
+ * --------------------------------------------------------------------
+ */
+int serlib_buffer_shrink(ser_buff_t* b);
+
+/*
+ * --------------------------------------------------------------------
+ * function: serlib_buffer_set_numa_node
+ * --------------------------------------------------------------------
+ * params  :
+ *         > b    - ser_buff_t*
+ *         > node - int (-1 to go back to the heap)
+ * --------------------------------------------------------------------
+ * Binds a buffer to a NUMA node, usually the node of the thread that
+ * will deserialize it (serlib_numa_current_node on that thread). Its
+ * contents move into the node's pool, and every later growth or
+ * shrink allocates from that pool too, so pages stay on the node
+ * whichever thread writes them. Returns 0 on success, -1 for a fixed
+ * buffer or a node out of range.
+ * --------------------------------------------------------------------
+ */
+int serlib_buffer_set_numa_node(ser_buff_t* b, int node);
+
 /*
  * ----------------------------------------------------
  * function: serlib_get_buffer_length
@@ -147,6 +384,135 @@ void serlib_copy_in_buffer_by_offset(ser_buff_t* client_send_ser_buffer, int siz
  */
 void serlib_free_buffer(ser_buff_t* b);
 
+/*
+ * --------------------------------------------------------------------
+ * function: serlib_buffer_freeze
+ * --------------------------------------------------------------------
+ * params  : b - ser_buff_t*
+ * --------------------------------------------------------------------
+ * Turns a finished buffer into an immutable, reference counted frozen
+ * buffer holding its first b->next bytes. The bytes are not copied:
+ * the frozen buffer takes over b->buffer and b itself is freed.
+ * The caller owns the single initial reference. b must come from
+ * serlib_init_buffer*; a SERLIB_BUFF_FIXED view can't be frozen.
+ * --------------------------------------------------------------------
+ */
+ser_frozen_t* serlib_buffer_freeze(ser_buff_t* b);
+
+/*
+ * --------------------------------------------------------------------
+ * function: serlib_frozen_retain
+ * --------------------------------------------------------------------
+ * params  : frozen - ser_frozen_t*
+ * --------------------------------------------------------------------
+ * Takes a reference on a frozen buffer. Safe across threads.
+ * --------------------------------------------------------------------
+ */
+void serlib_frozen_retain(ser_frozen_t* frozen);
+
+/*
+ * --------------------------------------------------------------------
+ * function: serlib_frozen_release
+ * --------------------------------------------------------------------
+ * params  : frozen - ser_frozen_t*
+ * --------------------------------------------------------------------
+ * Drops a reference on a frozen buffer, freeing it with the last one.
+ * --------------------------------------------------------------------
+ */
+void serlib_frozen_release(ser_frozen_t* frozen);
+
+/*
+ * --------------------------------------------------------------------
+ * function: serlib_slice_new
+ * --------------------------------------------------------------------
+ * params  :
+ *         > slice  - ser_slice_t*
+ *         > frozen - ser_frozen_t*
+ *         > offset - int
+ *         > size   - int
+ * --------------------------------------------------------------------
+ * Creates a slice over [offset, offset + size) of a frozen buffer,
+ * taking a reference on it. Returns 0 on success, -1 if the range is
+ * out of bounds.
+ * --------------------------------------------------------------------
+ */
+int serlib_slice_new(ser_slice_t* slice, ser_frozen_t* frozen, int offset, int size);
+
+/*
+ * --------------------------------------------------------------------
+ * function: serlib_slice_sub
+ * --------------------------------------------------------------------
+ * params  :
+ *         > slice  - ser_slice_t*
+ *         > parent - ser_slice_t*
+ *         > offset - int
+ *         > size   - int
+ * --------------------------------------------------------------------
+ * Creates a slice over [offset, offset + size) of another slice,
+ * sharing its storage. Returns 0 on success, -1 if out of bounds.
+ * --------------------------------------------------------------------
+ */
+int serlib_slice_sub(ser_slice_t* slice, ser_slice_t* parent, int offset, int size);
+
+/*
+ * --------------------------------------------------------------------
+ * function: serlib_slice_frame
+ * --------------------------------------------------------------------
+ * params  :
+ *         > frozen  - ser_frozen_t*
+ *         > offset  - int
+ *         > header  - ser_slice_t*
+ *         > payload - ser_slice_t*
+ * --------------------------------------------------------------------
+ * Slices the serialized ser_header_t at offset and the payload that
+ * follows it (payload_size bytes). Returns 0 on success, -1 if the
+ * frame does not fit in the frozen buffer.
+ * --------------------------------------------------------------------
+ */
+int serlib_slice_frame(ser_frozen_t* frozen, int offset, ser_slice_t* header, ser_slice_t* payload);
+
+/*
+ * --------------------------------------------------------------------
+ * function: serlib_slice_release
+ * --------------------------------------------------------------------
+ * params  : slice - ser_slice_t*
+ * --------------------------------------------------------------------
+ * Drops a slice's reference on its frozen buffer.
+ * --------------------------------------------------------------------
+ */
+void serlib_slice_release(ser_slice_t* slice);
+
+/*
+ * --------------------------------------------------------------------
+ * function: serlib_slice_as_buffer
+ * --------------------------------------------------------------------
+ * params  :
+ *         > slice - ser_slice_t*
+ *         > view  - ser_buff_t*
+ * --------------------------------------------------------------------
+ * Fills view with a read-only buffer over the slice for use with the
+ * deserialize functions. view must not be written to or freed.
+ * --------------------------------------------------------------------
+ */
+void serlib_slice_as_buffer(ser_slice_t* slice, ser_buff_t* view);
+
+/*
+ * ------------------------------------------------------------------------
+ * function: serlib_buffer_reserve
+ * ------------------------------------------------------------------------
+ * params  :
+ *         > b      - ser_buff_t*
+ *         > nbytes - int
+ * ------------------------------------------------------------------------
+ * Makes room for nbytes past b->next without writing them, e.g. before
+ * receiving straight into b->buffer. Heap buffers are grown with
+ * realloc and NUMA-bound ones within their node's pool. Returns
+ * SERLIB_OK, or SERLIB_ERR_OVERFLOW if b is a fixed buffer without room
+ * (it is marked overflowed) or b->next + nbytes would not fit in an int.
+ * ------------------------------------------------------------------------
+ */
+int serlib_buffer_reserve(ser_buff_t* b, int nbytes);
+
 /*
  * ------------------------------------------------------------------------
  * function: serlib_serialize_data
@@ -157,9 +523,95 @@ void serlib_free_buffer(ser_buff_t* b);
  *           > nbytes - int
  * ------------------------------------------------------------------------
  * Serializes string data to a given valid serialized string buffer.
+ * Returns SERLIB_OK, or SERLIB_ERR_OVERFLOW if b is a fixed buffer
+ * without room for nbytes (nothing is written).
  * ------------------------------------------------------------------------
  */
-void serlib_serialize_data(ser_buff_t* b, char* data, int nbytes);
+int serlib_serialize_data(ser_buff_t* b, char* data, int nbytes);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_cbuff_init
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > cb        - ser_cbuff_t*
+ *         > base_size - int
+ * ----------------------------------------------------------------------
+ * Initializes a concurrent append buffer. Storage is a fixed table of
+ * segments, segment i holding base_size * 2^i bytes, allocated on first
+ * use, so reservations never move already written bytes.
+ * ----------------------------------------------------------------------
+ */
+void serlib_cbuff_init(ser_cbuff_t* cb, int base_size);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_cbuff_reserve
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > cb     - ser_cbuff_t*
+ *         > nbytes - int
+ * ----------------------------------------------------------------------
+ * Reserves nbytes of contiguous space with an atomic fetch-add and
+ * returns a pointer to it. The writer fills it without locks and then
+ * publishes it with serlib_cbuff_commit. Safe from any number of
+ * threads.
+ * ----------------------------------------------------------------------
+ */
+char* serlib_cbuff_reserve(ser_cbuff_t* cb, int nbytes);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_cbuff_commit
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > cb     - ser_cbuff_t*
+ *         > nbytes - int
+ * ----------------------------------------------------------------------
+ * Publishes a completed reservation of nbytes.
+ * ----------------------------------------------------------------------
+ */
+void serlib_cbuff_commit(ser_cbuff_t* cb, int nbytes);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_cbuff_append
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > cb     - ser_cbuff_t*
+ *         > data   - char*
+ *         > nbytes - int
+ * ----------------------------------------------------------------------
+ * Reserves, copies and commits nbytes of data.
+ * ----------------------------------------------------------------------
+ */
+void serlib_cbuff_append(ser_cbuff_t* cb, char* data, int nbytes);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_cbuff_finish
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > cb - ser_cbuff_t*
+ *         > b  - ser_buff_t*
+ * ----------------------------------------------------------------------
+ * Waits for all outstanding reservations to be committed, serializes
+ * the appended records into b in reservation order and resets cb for
+ * the next batch. No writer may reserve while this runs.
+ * ----------------------------------------------------------------------
+ */
+void serlib_cbuff_finish(ser_cbuff_t* cb, ser_buff_t* b);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_cbuff_free
+ * ----------------------------------------------------------------------
+ * params  : cb - ser_cbuff_t*
+ * ----------------------------------------------------------------------
+ * Frees a concurrent append buffer's segments.
+ * ----------------------------------------------------------------------
+ */
+void serlib_cbuff_free(ser_cbuff_t* cb);
 
 /*
  * ----------------------------------------------------------------------
@@ -170,10 +622,11 @@ void serlib_serialize_data(ser_buff_t* b, char* data, int nbytes);
  *         > data   - int*
  *         > nbytes - int
  * ----------------------------------------------------------------------
- * Deserializes a buffers' string buffer for an integer.
+ * Serializes nbytes of integer data. Returns SERLIB_OK, or
+ * SERLIB_ERR_OVERFLOW if b is a full fixed buffer.
  * ----------------------------------------------------------------------
  */
-void serlib_serialize_data_int_ptr(ser_buff_t* b, int* data, int nbytes);
+int serlib_serialize_data_int_ptr(ser_buff_t* b, int* data, int nbytes);
 
 /*
  * ----------------------------------------------------------------------
@@ -209,10 +662,11 @@ void serlib_deserialize_data_int_ptr(ser_buff_t* b, int* dest, int size);
  * ----------------------------------------------------------------------
  * params  : b - ser_buff_t*
  * ----------------------------------------------------------------------
- * Serializes a buffers' employee_t buffer.
+ * Serializes a time_t. Returns SERLIB_OK, or SERLIB_ERR_OVERFLOW if
+ * b is a full fixed buffer.
  * ----------------------------------------------------------------------
  */
-void serlib_serialize_time_t(ser_buff_t* b, time_t* data, int size);
+int serlib_serialize_time_t(ser_buff_t* b, time_t* data, int size);
 
 /*
  * ----------------------------------------------------------------------
@@ -252,6 +706,86 @@ void serlib_serialize_list_t(list_t* list,
                              ser_buff_t* b,
                              void (* serialize_fn_ptr)(void *, ser_buff_t*));
 
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_serialize_list_t_cached
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > list             - list_t*
+ *         > b                - ser_buff_t*
+ *         > serialize_fn_ptr - function pointer to function (void*, ser_buff_t*)
+ * ----------------------------------------------------------------------
+ * Serializes a list in the same format as serlib_serialize_list_t, but
+ * keeps each node's encoded bytes. Nodes that were not appended,
+ * prepended, updated or marked dirty since the last cached serialize are
+ * copied from their cached encoding without calling serialize_fn_ptr.
+ * Returns SERLIB_OK, or SERLIB_ERR_OVERFLOW if b is a fixed buffer that
+ * ran out of room; the node being encoded then stays dirty and keeps
+ * its previous encoding, and b is left overflowed.
+ * ----------------------------------------------------------------------
+ */
+int serlib_serialize_list_t_cached(list_t* list,
+                                   ser_buff_t* b,
+                                   void (*serialize_fn_ptr)(void*, ser_buff_t*));
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_chunker_init
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > chunker          - serlib_list_chunker_t*
+ *         > list             - list_t*
+ *         > serialize_fn_ptr - function pointer to function (void*, ser_buff_t*)
+ * ----------------------------------------------------------------------
+ * Prepares a resumable serializer that writes a list in the same format
+ * as serlib_serialize_list_t, one fixed-size chunk at a time. The list
+ * must not be modified until the chunker is finished.
+ * ----------------------------------------------------------------------
+ */
+void serlib_list_chunker_init(serlib_list_chunker_t* chunker,
+                              list_t* list,
+                              void (*serialize_fn_ptr)(void*, ser_buff_t*));
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_serialize_list_chunk
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > chunker  - serlib_list_chunker_t*
+ *         > out      - char*
+ *         > out_size - int
+ * ----------------------------------------------------------------------
+ * Fills out with up to out_size bytes of the serialized list, resuming
+ * at the exact node and byte where the previous call stopped. Every
+ * chunk but the last is full, and peak memory is one chunk plus the
+ * largest single element. Returns the bytes written; 0 once the
+ * whole list, sentinel included, has been emitted.
+ * ----------------------------------------------------------------------
+ */
+int serlib_serialize_list_chunk(serlib_list_chunker_t* chunker, char* out, int out_size);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_chunker_done
+ * ----------------------------------------------------------------------
+ * params  : chunker - serlib_list_chunker_t*
+ * ----------------------------------------------------------------------
+ * Returns true once every byte of the list has been emitted.
+ * ----------------------------------------------------------------------
+ */
+bool serlib_list_chunker_done(serlib_list_chunker_t* chunker);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_chunker_free
+ * ----------------------------------------------------------------------
+ * params  : chunker - serlib_list_chunker_t*
+ * ----------------------------------------------------------------------
+ * Frees a chunker's element scratch buffer.
+ * ----------------------------------------------------------------------
+ */
+void serlib_list_chunker_free(serlib_list_chunker_t* chunker);
+
 /*
  * ----------------------------------------------------------------------
  * function: serlib_serialize_list_node_t
@@ -263,17 +797,223 @@ void serlib_serialize_list_t(list_t* list,
  */
 void serlib_serialize_list_node_t(list_node_t* list_node, ser_buff_t* b, void (*serialize_fn_ptr)(void*, ser_buff_t*));
 
+/*
+ * ------------------------------------------------------------------------------
+ * function: serlib_deserialize_list_t
+ * ------------------------------------------------------------------------------
+ * params  :
+ *         > b                  - ser_buff_t*
+ *         > elem_size          - int
+ *         > deserialize_fn_ptr - function pointer to function (void*, ser_buff_t*)
+ * ------------------------------------------------------------------------------
+ * Deserializes a list written by serlib_serialize_list_t into a new heap
+ * allocated list, reading elements until the sentinel.
+ * ------------------------------------------------------------------------------
+ */
+list_t* serlib_deserialize_list_t(ser_buff_t* b, int elem_size, void (*deserialize_fn_ptr)(void*, ser_buff_t*));
+
 /*
  * ----------------------------------------------------------------------
  * function: serlib_deserialize_list_node_t
  * ----------------------------------------------------------------------
  * params  : b - ser_buff_t*
  * ----------------------------------------------------------------------
- * Deserializes a employee list node.
+ * Deserializes elements into an existing run of nodes, stopping at the
+ * sentinel or the last node.
  * ----------------------------------------------------------------------
  */
 void serlib_deserialize_list_node_t(list_node_t* list_node, ser_buff_t* b, void (*deserialize_fn_ptr)(void*, ser_buff_t*));
 
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_serialize_list_t_indexed
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > list             - list_t*
+ *         > b                - ser_buff_t*
+ *         > serialize_fn_ptr - function pointer to function (void*, ser_buff_t*)
+ * ----------------------------------------------------------------------
+ * Serializes a list like serlib_serialize_list_t, followed by a footer
+ * holding the delta-compressed offset of every element, so the list can
+ * be read back at random through a serlib_list_reader_t.
+ *
+ * Footer layout (after the list sentinel):
+ *   uint32 footer size | varint offset deltas | uint32 checkpoint pairs
+ *   (offset, delta position) every SERLIB_LIST_INDEX_STRIDE elements |
+ *   uint32 count | uint32 stride | uint32 list size | uint32 deltas size |
+ *   uint32 magic
+ * ----------------------------------------------------------------------
+ */
+void serlib_serialize_list_t_indexed(list_t* list,
+                                     ser_buff_t* b,
+                                     void (*serialize_fn_ptr)(void*, ser_buff_t*));
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_index_skip
+ * ----------------------------------------------------------------------
+ * params  : b - ser_buff_t*
+ * ----------------------------------------------------------------------
+ * Skips the index footer of an indexed list. Call after the list itself
+ * has been deserialized (b->next sits right after the sentinel).
+ * ----------------------------------------------------------------------
+ */
+void serlib_list_index_skip(ser_buff_t* b);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_reader_open
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > reader - serlib_list_reader_t*
+ *         > data   - char*
+ *         > size   - int
+ * ----------------------------------------------------------------------
+ * Opens a lazy reader over an indexed list. data + size must end exactly
+ * at the footer trailer (e.g. an mmapped snapshot). Nothing is copied or
+ * decoded beyond the checkpoints, each of which must point inside the
+ * list and the delta stream. Returns 0 on success, -1 if no valid index
+ * is found.
+ * ----------------------------------------------------------------------
+ */
+int serlib_list_reader_open(serlib_list_reader_t* reader, char* data, int size);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_reader_get_count
+ * ----------------------------------------------------------------------
+ * params  : reader - serlib_list_reader_t*
+ * ----------------------------------------------------------------------
+ * Returns the number of elements in an indexed list.
+ * ----------------------------------------------------------------------
+ */
+unsigned int serlib_list_reader_get_count(serlib_list_reader_t* reader);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_reader_element
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > reader - serlib_list_reader_t*
+ *         > index  - unsigned int
+ *         > len    - int* (may be NULL)
+ * ----------------------------------------------------------------------
+ * Returns a pointer to the encoded bytes of element index, and its
+ * encoded length through len. Returns NULL if index is out of range or
+ * the deltas leading to it are truncated or point past the sentinel.
+ * ----------------------------------------------------------------------
+ */
+char* serlib_list_reader_element(serlib_list_reader_t* reader, unsigned int index, int* len);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_reader_get
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > reader             - serlib_list_reader_t*
+ *         > index              - unsigned int
+ *         > deserialize_fn_ptr - function pointer to function (void*, ser_buff_t*)
+ *         > dest               - void*
+ * ----------------------------------------------------------------------
+ * Decodes only element index into dest. Returns 0 on success, -1 if
+ * index is out of range or its offset is corrupt.
+ * ----------------------------------------------------------------------
+ */
+int serlib_list_reader_get(serlib_list_reader_t* reader,
+                           unsigned int index,
+                           void (*deserialize_fn_ptr)(void*, ser_buff_t*),
+                           void* dest);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_reader_get_range
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > reader             - serlib_list_reader_t*
+ *         > first              - unsigned int
+ *         > count              - unsigned int
+ *         > deserialize_fn_ptr - function pointer to function (void*, ser_buff_t*)
+ *         > dest               - void* (array of count elements)
+ *         > elem_size          - int
+ * ----------------------------------------------------------------------
+ * Decodes elements [first, first + count) into consecutive slots of
+ * dest. Returns the number of elements decoded, which stops short at
+ * the first corrupt delta, or -1 if the offset of first is corrupt.
+ * ----------------------------------------------------------------------
+ */
+int serlib_list_reader_get_range(serlib_list_reader_t* reader,
+                                 unsigned int first,
+                                 unsigned int count,
+                                 void (*deserialize_fn_ptr)(void*, ser_buff_t*),
+                                 void* dest,
+                                 int elem_size);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_image_size
+ * ----------------------------------------------------------------------
+ * params  : list - list_t*
+ * ----------------------------------------------------------------------
+ * Returns the number of bytes serlib_serialize_list_image writes for a
+ * list, not counting alignment padding, or -1 if it would not fit in an
+ * int.
+ * ----------------------------------------------------------------------
+ */
+int serlib_list_image_size(list_t* list);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_serialize_list_image
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > list - list_t*
+ *         > b    - ser_buff_t*
+ * ----------------------------------------------------------------------
+ * Writes a list as a relocatable image: b->next is first padded to a
+ * multiple of 8, then the header, a list_t, one list_node_t per element
+ * in list order and the elements' bytes, each slot rounded up to 8, are
+ * laid out as serlib_list_image_open will use them. head, tail and every
+ * node's next, prev and data hold offsets from the header, 0 for NULL.
+ * Elements are copied raw, elem_size bytes each, so they must not hold
+ * pointers. Returns SERLIB_OK, or SERLIB_ERR_OVERFLOW if a fixed buffer
+ * can't take the whole image (nothing is written).
+ *
+ * Image layout (8-byte aligned):
+ *   serlib_list_image_t | list_t | count * list_node_t |
+ *   count * data_stride element bytes
+ *
+ * The image is tied to the ABI that wrote it (pointer size, byte order
+ * and struct layout); node_size is checked on open.
+ * ----------------------------------------------------------------------
+ */
+int serlib_serialize_list_image(list_t* list, ser_buff_t* b);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_image_open
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > data - char* (8-byte aligned, writable image)
+ *         > size - int
+ * ----------------------------------------------------------------------
+ * Turns an image into a live list in place: one pass over the nodes
+ * rewrites each link into a pointer into data, checking that it stays
+ * in the image and that the nodes are in list order, and nothing is
+ * allocated or copied. An image already fixed up at this address is
+ * checked the same way; one that was fixed up elsewhere (e.g. copied,
+ * or mapped at another address) is relocated. Every other pointer the
+ * image stores (freeFn, node caches) is cleared. The element bytes are never
+ * written, so an mmapped image only dirties its node pages (map it
+ * MAP_PRIVATE to leave the file alone).
+ *
+ * The returned list lives inside data and is read-only: walk it with
+ * serlib_list_iterate or its head / next links, but don't append, pop
+ * or destroy it. Returns NULL if the image is malformed, in which case
+ * part of it may already have been rewritten.
+ * ----------------------------------------------------------------------
+ */
+list_t* serlib_list_image_open(char* data, int size);
+
 /*
  * ------------------------------------------------------
  * function: serlib_list_new
@@ -337,6 +1077,183 @@ void serlib_list_prepend(list_t* list, void* element);
  */
 void serlib_list_append(list_t* list, void* element);
 
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_push_head_node
+ * ------------------------------------------------------
+ * params  :
+ *         > list - list_t*
+ *         > node - list_node_t*
+ * ------------------------------------------------------
+ * Links a detached node in at the head of a list.
+ * ------------------------------------------------------
+ */
+void serlib_list_push_head_node(list_t* list, list_node_t* node);
+
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_push_tail_node
+ * ------------------------------------------------------
+ * params  :
+ *         > list - list_t*
+ *         > node - list_node_t*
+ * ------------------------------------------------------
+ * Links a detached node in at the tail of a list.
+ * ------------------------------------------------------
+ */
+void serlib_list_push_tail_node(list_t* list, list_node_t* node);
+
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_pop_head_node
+ * ------------------------------------------------------
+ * params  : list - list_t*
+ * ------------------------------------------------------
+ * Unlinks and returns the head node, or NULL if the
+ * list is empty.
+ * ------------------------------------------------------
+ */
+list_node_t* serlib_list_pop_head_node(list_t* list);
+
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_pop_tail_node
+ * ------------------------------------------------------
+ * params  : list - list_t*
+ * ------------------------------------------------------
+ * Unlinks and returns the tail node, or NULL if the
+ * list is empty.
+ * ------------------------------------------------------
+ */
+list_node_t* serlib_list_pop_tail_node(list_t* list);
+
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_release_node
+ * ------------------------------------------------------
+ * params  :
+ *         > list - list_t*
+ *         > node - list_node_t*
+ * ------------------------------------------------------
+ * Returns a popped node to the list's node cache, or
+ * frees it once the cache is full.
+ * ------------------------------------------------------
+ */
+void serlib_list_release_node(list_t* list, list_node_t* node);
+
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_set_node_cache
+ * ------------------------------------------------------
+ * params  :
+ *         > list      - list_t*
+ *         > max_nodes - int
+ * ------------------------------------------------------
+ * Sets how many removed nodes a list keeps for reuse,
+ * freeing any cached nodes beyond the new limit.
+ * ------------------------------------------------------
+ */
+void serlib_list_set_node_cache(list_t* list, int max_nodes);
+
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_set_numa_node
+ * ------------------------------------------------------
+ * params  :
+ *         > list - list_t*
+ *         > node - int (-1 to go back to the heap)
+ * ------------------------------------------------------
+ * Makes a list allocate new nodes from a NUMA node's
+ * pool. Nodes it already holds stay where they are;
+ * cached nodes from elsewhere are freed. Returns 0 on
+ * success, -1 for a node out of range.
+ * ------------------------------------------------------
+ */
+int serlib_list_set_numa_node(list_t* list, int node);
+
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_pop_head
+ * ------------------------------------------------------
+ * params  :
+ *         > list    - list_t*
+ *         > element - void*
+ * ------------------------------------------------------
+ * Removes the head node, copying its data to element.
+ * Returns false if the list is empty.
+ * ------------------------------------------------------
+ */
+bool serlib_list_pop_head(list_t* list, void* element);
+
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_pop_tail
+ * ------------------------------------------------------
+ * params  :
+ *         > list    - list_t*
+ *         > element - void*
+ * ------------------------------------------------------
+ * Removes the tail node, copying its data to element.
+ * Returns false if the list is empty.
+ * ------------------------------------------------------
+ */
+bool serlib_list_pop_tail(list_t* list, void* element);
+
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_move_node
+ * ------------------------------------------------------
+ * params  :
+ *         > dest - list_t*
+ *         > src  - list_t*
+ *         > node - list_node_t*
+ * ------------------------------------------------------
+ * Moves a node popped from src to the tail of dest
+ * without copying its data.
+ * ------------------------------------------------------
+ */
+void serlib_list_move_node(list_t* dest, list_t* src, list_node_t* node);
+
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_splice
+ * ------------------------------------------------------
+ * params  :
+ *         > dest - list_t*
+ *         > src  - list_t*
+ * ------------------------------------------------------
+ * Moves every node of src to the tail of dest in O(1),
+ * leaving src empty. src keeps its node cache.
+ * ------------------------------------------------------
+ */
+void serlib_list_splice(list_t* dest, list_t* src);
+
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_update
+ * ------------------------------------------------------
+ * params  :
+ *         > list    - list_t*
+ *         > node    - list_node_t*
+ *         > element - void*
+ * ------------------------------------------------------
+ * Replaces a node's data and marks it dirty.
+ * ------------------------------------------------------
+ */
+void serlib_list_update(list_t* list, list_node_t* node, void* element);
+
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_mark_dirty
+ * ------------------------------------------------------
+ * params  : node - list_node_t*
+ * ------------------------------------------------------
+ * Marks a node modified in place so its cached encoding
+ * is rebuilt on the next cached serialize.
+ * ------------------------------------------------------
+ */
+void serlib_list_mark_dirty(list_node_t* node);
+
 /*
  * ------------------------------------------------------
  * function: serlib_list_get_size
@@ -348,6 +1265,29 @@ void serlib_list_append(list_t* list, void* element);
  */
 int serlib_list_get_size(list_t* list);
 
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_get_bytes
+ * ------------------------------------------------------
+ * params  : list - list_t*
+ * ------------------------------------------------------
+ * Returns bytes held by a list's nodes, element data and
+ * cached encodings.
+ * ------------------------------------------------------
+ */
+long long serlib_list_get_bytes(list_t* list);
+
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_get_high_water
+ * ------------------------------------------------------
+ * params  : list - list_t*
+ * ------------------------------------------------------
+ * Returns the most bytes the list has ever held.
+ * ------------------------------------------------------
+ */
+long long serlib_list_get_high_water(list_t* list);
+
 /*
  * ------------------------------------------------------
  * function: serlib_list_iterate
@@ -364,22 +1304,29 @@ void serlib_list_iterate(list_t* list, bool (*list_iterator)(void *));
 
 /*
  * ------------------------------------------------------
- *
+ * function: serlib_list_get_head
  * ------------------------------------------------------
- *
+ * params  :
+ *         > list          - list_t*
+ *         > element       - void*
+ *         > should_remove - bool
  * ------------------------------------------------------
- *
+ * Copies the head node's data to element, removing the
+ * node if should_remove. Does nothing on an empty list.
  * ------------------------------------------------------
  */
 void serlib_list_get_head(list_t* list, void* element, bool should_remove);
 
 /*
  * ------------------------------------------------------
- *
+ * function: serlib_list_get_tail
  * ------------------------------------------------------
- *
+ * params  :
+ *         > list    - list_t*
+ *         > element - void*
  * ------------------------------------------------------
- *
+ * Copies the tail node's data to element. Does nothing
+ * on an empty list.
  * ------------------------------------------------------
  */
 void serlib_list_get_tail(list_t* list, void* element);
@@ -0,0 +1,85 @@
+#ifndef __SERLIB_FILTER_H__
+#define __SERLIB_FILTER_H__
+
+#include <stdbool.h>
+
+#include "serc.h"
+
+#define SERLIB_FIELD_INT   0
+#define SERLIB_FIELD_UINT  1
+#define SERLIB_FIELD_BYTES 2
+#define SERLIB_FIELD_VAR   3
+
+#define SERLIB_PRED_EQ     0
+#define SERLIB_PRED_NE     1
+#define SERLIB_PRED_LT     2
+#define SERLIB_PRED_LE     3
+#define SERLIB_PRED_GT     4
+#define SERLIB_PRED_GE     5
+#define SERLIB_PRED_PREFIX 6
+
+#define SERLIB_FILTER_MAX_FIELDS 64
+
+/*
+ * One field of a record as its serialize function writes it, in order.
+ * Integers are in host byte order, as serlib_serialize_data copies them.
+ *   INT / UINT - integer of size 1, 2, 4 or 8 bytes
+ *   BYTES      - size raw bytes (e.g. a fixed char array)
+ *   VAR        - an unsigned length of size 1, 2 or 4 bytes, followed
+ *                by that many bytes
+ */
+typedef struct _serlib_field_t {
+  int type;
+  int size;
+} serlib_field_t;
+
+/*
+ * A comparison of one field against a constant. Integer fields compare
+ * with value; BYTES and VAR fields compare bytes[0, bytes_size) with
+ * EQ, NE or PREFIX.
+ */
+typedef struct _serlib_predicate_t {
+  int field;
+  int op;
+  long long value;
+  char* bytes;
+  int bytes_size;
+} serlib_predicate_t;
+
+/*
+ * A scan over a serialized list: records matching every predicate are
+ * kept, either whole or reduced to the projected fields in the order
+ * given.
+ */
+typedef struct _serlib_list_filter_t {
+  serlib_field_t* fields;
+  int field_count;
+  serlib_predicate_t* predicates;
+  int predicate_count;
+  int* projection;
+  int projection_count;
+} serlib_list_filter_t;
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_filter
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > in     - ser_buff_t* (at the start of a serialized list)
+ *         > filter - serlib_list_filter_t*
+ *         > out    - ser_buff_t* (may be NULL to only count)
+ * ----------------------------------------------------------------------
+ * Scans a list written by serlib_serialize_list_t record by record, on
+ * the encoded bytes, without building any node or element. Matching
+ * records, or just their projected fields when projection_count > 0,
+ * are appended to out as a new serialized list, sentinel included, so
+ * it can be read back with serlib_deserialize_list_t. Runs of adjacent
+ * whole records are copied in one go. in->next is left just past the
+ * sentinel. Returns the number of matching records, or -1 if the list
+ * is truncated or malformed or out overflowed its fixed capacity, in
+ * which case out->next and in->next are left where they were.
+ * ----------------------------------------------------------------------
+ */
+int serlib_list_filter(ser_buff_t* in, serlib_list_filter_t* filter, ser_buff_t* out);
+
+#endif
@@ -0,0 +1,278 @@
+#ifndef __SERLIB_MAP_H__
+#define __SERLIB_MAP_H__
+
+#include <stdbool.h>
+
+#include "serc.h"
+
+#define SERLIB_MAP_MAGIC     0x50414d53
+#define SERLIB_MAP_VERSION   1
+#define SERLIB_MAP_GROUP     16
+#define SERLIB_MAP_MIN_SIZE  16
+
+#define SERLIB_MAP_KEY_BYTES 0
+#define SERLIB_MAP_KEY_INT   1
+
+/*
+ * One slot per table position. Byte-string keys and all values live in
+ * the map's arena and are referenced by offset, integer keys are stored
+ * inline, so a table can be written out and used again from any address
+ * without touching a pointer or rehashing a key.
+ */
+typedef struct _serlib_map_slot_t {
+  union {
+    struct {
+      unsigned int offset;
+      unsigned int size;
+    } bytes;
+    unsigned long long value;
+  } key;
+  unsigned int value_offset;
+  unsigned int value_size;
+} serlib_map_slot_t;
+
+/*
+ * Header of a serialized map image, followed by capacity + GROUP control
+ * bytes (padded to 8), capacity slots and arena_size arena bytes.
+ */
+typedef struct _serlib_map_image_t {
+  unsigned int magic;
+  unsigned int version;
+  unsigned int key_type;
+  unsigned int capacity;
+  unsigned int count;
+  unsigned int deleted;
+  unsigned int arena_size;
+  unsigned int garbage;
+} serlib_map_image_t;
+
+typedef struct _serlib_map_t {
+  int key_type;
+  unsigned int capacity;
+  unsigned int count;
+  unsigned int deleted;
+  unsigned char* ctrl;
+  serlib_map_slot_t* slots;
+  char* arena;
+  unsigned int arena_size;
+  unsigned int arena_capacity;
+  unsigned int garbage;
+  bool read_only;
+} serlib_map_t;
+
+typedef struct _serlib_map_entry_t {
+  char* key;
+  int key_size;
+  unsigned long long key_int;
+  char* value;
+  int value_size;
+} serlib_map_entry_t;
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_init
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > map      - serlib_map_t*
+ *         > key_type - int (SERLIB_MAP_KEY_BYTES or SERLIB_MAP_KEY_INT)
+ *         > capacity - unsigned int (expected entries, 0 for default)
+ * ----------------------------------------------------------------------
+ * Initializes an empty map. The table is a flat open-addressing array
+ * probed SERLIB_MAP_GROUP control bytes at a time (with SSE2 when
+ * available), as in a Swiss table.
+ * ----------------------------------------------------------------------
+ */
+void serlib_map_init(serlib_map_t* map, int key_type, unsigned int capacity);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_free
+ * ----------------------------------------------------------------------
+ * params  : map - serlib_map_t*
+ * ----------------------------------------------------------------------
+ * Frees a map's table and arena. For a map opened over an image this
+ * only forgets the image.
+ * ----------------------------------------------------------------------
+ */
+void serlib_map_free(serlib_map_t* map);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_put
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > map        - serlib_map_t*
+ *         > key        - char*
+ *         > key_size   - int
+ *         > value      - char*
+ *         > value_size - int
+ * ----------------------------------------------------------------------
+ * Inserts or replaces the value of a byte-string key. Values are copied
+ * into the map. Returns 0 on success, -1 if the map is read-only.
+ * ----------------------------------------------------------------------
+ */
+int serlib_map_put(serlib_map_t* map, char* key, int key_size, char* value, int value_size);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_put_int
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > map        - serlib_map_t*
+ *         > key        - unsigned long long
+ *         > value      - char*
+ *         > value_size - int
+ * ----------------------------------------------------------------------
+ * Inserts or replaces the value of an integer key. Returns 0 on success,
+ * -1 if the map is read-only.
+ * ----------------------------------------------------------------------
+ */
+int serlib_map_put_int(serlib_map_t* map, unsigned long long key, char* value, int value_size);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_get
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > map        - serlib_map_t*
+ *         > key        - char*
+ *         > key_size   - int
+ *         > value_size - int* (out, may be NULL)
+ * ----------------------------------------------------------------------
+ * Looks up a byte-string key. Returns a pointer to the value inside the
+ * map, valid until the map is next modified, or NULL if absent.
+ * ----------------------------------------------------------------------
+ */
+char* serlib_map_get(serlib_map_t* map, char* key, int key_size, int* value_size);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_get_int
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > map        - serlib_map_t*
+ *         > key        - unsigned long long
+ *         > value_size - int* (out, may be NULL)
+ * ----------------------------------------------------------------------
+ * Looks up an integer key. Returns a pointer to the value inside the
+ * map, valid until the map is next modified, or NULL if absent.
+ * ----------------------------------------------------------------------
+ */
+char* serlib_map_get_int(serlib_map_t* map, unsigned long long key, int* value_size);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_remove
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > map      - serlib_map_t*
+ *         > key      - char*
+ *         > key_size - int
+ * ----------------------------------------------------------------------
+ * Removes a byte-string key. Returns 0 if it was removed, -1 if absent
+ * or the map is read-only.
+ * ----------------------------------------------------------------------
+ */
+int serlib_map_remove(serlib_map_t* map, char* key, int key_size);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_remove_int
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > map - serlib_map_t*
+ *         > key - unsigned long long
+ * ----------------------------------------------------------------------
+ * Removes an integer key. Returns 0 if it was removed, -1 if absent or
+ * the map is read-only.
+ * ----------------------------------------------------------------------
+ */
+int serlib_map_remove_int(serlib_map_t* map, unsigned long long key);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_get_count
+ * ----------------------------------------------------------------------
+ * params  : map - serlib_map_t*
+ * ----------------------------------------------------------------------
+ * Returns the number of entries in a map.
+ * ----------------------------------------------------------------------
+ */
+unsigned int serlib_map_get_count(serlib_map_t* map);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_iterate
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > map   - serlib_map_t*
+ *         > pos   - unsigned int* (start at 0)
+ *         > entry - serlib_map_entry_t* (out)
+ * ----------------------------------------------------------------------
+ * Gets the next entry in table order. Returns false once every entry
+ * has been visited.
+ * ----------------------------------------------------------------------
+ */
+bool serlib_map_iterate(serlib_map_t* map, unsigned int* pos, serlib_map_entry_t* entry);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_serialize_map_t
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > b   - ser_buff_t*
+ *         > map - serlib_map_t*
+ * ----------------------------------------------------------------------
+ * Writes the map's table as an image: b->next is first padded to a
+ * multiple of 8, then the header, control bytes, slots and arena are
+ * copied out as they are. Returns SERLIB_OK or SERLIB_ERR_OVERFLOW.
+ * ----------------------------------------------------------------------
+ */
+int serlib_serialize_map_t(ser_buff_t* b, serlib_map_t* map);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_deserialize_map_t
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > b   - ser_buff_t*
+ *         > map - serlib_map_t* (out)
+ * ----------------------------------------------------------------------
+ * Reads an image written by serlib_serialize_map_t into a new, writable
+ * map. The arrays are copied as they are; no key is rehashed. Returns 0
+ * on success, -1 if the image is malformed.
+ * ----------------------------------------------------------------------
+ */
+int serlib_deserialize_map_t(ser_buff_t* b, serlib_map_t* map);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_open
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > map  - serlib_map_t* (out)
+ *         > data - char* (8-byte aligned image, e.g. mmapped)
+ *         > size - int
+ * ----------------------------------------------------------------------
+ * Opens a read-only map directly over an image without copying, so a
+ * table can be looked up straight from an mmapped file. The image must
+ * outlive the map. The header, control bytes and slot offsets are
+ * checked once here, as serlib_deserialize_map_t does, so lookups and
+ * iteration stay inside the image. Returns 0 on success, -1 if the
+ * image is malformed, truncated or misaligned.
+ * ----------------------------------------------------------------------
+ */
+int serlib_map_open(serlib_map_t* map, char* data, int size);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_image_size
+ * ----------------------------------------------------------------------
+ * params  : map - serlib_map_t*
+ * ----------------------------------------------------------------------
+ * Returns the size of the map's image, excluding alignment padding.
+ * ----------------------------------------------------------------------
+ */
+int serlib_map_image_size(serlib_map_t* map);
+
+#endif
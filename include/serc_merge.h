@@ -0,0 +1,134 @@
+#ifndef __SERLIB_MERGE_H__
+#define __SERLIB_MERGE_H__
+
+#include <stdbool.h>
+
+#include "serc.h"
+
+/*
+ * The sort key of one encoded element. Keys compare by number first,
+ * then by bytes[0, bytes_size) as memcmp would, a shorter prefix first.
+ * bytes may be NULL when bytes_size is 0; otherwise it must point into
+ * the element itself.
+ */
+typedef struct _serlib_merge_key_t {
+  long long number;
+  char* bytes;
+  int bytes_size;
+} serlib_merge_key_t;
+
+/*
+ * Reads the key of the element at the start of data, with available
+ * bytes left before the end of the run, and returns the element's
+ * encoded size, or -1 if it is truncated or malformed.
+ */
+typedef int (*serlib_merge_key_fn)(char* data, int available, serlib_merge_key_t* key);
+
+/*
+ * One input run: its buffer, read from b->next, and the key and size of
+ * the element at b->next.
+ */
+typedef struct _serlib_merge_run_t {
+  ser_buff_t* b;
+  serlib_merge_key_t key;
+  int size;
+} serlib_merge_run_t;
+
+typedef struct _serlib_list_merger_t {
+  serlib_merge_run_t* runs;
+  int run_count;
+  int* heap;
+  int heap_count;
+  serlib_merge_key_fn key_fn;
+  char* copy_src;
+  int copy_left;
+  bool sentinel_done;
+  bool failed;
+} serlib_list_merger_t;
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_merger_init
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > merger    - serlib_list_merger_t*
+ *         > runs      - ser_buff_t** (each at the start of a sorted list)
+ *         > run_count - int
+ *         > key_fn    - serlib_merge_key_fn
+ * ----------------------------------------------------------------------
+ * Prepares a streaming merge of lists written by serlib_serialize_list_t
+ * (or views over mmapped ones), each already sorted by key_fn's key.
+ * Elements are never decoded: key_fn reads each key straight from the
+ * encoded bytes, and the runs are merged through a heap of run_count
+ * entries, equal keys coming out in run order. The runs' buffers must
+ * stay untouched until the merger is finished. Returns 0 on success, -1
+ * if the first element of a run is malformed.
+ * ----------------------------------------------------------------------
+ */
+int serlib_list_merger_init(serlib_list_merger_t* merger,
+                            ser_buff_t** runs,
+                            int run_count,
+                            serlib_merge_key_fn key_fn);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_merge_list_chunk
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > merger   - serlib_list_merger_t*
+ *         > out      - char*
+ *         > out_size - int
+ * ----------------------------------------------------------------------
+ * Fills out with up to out_size bytes of the merged list, in the same
+ * format as serlib_serialize_list_t, resuming at the exact element and
+ * byte where the previous call stopped. Each element's bytes are copied
+ * once, from its run into out, and nothing else is buffered, so memory
+ * use is the heap alone whatever the size of the runs. Every chunk but
+ * the last is full. Each run's b->next is left just past its sentinel
+ * once it is exhausted. Returns the bytes written; 0 once the whole
+ * list, sentinel included, has been emitted; -1 if a run is truncated,
+ * malformed or out of order.
+ * ----------------------------------------------------------------------
+ */
+int serlib_merge_list_chunk(serlib_list_merger_t* merger, char* out, int out_size);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_merger_done
+ * ----------------------------------------------------------------------
+ * params  : merger - serlib_list_merger_t*
+ * ----------------------------------------------------------------------
+ * Returns true once every byte of the merged list has been emitted.
+ * ----------------------------------------------------------------------
+ */
+bool serlib_list_merger_done(serlib_list_merger_t* merger);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_merger_free
+ * ----------------------------------------------------------------------
+ * params  : merger - serlib_list_merger_t*
+ * ----------------------------------------------------------------------
+ * Frees a merger's run cursors and heap. The runs are left alone.
+ * ----------------------------------------------------------------------
+ */
+void serlib_list_merger_free(serlib_list_merger_t* merger);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_merge_lists
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > runs      - ser_buff_t**
+ *         > run_count - int
+ *         > key_fn    - serlib_merge_key_fn
+ *         > out       - ser_buff_t*
+ * ----------------------------------------------------------------------
+ * Merges the runs into out in one go, through a merger. Returns 0 on
+ * success, -1 if a run is malformed or out of order or out overflowed
+ * its fixed capacity, in which case out->next is left where it was.
+ * ----------------------------------------------------------------------
+ */
+int serlib_merge_lists(ser_buff_t** runs, int run_count, serlib_merge_key_fn key_fn, ser_buff_t* out);
+
+#endif
@@ -0,0 +1,148 @@
+#ifndef __SERLIB_NUMA_H__
+#define __SERLIB_NUMA_H__
+
+#include <stdbool.h>
+
+#define SERLIB_NUMA_MAX_NODES   64
+#define SERLIB_NUMA_CLASSES     22
+#define SERLIB_NUMA_SMALL_MAX   4096
+#define SERLIB_NUMA_CHUNK_SIZE  (256 * 1024)
+#define SERLIB_NUMA_LARGE_CACHE 8
+
+/*
+ * Per-node memory pools. Each node has its own size-class free lists,
+ * refilled from memory whose placement policy is set to that node
+ * (mbind) before anything touches it, so blocks land on the node they
+ * are allocated for no matter which thread first writes them. Small
+ * classes are carved from SERLIB_NUMA_CHUNK_SIZE chunks that are kept
+ * for the life of the process; larger ones are mapped individually and
+ * up to SERLIB_NUMA_LARGE_CACHE of each are kept per node for reuse.
+ *
+ * On a single-node machine, or when started with simulated nodes, the
+ * pools behave the same but no placement policy is applied.
+ */
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_numa_init
+ * ----------------------------------------------------------------------
+ * params  : simulated_nodes - int (0 to detect the real topology)
+ * ----------------------------------------------------------------------
+ * Sets up the per-node pools. With simulated_nodes > 0 the library acts
+ * as if the machine had that many nodes, without placing memory, so
+ * node-aware code paths can be exercised and benchmarked anywhere. Must
+ * be called before any other serlib_numa_* function or node-bound
+ * buffer or list; otherwise the real topology is detected on first use.
+ * Returns the node count, or -1 if the pools are already set up or
+ * simulated_nodes is out of range.
+ * ----------------------------------------------------------------------
+ */
+int serlib_numa_init(int simulated_nodes);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_numa_node_count
+ * ----------------------------------------------------------------------
+ * Returns the number of (real or simulated) nodes.
+ * ----------------------------------------------------------------------
+ */
+int serlib_numa_node_count(void);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_numa_is_simulated
+ * ----------------------------------------------------------------------
+ * Returns true if the nodes are simulated and no placement is applied.
+ * ----------------------------------------------------------------------
+ */
+bool serlib_numa_is_simulated(void);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_numa_current_node
+ * ----------------------------------------------------------------------
+ * Returns the node of the calling thread: the one it was moved to with
+ * serlib_numa_run_on_node, or else the node of the CPU it is running on
+ * (with simulated nodes, that CPU number modulo the node count).
+ * ----------------------------------------------------------------------
+ */
+int serlib_numa_current_node(void);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_numa_run_on_node
+ * ----------------------------------------------------------------------
+ * params  : node - int
+ * ----------------------------------------------------------------------
+ * Restricts the calling thread to the CPUs of a node and makes it the
+ * thread's current node. With simulated nodes only the latter happens.
+ * Returns 0 on success, -1 if the node is out of range or the affinity
+ * could not be set.
+ * ----------------------------------------------------------------------
+ */
+int serlib_numa_run_on_node(int node);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_numa_alloc
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > node - int
+ *         > size - int
+ * ----------------------------------------------------------------------
+ * Allocates size bytes, 16-byte aligned, from a node's pool. Safe to
+ * call from any thread.
+ * ----------------------------------------------------------------------
+ */
+void* serlib_numa_alloc(int node, int size);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_numa_realloc
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > ptr  - void* (from serlib_numa_alloc, or NULL)
+ *         > node - int
+ *         > size - int
+ * ----------------------------------------------------------------------
+ * Resizes a block, moving it to the given node's pool if it lives on
+ * another. Returns ptr itself when it already fits the size class and
+ * node.
+ * ----------------------------------------------------------------------
+ */
+void* serlib_numa_realloc(void* ptr, int node, int size);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_numa_free
+ * ----------------------------------------------------------------------
+ * params  : ptr - void* (from serlib_numa_alloc, or NULL)
+ * ----------------------------------------------------------------------
+ * Returns a block to the pool of the node it was allocated on. Safe to
+ * call from any thread.
+ * ----------------------------------------------------------------------
+ */
+void serlib_numa_free(void* ptr);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_numa_node_of
+ * ----------------------------------------------------------------------
+ * params  : ptr - void* (from serlib_numa_alloc)
+ * ----------------------------------------------------------------------
+ * Returns the node whose pool a block was allocated from.
+ * ----------------------------------------------------------------------
+ */
+int serlib_numa_node_of(void* ptr);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_numa_trim
+ * ----------------------------------------------------------------------
+ * Unmaps every cached large block on every node. Small-class chunks are
+ * kept.
+ * ----------------------------------------------------------------------
+ */
+void serlib_numa_trim(void);
+
+#endif
@@ -0,0 +1,197 @@
+#ifndef __SERLIB_RING_H__
+#define __SERLIB_RING_H__
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+#include "serc.h"
+
+#define SERLIB_RING_MAGIC     0x474e4952
+#define SERLIB_RING_MIN_SIZE  4096
+#define SERLIB_RING_CTRL_SIZE 4096
+
+#define SERLIB_RING_SPSC 0
+#define SERLIB_RING_MPSC 1
+
+/*
+ * Shared control block at the start of the ring mapping. head, tail and
+ * the wakeup words live on their own cache lines so producers and the
+ * consumer don't false-share.
+ */
+typedef struct _serlib_ring_ctrl_t {
+  unsigned int magic;
+  unsigned int mode;
+  unsigned long long capacity;
+  _Alignas(64) _Atomic unsigned long long head;
+  _Alignas(64) _Atomic unsigned long long tail;
+  _Alignas(64) _Atomic unsigned int consumer_idle;
+  _Atomic unsigned int wake_seq;
+} serlib_ring_ctrl_t;
+
+typedef struct _serlib_ring_t {
+  serlib_ring_ctrl_t* ctrl;
+  char* data;
+  unsigned long long capacity;
+  unsigned long long mask;
+  size_t map_size;
+  int fd;
+} serlib_ring_t;
+
+typedef struct _serlib_ring_slot_t {
+  ser_header_t* header;
+  ser_buff_t buff;
+  unsigned long long pos;
+  unsigned int frame_size;
+} serlib_ring_slot_t;
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_ring_create
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > ring     - serlib_ring_t*
+ *         > shm_name - const char* (NULL for an anonymous memfd)
+ *         > capacity - unsigned long long
+ *         > mode     - int (SERLIB_RING_SPSC / SERLIB_RING_MPSC)
+ * ----------------------------------------------------------------------
+ * Creates a shared-memory frame ring. capacity is rounded up to a power
+ * of two. With shm_name NULL the ring is backed by a memfd whose
+ * descriptor (ring->fd) can be inherited or passed over a socket;
+ * otherwise it is backed by shm_open(shm_name). Returns 0 on success,
+ * -1 on failure.
+ * ----------------------------------------------------------------------
+ */
+int serlib_ring_create(serlib_ring_t* ring, const char* shm_name, unsigned long long capacity, int mode);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_ring_attach_fd
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > ring - serlib_ring_t*
+ *         > fd   - int
+ * ----------------------------------------------------------------------
+ * Maps an existing ring from a memfd / shm descriptor. The ring takes
+ * ownership of fd. Returns 0 on success, -1 on failure.
+ * ----------------------------------------------------------------------
+ */
+int serlib_ring_attach_fd(serlib_ring_t* ring, int fd);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_ring_open
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > ring     - serlib_ring_t*
+ *         > shm_name - const char*
+ * ----------------------------------------------------------------------
+ * Maps an existing ring created with a shm name. Returns 0 on success,
+ * -1 on failure.
+ * ----------------------------------------------------------------------
+ */
+int serlib_ring_open(serlib_ring_t* ring, const char* shm_name);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_ring_close
+ * ----------------------------------------------------------------------
+ * params  : ring - serlib_ring_t*
+ * ----------------------------------------------------------------------
+ * Unmaps a ring and closes its descriptor. Named rings are not unlinked.
+ * ----------------------------------------------------------------------
+ */
+void serlib_ring_close(serlib_ring_t* ring);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_ring_reserve
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > ring         - serlib_ring_t*
+ *         > payload_size - int
+ *         > slot         - serlib_ring_slot_t*
+ * ----------------------------------------------------------------------
+ * Reserves a frame for payload_size bytes. slot->header points at the
+ * frame's ser_header_t and slot->buff is a fixed buffer over the
+ * payload that can be serialized into directly; writes past
+ * payload_size bytes fail with SERLIB_ERR_OVERFLOW instead of
+ * allocating. Never blocks. Returns 0 on success, -1 if the ring is
+ * full.
+ * ----------------------------------------------------------------------
+ */
+int serlib_ring_reserve(serlib_ring_t* ring, int payload_size, serlib_ring_slot_t* slot);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_ring_commit
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > ring - serlib_ring_t*
+ *         > slot - serlib_ring_slot_t*
+ * ----------------------------------------------------------------------
+ * Publishes a reserved frame. header->payload_size is set to the bytes
+ * serialized into slot->buff. If slot->buff overflowed, the frame is
+ * dropped rather than delivered. Wakes the consumer only if it is idle.
+ * ----------------------------------------------------------------------
+ */
+void serlib_ring_commit(serlib_ring_t* ring, serlib_ring_slot_t* slot);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_ring_send
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > ring   - serlib_ring_t*
+ *         > header - ser_header_t*
+ *         > b      - ser_buff_t*
+ * ----------------------------------------------------------------------
+ * Copies an already serialized buffer into the ring as one frame.
+ * Returns 0 on success, -1 if the ring is full.
+ * ----------------------------------------------------------------------
+ */
+int serlib_ring_send(serlib_ring_t* ring, ser_header_t* header, ser_buff_t* b);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_ring_peek
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > ring - serlib_ring_t*
+ *         > slot - serlib_ring_slot_t*
+ * ----------------------------------------------------------------------
+ * Gets the oldest committed frame without copying. slot->buff is a view
+ * over the payload that can be deserialized from directly. Consumer
+ * side only. Returns 0 on success, -1 if the ring is empty or the frame
+ * at its tail is corrupt (sizes outside the ring are never followed).
+ * ----------------------------------------------------------------------
+ */
+int serlib_ring_peek(serlib_ring_t* ring, serlib_ring_slot_t* slot);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_ring_release
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > ring - serlib_ring_t*
+ *         > slot - serlib_ring_slot_t*
+ * ----------------------------------------------------------------------
+ * Returns a frame obtained from serlib_ring_peek to the producers.
+ * ----------------------------------------------------------------------
+ */
+void serlib_ring_release(serlib_ring_t* ring, serlib_ring_slot_t* slot);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_ring_wait
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > ring       - serlib_ring_t*
+ *         > timeout_ms - int (-1 waits forever)
+ * ----------------------------------------------------------------------
+ * Blocks the consumer until a frame is available. Returns 0 when a frame
+ * is available, -1 on timeout.
+ * ----------------------------------------------------------------------
+ */
+int serlib_ring_wait(serlib_ring_t* ring, int timeout_ms);
+
+#endif
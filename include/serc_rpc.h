@@ -0,0 +1,516 @@
+#ifndef __SERLIB_RPC_H__
+#define __SERLIB_RPC_H__
+
+#include <pthread.h>
+#include <stdbool.h>
+
+#include "serc.h"
+
+#define SERLIB_RPC_CALL_FREE    0
+#define SERLIB_RPC_CALL_PENDING 1
+#define SERLIB_RPC_CALL_DONE    2
+#define SERLIB_RPC_CALL_READING 3
+
+#define SERLIB_RPC_TABLE_EMPTY  -1
+
+#define SERLIB_RPC_MAX_PAYLOAD_DEFAULT (16 * 1024 * 1024)
+#define SERLIB_RPC_MAX_PAYLOAD_LIMIT   (1024 * 1024 * 1024)
+#define SERLIB_RPC_POOL_KEEP_MAX       (1024 * 1024)
+
+#define SERLIB_RPC_CACHE_GENERATIONS 256
+
+typedef int (*serlib_rpc_handler_t)(ser_header_t* header,
+                                    ser_buff_t* request,
+                                    ser_buff_t* response,
+                                    void* ctx);
+
+typedef struct _serlib_rpc_pool_t {
+  ser_buff_t** buffers;
+  int count;
+  int capacity;
+  int high_water;
+} serlib_rpc_pool_t;
+
+typedef struct _serlib_rpc_cache_entry_t {
+  unsigned long long hash;
+  unsigned int rpc_proc_id;
+  char* key;
+  int key_size;
+  ser_frozen_t* response;
+  long long bytes;
+  bool used;
+  bool referenced;
+} serlib_rpc_cache_entry_t;
+
+typedef struct _serlib_rpc_cache_counters_t {
+  unsigned long long hits;
+  unsigned long long misses;
+  unsigned long long insertions;
+  unsigned long long evictions;
+  unsigned long long rejected;
+  unsigned long long stale;
+  int entries;
+  long long bytes;
+} serlib_rpc_cache_counters_t;
+
+/*
+ * Response cache keyed on rpc_proc_id plus the request payload bytes.
+ * Entries sit in a fixed ring swept by a CLOCK hand and are indexed by
+ * an open-addressed table of entry indices, like the client's call
+ * table. Responses are frozen buffers, so a hit is answered from a
+ * shared reference that stays valid even if the entry is evicted while
+ * it is being written. One cache may be shared by several servers.
+ *
+ * Each procedure id maps to one of SERLIB_RPC_CACHE_GENERATIONS
+ * generation counters, bumped by serlib_rpc_cache_invalidate. A
+ * response computed before an invalidation carries the old generation
+ * and is dropped on insert instead of being cached. Ids sharing a
+ * counter only cost each other a few extra misses.
+ */
+typedef struct _serlib_rpc_cache_t {
+  serlib_rpc_cache_entry_t* entries;
+  int capacity;
+  int* free_entries;
+  int free_count;
+  int* table;
+  unsigned int table_mask;
+  int hand;
+  long long bytes;
+  long long max_bytes;
+  serlib_rpc_cache_counters_t counters;
+  unsigned long long generations[SERLIB_RPC_CACHE_GENERATIONS];
+  pthread_mutex_t lock;
+} serlib_rpc_cache_t;
+
+typedef struct _serlib_rpc_proc_t {
+  serlib_rpc_handler_t handler;
+  void* ctx;
+  serlib_rpc_pool_t requests;
+  serlib_rpc_pool_t responses;
+  bool cacheable;
+} serlib_rpc_proc_t;
+
+typedef struct _serlib_rpc_server_t {
+  serlib_rpc_proc_t* procs;
+  unsigned int max_procs;
+  serlib_rpc_cache_t* cache;
+  unsigned int max_payload;
+} serlib_rpc_server_t;
+
+typedef struct _serlib_rpc_call_t {
+  unsigned int call_id;
+  int state;
+  ser_header_t header;
+  ser_buff_t* response;
+} serlib_rpc_call_t;
+
+typedef struct _serlib_rpc_client_t {
+  int fd;
+  unsigned int tid;
+  unsigned int next_call_id;
+  int max_inflight;
+  serlib_rpc_call_t* calls;
+  int* free_calls;
+  int free_count;
+  int* table;
+  unsigned int table_mask;
+  unsigned int max_payload;
+  bool reading;
+  bool broken;
+  pthread_mutex_t lock;
+  pthread_mutex_t send_lock;
+  pthread_cond_t cond;
+} serlib_rpc_client_t;
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_client_init
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > client        - serlib_rpc_client_t*
+ *         > fd            - int (connected stream socket)
+ *         > tid           - unsigned int
+ *         > max_inflight  - int
+ *         > response_size - int
+ * ----------------------------------------------------------------------
+ * Initializes a pipelining RPC client over one connection. Up to
+ * max_inflight calls may be outstanding at once, each with its own
+ * preallocated response buffer of response_size bytes (grown if a
+ * larger response arrives, up to the client's max payload).
+ * ----------------------------------------------------------------------
+ */
+void serlib_rpc_client_init(serlib_rpc_client_t* client, int fd, unsigned int tid, int max_inflight, int response_size);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_client_destroy
+ * ----------------------------------------------------------------------
+ * params  : client - serlib_rpc_client_t*
+ * ----------------------------------------------------------------------
+ * Frees a client's call table and buffers. Does not close the socket.
+ * ----------------------------------------------------------------------
+ */
+void serlib_rpc_client_destroy(serlib_rpc_client_t* client);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_client_set_max_payload
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > client      - serlib_rpc_client_t*
+ *         > max_payload - unsigned int
+ * ----------------------------------------------------------------------
+ * Sets the largest response payload the client accepts, by default
+ * SERLIB_RPC_MAX_PAYLOAD_DEFAULT. A larger frame shuts the connection
+ * down and fails every outstanding call. Returns 0 on success, -1 if
+ * max_payload is above SERLIB_RPC_MAX_PAYLOAD_LIMIT.
+ * ----------------------------------------------------------------------
+ */
+int serlib_rpc_client_set_max_payload(serlib_rpc_client_t* client, unsigned int max_payload);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_client_send
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > client      - serlib_rpc_client_t*
+ *         > rpc_proc_id - unsigned int
+ *         > request     - ser_buff_t* (request->next payload bytes)
+ *         > call_id     - unsigned int* (out)
+ * ----------------------------------------------------------------------
+ * Sends a request without waiting for its response. Safe to call from
+ * several threads. Returns 0 on success, -1 if max_inflight calls are
+ * already outstanding or the connection failed.
+ * ----------------------------------------------------------------------
+ */
+int serlib_rpc_client_send(serlib_rpc_client_t* client,
+                           unsigned int rpc_proc_id,
+                           ser_buff_t* request,
+                           unsigned int* call_id);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_client_wait
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > client   - serlib_rpc_client_t*
+ *         > call_id  - unsigned int
+ *         > header   - ser_header_t* (out, may be NULL)
+ *         > response - ser_buff_t** (out)
+ * ----------------------------------------------------------------------
+ * Waits for the response to call_id. Responses may arrive in any order;
+ * whichever waiter is reading the socket routes each one to its call
+ * through the rpc_call_id table. *response stays owned by the client
+ * until serlib_rpc_client_release. Returns 0 on success, -1 if the call
+ * is unknown or the connection failed.
+ * ----------------------------------------------------------------------
+ */
+int serlib_rpc_client_wait(serlib_rpc_client_t* client,
+                           unsigned int call_id,
+                           ser_header_t* header,
+                           ser_buff_t** response);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_client_release
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > client  - serlib_rpc_client_t*
+ *         > call_id - unsigned int
+ * ----------------------------------------------------------------------
+ * Returns a finished call and its response buffer to the client.
+ * ----------------------------------------------------------------------
+ */
+void serlib_rpc_client_release(serlib_rpc_client_t* client, unsigned int call_id);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_read_frame
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > fd          - int
+ *         > header      - ser_header_t* (out)
+ *         > payload     - ser_buff_t* (grown to fit unless fixed)
+ *         > max_payload - unsigned int (at most SERLIB_RPC_MAX_PAYLOAD_LIMIT)
+ * ----------------------------------------------------------------------
+ * Reads one header-framed message from a stream socket into payload
+ * (payload->next is left at 0, payload_size bytes are readable). A
+ * frame whose payload_size is above max_payload is not read; the stream
+ * can't be resynchronized after it, so close the socket. A fixed buffer
+ * is never grown: a frame that doesn't fit is read off the socket and
+ * dropped, payload is marked overflowed (see serlib_buffer_error) and
+ * SERLIB_ERR_OVERFLOW returned, and the stream stays usable. Returns 0
+ * on success, -1 on error, oversized frame or end of stream.
+ * ----------------------------------------------------------------------
+ */
+int serlib_rpc_read_frame(int fd, ser_header_t* header, ser_buff_t* payload, unsigned int max_payload);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_write_frame
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > fd      - int
+ *         > header  - ser_header_t* (payload_size is set from payload)
+ *         > payload - ser_buff_t* (payload->next bytes)
+ * ----------------------------------------------------------------------
+ * Writes one header-framed message to a stream socket, header and
+ * payload gathered into one sendmsg so the payload is sent from where
+ * it is without being copied. Concurrent writers to the same socket
+ * must serialize their calls. Returns 0 on success, -1 on error.
+ * ----------------------------------------------------------------------
+ */
+int serlib_rpc_write_frame(int fd, ser_header_t* header, ser_buff_t* payload);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_server_init
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > server    - serlib_rpc_server_t*
+ *         > max_procs - unsigned int
+ * ----------------------------------------------------------------------
+ * Initializes a dispatch registry for procedure ids below max_procs.
+ * Procedures live in a flat table indexed by rpc_proc_id. A server is
+ * not thread-safe; run one per serving thread.
+ * ----------------------------------------------------------------------
+ */
+void serlib_rpc_server_init(serlib_rpc_server_t* server, unsigned int max_procs);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_server_destroy
+ * ----------------------------------------------------------------------
+ * params  : server - serlib_rpc_server_t*
+ * ----------------------------------------------------------------------
+ * Frees a dispatch registry and all pooled buffers.
+ * ----------------------------------------------------------------------
+ */
+void serlib_rpc_server_destroy(serlib_rpc_server_t* server);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_server_register
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > server      - serlib_rpc_server_t*
+ *         > rpc_proc_id - unsigned int
+ *         > handler     - serlib_rpc_handler_t
+ *         > ctx         - void*
+ *         > pool_size   - int
+ * ----------------------------------------------------------------------
+ * Registers the handler for a procedure id. The procedure gets its own
+ * pools of up to pool_size request and response buffers, sized from
+ * the largest message seen so far up to SERLIB_RPC_POOL_KEEP_MAX;
+ * larger buffers are freed instead of pooled. Returns 0 on success, -1 if the id
+ * is out of range or already registered.
+ * ----------------------------------------------------------------------
+ */
+int serlib_rpc_server_register(serlib_rpc_server_t* server,
+                               unsigned int rpc_proc_id,
+                               serlib_rpc_handler_t handler,
+                               void* ctx,
+                               int pool_size);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_server_dispatch
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > server   - serlib_rpc_server_t*
+ *         > header   - ser_header_t*
+ *         > request  - ser_buff_t*
+ *         > response - ser_buff_t*
+ * ----------------------------------------------------------------------
+ * Calls the handler registered for header->rpc_proc_id. Returns the
+ * handler's result, or -1 if no handler is registered.
+ * ----------------------------------------------------------------------
+ */
+int serlib_rpc_server_dispatch(serlib_rpc_server_t* server,
+                               ser_header_t* header,
+                               ser_buff_t* request,
+                               ser_buff_t* response);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_server_serve_one
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > server - serlib_rpc_server_t*
+ *         > fd     - int
+ * ----------------------------------------------------------------------
+ * Reads one request frame into a pooled buffer, dispatches it and
+ * writes the response (same tid, rpc_proc_id and rpc_call_id) from a
+ * pooled buffer. For a cacheable procedure a cached response is sent
+ * without calling the handler, and a fresh one is cached. Requests for
+ * unknown procedures, and handlers that return < 0, get an empty
+ * response. A request larger than the server's max payload is not read:
+ * the connection is shut down and -1 returned. Once the pools are warm
+ * nothing is allocated. Returns 0 on success, -1 on connection error.
+ * ----------------------------------------------------------------------
+ */
+int serlib_rpc_server_serve_one(serlib_rpc_server_t* server, int fd);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_server_set_max_payload
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > server      - serlib_rpc_server_t*
+ *         > max_payload - unsigned int
+ * ----------------------------------------------------------------------
+ * Sets the largest request payload the server accepts, by default
+ * SERLIB_RPC_MAX_PAYLOAD_DEFAULT. payload_size comes from the peer, so
+ * this bounds what one frame header can make the server allocate.
+ * Returns 0 on success, -1 if max_payload is above
+ * SERLIB_RPC_MAX_PAYLOAD_LIMIT.
+ * ----------------------------------------------------------------------
+ */
+int serlib_rpc_server_set_max_payload(serlib_rpc_server_t* server, unsigned int max_payload);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_server_set_cache
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > server - serlib_rpc_server_t*
+ *         > cache  - serlib_rpc_cache_t* (NULL to detach)
+ * ----------------------------------------------------------------------
+ * Attaches a response cache to a server. Only procedures marked with
+ * serlib_rpc_server_set_cacheable use it.
+ * ----------------------------------------------------------------------
+ */
+void serlib_rpc_server_set_cache(serlib_rpc_server_t* server, serlib_rpc_cache_t* cache);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_server_set_cacheable
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > server      - serlib_rpc_server_t*
+ *         > rpc_proc_id - unsigned int
+ *         > cacheable   - bool
+ * ----------------------------------------------------------------------
+ * Opts a procedure in or out of response caching. Only opt in handlers
+ * whose response depends on nothing but the request payload, and that
+ * leave the request bytes unmodified. Returns 0 on success, -1 if the
+ * procedure is not registered.
+ * ----------------------------------------------------------------------
+ */
+int serlib_rpc_server_set_cacheable(serlib_rpc_server_t* server, unsigned int rpc_proc_id, bool cacheable);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_cache_init
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > cache       - serlib_rpc_cache_t*
+ *         > max_entries - int
+ *         > max_bytes   - long long (request + response bytes held)
+ * ----------------------------------------------------------------------
+ * Initializes an empty response cache. Entries larger than max_bytes
+ * are never cached. Safe to share between threads.
+ * ----------------------------------------------------------------------
+ */
+void serlib_rpc_cache_init(serlib_rpc_cache_t* cache, int max_entries, long long max_bytes);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_cache_destroy
+ * ----------------------------------------------------------------------
+ * params  : cache - serlib_rpc_cache_t*
+ * ----------------------------------------------------------------------
+ * Frees a cache. Responses still referenced by a caller stay valid
+ * until released.
+ * ----------------------------------------------------------------------
+ */
+void serlib_rpc_cache_destroy(serlib_rpc_cache_t* cache);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_cache_lookup
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > cache       - serlib_rpc_cache_t*
+ *         > rpc_proc_id - unsigned int
+ *         > payload     - char*
+ *         > size        - int
+ * ----------------------------------------------------------------------
+ * Looks up the response to a request. Returns a retained frozen buffer
+ * holding the serialized response payload, to be dropped with
+ * serlib_frozen_release, or NULL on a miss.
+ * ----------------------------------------------------------------------
+ */
+ser_frozen_t* serlib_rpc_cache_lookup(serlib_rpc_cache_t* cache, unsigned int rpc_proc_id, char* payload, int size);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_cache_generation
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > cache       - serlib_rpc_cache_t*
+ *         > rpc_proc_id - unsigned int
+ * ----------------------------------------------------------------------
+ * Returns a procedure's current generation. Read it before computing a
+ * response and pass it to serlib_rpc_cache_insert.
+ * ----------------------------------------------------------------------
+ */
+unsigned long long serlib_rpc_cache_generation(serlib_rpc_cache_t* cache, unsigned int rpc_proc_id);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_cache_insert
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > cache       - serlib_rpc_cache_t*
+ *         > rpc_proc_id - unsigned int
+ *         > payload     - char*
+ *         > size        - int
+ *         > response    - ser_buff_t* (response->next bytes, copied)
+ *         > generation  - unsigned long long (read before the response
+ *                         was computed)
+ * ----------------------------------------------------------------------
+ * Caches the response to a request, evicting entries the CLOCK hand
+ * finds unreferenced until it fits. Returns 0 on success, -1 if the
+ * entry exceeds the cache's byte cap, is already cached, or the
+ * procedure was invalidated since generation was read.
+ * ----------------------------------------------------------------------
+ */
+int serlib_rpc_cache_insert(serlib_rpc_cache_t* cache,
+                            unsigned int rpc_proc_id,
+                            char* payload,
+                            int size,
+                            ser_buff_t* response,
+                            unsigned long long generation);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_cache_invalidate
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > cache       - serlib_rpc_cache_t*
+ *         > rpc_proc_id - unsigned int
+ * ----------------------------------------------------------------------
+ * Drops every cached response of a procedure, e.g. after the data it
+ * reads has changed, and bumps its generation so responses computed
+ * before now are not cached either. Returns the number of entries
+ * dropped.
+ * ----------------------------------------------------------------------
+ */
+int serlib_rpc_cache_invalidate(serlib_rpc_cache_t* cache, unsigned int rpc_proc_id);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_cache_get_counters
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > cache    - serlib_rpc_cache_t*
+ *         > counters - serlib_rpc_cache_counters_t* (out)
+ * ----------------------------------------------------------------------
+ * Copies the cache's hit, miss, insertion, eviction, rejection and
+ * stale-insert counts and its current size.
+ * ----------------------------------------------------------------------
+ */
+void serlib_rpc_cache_get_counters(serlib_rpc_cache_t* cache, serlib_rpc_cache_counters_t* counters);
+
+#endif
@@ -0,0 +1,205 @@
+#ifndef __SERLIB_STATS_H__
+#define __SERLIB_STATS_H__
+
+#include <stdbool.h>
+#include <stdio.h>
+
+/*
+ * Instrumentation is compiled in only when built with -DSERLIB_STATS
+ * (make STATS=1). Without it every SERLIB_STAT_* hook is a no-op and
+ * snapshots are all zero.
+ */
+
+#define SERLIB_HIST_BUCKETS 32
+
+typedef enum _serlib_stat_t {
+  SERLIB_STAT_BUFFERS_CREATED,
+  SERLIB_STAT_BUFFERS_FREED,
+  SERLIB_STAT_REALLOCS,
+  SERLIB_STAT_REALLOC_BYTES,
+  SERLIB_STAT_BYTES_SERIALIZED,
+  SERLIB_STAT_BYTES_DESERIALIZED,
+  SERLIB_STAT_SKIPS_IGNORED,
+  SERLIB_STAT_LIST_NODES,
+  SERLIB_STAT_OVERFLOWS,
+  SERLIB_STAT_COUNT
+} serlib_stat_t;
+
+typedef enum _serlib_hist_t {
+  SERLIB_HIST_SERIALIZE,
+  SERLIB_HIST_DESERIALIZE,
+  SERLIB_HIST_SERIALIZE_LIST,
+  SERLIB_HIST_COUNT
+} serlib_hist_t;
+
+typedef enum _serlib_mem_kind_t {
+  SERLIB_MEM_BUFFERS,
+  SERLIB_MEM_LISTS,
+  SERLIB_MEM_MAPS,
+  SERLIB_MEM_COUNT
+} serlib_mem_kind_t;
+
+typedef struct _serlib_mem_t {
+  long long live[SERLIB_MEM_COUNT];
+  long long peak[SERLIB_MEM_COUNT];
+  long long total_live;
+  long long total_peak;
+} serlib_mem_t;
+
+typedef struct _serlib_stats_t {
+  unsigned long long counters[SERLIB_STAT_COUNT];
+  unsigned long long histograms[SERLIB_HIST_COUNT][SERLIB_HIST_BUCKETS];
+} serlib_stats_t;
+
+#ifdef SERLIB_STATS
+#define SERLIB_STAT_ADD(stat, n)           serlib_stats_add((stat), (n))
+#define SERLIB_STAT_TIME_START(var)        unsigned long long var = serlib_stats_time_start()
+#define SERLIB_STAT_TIME_END(hist, var)    serlib_stats_time_end((hist), (var))
+#else
+#define SERLIB_STAT_ADD(stat, n)           ((void)0)
+#define SERLIB_STAT_TIME_START(var)        ((void)0)
+#define SERLIB_STAT_TIME_END(hist, var)    ((void)0)
+#endif
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_stats_add
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > stat - serlib_stat_t
+ *         > n    - unsigned long long
+ * ----------------------------------------------------------------------
+ * Adds n to a counter in the calling thread's stats block. No atomic
+ * read-modify-write or shared cache line is involved. When the thread
+ * exits its counts move to a retired total and the block is handed to
+ * the next new thread.
+ * ----------------------------------------------------------------------
+ */
+void serlib_stats_add(serlib_stat_t stat, unsigned long long n);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_stats_time_start
+ * ----------------------------------------------------------------------
+ * Returns a start timestamp in ns, or 0 when histograms are disabled.
+ * ----------------------------------------------------------------------
+ */
+unsigned long long serlib_stats_time_start(void);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_stats_time_end
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > hist  - serlib_hist_t
+ *         > start - unsigned long long
+ * ----------------------------------------------------------------------
+ * Records the time since start in a log2(ns) bucket of hist.
+ * ----------------------------------------------------------------------
+ */
+void serlib_stats_time_end(serlib_hist_t hist, unsigned long long start);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_stats_enable_histograms
+ * ----------------------------------------------------------------------
+ * params  : enable - bool
+ * ----------------------------------------------------------------------
+ * Turns latency histograms on or off at runtime (off by default, since
+ * each timed call costs two clock reads).
+ * ----------------------------------------------------------------------
+ */
+void serlib_stats_enable_histograms(bool enable);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_stats_snapshot
+ * ----------------------------------------------------------------------
+ * params  : stats - serlib_stats_t*
+ * ----------------------------------------------------------------------
+ * Sums every thread's counters and histograms into stats, including
+ * those of threads that have exited.
+ * ----------------------------------------------------------------------
+ */
+void serlib_stats_snapshot(serlib_stats_t* stats);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_stats_reset
+ * ----------------------------------------------------------------------
+ * Zeroes all counters and histograms. Increments racing with a reset
+ * may survive it.
+ * ----------------------------------------------------------------------
+ */
+void serlib_stats_reset(void);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_stats_name
+ * ----------------------------------------------------------------------
+ * params  : stat - serlib_stat_t
+ * ----------------------------------------------------------------------
+ * Returns a counter's name as used in dumps.
+ * ----------------------------------------------------------------------
+ */
+const char* serlib_stats_name(serlib_stat_t stat);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_mem_account
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > kind  - serlib_mem_kind_t
+ *         > bytes - long long (negative when memory is released)
+ * ----------------------------------------------------------------------
+ * Adjusts the live byte count of a kind of allocation and its peak.
+ * Memory accounting is always compiled in, independent of SERLIB_STATS,
+ * and kept per thread: shared counts are only touched once a thread's
+ * pending bytes for a kind reach 64 KB, so peaks are exact to within
+ * that much per thread.
+ * ----------------------------------------------------------------------
+ */
+void serlib_mem_account(serlib_mem_kind_t kind, long long bytes);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_mem_snapshot
+ * ----------------------------------------------------------------------
+ * params  : mem - serlib_mem_t*
+ * ----------------------------------------------------------------------
+ * Copies live and peak byte counts for buffers, lists, maps and in
+ * total.
+ * Buffers count capacity, not bytes in use.
+ * ----------------------------------------------------------------------
+ */
+void serlib_mem_snapshot(serlib_mem_t* mem);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_mem_reset_peak
+ * ----------------------------------------------------------------------
+ * Restarts peak tracking from the current live byte counts.
+ * ----------------------------------------------------------------------
+ */
+void serlib_mem_reset_peak(void);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_stats_dump
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > out  - FILE*
+ *         > json - bool
+ * ----------------------------------------------------------------------
+ * Writes a snapshot, including memory accounting, as "name value"
+ * lines or as one JSON object.
+ * Histogram bucket i counts calls that took [2^i, 2^(i+1)) ns, the last
+ * one everything slower too. In text, each histogram is written as
+ * cumulative name_bucket{le="2^(i+1)"} lines, then le="+Inf" and
+ * name_count, both the total; in JSON, as the raw per-bucket counts
+ * keyed by 2^(i+1). Empty buckets are omitted.
+ * ----------------------------------------------------------------------
+ */
+void serlib_stats_dump(FILE* out, bool json);
+
+#endif
@@ -0,0 +1,252 @@
+#ifndef __SERLIB_URING_H__
+#define __SERLIB_URING_H__
+
+#include <stddef.h>
+#include <linux/io_uring.h>
+
+#include "serc.h"
+
+#define SERLIB_URING_OP_SEND 1
+#define SERLIB_URING_OP_RECV 2
+#define SERLIB_URING_OP_CANCEL 3
+
+#define SERLIB_URING_MAX_PAYLOAD_DEFAULT (16 * 1024 * 1024)
+#define SERLIB_URING_MAX_PAYLOAD_LIMIT   (1024 * 1024 * 1024)
+
+typedef struct _serlib_uring_conn_t serlib_uring_conn_t;
+
+typedef void (*serlib_uring_frame_fn)(serlib_uring_conn_t* conn, ser_header_t* header, ser_buff_t* payload, void* ctx);
+typedef void (*serlib_uring_close_fn)(serlib_uring_conn_t* conn, int err, void* ctx);
+typedef void (*serlib_uring_send_fn)(serlib_uring_conn_t* conn, ser_buff_t* b, int err, void* ctx);
+
+typedef struct _serlib_uring_op_t {
+  int type;
+  serlib_uring_conn_t* conn;
+  ser_buff_t* b;
+  int sent;
+  serlib_uring_send_fn done;
+  void* ctx;
+  struct _serlib_uring_op_t* next_free;
+} serlib_uring_op_t;
+
+struct _serlib_uring_conn_t {
+  int fd;
+  serlib_uring_frame_fn on_frame;
+  serlib_uring_close_fn on_close;
+  void* ctx;
+  ser_buff_t* partial;
+  unsigned int max_payload;
+  serlib_uring_op_t recv_op;
+  serlib_uring_op_t cancel_op;
+  int recv_armed;
+  int cancel_queued;
+  int inflight;
+  int close_err;
+  int closed;
+  int released;
+};
+
+typedef struct _serlib_uring_t {
+  int ring_fd;
+
+  // submission queue
+  unsigned* sq_head;
+  unsigned* sq_tail;
+  unsigned* sq_mask;
+  unsigned* sq_array;
+  struct io_uring_sqe* sqes;
+  unsigned sq_entries;
+  unsigned sq_local_tail;
+  unsigned sq_pending;
+
+  // completion queue
+  unsigned* cq_head;
+  unsigned* cq_tail;
+  unsigned* cq_mask;
+  struct io_uring_cqe* cqes;
+
+  void* sq_map;
+  size_t sq_map_size;
+  void* cq_map;
+  size_t cq_map_size;
+  size_t sqes_map_size;
+
+  // provided receive buffers
+  struct io_uring_buf_ring* buf_ring;
+  size_t buf_ring_size;
+  char* bufs;
+  int nbufs;
+  int buf_size;
+  unsigned short buf_group;
+  unsigned short buf_tail;
+
+  serlib_uring_op_t* ops;
+  serlib_uring_op_t* free_ops;
+  int nops;
+} serlib_uring_t;
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_uring_init
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > u        - serlib_uring_t*
+ *         > entries  - unsigned int
+ *         > nbufs    - int (power of two)
+ *         > buf_size - int
+ * ----------------------------------------------------------------------
+ * Sets up an io_uring instance and registers a fixed pool of nbufs
+ * receive buffers of buf_size bytes as a provided buffer ring, shared
+ * by every connection's multishot receive. Returns 0 on success, -1 on
+ * failure (e.g. a kernel without io_uring or buffer rings). Up to
+ * 2 * entries sends may be in flight at once.
+ * ----------------------------------------------------------------------
+ */
+int serlib_uring_init(serlib_uring_t* u, unsigned int entries, int nbufs, int buf_size);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_uring_destroy
+ * ----------------------------------------------------------------------
+ * params  : u - serlib_uring_t*
+ * ----------------------------------------------------------------------
+ * Tears down the ring and its buffer pool. Connections are not closed.
+ * ----------------------------------------------------------------------
+ */
+void serlib_uring_destroy(serlib_uring_t* u);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_uring_conn_init
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > conn     - serlib_uring_conn_t*
+ *         > fd       - int (connected stream socket)
+ *         > on_frame - serlib_uring_frame_fn
+ *         > on_close - serlib_uring_close_fn (may be NULL)
+ *         > ctx      - void*
+ * ----------------------------------------------------------------------
+ * Initializes a connection. on_frame gets each decoded ser_header_t
+ * and a read-only view of its payload, valid only during the callback.
+ * Once the connection is closed, by the peer, an error or
+ * serlib_uring_conn_close, and its last operation has completed, its
+ * reassembly buffer is freed and on_close is called exactly once, with
+ * 0 for EOF, ECANCELED for a local close, EMSGSIZE for a frame over the
+ * payload cap, ENOMEM if reassembly failed, or the error. on_close is
+ * the last callback for the connection, so the conn may be freed there.
+ * ----------------------------------------------------------------------
+ */
+void serlib_uring_conn_init(serlib_uring_conn_t* conn,
+                            int fd,
+                            serlib_uring_frame_fn on_frame,
+                            serlib_uring_close_fn on_close,
+                            void* ctx);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_uring_conn_set_max_payload
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > conn        - serlib_uring_conn_t*
+ *         > max_payload - unsigned int
+ * ----------------------------------------------------------------------
+ * Sets the largest frame payload the connection accepts, by default
+ * SERLIB_URING_MAX_PAYLOAD_DEFAULT. payload_size comes from the peer
+ * and a split frame is buffered until it is whole, so a header over
+ * the cap closes the connection with EMSGSIZE before anything of its
+ * payload is kept. Returns 0 on success, -1 if max_payload is above
+ * SERLIB_URING_MAX_PAYLOAD_LIMIT.
+ * ----------------------------------------------------------------------
+ */
+int serlib_uring_conn_set_max_payload(serlib_uring_conn_t* conn, unsigned int max_payload);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_uring_conn_destroy
+ * ----------------------------------------------------------------------
+ * params  : conn - serlib_uring_conn_t*
+ * ----------------------------------------------------------------------
+ * Frees a connection's reassembly buffer. Does not close the socket.
+ * Only for a connection with nothing in flight: one never armed with
+ * serlib_uring_recv, or one already handed to on_close. An armed
+ * connection must go through serlib_uring_conn_close instead, since
+ * the kernel still holds a pointer to it.
+ * ----------------------------------------------------------------------
+ */
+void serlib_uring_conn_destroy(serlib_uring_conn_t* conn);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_uring_conn_close
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > u    - serlib_uring_t*
+ *         > conn - serlib_uring_conn_t*
+ * ----------------------------------------------------------------------
+ * Closes a connection locally. No new receive or send is accepted, and
+ * an armed multishot receive is cancelled with IORING_OP_ASYNC_CANCEL.
+ * Sends already queued run to completion. The conn must stay alive
+ * until on_close is called, which happens from serlib_uring_run once
+ * the receive's final CQE (one without IORING_CQE_F_MORE), the cancel's
+ * and those of any sends have all arrived; the reassembly buffer is
+ * freed just before. If nothing is in flight, on_close is called before
+ * this returns. Does not close the socket. Returns 0 on success, -1 if
+ * the cancel could not be queued (the call may be retried).
+ * ----------------------------------------------------------------------
+ */
+int serlib_uring_conn_close(serlib_uring_t* u, serlib_uring_conn_t* conn);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_uring_recv
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > u    - serlib_uring_t*
+ *         > conn - serlib_uring_conn_t*
+ * ----------------------------------------------------------------------
+ * Queues a multishot receive on a connection. It stays armed until the
+ * peer closes or an error occurs. Returns 0 on success, -1 if the
+ * connection is closed.
+ * ----------------------------------------------------------------------
+ */
+int serlib_uring_recv(serlib_uring_t* u, serlib_uring_conn_t* conn);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_uring_send
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > u    - serlib_uring_t*
+ *         > conn - serlib_uring_conn_t*
+ *         > b    - ser_buff_t* (b->next bytes, usually header + payload)
+ *         > done - serlib_uring_send_fn (may be NULL)
+ *         > ctx  - void*
+ * ----------------------------------------------------------------------
+ * Queues a send of a serialized buffer. b must stay alive and unchanged
+ * until done is called. Short sends are resubmitted internally. Returns
+ * 0 on success, -1 if no operation slot is free.
+ * ----------------------------------------------------------------------
+ */
+int serlib_uring_send(serlib_uring_t* u,
+                      serlib_uring_conn_t* conn,
+                      ser_buff_t* b,
+                      serlib_uring_send_fn done,
+                      void* ctx);
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_uring_run
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > u        - serlib_uring_t*
+ *         > wait_for - unsigned int
+ * ----------------------------------------------------------------------
+ * Submits every queued operation in one io_uring_enter call, waiting
+ * for at least wait_for completions, then runs the callbacks of all
+ * available completions. Returns the number of completions handled,
+ * or -1 on error.
+ * ----------------------------------------------------------------------
+ */
+int serlib_uring_run(serlib_uring_t* u, unsigned int wait_for);
+
+#endif
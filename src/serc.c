@@ -5,8 +5,14 @@
 #include <ctype.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <stdint.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 #include "../include/serc.h"
+#include "../include/serc_stats.h"
+#include "../include/serc_numa.h"
 
 /*
  * ------------------------------------------------------
@@ -39,6 +45,19 @@ void serlib_init_buffer(ser_buff_t* b) {
 
   // set buffer's next segment
   b->next = 0;
+
+  // no usage seen yet, shrinking is opt-in
+  b->flags = 0;
+  b->high_water = 0;
+  b->window_peak = 0;
+  b->window_resets = 0;
+
+  // heap memory until bound to a node
+  b->node = -1;
+
+  serlib_mem_account(SERLIB_MEM_BUFFERS, b->size);
+
+  SERLIB_STAT_ADD(SERLIB_STAT_BUFFERS_CREATED, 1);
 };
 
 /*
@@ -71,6 +90,15 @@ void serlib_init_buffer_of_size(ser_buff_t** b, int size) {
   }
   (*b)->size = size;
   (*b)->next = 0;
+  (*b)->flags = 0;
+  (*b)->high_water = 0;
+  (*b)->window_peak = 0;
+  (*b)->window_resets = 0;
+  (*b)->node = -1;
+
+  serlib_mem_account(SERLIB_MEM_BUFFERS, size);
+
+  SERLIB_STAT_ADD(SERLIB_STAT_BUFFERS_CREATED, 1);
 };
 
 /*
@@ -110,6 +138,42 @@ ser_header_t* serlib_header_init(int tid, int rpc_proc_id, int rpc_call_id, int
   return ser_header;
 };
 
+/*
+ * ------------------------------------------------------
+ * function: serlib_serialize_header_t
+ * ------------------------------------------------------
+ * params  :
+ *         > b      - ser_buff_t*
+ *         > header - ser_header_t*
+ * ------------------------------------------------------
+ * Serializes a header.
+ * ------------------------------------------------------
+ */
+void serlib_serialize_header_t(ser_buff_t* b, ser_header_t* header) {
+  serlib_serialize_data(b, (char*)&header->tid, sizeof(header->tid));
+  serlib_serialize_data(b, (char*)&header->rpc_proc_id, sizeof(header->rpc_proc_id));
+  serlib_serialize_data(b, (char*)&header->rpc_call_id, sizeof(header->rpc_call_id));
+  serlib_serialize_data(b, (char*)&header->payload_size, sizeof(header->payload_size));
+};
+
+/*
+ * ------------------------------------------------------
+ * function: serlib_deserialize_header_t
+ * ------------------------------------------------------
+ * params  :
+ *         > b      - ser_buff_t*
+ *         > header - ser_header_t*
+ * ------------------------------------------------------
+ * Deserializes a header.
+ * ------------------------------------------------------
+ */
+void serlib_deserialize_header_t(ser_buff_t* b, ser_header_t* header) {
+  serlib_deserialize_data(b, (char*)&header->tid, sizeof(header->tid));
+  serlib_deserialize_data(b, (char*)&header->rpc_proc_id, sizeof(header->rpc_proc_id));
+  serlib_deserialize_data(b, (char*)&header->rpc_call_id, sizeof(header->rpc_call_id));
+  serlib_deserialize_data(b, (char*)&header->payload_size, sizeof(header->payload_size));
+};
+
 /*
  * --------------------------------------------------------------------
  * function: serlib_buffer_skip
@@ -131,7 +195,75 @@ void serlib_buffer_skip(ser_buff_t* b, int skip_size) {
     // skip the buffer
     // (adjust the next pointer)
     b->next += skip_size;
+    return;
+  }
+
+  SERLIB_STAT_ADD(SERLIB_STAT_SKIPS_IGNORED, 1);
+};
+
+/*
+ * --------------------------------------------------------------------
+ * function: serlib_buffer_init_fixed
+ * --------------------------------------------------------------------
+ * params  :
+ *         > b       - ser_buff_t*
+ *         > memory  - char*
+ *         > size    - int
+ *         > options - int (SERLIB_FIXED_PREFAULT | SERLIB_FIXED_MLOCK)
+ * --------------------------------------------------------------------
+ * Initializes a fixed-capacity buffer over caller-provided memory.
+ * --------------------------------------------------------------------
+ */
+int serlib_buffer_init_fixed(ser_buff_t* b, char* memory, int size, int options) {
+  if (!b || !memory || size <= 0) assert(0);
+
+  *b = (ser_buff_t){ .buffer = memory, .size = size, .flags = SERLIB_BUFF_FIXED, .node = -1 };
+
+  if (options & SERLIB_FIXED_PREFAULT) {
+    // touch one byte per page so the first message doesn't page fault;
+    // read and write back so caller data survives
+    long page = sysconf(_SC_PAGESIZE);
+    volatile char* touch = memory;
+    for (long i = 0; i < size; i += page) touch[i] = touch[i];
+    touch[size - 1] = touch[size - 1];
+  }
+
+  if (options & SERLIB_FIXED_MLOCK) {
+    if (mlock(memory, size) < 0) return SERLIB_ERR_MLOCK;
+    b->flags |= SERLIB_BUFF_LOCKED;
   }
+
+  return SERLIB_OK;
+};
+
+/*
+ * --------------------------------------------------------------------
+ * function: serlib_buffer_release_fixed
+ * --------------------------------------------------------------------
+ * params  : b - ser_buff_t*
+ * --------------------------------------------------------------------
+ * Unlocks a fixed buffer's memory if it was locked.
+ * --------------------------------------------------------------------
+ */
+void serlib_buffer_release_fixed(ser_buff_t* b) {
+  assert(b->flags & SERLIB_BUFF_FIXED);
+
+  if (b->flags & SERLIB_BUFF_LOCKED) munlock(b->buffer, b->size);
+  b->flags &= ~SERLIB_BUFF_LOCKED;
+};
+
+/*
+ * --------------------------------------------------------------------
+ * function: serlib_buffer_error
+ * --------------------------------------------------------------------
+ * params  : b - ser_buff_t*
+ * --------------------------------------------------------------------
+ * Returns SERLIB_ERR_OVERFLOW if a write to a fixed buffer has failed
+ * since its last reset, else SERLIB_OK.
+ * --------------------------------------------------------------------
+ */
+int serlib_buffer_error(ser_buff_t* b) {
+  return (b->flags & SERLIB_BUFF_OVERFLOW) ? SERLIB_ERR_OVERFLOW : SERLIB_OK;
 };
 
 /*
@@ -145,6 +277,132 @@ void serlib_buffer_skip(ser_buff_t* b, int skip_size) {
  */
 void serlib_reset_buffer(ser_buff_t* b) {
   b->next = 0;
+  b->flags &= ~SERLIB_BUFF_OVERFLOW;
+
+  if ((b->flags & SERLIB_BUFF_AUTO_SHRINK) && ++b->window_resets >= SERLIB_SHRINK_WINDOW) {
+    serlib_buffer_shrink(b);
+  }
+};
+
+/*
+ * --------------------------------------------------------------------
+ * function: serlib_buffer_high_water
+ * --------------------------------------------------------------------
+ * params  : b - ser_buff_t*
+ * --------------------------------------------------------------------
+ * Returns the most bytes ever serialized into the buffer.
+ * --------------------------------------------------------------------
+ */
+int serlib_buffer_high_water(ser_buff_t* b) {
+  return b->window_peak > b->high_water ? b->window_peak : b->high_water;
+};
+
+/*
+ * --------------------------------------------------------------------
+ * function: serlib_buffer_set_auto_shrink
+ * --------------------------------------------------------------------
+ * params  :
+ *         > b      - ser_buff_t*
+ *         > enable - bool
+ * --------------------------------------------------------------------
+ * Turns adaptive shrinking on or off for a long-lived heap buffer.
+ * --------------------------------------------------------------------
+ */
+void serlib_buffer_set_auto_shrink(ser_buff_t* b, bool enable) {
+  assert(!(b->flags & SERLIB_BUFF_FIXED));
+
+  if (enable) {
+    b->flags |= SERLIB_BUFF_AUTO_SHRINK;
+  } else {
+    b->flags &= ~SERLIB_BUFF_AUTO_SHRINK;
+  }
+  b->window_resets = 0;
+};
+
+/*
+ * --------------------------------------------------------------------
+ * function: serlib_buffer_shrink
+ * --------------------------------------------------------------------
+ * params  : b - ser_buff_t*
+ * --------------------------------------------------------------------
+ * Shrinks a buffer whose recent peak usage is well below its capacity.
+ * Returns the number of bytes released.
+ * --------------------------------------------------------------------
+ */
+int serlib_buffer_shrink(ser_buff_t* b) {
+  if (b == NULL) assert(0);
+
+  int peak = b->window_peak > b->next ? b->window_peak : b->next;
+
+  // start a new usage window either way
+  if (b->window_peak > b->high_water) b->high_water = b->window_peak;
+  b->window_peak = b->next;
+  b->window_resets = 0;
+
+  if (b->flags & SERLIB_BUFF_FIXED) return 0;
+  if (b->size <= SERIALIZE_BUFFER_DEFAULT_SIZE || (long long)peak * SERLIB_SHRINK_RATIO > b->size) return 0;
+
+  // keep room for twice the peak so the next burst doesn't regrow it
+  int size = SERIALIZE_BUFFER_DEFAULT_SIZE;
+  while (size < peak * 2) size *= 2;
+  if (size >= b->size) return 0;
+
+  char* buffer = b->flags & SERLIB_BUFF_NUMA
+    ? serlib_numa_realloc(b->buffer, b->node, (int)size)
+    : realloc(b->buffer, size);
+  if (!buffer) return 0;
+
+  int released = b->size - size;
+  b->buffer = buffer;
+  b->size = size;
+
+  serlib_mem_account(SERLIB_MEM_BUFFERS, -released);
+  return released;
+};
+
+/*
+ * --------------------------------------------------------------------
+ * function: serlib_buffer_set_numa_node
+ * --------------------------------------------------------------------
+ * params  :
+ *         > b    - ser_buff_t*
+ *         > node - int
+ * --------------------------------------------------------------------
+ * Moves a buffer's memory into a NUMA node's pool, or back to the
+ * heap for node -1.
+ * --------------------------------------------------------------------
+ */
+int serlib_buffer_set_numa_node(ser_buff_t* b, int node) {
+  if (b == NULL) assert(0);
+  if (b->flags & SERLIB_BUFF_FIXED) return -1;
+  if (node < -1 || node >= serlib_numa_node_count()) return -1;
+
+  bool bound = b->flags & SERLIB_BUFF_NUMA;
+  if (bound && node == b->node) return 0;
+  if (!bound && node < 0) return 0;
+
+  char* buffer;
+  if (node < 0) {
+    buffer = malloc(b->size);
+    if (!buffer) {
+      printf("ERROR:: serlib - Failed to allocate memory for ser buffer's buffer in serlib_buffer_set_numa_node\n");
+      exit(1);
+    }
+    memcpy(buffer, b->buffer, b->size);
+    serlib_numa_free(b->buffer);
+  } else if (bound) {
+    buffer = serlib_numa_realloc(b->buffer, node, b->size);
+  } else {
+    buffer = serlib_numa_alloc(node, b->size);
+    memcpy(buffer, b->buffer, b->size);
+    free(b->buffer);
+  }
+
+  b->buffer = buffer;
+  b->node = node;
+  if (node < 0) b->flags &= ~SERLIB_BUFF_NUMA;
+  else b->flags |= SERLIB_BUFF_NUMA;
+  return 0;
 };
 
 /*
@@ -201,144 +459,566 @@ void serlib_copy_in_buffer_by_offset(ser_buff_t* client_send_ser_buffer, int siz
  * --------------------------------------------
  */
 void serlib_free_buffer(ser_buff_t* b) {
-  free(b->buffer);
+  serlib_mem_account(SERLIB_MEM_BUFFERS, -b->size);
+
+  if (b->flags & SERLIB_BUFF_NUMA) serlib_numa_free(b->buffer);
+  else free(b->buffer);
   free(b);
+
+  SERLIB_STAT_ADD(SERLIB_STAT_BUFFERS_FREED, 1);
 };
 
 /*
- * ------------------------------------------------------------------------
- * function: serlib_serialize_data
- * ------------------------------------------------------------------------
- * params  : 
- *           > b      - ser_buff_t**
- *           > data   - char*
- *           > nbytes - int
- * ------------------------------------------------------------------------
- * Serializes string data to a given valid serialized string buffer.
- * ------------------------------------------------------------------------
+ * --------------------------------------------------------------------
+ * function: serlib_buffer_freeze
+ * --------------------------------------------------------------------
+ * params  : b - ser_buff_t*
+ * --------------------------------------------------------------------
+ * Turns a finished buffer into an immutable, reference counted frozen
+ * buffer without copying.
+ * --------------------------------------------------------------------
  */
-void serlib_serialize_data(ser_buff_t* b, char* data, int nbytes) {
-  if (b == NULL) assert(0);
+ser_frozen_t* serlib_buffer_freeze(ser_buff_t* b) {
+  if (!b || !b->buffer) assert(0);
 
-  ser_buff_t* buff = (ser_buff_t*)(b);
-  // get total available size of buffer
-  int available_size = buff->size - buff->next;
-  // resize flag used for resizing buffer
-  int should_resize = 0;
+  // a fixed buffer's shell and memory belong to the caller
+  if (b->flags & SERLIB_BUFF_FIXED) assert(0);
 
-  // if we don't have enough memory for data in buffer
-  while(available_size < nbytes) {
-    // increase (multiply) buffer size by 2
-    buff->size = buff->size * 2;
+  ser_frozen_t* frozen = (ser_frozen_t*) malloc(sizeof(ser_frozen_t));
+  if (!frozen) {
+    printf("ERROR:: serlib - Failed to allocate memory for frozen buffer in serlib_buffer_freeze\n");
+    exit(1);
+  }
 
-    // update total available size
-    available_size = buff->size - buff->next;
+  // take over the buffer's memory, the shell is no longer needed
+  atomic_init(&frozen->refs, 1);
+  frozen->size = b->next;
+  frozen->capacity = b->size;
+  frozen->flags = b->flags & SERLIB_BUFF_NUMA;
+  frozen->buffer = b->buffer;
+  free(b);
 
-    // set should resize flag
-    should_resize = 1;
-  }
+  return frozen;
+};
 
-  // else we have enough memory for data in buffer
-  if (should_resize == 0) {
-    // copy data from src to buffer's buffer (b->buffer)
-    memcpy((char*)buff->buffer + buff->next, data, nbytes);
+/*
+ * --------------------------------------------------------------------
+ * function: serlib_frozen_retain
+ * --------------------------------------------------------------------
+ * params  : frozen - ser_frozen_t*
+ * --------------------------------------------------------------------
+ * Takes a reference on a frozen buffer.
+ * --------------------------------------------------------------------
+ */
+void serlib_frozen_retain(ser_frozen_t* frozen) {
+  atomic_fetch_add_explicit(&frozen->refs, 1, memory_order_relaxed);
+};
 
-    // increase the buffers next memory to nbytes
-    buff->next += nbytes;
+/*
+ * --------------------------------------------------------------------
+ * function: serlib_frozen_release
+ * --------------------------------------------------------------------
+ * params  : frozen - ser_frozen_t*
+ * --------------------------------------------------------------------
+ * Drops a reference on a frozen buffer, freeing it with the last one.
+ * --------------------------------------------------------------------
+ */
+void serlib_frozen_release(ser_frozen_t* frozen) {
+  if (atomic_fetch_sub_explicit(&frozen->refs, 1, memory_order_acq_rel) == 1) {
+    serlib_mem_account(SERLIB_MEM_BUFFERS, -frozen->capacity);
 
-    return;
+    if (frozen->flags & SERLIB_BUFF_NUMA) serlib_numa_free(frozen->buffer);
+    else free(frozen->buffer);
+    free(frozen);
   }
+};
+
+/*
+ * --------------------------------------------------------------------
+ * function: serlib_slice_new
+ * --------------------------------------------------------------------
+ * params  :
+ *         > slice  - ser_slice_t*
+ *         > frozen - ser_frozen_t*
+ *         > offset - int
+ *         > size   - int
+ * --------------------------------------------------------------------
+ * Creates a slice over a range of a frozen buffer.
+ * --------------------------------------------------------------------
+ */
+int serlib_slice_new(ser_slice_t* slice, ser_frozen_t* frozen, int offset, int size) {
+  if (offset < 0 || size < 0 || offset > frozen->size - size) return -1;
 
-  // resize the buffer
-  buff->buffer = realloc(buff->buffer, buff->size);
+  serlib_frozen_retain(frozen);
+  slice->frozen = frozen;
+  slice->data = frozen->buffer + offset;
+  slice->size = size;
 
-  // copy data to buffer's buffer (b->buffer)
-  memcpy((char*)buff->buffer + buff->next, data, nbytes);
+  return 0;
+};
 
-  // increase buffer's next memory by nbtyes
-  buff->next += nbytes;
+/*
+ * --------------------------------------------------------------------
+ * function: serlib_slice_sub
+ * --------------------------------------------------------------------
+ * params  :
+ *         > slice  - ser_slice_t*
+ *         > parent - ser_slice_t*
+ *         > offset - int
+ *         > size   - int
+ * --------------------------------------------------------------------
+ * Creates a slice over a range of another slice.
+ * --------------------------------------------------------------------
+ */
+int serlib_slice_sub(ser_slice_t* slice, ser_slice_t* parent, int offset, int size) {
+  if (offset < 0 || size < 0 || offset > parent->size - size) return -1;
 
-  return;
+  return serlib_slice_new(slice, parent->frozen,
+                          (int)(parent->data - parent->frozen->buffer) + offset, size);
 };
 
 /*
- * ----------------------------------------------------------------------
- * function: serlib_serialize_data_int_ptr
- * ----------------------------------------------------------------------
+ * --------------------------------------------------------------------
+ * function: serlib_slice_frame
+ * --------------------------------------------------------------------
+ * params  :
+ *         > frozen  - ser_frozen_t*
+ *         > offset  - int
+ *         > header  - ser_slice_t*
+ *         > payload - ser_slice_t*
+ * --------------------------------------------------------------------
+ * Slices a serialized header and the payload that follows it.
+ * --------------------------------------------------------------------
+ */
+int serlib_slice_frame(ser_frozen_t* frozen, int offset, ser_slice_t* header, ser_slice_t* payload) {
+  int header_size = serlib_header_get_size();
+  if (offset < 0 || offset > frozen->size - header_size) return -1;
+
+  // payload_size is the last field of the serialized header
+  unsigned int payload_size;
+  memcpy(&payload_size, frozen->buffer + offset + header_size - sizeof(unsigned int), sizeof(unsigned int));
+  if (payload_size > (unsigned int)(frozen->size - offset - header_size)) return -1;
+
+  serlib_slice_new(header, frozen, offset, header_size);
+  serlib_slice_new(payload, frozen, offset + header_size, payload_size);
+
+  return 0;
+};
+
+/*
+ * --------------------------------------------------------------------
+ * function: serlib_slice_release
+ * --------------------------------------------------------------------
+ * params  : slice - ser_slice_t*
+ * --------------------------------------------------------------------
+ * Drops a slice's reference on its frozen buffer.
+ * --------------------------------------------------------------------
+ */
+void serlib_slice_release(ser_slice_t* slice) {
+  if (!slice->frozen) return;
+
+  serlib_frozen_release(slice->frozen);
+  slice->frozen = NULL;
+  slice->data = NULL;
+  slice->size = 0;
+};
+
+/*
+ * --------------------------------------------------------------------
+ * function: serlib_slice_as_buffer
+ * --------------------------------------------------------------------
+ * params  :
+ *         > slice - ser_slice_t*
+ *         > view  - ser_buff_t*
+ * --------------------------------------------------------------------
+ * Fills view with a read-only buffer over the slice.
+ * --------------------------------------------------------------------
+ */
+void serlib_slice_as_buffer(ser_slice_t* slice, ser_buff_t* view) {
+  *view = (ser_buff_t){ .buffer = slice->data, .size = slice->size, .flags = SERLIB_BUFF_FIXED, .node = -1 };
+};
+
+/*
+ * ------------------------------------------------------------------------
+ * function: serlib_buffer_grow
+ * ------------------------------------------------------------------------
  * params  :
  *         > b      - ser_buff_t*
- *         > data   - int*
  *         > nbytes - int
- * ----------------------------------------------------------------------
- * Deserializes a buffers' string buffer for an integer.
- * ----------------------------------------------------------------------
+ * ------------------------------------------------------------------------
+ * Doubles a heap buffer's size until nbytes fit past b->next.
+ * ------------------------------------------------------------------------
  */
-void serlib_serialize_data_int_ptr(ser_buff_t* b, int* data, int nbytes) {
-  if (b == NULL) assert(0);
+static void serlib_buffer_grow(ser_buff_t* b, int nbytes) {
+  // b->next + nbytes fits in an int, the doubled size may not
+  long long size = b->size > 0 ? b->size : SERIALIZE_BUFFER_DEFAULT_SIZE;
+  while (size - b->next < nbytes) size *= 2;
+  if (size > 0x7fffffff) size = 0x7fffffff;
+
+  // a bound buffer grows within its node's pool, not the writer's arena
+  char* buffer = b->flags & SERLIB_BUFF_NUMA
+    ? serlib_numa_realloc(b->buffer, b->node, size)
+    : realloc(b->buffer, size);
+  if (!buffer) {
+    printf("ERROR:: serlib - Failed to reallocate memory for ser buffer's buffer in serlib_buffer_grow\n");
+    exit(1);
+  }
 
-  ser_buff_t* buff = (ser_buff_t*)(b);
-  // get total available size of buffer
-  int available_size = buff->size - buff->next;
-  // resize flag used for resizing buffer
-  int should_resize = 0;
+  SERLIB_STAT_ADD(SERLIB_STAT_REALLOCS, 1);
+  SERLIB_STAT_ADD(SERLIB_STAT_REALLOC_BYTES, size - b->size);
+  serlib_mem_account(SERLIB_MEM_BUFFERS, size - b->size);
 
-  // if we don't have enough memory for data in buffer
-  while(available_size < nbytes) {
-    // increase (multiply) buffer size by 2
-    buff->size = buff->size * 2;
+  b->buffer = buffer;
+  b->size = (int)size;
+};
 
-    // update total available size
-    available_size = buff->size - buff->next;
+/*
+ * ------------------------------------------------------------------------
+ * function: serlib_buffer_reserve
+ * ------------------------------------------------------------------------
+ * params  :
+ *         > b      - ser_buff_t*
+ *         > nbytes - int
+ * ------------------------------------------------------------------------
+ * Doubles the buffer's size until nbytes fit past b->next, and records
+ * the write in the buffer's usage window. A fixed buffer is never grown;
+ * it is marked overflowed and SERLIB_ERR_OVERFLOW is returned instead,
+ * as for a size past what an int can index.
+ * ------------------------------------------------------------------------
+ */
+int serlib_buffer_reserve(ser_buff_t* b, int nbytes) {
+  if (nbytes < 0 || nbytes > 0x7fffffff - b->next) {
+    b->flags |= SERLIB_BUFF_OVERFLOW;
+    return SERLIB_ERR_OVERFLOW;
+  }
 
-    // set should resize flag
-    should_resize = 1;
+  if (b->size - b->next < nbytes) {
+    if (b->flags & SERLIB_BUFF_FIXED) {
+      b->flags |= SERLIB_BUFF_OVERFLOW;
+      SERLIB_STAT_ADD(SERLIB_STAT_OVERFLOWS, 1);
+      return SERLIB_ERR_OVERFLOW;
+    }
+    serlib_buffer_grow(b, nbytes);
   }
 
-  // else we have enough memory for data in buffer
-  if (should_resize == 0) {
-    // copy data from src to buffer's buffer (b->buffer)
-    memcpy((int*)buff->buffer + buff->next, data, nbytes);
+  if (b->next + nbytes > b->window_peak) b->window_peak = b->next + nbytes;
+  return SERLIB_OK;
+};
 
-    // increase the buffers next memory to nbytes
-    buff->next += nbytes;
+/*
+ * ------------------------------------------------------------------------
+ * function: serlib_serialize_data
+ * ------------------------------------------------------------------------
+ * params  : 
+ *           > b      - ser_buff_t**
+ *           > data   - char*
+ *           > nbytes - int
+ * ------------------------------------------------------------------------
+ * Serializes string data to a given valid serialized string buffer.
+ * Returns SERLIB_OK, or SERLIB_ERR_OVERFLOW if b is a fixed buffer
+ * without room for nbytes (nothing is written).
+ * ------------------------------------------------------------------------
+ */
+int serlib_serialize_data(ser_buff_t* b, char* data, int nbytes) {
+  if (b == NULL) assert(0);
 
-    return;
-  }
+  SERLIB_STAT_TIME_START(started);
 
-  // resize the buffer
-  buff->buffer = realloc(buff->buffer, buff->size);
+  if (serlib_buffer_reserve(b, nbytes) < 0) return SERLIB_ERR_OVERFLOW;
 
   // copy data to buffer's buffer (b->buffer)
-  memcpy((int*)buff->buffer + buff->next, data, nbytes);
+  memcpy(b->buffer + b->next, data, nbytes);
 
-  // increase buffer's next memory by nbtyes
-  buff->next += nbytes;
+  // increase buffer's next memory by nbytes
+  b->next += nbytes;
 
-  return;
-}
+  SERLIB_STAT_ADD(SERLIB_STAT_BYTES_SERIALIZED, nbytes);
+  SERLIB_STAT_TIME_END(SERLIB_HIST_SERIALIZE, started);
+
+  return SERLIB_OK;
+};
 
 /*
  * ----------------------------------------------------------------------
- * function: serlib_deserialize_data_int
+ * function: serlib_cbuff_segment_start
  * ----------------------------------------------------------------------
  * params  :
- *         > dest - int*
- *         > b    - ser_buff_t*
- *         > size - int
+ *         > cb      - ser_cbuff_t*
+ *         > segment - int
  * ----------------------------------------------------------------------
- * Deserializes a buffers' string buffer for an integer.
+ * Returns the logical offset where a segment begins.
  * ----------------------------------------------------------------------
  */
-void serlib_deserialize_data_int(ser_buff_t* b, int dest, int size) {
-  if (!b || !b->buffer) assert(0);
-  if (!size) return;
-  if ((b->size - b->next) < size) assert(0);
+static long long serlib_cbuff_segment_start(ser_cbuff_t* cb, int segment) {
+  return (long long)cb->base_size * ((1LL << segment) - 1);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_cbuff_segment_of
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > cb     - ser_cbuff_t*
+ *         > offset - long long
+ * ----------------------------------------------------------------------
+ * Returns the segment holding a logical offset.
+ * ----------------------------------------------------------------------
+ */
+static int serlib_cbuff_segment_of(ser_cbuff_t* cb, long long offset) {
+  int segment = 63 - __builtin_clzll((unsigned long long)(offset / cb->base_size) + 1);
+  if (segment >= SERLIB_CBUFF_SEGMENTS) {
+    printf("ERROR:: serlib - Concurrent buffer is out of segments in serlib_cbuff_segment_of\n");
+    exit(1);
+  }
+
+  return segment;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_cbuff_segment_get
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > cb      - ser_cbuff_t*
+ *         > segment - int
+ * ----------------------------------------------------------------------
+ * Returns a segment's memory, allocating it if this is the first
+ * reservation to land in it. Racing allocators keep the first winner.
+ * ----------------------------------------------------------------------
+ */
+static char* serlib_cbuff_segment_get(ser_cbuff_t* cb, int segment) {
+  char* buffer = atomic_load_explicit(&cb->segments[segment].buffer, memory_order_acquire);
+  if (buffer) return buffer;
+
+  char* fresh = malloc((size_t)cb->base_size << segment);
+  if (!fresh) {
+    printf("ERROR:: serlib - Failed to allocate memory for concurrent buffer segment in serlib_cbuff_segment_get\n");
+    exit(1);
+  }
+
+  if (!atomic_compare_exchange_strong_explicit(&cb->segments[segment].buffer, &buffer, fresh,
+                                               memory_order_acq_rel, memory_order_acquire)) {
+    free(fresh);
+    return buffer;
+  }
+
+  serlib_mem_account(SERLIB_MEM_BUFFERS, (long long)cb->base_size << segment);
+  return fresh;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_cbuff_init
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > cb        - ser_cbuff_t*
+ *         > base_size - int
+ * ----------------------------------------------------------------------
+ * Initializes a concurrent append buffer.
+ * ----------------------------------------------------------------------
+ */
+void serlib_cbuff_init(ser_cbuff_t* cb, int base_size) {
+  assert(base_size > 0);
+
+  atomic_init(&cb->reserved, 0);
+  atomic_init(&cb->committed, 0);
+  cb->base_size = base_size;
+
+  for (int i = 0; i < SERLIB_CBUFF_SEGMENTS; i++) {
+    atomic_init(&cb->segments[i].buffer, NULL);
+    cb->segments[i].head_skip = 0;
+    cb->segments[i].used_end = -1;
+  }
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_cbuff_reserve
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > cb     - ser_cbuff_t*
+ *         > nbytes - int
+ * ----------------------------------------------------------------------
+ * Reserves nbytes of contiguous space and returns a pointer to it.
+ * ----------------------------------------------------------------------
+ */
+char* serlib_cbuff_reserve(ser_cbuff_t* cb, int nbytes) {
+  assert(nbytes > 0);
+
+  for (;;) {
+    long long offset = atomic_fetch_add_explicit(&cb->reserved, nbytes, memory_order_relaxed);
+    int first = serlib_cbuff_segment_of(cb, offset);
+    int last = serlib_cbuff_segment_of(cb, offset + nbytes - 1);
+
+    if (first == last) {
+      return serlib_cbuff_segment_get(cb, first) + (offset - serlib_cbuff_segment_start(cb, first));
+    }
+
+    // the range straddles a segment boundary; only this reservation can
+    // cross it, so record the dead bytes on both sides and try again
+    cb->segments[first].used_end = offset - serlib_cbuff_segment_start(cb, first);
+    for (int i = first + 1; i <= last; i++) {
+      long long start = serlib_cbuff_segment_start(cb, i);
+      long long end = serlib_cbuff_segment_start(cb, i + 1);
+      cb->segments[i].head_skip = (offset + nbytes < end ? offset + nbytes : end) - start;
+    }
+    atomic_fetch_add_explicit(&cb->committed, nbytes, memory_order_release);
+  }
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_cbuff_commit
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > cb     - ser_cbuff_t*
+ *         > nbytes - int
+ * ----------------------------------------------------------------------
+ * Publishes a completed reservation of nbytes.
+ * ----------------------------------------------------------------------
+ */
+void serlib_cbuff_commit(ser_cbuff_t* cb, int nbytes) {
+  atomic_fetch_add_explicit(&cb->committed, nbytes, memory_order_release);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_cbuff_append
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > cb     - ser_cbuff_t*
+ *         > data   - char*
+ *         > nbytes - int
+ * ----------------------------------------------------------------------
+ * Reserves, copies and commits nbytes of data.
+ * ----------------------------------------------------------------------
+ */
+void serlib_cbuff_append(ser_cbuff_t* cb, char* data, int nbytes) {
+  char* dest = serlib_cbuff_reserve(cb, nbytes);
+  memcpy(dest, data, nbytes);
+  serlib_cbuff_commit(cb, nbytes);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_cbuff_finish
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > cb - ser_cbuff_t*
+ *         > b  - ser_buff_t*
+ * ----------------------------------------------------------------------
+ * Serializes the appended records into b and resets cb.
+ * ----------------------------------------------------------------------
+ */
+void serlib_cbuff_finish(ser_cbuff_t* cb, ser_buff_t* b) {
+  long long reserved = atomic_load_explicit(&cb->reserved, memory_order_relaxed);
+
+  // wait for writers that reserved but have not published yet
+  while (atomic_load_explicit(&cb->committed, memory_order_acquire) != reserved) {
+    sched_yield();
+  }
+
+  for (int i = 0; i < SERLIB_CBUFF_SEGMENTS; i++) {
+    long long start = serlib_cbuff_segment_start(cb, i);
+    if (start >= reserved) break;
+
+    ser_cbuff_segment_t* segment = &cb->segments[i];
+    long long end = serlib_cbuff_segment_start(cb, i + 1);
+    if (end > reserved) end = reserved;
+    end -= start;
+    if (segment->used_end >= 0 && segment->used_end < end) end = segment->used_end;
+
+    if (end > segment->head_skip) {
+      char* buffer = atomic_load_explicit(&segment->buffer, memory_order_relaxed);
+      serlib_serialize_data(b, buffer + segment->head_skip, (int)(end - segment->head_skip));
+    }
+
+    segment->head_skip = 0;
+    segment->used_end = -1;
+  }
+
+  atomic_store_explicit(&cb->reserved, 0, memory_order_relaxed);
+  atomic_store_explicit(&cb->committed, 0, memory_order_relaxed);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_cbuff_free
+ * ----------------------------------------------------------------------
+ * params  : cb - ser_cbuff_t*
+ * ----------------------------------------------------------------------
+ * Frees a concurrent append buffer's segments.
+ * ----------------------------------------------------------------------
+ */
+void serlib_cbuff_free(ser_cbuff_t* cb) {
+  for (int i = 0; i < SERLIB_CBUFF_SEGMENTS; i++) {
+    char* buffer = atomic_load_explicit(&cb->segments[i].buffer, memory_order_relaxed);
+    if (!buffer) continue;
+
+    serlib_mem_account(SERLIB_MEM_BUFFERS, -((long long)cb->base_size << i));
+    free(buffer);
+    atomic_store_explicit(&cb->segments[i].buffer, NULL, memory_order_relaxed);
+  }
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_serialize_data_int_ptr
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > b      - ser_buff_t*
+ *         > data   - int*
+ *         > nbytes - int
+ * ----------------------------------------------------------------------
+ * Serializes nbytes of integer data.
+ * ----------------------------------------------------------------------
+ */
+int serlib_serialize_data_int_ptr(ser_buff_t* b, int* data, int nbytes) {
+  if (b == NULL) assert(0);
+
+  SERLIB_STAT_TIME_START(started);
+
+  if (serlib_buffer_reserve(b, nbytes) < 0) return SERLIB_ERR_OVERFLOW;
+
+  // copy data to buffer's buffer (b->buffer)
+  memcpy(b->buffer + b->next, data, nbytes);
+
+  // increase buffer's next memory by nbytes
+  b->next += nbytes;
+
+  SERLIB_STAT_ADD(SERLIB_STAT_BYTES_SERIALIZED, nbytes);
+  SERLIB_STAT_TIME_END(SERLIB_HIST_SERIALIZE, started);
+
+  return SERLIB_OK;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_deserialize_data_int
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > dest - int*
+ *         > b    - ser_buff_t*
+ *         > size - int
+ * ----------------------------------------------------------------------
+ * Deserializes a buffers' string buffer for an integer.
+ * ----------------------------------------------------------------------
+ */
+void serlib_deserialize_data_int(ser_buff_t* b, int dest, int size) {
+  if (!b || !b->buffer) assert(0);
+  if (!size) return;
+  if ((b->size - b->next) < size) assert(0);
+
+  SERLIB_STAT_TIME_START(started);
 
   // copy data from dest to string buffer
   dest = (int)*(b->buffer + b->next);
 
   // increment the buffer's next pointer
   b->next += size;
+
+  SERLIB_STAT_ADD(SERLIB_STAT_BYTES_DESERIALIZED, size);
+  SERLIB_STAT_TIME_END(SERLIB_HIST_DESERIALIZE, started);
 };
 
 /*
@@ -358,11 +1038,16 @@ void serlib_deserialize_data_int_ptr(ser_buff_t* b, int* dest, int size) {
   if (!size) return;
   if ((b->size - b->next) < size) assert(0);
 
+  SERLIB_STAT_TIME_START(started);
+
   // copy data from dest to string buffer
   memcpy(dest, (int*)(b->buffer + b->next), size);
 
   // increment the buffer's next pointer
   b->next += size;
+
+  SERLIB_STAT_ADD(SERLIB_STAT_BYTES_DESERIALIZED, size);
+  SERLIB_STAT_TIME_END(SERLIB_HIST_DESERIALIZE, started);
 };
 
 /*
@@ -371,51 +1056,26 @@ void serlib_deserialize_data_int_ptr(ser_buff_t* b, int* dest, int size) {
  * ----------------------------------------------------------------------
  * params  : b - ser_buff_t*
  * ----------------------------------------------------------------------
- * Serializes a buffers' employee_t buffer.
+ * Serializes a time_t.
  * ----------------------------------------------------------------------
  */
-void serlib_serialize_time_t(ser_buff_t* b, time_t* data, int size) {
+int serlib_serialize_time_t(ser_buff_t* b, time_t* data, int size) {
   if (b == NULL) assert(0);
 
-  ser_buff_t* buff = (ser_buff_t*)(b);
-  // get total available size of buffer
-  int available_size = buff->size - buff->next;
-  // resize flag used for resizing buffer
-  int should_resize = 0;
-
-  // if we don't have enough memory for data in buffer
-  while(available_size < size) {
-    // increase (multiply) buffer size by 2
-    buff->size = buff->size * 2;
-
-    // update total available size
-    available_size = buff->size - buff->next;
-
-    // set should resize flag
-    should_resize = 1;
-  }
-
-  // else we have enough memory for data in buffer
-  if (should_resize == 0) {
-    // copy data from src to buffer's buffer (b->buffer)
-    memcpy((time_t*)buff->buffer + buff->next, data, size);
-
-    // increase the buffers next memory to nbytes
-    buff->next += size;
-
-    return;
-  }
+  SERLIB_STAT_TIME_START(started);
 
-  // resize the buffer
-  buff->buffer = realloc(buff->buffer, buff->size);
+  if (serlib_buffer_reserve(b, size) < 0) return SERLIB_ERR_OVERFLOW;
 
   // copy data to buffer's buffer (b->buffer)
-  memcpy((time_t*)buff->buffer + buff->next, data, size);
+  memcpy(b->buffer + b->next, data, size);
+
+  // increase buffer's next memory by nbytes
+  b->next += size;
 
-  // increase buffer's next memory by nbtyes
-  buff->next += size;
+  SERLIB_STAT_ADD(SERLIB_STAT_BYTES_SERIALIZED, size);
+  SERLIB_STAT_TIME_END(SERLIB_HIST_SERIALIZE, started);
 
-  return;
+  return SERLIB_OK;
 };
 
 /*
@@ -432,11 +1092,16 @@ void serlib_deserialize_time_t(ser_buff_t*b, time_t* dest, int size) {
   if (!size) return;
   if ((b->size - b->next) < size) assert(0);
 
+  SERLIB_STAT_TIME_START(started);
+
   // copy data from dest to string buffer
   memcpy(dest, (b->buffer + b->next), size);
 
   // increment the buffer's next pointer
   b->next += size;
+
+  SERLIB_STAT_ADD(SERLIB_STAT_BYTES_DESERIALIZED, size);
+  SERLIB_STAT_TIME_END(SERLIB_HIST_DESERIALIZE, started);
 };
 
 /*
@@ -456,11 +1121,35 @@ void serlib_deserialize_data(ser_buff_t* b, char* dest, int size) {
   if (!size) return;
   if ((b->size - b->next) < size) assert(0);
 
+  SERLIB_STAT_TIME_START(started);
+
   // copy data from dest to string buffer
   memcpy(dest, b->buffer + b->next, size);
 
   // increment the buffer's next pointer
   b->next += size;
+
+  SERLIB_STAT_ADD(SERLIB_STAT_BYTES_DESERIALIZED, size);
+  SERLIB_STAT_TIME_END(SERLIB_HIST_DESERIALIZE, started);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_account
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > list  - list_t*
+ *         > bytes - long long
+ * ----------------------------------------------------------------------
+ * Adjusts a list's byte count, its high water mark and the global
+ * list accounting.
+ * ----------------------------------------------------------------------
+ */
+static void serlib_list_account(list_t* list, long long bytes) {
+  list->bytes += bytes;
+  if (list->bytes > list->high_water) list->high_water = list->bytes;
+
+  serlib_mem_account(SERLIB_MEM_LISTS, bytes);
 };
 
 /*
@@ -483,7 +1172,9 @@ void serlib_serialize_list_t(list_t* list,
     return;
   }
 
+  SERLIB_STAT_TIME_START(started);
   serlib_serialize_list_node_t(list->head, b, serialize_fn_ptr);
+  SERLIB_STAT_TIME_END(SERLIB_HIST_SERIALIZE_LIST, started);
 };
 
 /*
@@ -508,27 +1199,206 @@ void serlib_serialize_list_node_t(list_node_t* list_node, ser_buff_t* b, void (*
   serlib_serialize_list_node_t(list_node->next, b, serialize_fn_ptr);
 };
 
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_serialize_list_t_cached
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > list             - list_t*
+ *         > b                - ser_buff_t*
+ *         > serialize_fn_ptr - function pointer to function (void*, ser_buff_t*)
+ * ----------------------------------------------------------------------
+ * Serializes a list, re-encoding only dirty nodes.
+ * ----------------------------------------------------------------------
+ */
+int serlib_serialize_list_t_cached(list_t* list,
+                                   ser_buff_t* b,
+                                   void (*serialize_fn_ptr)(void*, ser_buff_t*))
+{
+  if (b == NULL) assert(0);
+
+  unsigned int sentinel = 0xFFFFFFFF;
+  if (!list) return serlib_serialize_data(b, (char*)&sentinel, sizeof(unsigned int));
+
+  list_node_t* node = list->head;
+  for (int i = 0; i < list->logical_length; i++, node = node->next) {
+    // clean node, copy its last encoding as is
+    if (!node->dirty && node->encoding) {
+      if (serlib_serialize_data(b, node->encoding, node->encoding_size) != SERLIB_OK) return SERLIB_ERR_OVERFLOW;
+      continue;
+    }
+
+    // dirty node, encode it and keep a copy of the bytes
+    int start = b->next;
+    serialize_fn_ptr(node->data, b);
+
+    // a truncated encoding is not cached; the node stays dirty with its
+    // previous bytes
+    if (serlib_buffer_error(b) != SERLIB_OK) return SERLIB_ERR_OVERFLOW;
+
+    int encoding_size = b->next - start;
+
+    if (encoding_size != node->encoding_size || !node->encoding) {
+      char* encoding = realloc(node->encoding, encoding_size ? encoding_size : 1);
+      if (!encoding) {
+        printf("ERROR:: serlib - Failed to allocate memory for node encoding in serlib_serialize_list_t_cached\n");
+        exit(1);
+      }
+      serlib_list_account(list, encoding_size - node->encoding_size);
+      node->encoding = encoding;
+      node->encoding_size = encoding_size;
+    }
+
+    memcpy(node->encoding, b->buffer + start, encoding_size);
+    node->dirty = false;
+  }
+
+  return serlib_serialize_data(b, (char*)&sentinel, sizeof(unsigned int));
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_chunker_init
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > chunker          - serlib_list_chunker_t*
+ *         > list             - list_t*
+ *         > serialize_fn_ptr - function pointer to function (void*, ser_buff_t*)
+ * ----------------------------------------------------------------------
+ * Prepares a resumable chunked list serializer.
+ * ----------------------------------------------------------------------
+ */
+void serlib_list_chunker_init(serlib_list_chunker_t* chunker,
+                              list_t* list,
+                              void (*serialize_fn_ptr)(void*, ser_buff_t*))
+{
+  assert(serialize_fn_ptr != NULL);
+
+  chunker->list = list;
+  chunker->node = list ? list->head : NULL;
+  chunker->index = 0;
+  chunker->scratch_pos = 0;
+  chunker->sentinel_done = false;
+  chunker->finished = false;
+  chunker->serialize_fn_ptr = serialize_fn_ptr;
+  serlib_init_buffer_of_size(&chunker->scratch, SERIALIZE_BUFFER_DEFAULT_SIZE);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_serialize_list_chunk
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > chunker  - serlib_list_chunker_t*
+ *         > out      - char*
+ *         > out_size - int
+ * ----------------------------------------------------------------------
+ * Fills out with the next chunk of the serialized list.
+ * ----------------------------------------------------------------------
+ */
+int serlib_serialize_list_chunk(serlib_list_chunker_t* chunker, char* out, int out_size) {
+  ser_buff_t* scratch = chunker->scratch;
+  int written = 0;
+
+  while (written < out_size) {
+    // drain what is left of the current element first
+    if (chunker->scratch_pos < scratch->next) {
+      int n = scratch->next - chunker->scratch_pos;
+      if (n > out_size - written) n = out_size - written;
+
+      memcpy(out + written, scratch->buffer + chunker->scratch_pos, n);
+      chunker->scratch_pos += n;
+      written += n;
+      continue;
+    }
+
+    if (chunker->finished) break;
+
+    // encode the next element (or the sentinel) into the scratch buffer
+    serlib_reset_buffer(scratch);
+    chunker->scratch_pos = 0;
+
+    int length = chunker->list ? chunker->list->logical_length : 0;
+    if (chunker->index < length) {
+      chunker->serialize_fn_ptr(chunker->node->data, scratch);
+      chunker->node = chunker->node->next;
+      chunker->index++;
+    } else if (!chunker->sentinel_done) {
+      unsigned int sentinel = 0xFFFFFFFF;
+      serlib_serialize_data(scratch, (char*)&sentinel, sizeof(unsigned int));
+      chunker->sentinel_done = true;
+    } else {
+      chunker->finished = true;
+    }
+  }
+
+  return written;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_chunker_done
+ * ----------------------------------------------------------------------
+ * params  : chunker - serlib_list_chunker_t*
+ * ----------------------------------------------------------------------
+ * Returns true once every byte of the list has been emitted.
+ * ----------------------------------------------------------------------
+ */
+bool serlib_list_chunker_done(serlib_list_chunker_t* chunker) {
+  return chunker->sentinel_done && chunker->scratch_pos == chunker->scratch->next;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_chunker_free
+ * ----------------------------------------------------------------------
+ * params  : chunker - serlib_list_chunker_t*
+ * ----------------------------------------------------------------------
+ * Frees a chunker's element scratch buffer.
+ * ----------------------------------------------------------------------
+ */
+void serlib_list_chunker_free(serlib_list_chunker_t* chunker) {
+  serlib_free_buffer(chunker->scratch);
+  chunker->scratch = NULL;
+};
+
+static list_node_t* serlib_list_take_node(list_t* list);
+
 /*
  * ------------------------------------------------------------------------------
  * function: serlib_deserialize_list_t
  * ------------------------------------------------------------------------------
  * params  :
- *         > b                - ser_buff_t*
- *         > serialize_fn_ptr - function pointer to function (void*, ser_buff_t*)
+ *         > b                  - ser_buff_t*
+ *         > elem_size          - int
+ *         > deserialize_fn_ptr - function pointer to function (void*, ser_buff_t*)
  * ------------------------------------------------------------------------------
- * Deserializes a employee list.
+ * Deserializes a list written by serlib_serialize_list_t into a new heap
+ * allocated list, reading elements until the sentinel.
  * ------------------------------------------------------------------------------
  */
-list_t* serlib_deserialize_list_t(ser_buff_t* b, void (*deserialize_fn_ptr)(void*, ser_buff_t*)) {
+list_t* serlib_deserialize_list_t(ser_buff_t* b, int elem_size, void (*deserialize_fn_ptr)(void*, ser_buff_t*)) {
   if (!b || !b->buffer) return NULL;
 
   // create new generic linked list memory
   list_t* list = malloc(sizeof(list_t));
-  serlib_list_new(list, sizeof(list_t), NULL);
+  if (!list) {
+    printf("ERROR:: serlib - Failed to allocate memory for list in serlib_deserialize_list_t\n");
+    exit(1);
+  }
+  serlib_list_new(list, elem_size, NULL);
 
-  // set linked list head and deserialize data
-  serlib_deserialize_list_node_t(list->head, b, deserialize_fn_ptr);
-  list->tail = NULL;
+  for (;;) {
+    unsigned int sentinel;
+    serlib_deserialize_data(b, (char*)&sentinel, sizeof(unsigned int));
+    if (sentinel == 0xFFFFFFFF) break;
+
+    serlib_buffer_skip(b, (int)(-1 * sizeof(unsigned int)));
+
+    list_node_t* node = serlib_list_take_node(list);
+    deserialize_fn_ptr(node->data, b);
+    serlib_list_push_tail_node(list, node);
+  }
 
   return list;
 };
@@ -539,32 +1409,626 @@ list_t* serlib_deserialize_list_t(ser_buff_t* b, void (*deserialize_fn_ptr)(void
  * ----------------------------------------------------------------------
  * params  : b - ser_buff_t*
  * ----------------------------------------------------------------------
- * Deserializes a employee list node.
+ * Deserializes elements into an existing run of nodes, stopping at the
+ * sentinel or the last node.
  * ----------------------------------------------------------------------
  */
 void serlib_deserialize_list_node_t(list_node_t* list_node, ser_buff_t* b, void (*deserialize_fn_ptr)(void*, ser_buff_t*)) {
-  int sentinel = 0xFFFFFFFF;
-  serlib_deserialize_data(b, (char*)&sentinel, sizeof(int));
-  if (sentinel == 0xFFFFFFFF) {
-    return;
-  }
+  for (; list_node; list_node = list_node->next) {
+    unsigned int sentinel;
+    serlib_deserialize_data(b, (char*)&sentinel, sizeof(unsigned int));
+    if (sentinel == 0xFFFFFFFF) {
+      return;
+    }
 
-  serlib_buffer_skip(b, (int)(-1 * sizeof(int)));
+    serlib_buffer_skip(b, (int)(-1 * sizeof(unsigned int)));
 
-  deserialize_fn_ptr(list_node->data, b);
-  serlib_deserialize_list_node_t(list_node->next, b, deserialize_fn_ptr);
+    deserialize_fn_ptr(list_node->data, b);
+    list_node->dirty = true;
+  }
 };
 
 /*
- * ------------------------------------------------------
- * function: serlib_list_new
- * ------------------------------------------------------
- * params:
- *       > list      - list_t*
- *       > elem_size - int
- *       > freeFn    - function pointer
- *          > params: void*
- * ------------------------------------------------------
+ * ----------------------------------------------------------------------
+ * function: serlib_list_index_put_varint
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > b     - ser_buff_t*
+ *         > value - unsigned int
+ * ----------------------------------------------------------------------
+ * Serializes an unsigned integer as a LEB128 varint.
+ * ----------------------------------------------------------------------
+ */
+static void serlib_list_index_put_varint(ser_buff_t* b, unsigned int value) {
+  unsigned char bytes[5];
+  int n = 0;
+
+  do {
+    bytes[n] = value & 0x7F;
+    value >>= 7;
+    if (value) bytes[n] |= 0x80;
+    n++;
+  } while (value);
+
+  serlib_serialize_data(b, (char*)bytes, n);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_index_get_varint
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > reader - serlib_list_reader_t*
+ *         > pos    - int*
+ * ----------------------------------------------------------------------
+ * Decodes the varint at *pos in the reader's delta stream into *value
+ * and advances *pos past it. Returns 0, or -1 if the varint runs past
+ * the end of the stream.
+ * ----------------------------------------------------------------------
+ */
+static int serlib_list_index_get_varint(serlib_list_reader_t* reader, int* pos, unsigned int* value) {
+  *value = 0;
+  int shift = 0;
+
+  while (*pos >= 0 && *pos < reader->deltas_size && shift < 35) {
+    unsigned char byte = reader->deltas[(*pos)++];
+    *value |= (unsigned int)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) return 0;
+    shift += 7;
+  }
+
+  return -1;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_index_get_u32
+ * ----------------------------------------------------------------------
+ * params  : src - unsigned char*
+ * ----------------------------------------------------------------------
+ * Reads a native unsigned int from a possibly unaligned address.
+ * ----------------------------------------------------------------------
+ */
+static unsigned int serlib_list_index_get_u32(unsigned char* src) {
+  unsigned int value;
+  memcpy(&value, src, sizeof(unsigned int));
+  return value;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_serialize_list_t_indexed
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > list             - list_t*
+ *         > b                - ser_buff_t*
+ *         > serialize_fn_ptr - function pointer to function (void*, ser_buff_t*)
+ * ----------------------------------------------------------------------
+ * Serializes a list followed by a delta-compressed element offset index.
+ * ----------------------------------------------------------------------
+ */
+void serlib_serialize_list_t_indexed(list_t* list,
+                                     ser_buff_t* b,
+                                     void (*serialize_fn_ptr)(void*, ser_buff_t*))
+{
+  if (b == NULL) assert(0);
+
+  unsigned int sentinel = 0xFFFFFFFF;
+  unsigned int count = list ? (unsigned int)list->logical_length : 0;
+  unsigned int stride = SERLIB_LIST_INDEX_STRIDE;
+  int start = b->next;
+  unsigned int prev_offset = 0;
+
+  ser_buff_t* deltas = NULL;
+  ser_buff_t* checkpoints = NULL;
+  serlib_init_buffer_of_size(&deltas, SERIALIZE_BUFFER_DEFAULT_SIZE);
+  serlib_init_buffer_of_size(&checkpoints, SERIALIZE_BUFFER_DEFAULT_SIZE);
+
+  // serialize elements, recording each one's offset from the list start
+  list_node_t* node = count ? list->head : NULL;
+  for (unsigned int i = 0; i < count; i++, node = node->next) {
+    unsigned int offset = b->next - start;
+
+    serlib_list_index_put_varint(deltas, offset - prev_offset);
+    prev_offset = offset;
+
+    // every stride elements, keep an absolute offset to seek from
+    if (i % stride == 0) {
+      unsigned int delta_pos = deltas->next;
+      serlib_serialize_data(checkpoints, (char*)&offset, sizeof(unsigned int));
+      serlib_serialize_data(checkpoints, (char*)&delta_pos, sizeof(unsigned int));
+    }
+
+    serialize_fn_ptr(node->data, b);
+  }
+
+  serlib_serialize_data(b, (char*)&sentinel, sizeof(unsigned int));
+
+  unsigned int list_size = b->next - start;
+  unsigned int deltas_size = deltas->next;
+  unsigned int magic = SERLIB_LIST_INDEX_MAGIC;
+  unsigned int footer_size = deltas->next + checkpoints->next + 5 * sizeof(unsigned int);
+
+  // footer
+  serlib_serialize_data(b, (char*)&footer_size, sizeof(unsigned int));
+  serlib_serialize_data(b, deltas->buffer, deltas->next);
+  serlib_serialize_data(b, checkpoints->buffer, checkpoints->next);
+  serlib_serialize_data(b, (char*)&count, sizeof(unsigned int));
+  serlib_serialize_data(b, (char*)&stride, sizeof(unsigned int));
+  serlib_serialize_data(b, (char*)&list_size, sizeof(unsigned int));
+  serlib_serialize_data(b, (char*)&deltas_size, sizeof(unsigned int));
+  serlib_serialize_data(b, (char*)&magic, sizeof(unsigned int));
+
+  serlib_free_buffer(deltas);
+  serlib_free_buffer(checkpoints);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_index_skip
+ * ----------------------------------------------------------------------
+ * params  : b - ser_buff_t*
+ * ----------------------------------------------------------------------
+ * Skips the index footer of an indexed list.
+ * ----------------------------------------------------------------------
+ */
+void serlib_list_index_skip(ser_buff_t* b) {
+  unsigned int footer_size = 0;
+  serlib_deserialize_data(b, (char*)&footer_size, sizeof(unsigned int));
+
+  if ((int)footer_size < 0 || b->next + (int)footer_size > b->size) assert(0);
+  b->next += footer_size;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_reader_open
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > reader - serlib_list_reader_t*
+ *         > data   - char*
+ *         > size   - int
+ * ----------------------------------------------------------------------
+ * Opens a lazy reader over an indexed list.
+ * ----------------------------------------------------------------------
+ */
+int serlib_list_reader_open(serlib_list_reader_t* reader, char* data, int size) {
+  int trailer_size = 5 * sizeof(unsigned int);
+  if (!reader || !data || size < trailer_size) return -1;
+
+  unsigned char* trailer = (unsigned char*)data + size - trailer_size;
+  unsigned int count = serlib_list_index_get_u32(trailer);
+  unsigned int stride = serlib_list_index_get_u32(trailer + 4);
+  unsigned int list_size = serlib_list_index_get_u32(trailer + 8);
+  unsigned int deltas_size = serlib_list_index_get_u32(trailer + 12);
+  unsigned int magic = serlib_list_index_get_u32(trailer + 16);
+
+  if (magic != SERLIB_LIST_INDEX_MAGIC || !stride) return -1;
+
+  unsigned long long checkpoints_size = ((unsigned long long)count + stride - 1) / stride * 8;
+  unsigned long long total = (unsigned long long)list_size + sizeof(unsigned int)
+                           + deltas_size + checkpoints_size + trailer_size;
+  if (total > (unsigned long long)size || list_size < sizeof(unsigned int)) return -1;
+
+  // every checkpoint must land on an element start inside the list and
+  // on a varint inside the delta stream, in order
+  unsigned int end = list_size - sizeof(unsigned int);
+  unsigned int prev_offset = 0;
+  unsigned int prev_pos = 0;
+  unsigned char* checkpoints = (unsigned char*)data + size - trailer_size - checkpoints_size;
+
+  for (unsigned long long k = 0; k < checkpoints_size / 8; k++) {
+    unsigned int offset = serlib_list_index_get_u32(checkpoints + k * 8);
+    unsigned int delta_pos = serlib_list_index_get_u32(checkpoints + k * 8 + 4);
+
+    if (offset > end || delta_pos > deltas_size) return -1;
+    if (offset < prev_offset || delta_pos < prev_pos) return -1;
+    prev_offset = offset;
+    prev_pos = delta_pos;
+  }
+
+  reader->base = data + size - total;
+  reader->list_size = list_size;
+  reader->count = count;
+  reader->stride = stride;
+  reader->deltas = (unsigned char*)reader->base + list_size + sizeof(unsigned int);
+  reader->deltas_size = deltas_size;
+  reader->checkpoints = reader->deltas + deltas_size;
+
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_reader_get_count
+ * ----------------------------------------------------------------------
+ * params  : reader - serlib_list_reader_t*
+ * ----------------------------------------------------------------------
+ * Returns the number of elements in an indexed list.
+ * ----------------------------------------------------------------------
+ */
+unsigned int serlib_list_reader_get_count(serlib_list_reader_t* reader) {
+  return reader->count;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_reader_seek
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > reader - serlib_list_reader_t*
+ *         > index  - unsigned int
+ *         > pos    - int*
+ * ----------------------------------------------------------------------
+ * Finds the offset of element index, leaving *pos at the delta of the
+ * element after it. Decodes at most stride - 1 varints. Returns 0, or -1
+ * if a delta is truncated or lands past the sentinel.
+ * ----------------------------------------------------------------------
+ */
+static int serlib_list_reader_seek(serlib_list_reader_t* reader,
+                                   unsigned int index,
+                                   unsigned int* offset,
+                                   int* pos)
+{
+  unsigned int checkpoint = index / reader->stride;
+  unsigned char* entry = reader->checkpoints + (size_t)checkpoint * 8;
+  unsigned int end = reader->list_size - sizeof(unsigned int);
+
+  *offset = serlib_list_index_get_u32(entry);
+  *pos = serlib_list_index_get_u32(entry + 4);
+
+  for (unsigned int i = checkpoint * reader->stride; i < index; i++) {
+    unsigned int delta;
+    if (serlib_list_index_get_varint(reader, pos, &delta) < 0) return -1;
+    if (delta > end - *offset) return -1;
+    *offset += delta;
+  }
+
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_reader_next_offset
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > reader - serlib_list_reader_t*
+ *         > index  - unsigned int
+ *         > offset - unsigned int* (in: element index, out: the next one)
+ *         > pos    - int*
+ * ----------------------------------------------------------------------
+ * Advances *offset from element index to the element after it (or to
+ * the sentinel for the last element). Returns 0, or -1 if the delta is
+ * truncated or lands past the sentinel.
+ * ----------------------------------------------------------------------
+ */
+static int serlib_list_reader_next_offset(serlib_list_reader_t* reader,
+                                          unsigned int index,
+                                          unsigned int* offset,
+                                          int* pos)
+{
+  unsigned int end = reader->list_size - sizeof(unsigned int);
+
+  if (index + 1 >= reader->count) {
+    *offset = end;
+    return 0;
+  }
+
+  unsigned int delta;
+  if (serlib_list_index_get_varint(reader, pos, &delta) < 0) return -1;
+  if (delta > end - *offset) return -1;
+
+  *offset += delta;
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_reader_element
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > reader - serlib_list_reader_t*
+ *         > index  - unsigned int
+ *         > len    - int* (may be NULL)
+ * ----------------------------------------------------------------------
+ * Returns a pointer to the encoded bytes of element index, or NULL.
+ * ----------------------------------------------------------------------
+ */
+char* serlib_list_reader_element(serlib_list_reader_t* reader, unsigned int index, int* len) {
+  if (index >= reader->count) return NULL;
+
+  int pos = 0;
+  unsigned int offset;
+  if (serlib_list_reader_seek(reader, index, &offset, &pos) < 0) return NULL;
+
+  if (len) {
+    unsigned int next = offset;
+    if (serlib_list_reader_next_offset(reader, index, &next, &pos) < 0) return NULL;
+    *len = next - offset;
+  }
+
+  return reader->base + offset;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_reader_get
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > reader             - serlib_list_reader_t*
+ *         > index              - unsigned int
+ *         > deserialize_fn_ptr - function pointer to function (void*, ser_buff_t*)
+ *         > dest               - void*
+ * ----------------------------------------------------------------------
+ * Decodes only element index into dest.
+ * ----------------------------------------------------------------------
+ */
+int serlib_list_reader_get(serlib_list_reader_t* reader,
+                           unsigned int index,
+                           void (*deserialize_fn_ptr)(void*, ser_buff_t*),
+                           void* dest)
+{
+  return serlib_list_reader_get_range(reader, index, 1, deserialize_fn_ptr, dest, 0) == 1 ? 0 : -1;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_reader_get_range
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > reader             - serlib_list_reader_t*
+ *         > first              - unsigned int
+ *         > count              - unsigned int
+ *         > deserialize_fn_ptr - function pointer to function (void*, ser_buff_t*)
+ *         > dest               - void* (array of count elements)
+ *         > elem_size          - int
+ * ----------------------------------------------------------------------
+ * Decodes elements [first, first + count) into consecutive slots of dest.
+ * ----------------------------------------------------------------------
+ */
+int serlib_list_reader_get_range(serlib_list_reader_t* reader,
+                                 unsigned int first,
+                                 unsigned int count,
+                                 void (*deserialize_fn_ptr)(void*, ser_buff_t*),
+                                 void* dest,
+                                 int elem_size)
+{
+  assert(deserialize_fn_ptr != NULL);
+  if (first >= reader->count) return 0;
+  if (count > reader->count - first) count = reader->count - first;
+
+  // view over the encoded list; nothing is copied
+  ser_buff_t view = { .buffer = reader->base, .size = reader->list_size, .flags = SERLIB_BUFF_FIXED, .node = -1 };
+
+  int pos = 0;
+  unsigned int offset;
+  if (serlib_list_reader_seek(reader, first, &offset, &pos) < 0) return -1;
+
+  for (unsigned int i = 0; i < count; i++) {
+    view.next = offset;
+    deserialize_fn_ptr((char*)dest + (size_t)i * elem_size, &view);
+
+    if (i + 1 < count && serlib_list_reader_next_offset(reader, first + i, &offset, &pos) < 0) {
+      return i + 1;
+    }
+  }
+
+  return count;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_image_layout
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > count     - unsigned long long
+ *         > stride    - unsigned long long
+ *         > nodes_off - unsigned long long* (out)
+ *         > data_off  - unsigned long long* (out)
+ * ----------------------------------------------------------------------
+ * Computes where the nodes and element bytes of an image start, and
+ * returns its total size.
+ * ----------------------------------------------------------------------
+ */
+static unsigned long long serlib_list_image_layout(unsigned long long count,
+                                                   unsigned long long stride,
+                                                   unsigned long long* nodes_off,
+                                                   unsigned long long* data_off)
+{
+  *nodes_off = sizeof(serlib_list_image_t) + ((sizeof(list_t) + 7) & ~(size_t)7);
+  *data_off = *nodes_off + count * sizeof(list_node_t);
+  return *data_off + count * stride;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_image_size
+ * ----------------------------------------------------------------------
+ * params  : list - list_t*
+ * ----------------------------------------------------------------------
+ * Returns the size of a list's image, or -1 if it is too large.
+ * ----------------------------------------------------------------------
+ */
+int serlib_list_image_size(list_t* list) {
+  if (list == NULL) assert(0);
+
+  unsigned long long nodes_off, data_off;
+  unsigned long long stride = ((unsigned long long)list->elem_size + 7) & ~7ULL;
+  unsigned long long size = serlib_list_image_layout(list->logical_length, stride, &nodes_off, &data_off);
+
+  return size > 0x7fffffffULL ? -1 : (int)size;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_serialize_list_image
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > list - list_t*
+ *         > b    - ser_buff_t*
+ * ----------------------------------------------------------------------
+ * Writes a list as a relocatable image with offset links.
+ * ----------------------------------------------------------------------
+ */
+int serlib_serialize_list_image(list_t* list, ser_buff_t* b) {
+  if (list == NULL || b == NULL) assert(0);
+
+  int size = serlib_list_image_size(list);
+  if (size < 0) return SERLIB_ERR_OVERFLOW;
+
+  int pad = (8 - (b->next & 7)) & 7;
+  if (serlib_buffer_reserve(b, pad + size) < 0) return SERLIB_ERR_OVERFLOW;
+
+  unsigned int count = list->logical_length;
+  unsigned long long stride = ((unsigned long long)list->elem_size + 7) & ~7ULL;
+  unsigned long long nodes_off, data_off;
+  serlib_list_image_layout(count, stride, &nodes_off, &data_off);
+
+  // the image is built in place; padding and unused bytes are zeroed
+  char* image = b->buffer + b->next + pad;
+  memset(b->buffer + b->next, 0, pad + size);
+
+  serlib_list_image_t header = {
+    SERLIB_LIST_IMAGE_MAGIC,
+    SERLIB_LIST_IMAGE_VERSION,
+    sizeof(list_node_t),
+    count,
+    list->elem_size,
+    (unsigned int)stride,
+    (unsigned long long)size,
+    0
+  };
+  memcpy(image, &header, sizeof(header));
+
+  list_t* out = (list_t*)(image + sizeof(header));
+  out->logical_length = count;
+  out->elem_size = list->elem_size;
+  out->head = count ? (list_node_t*)(uintptr_t)nodes_off : NULL;
+  out->tail = count ? (list_node_t*)(uintptr_t)(nodes_off + (count - 1) * sizeof(list_node_t)) : NULL;
+  out->numa_node = -1;
+
+  list_node_t* nodes = (list_node_t*)(image + nodes_off);
+  list_node_t* node = list->head;
+  for (unsigned int i = 0; i < count; i++, node = node->next) {
+    unsigned long long self = nodes_off + (unsigned long long)i * sizeof(list_node_t);
+    nodes[i].data = (void*)(uintptr_t)(data_off + i * stride);
+    nodes[i].next = i + 1 < count ? (list_node_t*)(uintptr_t)(self + sizeof(list_node_t)) : NULL;
+    nodes[i].prev = i ? (list_node_t*)(uintptr_t)(self - sizeof(list_node_t)) : NULL;
+    nodes[i].numa_node = -1;
+    memcpy(image + data_off + i * stride, node->data, list->elem_size);
+  }
+
+  b->next += pad + size;
+  SERLIB_STAT_ADD(SERLIB_STAT_BYTES_SERIALIZED, pad + size);
+
+  return SERLIB_OK;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_image_relink
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > link   - void* (as stored in the image)
+ *         > base   - unsigned long long
+ *         > here   - char*
+ *         > expect - unsigned long long (offset the link must have)
+ *         > ok     - bool* (cleared on mismatch)
+ * ----------------------------------------------------------------------
+ * Rebases one non-NULL link from base to here.
+ * ----------------------------------------------------------------------
+ */
+static void* serlib_list_image_relink(void* link, unsigned long long base, char* here,
+                                      unsigned long long expect, bool* ok)
+{
+  if ((unsigned long long)(uintptr_t)link - base != expect) *ok = false;
+  return here + expect;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_image_open
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > data - char*
+ *         > size - int
+ * ----------------------------------------------------------------------
+ * Fixes up an image's links in place and returns its list.
+ * ----------------------------------------------------------------------
+ */
+list_t* serlib_list_image_open(char* data, int size) {
+  if (!data || ((uintptr_t)data & 7) || size < (int)sizeof(serlib_list_image_t)) return NULL;
+
+  serlib_list_image_t* header = (serlib_list_image_t*)data;
+  if (header->magic != SERLIB_LIST_IMAGE_MAGIC || header->version != SERLIB_LIST_IMAGE_VERSION) return NULL;
+  if (header->node_size != sizeof(list_node_t) || header->elem_size <= 0) return NULL;
+  if (header->data_stride != (((unsigned int)header->elem_size + 7) & ~7U)) return NULL;
+
+  unsigned long long count = header->count;
+  unsigned long long stride = header->data_stride;
+  unsigned long long nodes_off, data_off;
+  unsigned long long image_size = serlib_list_image_layout(count, stride, &nodes_off, &data_off);
+  if (header->image_size != image_size || image_size > (unsigned long long)size) return NULL;
+
+  list_t* list = (list_t*)(data + sizeof(serlib_list_image_t));
+  if (list->logical_length != (int)count || list->elem_size != header->elem_size) return NULL;
+
+  // every link is checked, even in an image that claims to be fixed up
+  // at this address already: base is as untrusted as the rest. Links
+  // must follow list order, so walking the result always ends
+  unsigned long long base = header->base;
+  unsigned long long here = (uintptr_t)data;
+  bool ok = true;
+  list_node_t* nodes = (list_node_t*)(data + nodes_off);
+  if (count) {
+    list->head = serlib_list_image_relink(list->head, base, data, nodes_off, &ok);
+    list->tail = serlib_list_image_relink(list->tail, base, data, nodes_off + (count - 1) * sizeof(list_node_t), &ok);
+  } else {
+    ok = !list->head && !list->tail;
+  }
+
+  for (unsigned long long i = 0; ok && i < count; i++) {
+    unsigned long long self = nodes_off + i * sizeof(list_node_t);
+    list_node_t* node = &nodes[i];
+
+    node->data = serlib_list_image_relink(node->data, base, data, data_off + i * stride, &ok);
+    if (i + 1 < count) node->next = serlib_list_image_relink(node->next, base, data, self + sizeof(list_node_t), &ok);
+    else if (node->next) ok = false;
+    if (i) node->prev = serlib_list_image_relink(node->prev, base, data, self - sizeof(list_node_t), &ok);
+    else if (node->prev) ok = false;
+
+    // no cached encoding to copy from
+    node->encoding = NULL;
+    node->encoding_size = 0;
+    node->dirty = true;
+    node->numa_node = -1;
+  }
+  if (!ok) return NULL;
+
+  // read-only: nothing here was allocated by the list's own functions,
+  // and no pointer stored in the image is left to be called or freed
+  list->freeFn = NULL;
+  list->bytes = 0;
+  list->high_water = 0;
+  list->free_nodes = NULL;
+  list->free_count = 0;
+  list->max_free_nodes = 0;
+  list->numa_node = -1;
+
+  header->base = here;
+  return list;
+};
+
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_new
+ * ------------------------------------------------------
+ * params:
+ *       > list      - list_t*
+ *       > elem_size - int
+ *       > freeFn    - function pointer
+ *          > params: void*
+ * ------------------------------------------------------
  * Creates a new linked list.
  * ------------------------------------------------------
  */
@@ -575,11 +2039,23 @@ void serlib_list_new(list_t* list, int elem_size, void (*freeFn)(void *)) {
   // set the default values
   list->logical_length = 0;
   list->elem_size = elem_size;
-  list->head = serlib_list_new_node(elem_size);
-  list->tail= list->head;
+  list->head = NULL;
+  list->tail = NULL;
 
   // pass freeing function ptr
   list->freeFn = freeFn;
+
+  // nothing held yet
+  list->bytes = 0;
+  list->high_water = 0;
+
+  // removed nodes are kept for reuse, up to the cache limit
+  list->free_nodes = NULL;
+  list->free_count = 0;
+  list->max_free_nodes = SERLIB_LIST_NODE_CACHE;
+
+  // nodes come from the heap until bound to a NUMA node
+  list->numa_node = -1;
 };
 
 /*
@@ -593,13 +2069,107 @@ void serlib_list_new(list_t* list, int elem_size, void (*freeFn)(void *)) {
  */
 list_node_t* serlib_list_new_node(int size) {
   list_node_t* list_node = (list_node_t*) malloc(sizeof(list_node_t));
+  if (!list_node) {
+    printf("ERROR:: serlib - Failed to allocate memory for list node in serlib_list_new_node\n");
+    exit(1);
+  }
+
+  list_node->data = (void*) malloc(size);
+  if (!list_node->data) {
+    printf("ERROR:: serlib - Failed to allocate memory for list node data in serlib_list_new_node\n");
+    exit(1);
+  }
 
-  list_node->data = (void*) malloc(sizeof(size));
   list_node->next = NULL;
+  list_node->prev = NULL;
+  list_node->encoding = NULL;
+  list_node->encoding_size = 0;
+  list_node->dirty = true;
+  list_node->numa_node = -1;
 
   return list_node;
 };
 
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_node_bytes
+ * ------------------------------------------------------
+ * params  :
+ *         > list - list_t*
+ *         > node - list_node_t*
+ * ------------------------------------------------------
+ * Returns the bytes a node of list holds.
+ * ------------------------------------------------------
+ */
+static long long serlib_list_node_bytes(list_t* list, list_node_t* node) {
+  return sizeof(list_node_t) + list->elem_size + node->encoding_size;
+};
+
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_take_node
+ * ------------------------------------------------------
+ * params  : list - list_t*
+ * ------------------------------------------------------
+ * Gets a node from the list's node cache, or allocates
+ * one if the cache is empty.
+ * ------------------------------------------------------
+ */
+static list_node_t* serlib_list_take_node(list_t* list) {
+  list_node_t* node = list->free_nodes;
+  if (node) {
+    list->free_nodes = node->next;
+    list->free_count--;
+  } else if (list->numa_node >= 0) {
+    // node and data share one block from the node's pool
+    node = serlib_numa_alloc(list->numa_node, sizeof(list_node_t) + list->elem_size);
+    node->data = node + 1;
+    node->encoding = NULL;
+    node->encoding_size = 0;
+    node->numa_node = list->numa_node;
+    serlib_list_account(list, serlib_list_node_bytes(list, node));
+    SERLIB_STAT_ADD(SERLIB_STAT_LIST_NODES, 1);
+  } else {
+    node = serlib_list_new_node(list->elem_size);
+    serlib_list_account(list, serlib_list_node_bytes(list, node));
+    SERLIB_STAT_ADD(SERLIB_STAT_LIST_NODES, 1);
+  }
+
+  node->next = NULL;
+  node->prev = NULL;
+  node->dirty = true;
+  return node;
+};
+
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_free_node
+ * ------------------------------------------------------
+ * params  :
+ *         > list - list_t*
+ *         > node - list_node_t*
+ * ------------------------------------------------------
+ * Frees a node that the list accounts for.
+ * ------------------------------------------------------
+ */
+static void serlib_list_free_node(list_t* list, list_node_t* node) {
+  serlib_list_account(list, -serlib_list_node_bytes(list, node));
+
+  // free up node's cached encoding
+  free(node->encoding);
+
+  // a pooled node carries its data in the same block
+  if (node->numa_node >= 0) {
+    serlib_numa_free(node);
+    return;
+  }
+
+  // free up node's data
+  free(node->data);
+  // free up node's pointer
+  free(node);
+};
+
 /*
  * ------------------------------------------------------
  * function: serlib_list_destroy
@@ -616,17 +2186,27 @@ void serlib_list_destroy(list_t* list) {
   while(list->head != NULL) {
     // set current node to list head to start
     current_node = list->head;
+    // move the list head along before freeing the node
+    list->head = current_node->next;
 
     // call clean up pointer function if there is one
     if (list->freeFn) {
       list->freeFn(current_node->data);
     }
 
-    // free up node's data
-    free(current_node->data);
-    // free up node's pointer
-    free(current_node);
+    serlib_list_free_node(list, current_node);
+  }
+
+  // cached nodes hold no live data
+  while (list->free_nodes != NULL) {
+    current_node = list->free_nodes;
+    list->free_nodes = current_node->next;
+    serlib_list_free_node(list, current_node);
   }
+
+  list->tail = NULL;
+  list->logical_length = 0;
+  list->free_count = 0;
 };
 
 /*
@@ -641,27 +2221,13 @@ void serlib_list_destroy(list_t* list) {
  * ------------------------------------------------------
  */
 void serlib_list_prepend(list_t* list, void* element) {
-  // allocate memory for node
-  list_node_t* node = malloc(sizeof(list_node_t));
+  // get a recycled or new node
+  list_node_t* node = serlib_list_take_node(list);
 
-  // create memory for node data
-  node->data = malloc(list->elem_size);
   // copy data to node
   memcpy(node->data, element, list->elem_size);
 
-  // set the next of node to list head
-  node->next = list->head;
-  // set list head to current node
-  list->head = node;
-
-  // if first node
-  if (!list->tail) {
-    // set list / node tail to head
-    list->tail = list->head;
-  }
-
-  // increment count of nodes
-  list->logical_length++;
+  serlib_list_push_head_node(list, node);
 };
 
 /*
@@ -676,30 +2242,357 @@ void serlib_list_prepend(list_t* list, void* element) {
  * ------------------------------------------------------
  */
 void serlib_list_append(list_t* list, void* element) {
-  // create memory for node
-  list_node_t* node = malloc(sizeof(list_node_t));
-  // create memory for node data
-  node->data = malloc(list->elem_size);
-  // set node pointer to NULL
-  node->next = NULL;
+  // get a recycled or new node
+  list_node_t* node = serlib_list_take_node(list);
 
   // copy the data into the node
   memcpy(node->data, element, list->elem_size);
 
-  // if this is first node in list
-  if (list->logical_length == 0) {
-    list->head = node;
-    list->tail = node;
-  // else, we have other nodes, so append
+  serlib_list_push_tail_node(list, node);
+};
+
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_push_head_node
+ * ------------------------------------------------------
+ * params  :
+ *         > list - list_t*
+ *         > node - list_node_t*
+ * ------------------------------------------------------
+ * Links a detached node in at the head of a list.
+ * ------------------------------------------------------
+ */
+void serlib_list_push_head_node(list_t* list, list_node_t* node) {
+  // set the next of node to list head
+  node->prev = NULL;
+  node->next = list->head;
+
+  // if first node, it is the tail too
+  if (list->head) {
+    list->head->prev = node;
   } else {
-    list->tail->next = node;
     list->tail = node;
   }
+  list->head = node;
 
   // increment count of nodes
   list->logical_length++;
 };
 
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_push_tail_node
+ * ------------------------------------------------------
+ * params  :
+ *         > list - list_t*
+ *         > node - list_node_t*
+ * ------------------------------------------------------
+ * Links a detached node in at the tail of a list.
+ * ------------------------------------------------------
+ */
+void serlib_list_push_tail_node(list_t* list, list_node_t* node) {
+  node->next = NULL;
+  node->prev = list->tail;
+
+  // if this is first node in list
+  if (list->tail) {
+    list->tail->next = node;
+  } else {
+    list->head = node;
+  }
+  list->tail = node;
+
+  // increment count of nodes
+  list->logical_length++;
+};
+
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_unlink_node
+ * ------------------------------------------------------
+ * params  :
+ *         > list - list_t*
+ *         > node - list_node_t*
+ * ------------------------------------------------------
+ * Unlinks a node from a list.
+ * ------------------------------------------------------
+ */
+static void serlib_list_unlink_node(list_t* list, list_node_t* node) {
+  if (node->prev) {
+    node->prev->next = node->next;
+  } else {
+    list->head = node->next;
+  }
+
+  if (node->next) {
+    node->next->prev = node->prev;
+  } else {
+    list->tail = node->prev;
+  }
+
+  node->next = NULL;
+  node->prev = NULL;
+  list->logical_length--;
+};
+
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_pop_head_node
+ * ------------------------------------------------------
+ * params  : list - list_t*
+ * ------------------------------------------------------
+ * Unlinks and returns the head node, or NULL if the
+ * list is empty.
+ * ------------------------------------------------------
+ */
+list_node_t* serlib_list_pop_head_node(list_t* list) {
+  list_node_t* node = list->head;
+  if (node) serlib_list_unlink_node(list, node);
+  return node;
+};
+
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_pop_tail_node
+ * ------------------------------------------------------
+ * params  : list - list_t*
+ * ------------------------------------------------------
+ * Unlinks and returns the tail node, or NULL if the
+ * list is empty.
+ * ------------------------------------------------------
+ */
+list_node_t* serlib_list_pop_tail_node(list_t* list) {
+  list_node_t* node = list->tail;
+  if (node) serlib_list_unlink_node(list, node);
+  return node;
+};
+
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_release_node
+ * ------------------------------------------------------
+ * params  :
+ *         > list - list_t*
+ *         > node - list_node_t*
+ * ------------------------------------------------------
+ * Returns a popped node to the list's node cache, or
+ * frees it once the cache is full.
+ * ------------------------------------------------------
+ */
+void serlib_list_release_node(list_t* list, list_node_t* node) {
+  if (list->free_count >= list->max_free_nodes) {
+    serlib_list_free_node(list, node);
+    return;
+  }
+
+  // a recycled node's old encoding is never valid again
+  serlib_list_account(list, -node->encoding_size);
+  free(node->encoding);
+  node->encoding = NULL;
+  node->encoding_size = 0;
+
+  node->prev = NULL;
+  node->next = list->free_nodes;
+  list->free_nodes = node;
+  list->free_count++;
+};
+
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_set_node_cache
+ * ------------------------------------------------------
+ * params  :
+ *         > list      - list_t*
+ *         > max_nodes - int
+ * ------------------------------------------------------
+ * Sets how many removed nodes a list keeps for reuse,
+ * freeing any cached nodes beyond the new limit.
+ * ------------------------------------------------------
+ */
+void serlib_list_set_node_cache(list_t* list, int max_nodes) {
+  assert(max_nodes >= 0);
+
+  list->max_free_nodes = max_nodes;
+  while (list->free_count > max_nodes) {
+    list_node_t* node = list->free_nodes;
+    list->free_nodes = node->next;
+    list->free_count--;
+    serlib_list_free_node(list, node);
+  }
+};
+
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_set_numa_node
+ * ------------------------------------------------------
+ * params  :
+ *         > list - list_t*
+ *         > node - int
+ * ------------------------------------------------------
+ * Makes a list allocate new nodes from a NUMA node's
+ * pool, or from the heap for node -1.
+ * ------------------------------------------------------
+ */
+int serlib_list_set_numa_node(list_t* list, int node) {
+  if (node < -1 || node >= serlib_numa_node_count()) return -1;
+
+  list->numa_node = node;
+
+  // drop cached nodes that live elsewhere so reuse stays local
+  list_node_t** link = &list->free_nodes;
+  while (*link) {
+    list_node_t* cached = *link;
+    if (cached->numa_node == node) {
+      link = &cached->next;
+      continue;
+    }
+    *link = cached->next;
+    list->free_count--;
+    serlib_list_free_node(list, cached);
+  }
+
+  return 0;
+};
+
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_pop_head
+ * ------------------------------------------------------
+ * params  :
+ *         > list    - list_t*
+ *         > element - void*
+ * ------------------------------------------------------
+ * Removes the head node, copying its data to element.
+ * Returns false if the list is empty.
+ * ------------------------------------------------------
+ */
+bool serlib_list_pop_head(list_t* list, void* element) {
+  list_node_t* node = serlib_list_pop_head_node(list);
+  if (!node) return false;
+
+  memcpy(element, node->data, list->elem_size);
+  serlib_list_release_node(list, node);
+  return true;
+};
+
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_pop_tail
+ * ------------------------------------------------------
+ * params  :
+ *         > list    - list_t*
+ *         > element - void*
+ * ------------------------------------------------------
+ * Removes the tail node, copying its data to element.
+ * Returns false if the list is empty.
+ * ------------------------------------------------------
+ */
+bool serlib_list_pop_tail(list_t* list, void* element) {
+  list_node_t* node = serlib_list_pop_tail_node(list);
+  if (!node) return false;
+
+  memcpy(element, node->data, list->elem_size);
+  serlib_list_release_node(list, node);
+  return true;
+};
+
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_move_node
+ * ------------------------------------------------------
+ * params  :
+ *         > dest - list_t*
+ *         > src  - list_t*
+ *         > node - list_node_t*
+ * ------------------------------------------------------
+ * Moves a node popped from src to the tail of dest
+ * without copying its data.
+ * ------------------------------------------------------
+ */
+void serlib_list_move_node(list_t* dest, list_t* src, list_node_t* node) {
+  assert(dest->elem_size == src->elem_size);
+
+  // the memory stays live, only its owner changes
+  long long bytes = serlib_list_node_bytes(src, node);
+  src->bytes -= bytes;
+  dest->bytes += bytes;
+  if (dest->bytes > dest->high_water) dest->high_water = dest->bytes;
+
+  serlib_list_push_tail_node(dest, node);
+};
+
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_splice
+ * ------------------------------------------------------
+ * params  :
+ *         > dest - list_t*
+ *         > src  - list_t*
+ * ------------------------------------------------------
+ * Moves every node of src to the tail of dest in O(1),
+ * leaving src empty. src keeps its node cache.
+ * ------------------------------------------------------
+ */
+void serlib_list_splice(list_t* dest, list_t* src) {
+  assert(dest->elem_size == src->elem_size);
+  if (src->logical_length == 0) return;
+
+  // cached nodes carry no encoding, so what they hold is
+  // known without walking the moved nodes
+  long long cached = (long long)src->free_count * (sizeof(list_node_t) + src->elem_size);
+  long long bytes = src->bytes - cached;
+  src->bytes = cached;
+  dest->bytes += bytes;
+  if (dest->bytes > dest->high_water) dest->high_water = dest->bytes;
+
+  if (dest->tail) {
+    dest->tail->next = src->head;
+    src->head->prev = dest->tail;
+  } else {
+    dest->head = src->head;
+  }
+  dest->tail = src->tail;
+  dest->logical_length += src->logical_length;
+
+  src->head = NULL;
+  src->tail = NULL;
+  src->logical_length = 0;
+};
+
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_update
+ * ------------------------------------------------------
+ * params  :
+ *         > list    - list_t*
+ *         > node    - list_node_t*
+ *         > element - void*
+ * ------------------------------------------------------
+ * Replaces a node's data and marks it dirty.
+ * ------------------------------------------------------
+ */
+void serlib_list_update(list_t* list, list_node_t* node, void* element) {
+  assert(node != NULL);
+
+  // copy the new data into the node
+  memcpy(node->data, element, list->elem_size);
+  node->dirty = true;
+};
+
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_mark_dirty
+ * ------------------------------------------------------
+ * params  : node - list_node_t*
+ * ------------------------------------------------------
+ * Marks a node modified in place so its cached encoding
+ * is rebuilt on the next cached serialize.
+ * ------------------------------------------------------
+ */
+void serlib_list_mark_dirty(list_node_t* node) {
+  node->dirty = true;
+};
+
 /*
  * ------------------------------------------------------
  * function: serlib_list_get_size
@@ -713,6 +2606,33 @@ int serlib_list_get_size(list_t* list) {
   return list->logical_length;
 };
 
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_get_bytes
+ * ------------------------------------------------------
+ * params  : list - list_t*
+ * ------------------------------------------------------
+ * Returns bytes held by a list's nodes, element data and
+ * cached encodings.
+ * ------------------------------------------------------
+ */
+long long serlib_list_get_bytes(list_t* list) {
+  return list->bytes;
+};
+
+/*
+ * ------------------------------------------------------
+ * function: serlib_list_get_high_water
+ * ------------------------------------------------------
+ * params  : list - list_t*
+ * ------------------------------------------------------
+ * Returns the most bytes the list has ever held.
+ * ------------------------------------------------------
+ */
+long long serlib_list_get_high_water(list_t* list) {
+  return list->high_water;
+};
+
 /*
  * ------------------------------------------------------
  * function: serlib_list_iterate
@@ -738,25 +2658,42 @@ void serlib_list_iterate(list_t* list, bool (*list_iterator)(void *)) {
 
 /*
  * ------------------------------------------------------
- *
+ * function: serlib_list_get_head
  * ------------------------------------------------------
- *
+ * params  :
+ *         > list          - list_t*
+ *         > element       - void*
+ *         > should_remove - bool
  * ------------------------------------------------------
- *
+ * Copies the head node's data to element, removing the
+ * node if should_remove. Does nothing on an empty list.
  * ------------------------------------------------------
  */
 void serlib_list_get_head(list_t* list, void* element, bool should_remove) {
+  if (!list->head) return;
+
+  if (should_remove) {
+    serlib_list_pop_head(list, element);
+    return;
+  }
+
+  memcpy(element, list->head->data, list->elem_size);
 };
 
 /*
  * ------------------------------------------------------
- *
+ * function: serlib_list_get_tail
  * ------------------------------------------------------
- *
+ * params  :
+ *         > list    - list_t*
+ *         > element - void*
  * ------------------------------------------------------
- *
+ * Copies the tail node's data to element. Does nothing
+ * on an empty list.
  * ------------------------------------------------------
  */
 void serlib_list_get_tail(list_t* list, void* element) {
-};
+  if (!list->tail) return;
 
+  memcpy(element, list->tail->data, list->elem_size);
+};
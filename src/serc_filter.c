@@ -0,0 +1,276 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "../include/serc_filter.h"
+
+#define SERLIB_FILTER_SENTINEL 0xFFFFFFFF
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_filter_validate
+ * ----------------------------------------------------------------------
+ * params  : filter - serlib_list_filter_t*
+ * ----------------------------------------------------------------------
+ * Checks a filter's layout, predicates and projection, and returns
+ * the size of a record if every field has a fixed size, or -1.
+ * ----------------------------------------------------------------------
+ */
+static int serlib_filter_validate(serlib_list_filter_t* filter) {
+  if (filter->field_count < 1 || filter->field_count > SERLIB_FILTER_MAX_FIELDS) assert(0);
+  if (filter->predicate_count < 0 || filter->projection_count < 0) assert(0);
+
+  int record_size = 0;
+  for (int i = 0; i < filter->field_count; i++) {
+    serlib_field_t* field = &filter->fields[i];
+    int size = field->size;
+
+    switch (field->type) {
+      case SERLIB_FIELD_INT:
+      case SERLIB_FIELD_UINT:
+        if (size != 1 && size != 2 && size != 4 && size != 8) assert(0);
+        break;
+      case SERLIB_FIELD_BYTES:
+        if (size < 1) assert(0);
+        break;
+      case SERLIB_FIELD_VAR:
+        if (size != 1 && size != 2 && size != 4) assert(0);
+        record_size = -1;
+        break;
+      default:
+        assert(0);
+    }
+
+    if (record_size >= 0) record_size += size;
+  }
+
+  for (int i = 0; i < filter->predicate_count; i++) {
+    serlib_predicate_t* pred = &filter->predicates[i];
+    if (pred->field < 0 || pred->field >= filter->field_count) assert(0);
+
+    int type = filter->fields[pred->field].type;
+    bool numeric = type == SERLIB_FIELD_INT || type == SERLIB_FIELD_UINT;
+    if (numeric && (pred->op < SERLIB_PRED_EQ || pred->op > SERLIB_PRED_GE)) assert(0);
+    if (!numeric && pred->op != SERLIB_PRED_EQ && pred->op != SERLIB_PRED_NE && pred->op != SERLIB_PRED_PREFIX) assert(0);
+    if (!numeric && (pred->bytes_size < 0 || (pred->bytes_size && !pred->bytes))) assert(0);
+  }
+
+  for (int i = 0; i < filter->projection_count; i++) {
+    if (filter->projection[i] < 0 || filter->projection[i] >= filter->field_count) assert(0);
+  }
+
+  return record_size;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_filter_load
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > data - char*
+ *         > size - int (1, 2, 4 or 8)
+ * ----------------------------------------------------------------------
+ * Reads an unsigned integer of size bytes as serialized.
+ * ----------------------------------------------------------------------
+ */
+static unsigned long long serlib_filter_load(char* data, int size) {
+  switch (size) {
+    case 1: { unsigned char v; memcpy(&v, data, 1); return v; }
+    case 2: { unsigned short v; memcpy(&v, data, 2); return v; }
+    case 4: { unsigned int v; memcpy(&v, data, 4); return v; }
+    default: { unsigned long long v; memcpy(&v, data, 8); return v; }
+  }
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_filter_compare
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > op  - int
+ *         > cmp - int (-1, 0 or 1: field against constant)
+ * ----------------------------------------------------------------------
+ * Applies a comparison operator to a three-way comparison.
+ * ----------------------------------------------------------------------
+ */
+static bool serlib_filter_compare(int op, int cmp) {
+  switch (op) {
+    case SERLIB_PRED_EQ: return cmp == 0;
+    case SERLIB_PRED_NE: return cmp != 0;
+    case SERLIB_PRED_LT: return cmp < 0;
+    case SERLIB_PRED_LE: return cmp <= 0;
+    case SERLIB_PRED_GT: return cmp > 0;
+    default:             return cmp >= 0;
+  }
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_filter_match
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > field - serlib_field_t*
+ *         > pred  - serlib_predicate_t*
+ *         > data  - char* (the field's bytes, after any length)
+ *         > len   - int
+ * ----------------------------------------------------------------------
+ * Evaluates one predicate on a field's encoded bytes.
+ * ----------------------------------------------------------------------
+ */
+static bool serlib_filter_match(serlib_field_t* field, serlib_predicate_t* pred, char* data, int len) {
+  if (field->type == SERLIB_FIELD_INT) {
+    // sign-extend from the field's width
+    int shift = 64 - field->size * 8;
+    long long v = (long long)(serlib_filter_load(data, field->size) << shift) >> shift;
+    return serlib_filter_compare(pred->op, (v > pred->value) - (v < pred->value));
+  }
+
+  if (field->type == SERLIB_FIELD_UINT) {
+    unsigned long long v = serlib_filter_load(data, field->size);
+    unsigned long long c = (unsigned long long)pred->value;
+    return serlib_filter_compare(pred->op, (v > c) - (v < c));
+  }
+
+  if (pred->op == SERLIB_PRED_PREFIX) {
+    return len >= pred->bytes_size && memcmp(data, pred->bytes, pred->bytes_size) == 0;
+  }
+
+  bool equal = len == pred->bytes_size && memcmp(data, pred->bytes, len) == 0;
+  return pred->op == SERLIB_PRED_EQ ? equal : !equal;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_filter_scan
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > in     - ser_buff_t*
+ *         > filter - serlib_list_filter_t*
+ *         > out    - ser_buff_t*
+ * ----------------------------------------------------------------------
+ * Does the work of serlib_list_filter, possibly leaving a partial list
+ * in out on failure.
+ * ----------------------------------------------------------------------
+ */
+static int serlib_filter_scan(ser_buff_t* in, serlib_list_filter_t* filter, ser_buff_t* out) {
+  int record_size = serlib_filter_validate(filter);
+
+  // with a fixed layout every field sits at the same offset in each record
+  int starts[SERLIB_FILTER_MAX_FIELDS];
+  int lens[SERLIB_FILTER_MAX_FIELDS];
+  if (record_size >= 0) {
+    int offset = 0;
+    for (int i = 0; i < filter->field_count; i++) {
+      starts[i] = offset;
+      lens[i] = filter->fields[i].size;
+      offset += lens[i];
+    }
+  }
+
+  char* base = in->buffer;
+  int end = in->size;
+  int pos = in->next;
+  int matched = 0;
+  int run_start = -1;
+  int run_end = -1;
+
+  for (;;) {
+    if (pos < 0 || end - pos < (int)sizeof(unsigned int)) return -1;
+
+    unsigned int first;
+    memcpy(&first, base + pos, sizeof(unsigned int));
+    if (first == SERLIB_FILTER_SENTINEL) break;
+
+    // field positions are relative to the record
+    int record_end;
+    if (record_size >= 0) {
+      if (end - pos < record_size) return -1;
+      record_end = pos + record_size;
+    } else {
+      int p = pos;
+      for (int i = 0; i < filter->field_count; i++) {
+        serlib_field_t* field = &filter->fields[i];
+        if (end - p < field->size) return -1;
+
+        int len = field->size;
+        if (field->type == SERLIB_FIELD_VAR) {
+          unsigned long long var_len = serlib_filter_load(base + p, field->size);
+          p += field->size;
+          if (var_len > (unsigned long long)(end - p)) return -1;
+          len = (int)var_len;
+        }
+
+        starts[i] = p - pos;
+        lens[i] = len;
+        p += len;
+      }
+      record_end = p;
+    }
+
+    char* record = base + pos;
+    bool keep = true;
+    for (int i = 0; keep && i < filter->predicate_count; i++) {
+      serlib_predicate_t* pred = &filter->predicates[i];
+      keep = serlib_filter_match(&filter->fields[pred->field], pred, record + starts[pred->field], lens[pred->field]);
+    }
+
+    if (keep) {
+      matched++;
+
+      if (out && !filter->projection_count) {
+        // adjacent matches are copied as one run
+        if (run_start < 0) run_start = pos;
+        run_end = record_end;
+      } else if (out) {
+        for (int i = 0; i < filter->projection_count; i++) {
+          int f = filter->projection[i];
+          int prefix = filter->fields[f].type == SERLIB_FIELD_VAR ? filter->fields[f].size : 0;
+          if (serlib_serialize_data(out, record + starts[f] - prefix, lens[f] + prefix) != SERLIB_OK) return -1;
+        }
+      }
+    } else if (run_start >= 0) {
+      if (serlib_serialize_data(out, base + run_start, run_end - run_start) != SERLIB_OK) return -1;
+      run_start = -1;
+    }
+
+    pos = record_end;
+  }
+
+  if (run_start >= 0 && serlib_serialize_data(out, base + run_start, run_end - run_start) != SERLIB_OK) return -1;
+
+  in->next = pos + sizeof(unsigned int);
+
+  if (out) {
+    unsigned int sentinel = SERLIB_FILTER_SENTINEL;
+    if (serlib_serialize_data(out, (char*)&sentinel, sizeof(unsigned int)) != SERLIB_OK) return -1;
+  }
+
+  return matched;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_filter
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > in     - ser_buff_t*
+ *         > filter - serlib_list_filter_t*
+ *         > out    - ser_buff_t*
+ * ----------------------------------------------------------------------
+ * Filters and projects a serialized list without deserializing it.
+ * ----------------------------------------------------------------------
+ */
+int serlib_list_filter(ser_buff_t* in, serlib_list_filter_t* filter, ser_buff_t* out) {
+  if (!in || !in->buffer || !filter) assert(0);
+
+  int out_next = out ? out->next : 0;
+
+  int matched = serlib_filter_scan(in, filter, out);
+  if (matched < 0 && out) {
+    // drop whatever part of the list made it into out
+    out->next = out_next;
+  }
+
+  return matched;
+};
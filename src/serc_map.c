@@ -0,0 +1,968 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "../include/serc_map.h"
+#include "../include/serc_stats.h"
+
+#define SERLIB_MAP_CTRL_EMPTY   0x80
+#define SERLIB_MAP_CTRL_DELETED 0xFE
+
+/*
+ * Lookup key: byte-string maps use data/size, integer maps use value.
+ */
+typedef struct _serlib_map_key_t {
+  char* data;
+  int size;
+  unsigned long long value;
+} serlib_map_key_t;
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_mix
+ * ----------------------------------------------------------------------
+ * params  : h - unsigned long long
+ * ----------------------------------------------------------------------
+ * 64-bit finalizer (murmur3 fmix64).
+ * ----------------------------------------------------------------------
+ */
+static unsigned long long serlib_map_mix(unsigned long long h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_hash
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > map - serlib_map_t*
+ *         > key - serlib_map_key_t*
+ * ----------------------------------------------------------------------
+ * Hashes a key. The hash has a fixed seed so that serialized tables can
+ * be probed by any process without rehashing.
+ * ----------------------------------------------------------------------
+ */
+static unsigned long long serlib_map_hash(serlib_map_t* map, serlib_map_key_t* key) {
+  if (map->key_type == SERLIB_MAP_KEY_INT) {
+    return serlib_map_mix(key->value ^ 0x9E3779B97F4A7C15ULL);
+  }
+
+  unsigned long long h = 0x9E3779B97F4A7C15ULL ^ ((unsigned long long)key->size * 0xc6a4a7935bd1e995ULL);
+  char* p = key->data;
+  int left = key->size;
+
+  for (; left >= 8; p += 8, left -= 8) {
+    unsigned long long k;
+    memcpy(&k, p, 8);
+    h = (h ^ serlib_map_mix(k)) * 0x9E3779B97F4A7C15ULL;
+  }
+
+  if (left) {
+    unsigned long long k = 0;
+    memcpy(&k, p, left);
+    h = (h ^ serlib_map_mix(k)) * 0x9E3779B97F4A7C15ULL;
+  }
+
+  return serlib_map_mix(h);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_group_match
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > group - unsigned char*
+ *         > tag   - unsigned char
+ * ----------------------------------------------------------------------
+ * Returns a bitmask of the control bytes in a group equal to tag.
+ * ----------------------------------------------------------------------
+ */
+static unsigned int serlib_map_group_match(unsigned char* group, unsigned char tag) {
+#if defined(__SSE2__)
+  __m128i ctrl = _mm_loadu_si128((__m128i*)group);
+  return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)tag)));
+#else
+  unsigned int mask = 0;
+  for (int i = 0; i < SERLIB_MAP_GROUP; i++) {
+    if (group[i] == tag) mask |= 1u << i;
+  }
+  return mask;
+#endif
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_group_free
+ * ----------------------------------------------------------------------
+ * params  : group - unsigned char*
+ * ----------------------------------------------------------------------
+ * Returns a bitmask of the empty or deleted control bytes in a group
+ * (those with the high bit set).
+ * ----------------------------------------------------------------------
+ */
+static unsigned int serlib_map_group_free(unsigned char* group) {
+#if defined(__SSE2__)
+  return (unsigned int)_mm_movemask_epi8(_mm_loadu_si128((__m128i*)group));
+#else
+  unsigned int mask = 0;
+  for (int i = 0; i < SERLIB_MAP_GROUP; i++) {
+    if (group[i] & 0x80) mask |= 1u << i;
+  }
+  return mask;
+#endif
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_ctrl_size
+ * ----------------------------------------------------------------------
+ * params  : capacity - unsigned int
+ * ----------------------------------------------------------------------
+ * Returns the bytes used by capacity control bytes plus the mirrored
+ * first group, padded so the slots that follow are 8-byte aligned.
+ * ----------------------------------------------------------------------
+ */
+static unsigned int serlib_map_ctrl_size(unsigned int capacity) {
+  return (capacity + SERLIB_MAP_GROUP + 7) & ~7u;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_set_ctrl
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > map   - serlib_map_t*
+ *         > index - unsigned int
+ *         > tag   - unsigned char
+ * ----------------------------------------------------------------------
+ * Sets a control byte, and its mirror past the end of the table so a
+ * group load never has to wrap.
+ * ----------------------------------------------------------------------
+ */
+static void serlib_map_set_ctrl(serlib_map_t* map, unsigned int index, unsigned char tag) {
+  map->ctrl[index] = tag;
+  if (index < SERLIB_MAP_GROUP) map->ctrl[map->capacity + index] = tag;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_alloc_table
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > map      - serlib_map_t*
+ *         > capacity - unsigned int (power of two)
+ * ----------------------------------------------------------------------
+ * Allocates an empty table. Control bytes and slots share one block.
+ * ----------------------------------------------------------------------
+ */
+static void serlib_map_alloc_table(serlib_map_t* map, unsigned int capacity) {
+  unsigned int ctrl_size = serlib_map_ctrl_size(capacity);
+  size_t size = ctrl_size + (size_t)capacity * sizeof(serlib_map_slot_t);
+
+  char* table = malloc(size);
+  if (!table) {
+    printf("ERROR:: serlib - Failed to allocate memory for map table in serlib_map_alloc_table\n");
+    exit(1);
+  }
+  serlib_mem_account(SERLIB_MEM_MAPS, size);
+
+  memset(table, SERLIB_MAP_CTRL_EMPTY, ctrl_size);
+  map->ctrl = (unsigned char*)table;
+  map->slots = (serlib_map_slot_t*)(table + ctrl_size);
+  map->capacity = capacity;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_free_table
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > ctrl     - unsigned char*
+ *         > capacity - unsigned int
+ * ----------------------------------------------------------------------
+ * Frees a table allocated by serlib_map_alloc_table.
+ * ----------------------------------------------------------------------
+ */
+static void serlib_map_free_table(unsigned char* ctrl, unsigned int capacity) {
+  serlib_mem_account(SERLIB_MEM_MAPS,
+                     -(long long)(serlib_map_ctrl_size(capacity) + (size_t)capacity * sizeof(serlib_map_slot_t)));
+  free(ctrl);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_key_equal
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > map  - serlib_map_t*
+ *         > slot - serlib_map_slot_t*
+ *         > key  - serlib_map_key_t*
+ * ----------------------------------------------------------------------
+ * Compares a slot's key to a lookup key.
+ * ----------------------------------------------------------------------
+ */
+static bool serlib_map_key_equal(serlib_map_t* map, serlib_map_slot_t* slot, serlib_map_key_t* key) {
+  if (map->key_type == SERLIB_MAP_KEY_INT) return slot->key.value == key->value;
+
+  return slot->key.bytes.size == (unsigned int)key->size &&
+         memcmp(map->arena + slot->key.bytes.offset, key->data, key->size) == 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_find
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > map  - serlib_map_t*
+ *         > key  - serlib_map_key_t*
+ *         > hash - unsigned long long
+ * ----------------------------------------------------------------------
+ * Returns the slot index holding key, or -1. Probes one group of
+ * control bytes at a time and stops at the first group with an empty
+ * byte.
+ * ----------------------------------------------------------------------
+ */
+static long serlib_map_find(serlib_map_t* map, serlib_map_key_t* key, unsigned long long hash) {
+  unsigned int mask = map->capacity - 1;
+  unsigned int pos = (unsigned int)(hash >> 7) & mask;
+  unsigned char tag = hash & 0x7F;
+
+  for (unsigned int stride = 0; stride <= map->capacity; ) {
+    unsigned char* group = map->ctrl + pos;
+
+    for (unsigned int match = serlib_map_group_match(group, tag); match; match &= match - 1) {
+      unsigned int index = (pos + __builtin_ctz(match)) & mask;
+      if (serlib_map_key_equal(map, &map->slots[index], key)) return index;
+    }
+
+    if (serlib_map_group_match(group, SERLIB_MAP_CTRL_EMPTY)) return -1;
+
+    stride += SERLIB_MAP_GROUP;
+    pos = (pos + stride) & mask;
+  }
+
+  return -1;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_find_free
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > map  - serlib_map_t*
+ *         > hash - unsigned long long
+ * ----------------------------------------------------------------------
+ * Returns the first empty or deleted slot on hash's probe sequence.
+ * ----------------------------------------------------------------------
+ */
+static unsigned int serlib_map_find_free(serlib_map_t* map, unsigned long long hash) {
+  unsigned int mask = map->capacity - 1;
+  unsigned int pos = (unsigned int)(hash >> 7) & mask;
+
+  for (unsigned int stride = 0; ; ) {
+    unsigned int free_mask = serlib_map_group_free(map->ctrl + pos);
+    if (free_mask) return (pos + __builtin_ctz(free_mask)) & mask;
+
+    stride += SERLIB_MAP_GROUP;
+    pos = (pos + stride) & mask;
+  }
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_arena_append
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > map  - serlib_map_t*
+ *         > data - char*
+ *         > size - int
+ * ----------------------------------------------------------------------
+ * Copies bytes to the end of the arena, which must have room, and
+ * returns their offset.
+ * ----------------------------------------------------------------------
+ */
+static unsigned int serlib_map_arena_append(serlib_map_t* map, char* data, int size) {
+  unsigned int offset = map->arena_size;
+  if (size) memcpy(map->arena + offset, data, size);
+  map->arena_size += size;
+  return offset;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_rehash
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > map      - serlib_map_t*
+ *         > capacity - unsigned int (power of two)
+ * ----------------------------------------------------------------------
+ * Rebuilds the table at capacity, dropping tombstones and compacting
+ * the arena. The arena keeps its allocated size.
+ * ----------------------------------------------------------------------
+ */
+static void serlib_map_rehash(serlib_map_t* map, unsigned int capacity) {
+  unsigned char* old_ctrl = map->ctrl;
+  serlib_map_slot_t* old_slots = map->slots;
+  unsigned int old_capacity = map->capacity;
+  char* old_arena = map->arena;
+
+  map->arena = malloc(map->arena_capacity ? map->arena_capacity : 1);
+  if (!map->arena) {
+    printf("ERROR:: serlib - Failed to allocate memory for map arena in serlib_map_rehash\n");
+    exit(1);
+  }
+  map->arena_size = 0;
+  map->garbage = 0;
+  map->deleted = 0;
+
+  serlib_map_alloc_table(map, capacity);
+
+  for (unsigned int i = 0; i < old_capacity; i++) {
+    if (old_ctrl[i] & 0x80) continue;
+
+    serlib_map_slot_t slot = old_slots[i];
+    serlib_map_key_t key = { NULL, 0, slot.key.value };
+    if (map->key_type == SERLIB_MAP_KEY_BYTES) {
+      key.data = old_arena + slot.key.bytes.offset;
+      key.size = slot.key.bytes.size;
+      slot.key.bytes.offset = serlib_map_arena_append(map, key.data, key.size);
+    }
+    slot.value_offset = serlib_map_arena_append(map, old_arena + slot.value_offset, slot.value_size);
+
+    unsigned long long hash = serlib_map_hash(map, &key);
+    unsigned int index = serlib_map_find_free(map, hash);
+    map->slots[index] = slot;
+    serlib_map_set_ctrl(map, index, hash & 0x7F);
+  }
+
+  serlib_map_free_table(old_ctrl, old_capacity);
+  free(old_arena);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_arena_reserve
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > map    - serlib_map_t*
+ *         > nbytes - unsigned int
+ * ----------------------------------------------------------------------
+ * Makes room for nbytes in the arena, compacting it first if at least
+ * half of it is garbage from replaced or removed entries.
+ * ----------------------------------------------------------------------
+ */
+static void serlib_map_arena_reserve(serlib_map_t* map, unsigned int nbytes) {
+  if (map->arena && map->arena_capacity - map->arena_size >= nbytes) return;
+
+  if (map->garbage && map->garbage * 2 >= map->arena_size) {
+    serlib_map_rehash(map, map->capacity);
+    if (map->arena_capacity - map->arena_size >= nbytes) return;
+  }
+
+  unsigned int size = map->arena_capacity ? map->arena_capacity : SERIALIZE_BUFFER_DEFAULT_SIZE;
+  while (size - map->arena_size < nbytes) size *= 2;
+
+  char* arena = realloc(map->arena, size);
+  if (!arena) {
+    printf("ERROR:: serlib - Failed to allocate memory for map arena in serlib_map_arena_reserve\n");
+    exit(1);
+  }
+  serlib_mem_account(SERLIB_MEM_MAPS, size - map->arena_capacity);
+
+  map->arena = arena;
+  map->arena_capacity = size;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_init
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > map      - serlib_map_t*
+ *         > key_type - int (SERLIB_MAP_KEY_BYTES or SERLIB_MAP_KEY_INT)
+ *         > capacity - unsigned int (expected entries, 0 for default)
+ * ----------------------------------------------------------------------
+ * Initializes an empty map.
+ * ----------------------------------------------------------------------
+ */
+void serlib_map_init(serlib_map_t* map, int key_type, unsigned int capacity) {
+  assert(key_type == SERLIB_MAP_KEY_BYTES || key_type == SERLIB_MAP_KEY_INT);
+
+  // size the table so capacity entries stay under the 7/8 load limit
+  unsigned int size = SERLIB_MAP_MIN_SIZE;
+  while ((unsigned long long)capacity * 8 > (unsigned long long)size * 7) size *= 2;
+
+  map->key_type = key_type;
+  map->count = 0;
+  map->deleted = 0;
+  map->arena = NULL;
+  map->arena_size = 0;
+  map->arena_capacity = 0;
+  map->garbage = 0;
+  map->read_only = false;
+
+  serlib_map_alloc_table(map, size);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_free
+ * ----------------------------------------------------------------------
+ * params  : map - serlib_map_t*
+ * ----------------------------------------------------------------------
+ * Frees a map's table and arena.
+ * ----------------------------------------------------------------------
+ */
+void serlib_map_free(serlib_map_t* map) {
+  if (!map->read_only) {
+    serlib_map_free_table(map->ctrl, map->capacity);
+    serlib_mem_account(SERLIB_MEM_MAPS, -(long long)map->arena_capacity);
+    free(map->arena);
+  }
+
+  map->ctrl = NULL;
+  map->slots = NULL;
+  map->arena = NULL;
+  map->capacity = 0;
+  map->count = 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_insert
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > map        - serlib_map_t*
+ *         > key        - serlib_map_key_t*
+ *         > value      - char*
+ *         > value_size - int
+ * ----------------------------------------------------------------------
+ * Inserts or replaces a key's value.
+ * ----------------------------------------------------------------------
+ */
+static int serlib_map_insert(serlib_map_t* map, serlib_map_key_t* key, char* value, int value_size) {
+  if (map->read_only) return -1;
+  assert(value_size >= 0 && (value || !value_size));
+
+  unsigned long long hash = serlib_map_hash(map, key);
+
+  // reserve first: compacting the arena rebuilds the table
+  serlib_map_arena_reserve(map, key->size + value_size);
+
+  long found = serlib_map_find(map, key, hash);
+  if (found >= 0) {
+    serlib_map_slot_t* slot = &map->slots[found];
+    map->garbage += slot->value_size;
+    slot->value_offset = serlib_map_arena_append(map, value, value_size);
+    slot->value_size = value_size;
+    return 0;
+  }
+
+  // keep live entries plus tombstones under 7/8 of the table, growing
+  // only when live entries alone would pass half of that
+  if ((unsigned long long)(map->count + map->deleted + 1) * 8 > (unsigned long long)map->capacity * 7) {
+    unsigned int capacity = map->capacity;
+    if ((unsigned long long)(map->count + 1) * 16 > (unsigned long long)capacity * 7) capacity *= 2;
+    serlib_map_rehash(map, capacity);
+  }
+
+  unsigned int index = serlib_map_find_free(map, hash);
+  if (map->ctrl[index] == SERLIB_MAP_CTRL_DELETED) map->deleted--;
+
+  serlib_map_slot_t* slot = &map->slots[index];
+  if (map->key_type == SERLIB_MAP_KEY_INT) {
+    slot->key.value = key->value;
+  } else {
+    slot->key.bytes.offset = serlib_map_arena_append(map, key->data, key->size);
+    slot->key.bytes.size = key->size;
+  }
+  slot->value_offset = serlib_map_arena_append(map, value, value_size);
+  slot->value_size = value_size;
+
+  serlib_map_set_ctrl(map, index, hash & 0x7F);
+  map->count++;
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_lookup
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > map        - serlib_map_t*
+ *         > key        - serlib_map_key_t*
+ *         > value_size - int* (out, may be NULL)
+ * ----------------------------------------------------------------------
+ * Returns a pointer to a key's value, or NULL.
+ * ----------------------------------------------------------------------
+ */
+static char* serlib_map_lookup(serlib_map_t* map, serlib_map_key_t* key, int* value_size) {
+  long found = serlib_map_find(map, key, serlib_map_hash(map, key));
+  if (found < 0) return NULL;
+
+  serlib_map_slot_t* slot = &map->slots[found];
+  if (value_size) *value_size = slot->value_size;
+  return map->arena + slot->value_offset;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_delete
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > map - serlib_map_t*
+ *         > key - serlib_map_key_t*
+ * ----------------------------------------------------------------------
+ * Removes a key, leaving a tombstone.
+ * ----------------------------------------------------------------------
+ */
+static int serlib_map_delete(serlib_map_t* map, serlib_map_key_t* key) {
+  if (map->read_only) return -1;
+
+  long found = serlib_map_find(map, key, serlib_map_hash(map, key));
+  if (found < 0) return -1;
+
+  serlib_map_slot_t* slot = &map->slots[found];
+  map->garbage += slot->value_size;
+  if (map->key_type == SERLIB_MAP_KEY_BYTES) map->garbage += slot->key.bytes.size;
+
+  serlib_map_set_ctrl(map, found, SERLIB_MAP_CTRL_DELETED);
+  map->count--;
+  map->deleted++;
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_put
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > map        - serlib_map_t*
+ *         > key        - char*
+ *         > key_size   - int
+ *         > value      - char*
+ *         > value_size - int
+ * ----------------------------------------------------------------------
+ * Inserts or replaces the value of a byte-string key.
+ * ----------------------------------------------------------------------
+ */
+int serlib_map_put(serlib_map_t* map, char* key, int key_size, char* value, int value_size) {
+  assert(map->key_type == SERLIB_MAP_KEY_BYTES && key_size >= 0);
+
+  serlib_map_key_t k = { key, key_size, 0 };
+  return serlib_map_insert(map, &k, value, value_size);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_put_int
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > map        - serlib_map_t*
+ *         > key        - unsigned long long
+ *         > value      - char*
+ *         > value_size - int
+ * ----------------------------------------------------------------------
+ * Inserts or replaces the value of an integer key.
+ * ----------------------------------------------------------------------
+ */
+int serlib_map_put_int(serlib_map_t* map, unsigned long long key, char* value, int value_size) {
+  assert(map->key_type == SERLIB_MAP_KEY_INT);
+
+  serlib_map_key_t k = { NULL, 0, key };
+  return serlib_map_insert(map, &k, value, value_size);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_get
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > map        - serlib_map_t*
+ *         > key        - char*
+ *         > key_size   - int
+ *         > value_size - int* (out, may be NULL)
+ * ----------------------------------------------------------------------
+ * Looks up a byte-string key.
+ * ----------------------------------------------------------------------
+ */
+char* serlib_map_get(serlib_map_t* map, char* key, int key_size, int* value_size) {
+  assert(map->key_type == SERLIB_MAP_KEY_BYTES);
+
+  serlib_map_key_t k = { key, key_size, 0 };
+  return serlib_map_lookup(map, &k, value_size);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_get_int
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > map        - serlib_map_t*
+ *         > key        - unsigned long long
+ *         > value_size - int* (out, may be NULL)
+ * ----------------------------------------------------------------------
+ * Looks up an integer key.
+ * ----------------------------------------------------------------------
+ */
+char* serlib_map_get_int(serlib_map_t* map, unsigned long long key, int* value_size) {
+  assert(map->key_type == SERLIB_MAP_KEY_INT);
+
+  serlib_map_key_t k = { NULL, 0, key };
+  return serlib_map_lookup(map, &k, value_size);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_remove
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > map      - serlib_map_t*
+ *         > key      - char*
+ *         > key_size - int
+ * ----------------------------------------------------------------------
+ * Removes a byte-string key.
+ * ----------------------------------------------------------------------
+ */
+int serlib_map_remove(serlib_map_t* map, char* key, int key_size) {
+  assert(map->key_type == SERLIB_MAP_KEY_BYTES);
+
+  serlib_map_key_t k = { key, key_size, 0 };
+  return serlib_map_delete(map, &k);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_remove_int
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > map - serlib_map_t*
+ *         > key - unsigned long long
+ * ----------------------------------------------------------------------
+ * Removes an integer key.
+ * ----------------------------------------------------------------------
+ */
+int serlib_map_remove_int(serlib_map_t* map, unsigned long long key) {
+  assert(map->key_type == SERLIB_MAP_KEY_INT);
+
+  serlib_map_key_t k = { NULL, 0, key };
+  return serlib_map_delete(map, &k);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_get_count
+ * ----------------------------------------------------------------------
+ * params  : map - serlib_map_t*
+ * ----------------------------------------------------------------------
+ * Returns the number of entries in a map.
+ * ----------------------------------------------------------------------
+ */
+unsigned int serlib_map_get_count(serlib_map_t* map) {
+  return map->count;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_iterate
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > map   - serlib_map_t*
+ *         > pos   - unsigned int* (start at 0)
+ *         > entry - serlib_map_entry_t* (out)
+ * ----------------------------------------------------------------------
+ * Gets the next entry in table order.
+ * ----------------------------------------------------------------------
+ */
+bool serlib_map_iterate(serlib_map_t* map, unsigned int* pos, serlib_map_entry_t* entry) {
+  for (; *pos < map->capacity; (*pos)++) {
+    if (map->ctrl[*pos] & 0x80) continue;
+
+    serlib_map_slot_t* slot = &map->slots[(*pos)++];
+    if (map->key_type == SERLIB_MAP_KEY_INT) {
+      entry->key = NULL;
+      entry->key_size = 0;
+      entry->key_int = slot->key.value;
+    } else {
+      entry->key = map->arena + slot->key.bytes.offset;
+      entry->key_size = slot->key.bytes.size;
+      entry->key_int = 0;
+    }
+    entry->value = map->arena + slot->value_offset;
+    entry->value_size = slot->value_size;
+    return true;
+  }
+
+  return false;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_image_size
+ * ----------------------------------------------------------------------
+ * params  : map - serlib_map_t*
+ * ----------------------------------------------------------------------
+ * Returns the size of the map's image, excluding alignment padding.
+ * ----------------------------------------------------------------------
+ */
+int serlib_map_image_size(serlib_map_t* map) {
+  size_t size = sizeof(serlib_map_image_t)
+              + serlib_map_ctrl_size(map->capacity)
+              + (size_t)map->capacity * sizeof(serlib_map_slot_t)
+              + map->arena_size;
+  return (int)((size + 7) & ~(size_t)7);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_serialize_map_t
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > b   - ser_buff_t*
+ *         > map - serlib_map_t*
+ * ----------------------------------------------------------------------
+ * Writes the map's table as an image.
+ * ----------------------------------------------------------------------
+ */
+int serlib_serialize_map_t(ser_buff_t* b, serlib_map_t* map) {
+  if (b == NULL) assert(0);
+
+  char zeros[8] = { 0 };
+  int pad = (8 - (b->next & 7)) & 7;
+  int size = serlib_map_image_size(map);
+
+  // fail before writing anything if a fixed buffer can't take it all
+  if ((b->flags & SERLIB_BUFF_FIXED) && b->size - b->next < pad + size) {
+    b->flags |= SERLIB_BUFF_OVERFLOW;
+    return SERLIB_ERR_OVERFLOW;
+  }
+
+  serlib_map_image_t image = {
+    SERLIB_MAP_MAGIC,
+    SERLIB_MAP_VERSION,
+    map->key_type,
+    map->capacity,
+    map->count,
+    map->deleted,
+    map->arena_size,
+    map->garbage
+  };
+
+  int written = (int)sizeof(image) + (int)serlib_map_ctrl_size(map->capacity)
+              + map->capacity * (int)sizeof(serlib_map_slot_t) + map->arena_size;
+
+  serlib_serialize_data(b, zeros, pad);
+  serlib_serialize_data(b, (char*)&image, sizeof(image));
+  serlib_serialize_data(b, (char*)map->ctrl, serlib_map_ctrl_size(map->capacity));
+  serlib_serialize_data(b, (char*)map->slots, map->capacity * sizeof(serlib_map_slot_t));
+  if (map->arena_size) serlib_serialize_data(b, map->arena, map->arena_size);
+  serlib_serialize_data(b, zeros, size - written);
+
+  return SERLIB_OK;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_check_image
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > image - serlib_map_image_t*
+ *         > size  - long long (bytes available)
+ * ----------------------------------------------------------------------
+ * Validates an image header. Returns the image size, or -1.
+ * ----------------------------------------------------------------------
+ */
+static long long serlib_map_check_image(serlib_map_image_t* image, long long size) {
+  if (size < (long long)sizeof(*image)) return -1;
+  if (image->magic != SERLIB_MAP_MAGIC || image->version != SERLIB_MAP_VERSION) return -1;
+  if (image->key_type != SERLIB_MAP_KEY_BYTES && image->key_type != SERLIB_MAP_KEY_INT) return -1;
+  if (image->capacity < SERLIB_MAP_MIN_SIZE || (image->capacity & (image->capacity - 1))) return -1;
+  if (image->capacity > (1u << 28) || image->count + image->deleted >= image->capacity) return -1;
+
+  long long total = sizeof(*image)
+                  + serlib_map_ctrl_size(image->capacity)
+                  + (long long)image->capacity * sizeof(serlib_map_slot_t)
+                  + image->arena_size;
+  total = (total + 7) & ~7LL;
+
+  return total <= size ? total : -1;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_use_image
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > map   - serlib_map_t*
+ *         > image - serlib_map_image_t*
+ * ----------------------------------------------------------------------
+ * Points a map at the arrays of an image.
+ * ----------------------------------------------------------------------
+ */
+static void serlib_map_use_image(serlib_map_t* map, serlib_map_image_t* image) {
+  char* ctrl = (char*)(image + 1);
+  char* slots = ctrl + serlib_map_ctrl_size(image->capacity);
+
+  map->key_type = image->key_type;
+  map->capacity = image->capacity;
+  map->count = image->count;
+  map->deleted = image->deleted;
+  map->ctrl = (unsigned char*)ctrl;
+  map->slots = (serlib_map_slot_t*)slots;
+  map->arena = slots + (size_t)image->capacity * sizeof(serlib_map_slot_t);
+  map->arena_size = image->arena_size;
+  map->arena_capacity = image->arena_size;
+  map->garbage = image->garbage;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_check_tables
+ * ----------------------------------------------------------------------
+ * params  : view - serlib_map_t* (over an image's arrays)
+ * ----------------------------------------------------------------------
+ * Validates the arrays of an image whose header already passed
+ * serlib_map_check_image: every control byte is a tag, empty or
+ * deleted, the live and deleted ones match count and deleted, the
+ * mirrored group repeats the first one, and every live slot's offsets
+ * stay inside the arena. Returns 0, or -1.
+ * ----------------------------------------------------------------------
+ */
+static int serlib_map_check_tables(serlib_map_t* view) {
+  unsigned int live = 0;
+  unsigned int deleted = 0;
+
+  for (unsigned int i = 0; i < view->capacity; i++) {
+    unsigned char ctrl = view->ctrl[i];
+    if (ctrl == SERLIB_MAP_CTRL_EMPTY) continue;
+    if (ctrl == SERLIB_MAP_CTRL_DELETED) {
+      deleted++;
+      continue;
+    }
+    if (ctrl & 0x80) return -1;
+    live++;
+
+    // slot offsets must stay inside the arena
+    serlib_map_slot_t* slot = &view->slots[i];
+    unsigned long long value_end = (unsigned long long)slot->value_offset + slot->value_size;
+    unsigned long long key_end = view->key_type == SERLIB_MAP_KEY_BYTES
+                               ? (unsigned long long)slot->key.bytes.offset + slot->key.bytes.size : 0;
+    if (value_end > view->arena_size || key_end > view->arena_size) return -1;
+  }
+
+  // probing relies on both: a wrong count could leave no free byte to find
+  if (live != view->count || deleted != view->deleted) return -1;
+  if (memcmp(view->ctrl + view->capacity, view->ctrl, SERLIB_MAP_GROUP) != 0) return -1;
+
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_map_open
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > map  - serlib_map_t* (out)
+ *         > data - char* (8-byte aligned image, e.g. mmapped)
+ *         > size - int
+ * ----------------------------------------------------------------------
+ * Opens a read-only map directly over an image without copying.
+ * ----------------------------------------------------------------------
+ */
+int serlib_map_open(serlib_map_t* map, char* data, int size) {
+  if (!data || ((uintptr_t)data & 7)) return -1;
+
+  serlib_map_image_t* image = (serlib_map_image_t*)data;
+  if (serlib_map_check_image(image, size) < 0) return -1;
+
+  serlib_map_t view;
+  serlib_map_use_image(&view, image);
+  if (serlib_map_check_tables(&view) < 0) return -1;
+
+  *map = view;
+  map->read_only = true;
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_deserialize_map_t
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > b   - ser_buff_t*
+ *         > map - serlib_map_t* (out)
+ * ----------------------------------------------------------------------
+ * Reads an image into a new, writable map without rehashing.
+ * ----------------------------------------------------------------------
+ */
+int serlib_deserialize_map_t(ser_buff_t* b, serlib_map_t* map) {
+  if (!b || !b->buffer) assert(0);
+
+  int pad = (8 - (b->next & 7)) & 7;
+  if (b->size - b->next < pad) return -1;
+
+  serlib_map_image_t image;
+  char* data = b->buffer + b->next + pad;
+  long long available = b->size - b->next - pad;
+  if (available < (long long)sizeof(image)) return -1;
+  memcpy(&image, data, sizeof(image));
+
+  long long size = serlib_map_check_image(&image, available);
+  if (size < 0) return -1;
+
+  // view the image through a temporary map, then copy its arrays as is
+  serlib_map_t view;
+  char* copy = NULL;
+  if ((uintptr_t)data & 7) {
+    copy = malloc(size);
+    if (!copy) {
+      printf("ERROR:: serlib - Failed to allocate memory for map image in serlib_deserialize_map_t\n");
+      exit(1);
+    }
+    memcpy(copy, data, size);
+    data = copy;
+  }
+  serlib_map_use_image(&view, (serlib_map_image_t*)data);
+
+  if (serlib_map_check_tables(&view) < 0) {
+    free(copy);
+    return -1;
+  }
+
+  map->key_type = view.key_type;
+  map->count = view.count;
+  map->deleted = view.deleted;
+  map->garbage = view.garbage;
+  map->read_only = false;
+
+  serlib_map_alloc_table(map, view.capacity);
+  memcpy(map->ctrl, view.ctrl, serlib_map_ctrl_size(view.capacity));
+  memcpy(map->slots, view.slots, (size_t)view.capacity * sizeof(serlib_map_slot_t));
+
+  map->arena_capacity = view.arena_size;
+  map->arena_size = view.arena_size;
+  map->arena = malloc(view.arena_size ? view.arena_size : 1);
+  if (!map->arena) {
+    printf("ERROR:: serlib - Failed to allocate memory for map arena in serlib_deserialize_map_t\n");
+    exit(1);
+  }
+  memcpy(map->arena, view.arena, view.arena_size);
+  serlib_mem_account(SERLIB_MEM_MAPS, view.arena_size);
+
+  free(copy);
+  b->next += pad + (int)size;
+  return 0;
+};
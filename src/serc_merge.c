@@ -0,0 +1,328 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "../include/serc_merge.h"
+
+#define SERLIB_MERGE_SENTINEL 0xFFFFFFFF
+
+static const unsigned int serlib_merge_sentinel = SERLIB_MERGE_SENTINEL;
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_merge_compare
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > a - serlib_merge_key_t*
+ *         > b - serlib_merge_key_t*
+ * ----------------------------------------------------------------------
+ * Three-way comparison of two keys.
+ * ----------------------------------------------------------------------
+ */
+static int serlib_merge_compare(serlib_merge_key_t* a, serlib_merge_key_t* b) {
+  if (a->number != b->number) return a->number < b->number ? -1 : 1;
+
+  int n = a->bytes_size < b->bytes_size ? a->bytes_size : b->bytes_size;
+  int cmp = n ? memcmp(a->bytes, b->bytes, n) : 0;
+  if (cmp) return cmp;
+
+  return (a->bytes_size > b->bytes_size) - (a->bytes_size < b->bytes_size);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_merge_less
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > merger - serlib_list_merger_t*
+ *         > i      - int (run index)
+ *         > j      - int (run index)
+ * ----------------------------------------------------------------------
+ * Orders the heads of two runs, equal keys by run index.
+ * ----------------------------------------------------------------------
+ */
+static bool serlib_merge_less(serlib_list_merger_t* merger, int i, int j) {
+  int cmp = serlib_merge_compare(&merger->runs[i].key, &merger->runs[j].key);
+  return cmp ? cmp < 0 : i < j;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_merge_sift_down
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > merger - serlib_list_merger_t*
+ *         > pos    - int
+ * ----------------------------------------------------------------------
+ * Moves a heap entry down until neither child is smaller.
+ * ----------------------------------------------------------------------
+ */
+static void serlib_merge_sift_down(serlib_list_merger_t* merger, int pos) {
+  int* heap = merger->heap;
+  int count = merger->heap_count;
+  int run = heap[pos];
+
+  for (;;) {
+    int child = 2 * pos + 1;
+    if (child >= count) break;
+    if (child + 1 < count && serlib_merge_less(merger, heap[child + 1], heap[child])) child++;
+    if (!serlib_merge_less(merger, heap[child], run)) break;
+
+    heap[pos] = heap[child];
+    pos = child;
+  }
+
+  heap[pos] = run;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_merge_read
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > merger - serlib_list_merger_t*
+ *         > run    - serlib_merge_run_t*
+ * ----------------------------------------------------------------------
+ * Reads the key and size of the element at a run's b->next. Returns 1
+ * for an element, 0 at the sentinel (skipped), -1 if malformed.
+ * ----------------------------------------------------------------------
+ */
+static int serlib_merge_read(serlib_list_merger_t* merger, serlib_merge_run_t* run) {
+  ser_buff_t* b = run->b;
+  int available = b->size - b->next;
+  if (b->next < 0 || available < (int)sizeof(unsigned int)) return -1;
+
+  char* data = b->buffer + b->next;
+  unsigned int first;
+  memcpy(&first, data, sizeof(unsigned int));
+  if (first == SERLIB_MERGE_SENTINEL) {
+    b->next += sizeof(unsigned int);
+    run->size = 0;
+    return 0;
+  }
+
+  memset(&run->key, 0, sizeof(run->key));
+  int size = merger->key_fn(data, available, &run->key);
+  if (size <= 0 || size > available || run->key.bytes_size < 0) return -1;
+  if (run->key.bytes_size && !run->key.bytes) return -1;
+
+  run->size = size;
+  return 1;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_merge_take
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > merger - serlib_list_merger_t*
+ *         > src    - char** (out)
+ * ----------------------------------------------------------------------
+ * Takes the smallest head element off the heap and advances its run.
+ * Returns the element's size, 0 once every run is exhausted, or -1.
+ * ----------------------------------------------------------------------
+ */
+static int serlib_merge_take(serlib_list_merger_t* merger, char** src) {
+  if (!merger->heap_count) return 0;
+
+  serlib_merge_run_t* run = &merger->runs[merger->heap[0]];
+  int size = run->size;
+  serlib_merge_key_t last = run->key;
+
+  *src = run->b->buffer + run->b->next;
+  run->b->next += size;
+
+  int status = serlib_merge_read(merger, run);
+  if (status < 0) return -1;
+
+  if (status == 0) {
+    merger->heap[0] = merger->heap[--merger->heap_count];
+  } else if (serlib_merge_compare(&run->key, &last) < 0) {
+    // the run isn't sorted
+    return -1;
+  }
+
+  if (merger->heap_count) serlib_merge_sift_down(merger, 0);
+  return size;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_merger_init
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > merger    - serlib_list_merger_t*
+ *         > runs      - ser_buff_t**
+ *         > run_count - int
+ *         > key_fn    - serlib_merge_key_fn
+ * ----------------------------------------------------------------------
+ * Reads the first element of every run and builds the heap.
+ * ----------------------------------------------------------------------
+ */
+int serlib_list_merger_init(serlib_list_merger_t* merger,
+                            ser_buff_t** runs,
+                            int run_count,
+                            serlib_merge_key_fn key_fn)
+{
+  if (!merger || !key_fn || run_count < 0 || (run_count && !runs)) assert(0);
+
+  memset(merger, 0, sizeof(*merger));
+  merger->key_fn = key_fn;
+  merger->run_count = run_count;
+
+  int slots = run_count ? run_count : 1;
+  merger->runs = calloc(slots, sizeof(serlib_merge_run_t));
+  merger->heap = malloc(slots * sizeof(int));
+  if (!merger->runs || !merger->heap) {
+    printf("ERROR:: serlib - Failed to allocate memory for merge runs in serlib_list_merger_init\n");
+    exit(1);
+  }
+
+  for (int i = 0; i < run_count; i++) {
+    if (!runs[i] || !runs[i]->buffer) assert(0);
+    merger->runs[i].b = runs[i];
+
+    int status = serlib_merge_read(merger, &merger->runs[i]);
+    if (status < 0) {
+      serlib_list_merger_free(merger);
+      return -1;
+    }
+    if (status) merger->heap[merger->heap_count++] = i;
+  }
+
+  for (int pos = merger->heap_count / 2 - 1; pos >= 0; pos--) {
+    serlib_merge_sift_down(merger, pos);
+  }
+
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_merge_list_chunk
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > merger   - serlib_list_merger_t*
+ *         > out      - char*
+ *         > out_size - int
+ * ----------------------------------------------------------------------
+ * Fills out with up to out_size bytes of the merged list.
+ * ----------------------------------------------------------------------
+ */
+int serlib_merge_list_chunk(serlib_list_merger_t* merger, char* out, int out_size) {
+  if (merger->failed) return -1;
+
+  int written = 0;
+
+  while (written < out_size) {
+    // finish the element cut off by the previous chunk first
+    if (merger->copy_left) {
+      int n = merger->copy_left;
+      if (n > out_size - written) n = out_size - written;
+
+      memcpy(out + written, merger->copy_src, n);
+      merger->copy_src += n;
+      merger->copy_left -= n;
+      written += n;
+      continue;
+    }
+
+    char* src;
+    int size = serlib_merge_take(merger, &src);
+    if (size < 0) {
+      merger->failed = true;
+      return -1;
+    }
+
+    if (size) {
+      merger->copy_src = src;
+      merger->copy_left = size;
+    } else if (!merger->sentinel_done) {
+      merger->copy_src = (char*)&serlib_merge_sentinel;
+      merger->copy_left = sizeof(unsigned int);
+      merger->sentinel_done = true;
+    } else {
+      break;
+    }
+  }
+
+  return written;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_merger_done
+ * ----------------------------------------------------------------------
+ * params  : merger - serlib_list_merger_t*
+ * ----------------------------------------------------------------------
+ * Returns true once every byte of the merged list has been emitted.
+ * ----------------------------------------------------------------------
+ */
+bool serlib_list_merger_done(serlib_list_merger_t* merger) {
+  return merger->sentinel_done && !merger->copy_left;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_list_merger_free
+ * ----------------------------------------------------------------------
+ * params  : merger - serlib_list_merger_t*
+ * ----------------------------------------------------------------------
+ * Frees a merger's run cursors and heap.
+ * ----------------------------------------------------------------------
+ */
+void serlib_list_merger_free(serlib_list_merger_t* merger) {
+  free(merger->runs);
+  free(merger->heap);
+  merger->runs = NULL;
+  merger->heap = NULL;
+  merger->heap_count = 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_merge_lists
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > runs      - ser_buff_t**
+ *         > run_count - int
+ *         > key_fn    - serlib_merge_key_fn
+ *         > out       - ser_buff_t*
+ * ----------------------------------------------------------------------
+ * Merges the runs into out in one go.
+ * ----------------------------------------------------------------------
+ */
+int serlib_merge_lists(ser_buff_t** runs, int run_count, serlib_merge_key_fn key_fn, ser_buff_t* out) {
+  if (!out) assert(0);
+
+  int out_next = out->next;
+
+  serlib_list_merger_t merger;
+  if (serlib_list_merger_init(&merger, runs, run_count, key_fn) < 0) return -1;
+
+  // each element goes straight from its run into out
+  int result = 0;
+  for (;;) {
+    char* src;
+    int size = serlib_merge_take(&merger, &src);
+    if (size <= 0) {
+      result = size;
+      break;
+    }
+    if (serlib_serialize_data(out, src, size) != SERLIB_OK) {
+      result = -1;
+      break;
+    }
+  }
+
+  if (result == 0 && serlib_serialize_data(out, (char*)&serlib_merge_sentinel, sizeof(unsigned int)) != SERLIB_OK) {
+    result = -1;
+  }
+
+  // drop whatever part of the merged list made it into out
+  if (result < 0) out->next = out_next;
+
+  serlib_list_merger_free(&merger);
+  return result;
+};
@@ -0,0 +1,464 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+#include "../include/serc_numa.h"
+
+#define SERLIB_NUMA_MAGIC     0x414d554e
+#define SERLIB_NUMA_HUGE      0xFFFF
+#define SERLIB_NUMA_MIN_CLASS 16
+
+/*
+ * Every block starts with this header. Size classes are by payload
+ * (16 << class bytes), so the power-of-two sizes buffers grow through
+ * fit a class exactly.
+ */
+typedef struct _serlib_numa_block_t {
+  unsigned int magic;
+  unsigned short node;
+  unsigned short klass;
+  unsigned long long size;
+} serlib_numa_block_t;
+
+typedef struct _serlib_numa_pool_t {
+  _Alignas(64) pthread_mutex_t lock;
+  serlib_numa_block_t* free[SERLIB_NUMA_CLASSES];
+  int cached[SERLIB_NUMA_CLASSES];
+  char* chunk;
+  size_t chunk_used;
+} serlib_numa_pool_t;
+
+static pthread_mutex_t serlib_numa_init_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Atomic(serlib_numa_pool_t*) serlib_numa_pools = NULL;
+static int serlib_numa_nodes = 0;
+static bool serlib_numa_simulated = false;
+static size_t serlib_numa_page_size = 4096;
+static _Thread_local int serlib_numa_thread_node = -1;
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_numa_list_max
+ * ----------------------------------------------------------------------
+ * params  : path - const char* (sysfs list such as "0-3,6")
+ * ----------------------------------------------------------------------
+ * Returns the highest number in a sysfs list file, or -1.
+ * ----------------------------------------------------------------------
+ */
+static int serlib_numa_list_max(const char* path) {
+  FILE* f = fopen(path, "r");
+  if (!f) return -1;
+
+  char line[4096];
+  int max = -1;
+  if (fgets(line, sizeof(line), f)) {
+    char* p = line;
+    while (*p) {
+      if (*p < '0' || *p > '9') {
+        p++;
+        continue;
+      }
+      int n = (int)strtol(p, &p, 10);
+      if (n > max) max = n;
+    }
+  }
+
+  fclose(f);
+  return max;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_numa_node_cpus
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > node - int
+ *         > set  - cpu_set_t* (out)
+ * ----------------------------------------------------------------------
+ * Reads the CPUs of a node from sysfs. Returns 0 on success, -1 if the
+ * node has none or cannot be read.
+ * ----------------------------------------------------------------------
+ */
+static int serlib_numa_node_cpus(int node, cpu_set_t* set) {
+  char path[64];
+  snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+
+  FILE* f = fopen(path, "r");
+  if (!f) return -1;
+
+  char line[4096];
+  char* p = fgets(line, sizeof(line), f);
+  fclose(f);
+  if (!p) return -1;
+
+  CPU_ZERO(set);
+  while (*p >= '0' && *p <= '9') {
+    int first = (int)strtol(p, &p, 10);
+    int last = first;
+    if (*p == '-') last = (int)strtol(p + 1, &p, 10);
+    for (int cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) CPU_SET(cpu, set);
+    if (*p == ',') p++;
+  }
+
+  return CPU_COUNT(set) ? 0 : -1;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_numa_init
+ * ----------------------------------------------------------------------
+ * params  : simulated_nodes - int
+ * ----------------------------------------------------------------------
+ * Sets up the per-node pools for the real or a simulated topology.
+ * ----------------------------------------------------------------------
+ */
+int serlib_numa_init(int simulated_nodes) {
+  if (simulated_nodes < 0 || simulated_nodes > SERLIB_NUMA_MAX_NODES) return -1;
+
+  pthread_mutex_lock(&serlib_numa_init_lock);
+  if (atomic_load_explicit(&serlib_numa_pools, memory_order_acquire)) {
+    pthread_mutex_unlock(&serlib_numa_init_lock);
+    return -1;
+  }
+
+  int nodes = simulated_nodes;
+  if (!nodes) {
+    nodes = serlib_numa_list_max("/sys/devices/system/node/online") + 1;
+    if (nodes < 1) nodes = 1;
+    if (nodes > SERLIB_NUMA_MAX_NODES) nodes = SERLIB_NUMA_MAX_NODES;
+  }
+
+  serlib_numa_pool_t* pools = aligned_alloc(64, nodes * sizeof(serlib_numa_pool_t));
+  if (!pools) {
+    printf("ERROR:: serlib - Failed to allocate memory for node pools in serlib_numa_init\n");
+    exit(1);
+  }
+  memset(pools, 0, nodes * sizeof(serlib_numa_pool_t));
+  for (int i = 0; i < nodes; i++) {
+    pthread_mutex_init(&pools[i].lock, NULL);
+  }
+
+  long page_size = sysconf(_SC_PAGESIZE);
+  if (page_size > 0) serlib_numa_page_size = page_size;
+  serlib_numa_nodes = nodes;
+  serlib_numa_simulated = simulated_nodes > 0;
+  atomic_store_explicit(&serlib_numa_pools, pools, memory_order_release);
+
+  pthread_mutex_unlock(&serlib_numa_init_lock);
+  return nodes;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_numa_get_pools
+ * ----------------------------------------------------------------------
+ * Returns the node pools, detecting the topology on first use.
+ * ----------------------------------------------------------------------
+ */
+static serlib_numa_pool_t* serlib_numa_get_pools(void) {
+  serlib_numa_pool_t* pools = atomic_load_explicit(&serlib_numa_pools, memory_order_acquire);
+  if (pools) return pools;
+
+  serlib_numa_init(0);
+  return atomic_load_explicit(&serlib_numa_pools, memory_order_acquire);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_numa_node_count
+ * ----------------------------------------------------------------------
+ * Returns the number of (real or simulated) nodes.
+ * ----------------------------------------------------------------------
+ */
+int serlib_numa_node_count(void) {
+  serlib_numa_get_pools();
+  return serlib_numa_nodes;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_numa_is_simulated
+ * ----------------------------------------------------------------------
+ * Returns true if the nodes are simulated.
+ * ----------------------------------------------------------------------
+ */
+bool serlib_numa_is_simulated(void) {
+  serlib_numa_get_pools();
+  return serlib_numa_simulated;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_numa_current_node
+ * ----------------------------------------------------------------------
+ * Returns the node of the calling thread.
+ * ----------------------------------------------------------------------
+ */
+int serlib_numa_current_node(void) {
+  if (serlib_numa_thread_node >= 0) return serlib_numa_thread_node;
+  serlib_numa_get_pools();
+
+  unsigned int cpu = 0;
+  unsigned int node = 0;
+  if (syscall(SYS_getcpu, &cpu, &node, NULL) < 0) return 0;
+
+  if (serlib_numa_simulated) return cpu % serlib_numa_nodes;
+  return node < (unsigned int)serlib_numa_nodes ? (int)node : 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_numa_run_on_node
+ * ----------------------------------------------------------------------
+ * params  : node - int
+ * ----------------------------------------------------------------------
+ * Moves the calling thread to a node's CPUs.
+ * ----------------------------------------------------------------------
+ */
+int serlib_numa_run_on_node(int node) {
+  serlib_numa_get_pools();
+  if (node < 0 || node >= serlib_numa_nodes) return -1;
+
+  // a single node has nowhere else to run
+  if (!serlib_numa_simulated && serlib_numa_nodes > 1) {
+    cpu_set_t set;
+    if (serlib_numa_node_cpus(node, &set) < 0) return -1;
+    if (sched_setaffinity(0, sizeof(set), &set) < 0) return -1;
+  }
+
+  serlib_numa_thread_node = node;
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_numa_map
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > len  - size_t
+ *         > node - int
+ * ----------------------------------------------------------------------
+ * Maps fresh memory and sets its policy to prefer node before any page
+ * of it is touched. The policy is best effort: if mbind is unavailable
+ * the memory is still usable, just placed by first touch.
+ * ----------------------------------------------------------------------
+ */
+static void* serlib_numa_map(size_t len, int node) {
+  void* map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (map == MAP_FAILED) {
+    printf("ERROR:: serlib - Failed to map memory for node pool in serlib_numa_map\n");
+    exit(1);
+  }
+
+  if (!serlib_numa_simulated) {
+    unsigned long mask = 1UL << node;
+    syscall(SYS_mbind, map, len, MPOL_PREFERRED, &mask, SERLIB_NUMA_MAX_NODES + 1, 0);
+  }
+
+  return map;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_numa_class
+ * ----------------------------------------------------------------------
+ * params  : size - int
+ * ----------------------------------------------------------------------
+ * Returns the smallest class holding size bytes, or SERLIB_NUMA_HUGE.
+ * ----------------------------------------------------------------------
+ */
+static int serlib_numa_class(int size) {
+  int klass = 0;
+  while (klass < SERLIB_NUMA_CLASSES && ((long long)SERLIB_NUMA_MIN_CLASS << klass) < size) klass++;
+  return klass < SERLIB_NUMA_CLASSES ? klass : SERLIB_NUMA_HUGE;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_numa_map_size
+ * ----------------------------------------------------------------------
+ * params  : payload - size_t
+ * ----------------------------------------------------------------------
+ * Returns the page-rounded mapping size for a payload and its header.
+ * ----------------------------------------------------------------------
+ */
+static size_t serlib_numa_map_size(size_t payload) {
+  size_t len = sizeof(serlib_numa_block_t) + payload;
+  return (len + serlib_numa_page_size - 1) & ~(serlib_numa_page_size - 1);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_numa_alloc
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > node - int
+ *         > size - int
+ * ----------------------------------------------------------------------
+ * Allocates size bytes from a node's pool.
+ * ----------------------------------------------------------------------
+ */
+void* serlib_numa_alloc(int node, int size) {
+  serlib_numa_pool_t* pools = serlib_numa_get_pools();
+  if (node < 0 || node >= serlib_numa_nodes || size < 0) assert(0);
+
+  int klass = serlib_numa_class(size);
+  serlib_numa_block_t* block = NULL;
+
+  if (klass == SERLIB_NUMA_HUGE) {
+    size_t len = serlib_numa_map_size(size);
+    block = serlib_numa_map(len, node);
+    block->size = len;
+  } else {
+    serlib_numa_pool_t* pool = &pools[node];
+    size_t payload = (size_t)SERLIB_NUMA_MIN_CLASS << klass;
+    size_t total = sizeof(serlib_numa_block_t) + payload;
+
+    pthread_mutex_lock(&pool->lock);
+    block = pool->free[klass];
+    if (block) {
+      pool->free[klass] = *(serlib_numa_block_t**)(block + 1);
+      pool->cached[klass]--;
+    } else if (payload <= SERLIB_NUMA_SMALL_MAX) {
+      if (!pool->chunk || pool->chunk_used + total > SERLIB_NUMA_CHUNK_SIZE) {
+        pool->chunk = serlib_numa_map(SERLIB_NUMA_CHUNK_SIZE, node);
+        pool->chunk_used = 0;
+      }
+      block = (serlib_numa_block_t*)(pool->chunk + pool->chunk_used);
+      pool->chunk_used += total;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    // large classes are mapped one block at a time, outside the lock
+    if (!block) block = serlib_numa_map(serlib_numa_map_size(payload), node);
+    block->size = 0;
+  }
+
+  block->magic = SERLIB_NUMA_MAGIC;
+  block->node = node;
+  block->klass = klass;
+  return block + 1;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_numa_realloc
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > ptr  - void*
+ *         > node - int
+ *         > size - int
+ * ----------------------------------------------------------------------
+ * Resizes a block, moving it to node if it lives elsewhere.
+ * ----------------------------------------------------------------------
+ */
+void* serlib_numa_realloc(void* ptr, int node, int size) {
+  if (!ptr) return serlib_numa_alloc(node, size);
+
+  serlib_numa_block_t* block = (serlib_numa_block_t*)ptr - 1;
+  if (block->magic != SERLIB_NUMA_MAGIC) assert(0);
+
+  int klass = serlib_numa_class(size);
+  if (klass != SERLIB_NUMA_HUGE && block->klass == klass && block->node == node) return ptr;
+
+  size_t usable = block->klass == SERLIB_NUMA_HUGE
+    ? block->size - sizeof(serlib_numa_block_t)
+    : (size_t)SERLIB_NUMA_MIN_CLASS << block->klass;
+
+  void* moved = serlib_numa_alloc(node, size);
+  memcpy(moved, ptr, usable < (size_t)size ? usable : (size_t)size);
+  serlib_numa_free(ptr);
+  return moved;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_numa_free
+ * ----------------------------------------------------------------------
+ * params  : ptr - void*
+ * ----------------------------------------------------------------------
+ * Returns a block to the pool of its node.
+ * ----------------------------------------------------------------------
+ */
+void serlib_numa_free(void* ptr) {
+  if (!ptr) return;
+
+  serlib_numa_block_t* block = (serlib_numa_block_t*)ptr - 1;
+  if (block->magic != SERLIB_NUMA_MAGIC) assert(0);
+  block->magic = 0;
+
+  if (block->klass == SERLIB_NUMA_HUGE) {
+    munmap(block, block->size);
+    return;
+  }
+
+  serlib_numa_pool_t* pool = &serlib_numa_get_pools()[block->node];
+  int klass = block->klass;
+  size_t payload = (size_t)SERLIB_NUMA_MIN_CLASS << klass;
+
+  pthread_mutex_lock(&pool->lock);
+  if (payload > SERLIB_NUMA_SMALL_MAX && pool->cached[klass] >= SERLIB_NUMA_LARGE_CACHE) {
+    pthread_mutex_unlock(&pool->lock);
+    munmap(block, serlib_numa_map_size(payload));
+    return;
+  }
+
+  *(serlib_numa_block_t**)ptr = pool->free[klass];
+  pool->free[klass] = block;
+  pool->cached[klass]++;
+  pthread_mutex_unlock(&pool->lock);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_numa_node_of
+ * ----------------------------------------------------------------------
+ * params  : ptr - void*
+ * ----------------------------------------------------------------------
+ * Returns the node a block was allocated from.
+ * ----------------------------------------------------------------------
+ */
+int serlib_numa_node_of(void* ptr) {
+  serlib_numa_block_t* block = (serlib_numa_block_t*)ptr - 1;
+  if (block->magic != SERLIB_NUMA_MAGIC) assert(0);
+
+  return block->node;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_numa_trim
+ * ----------------------------------------------------------------------
+ * Unmaps every cached large block.
+ * ----------------------------------------------------------------------
+ */
+void serlib_numa_trim(void) {
+  serlib_numa_pool_t* pools = serlib_numa_get_pools();
+
+  for (int node = 0; node < serlib_numa_nodes; node++) {
+    serlib_numa_pool_t* pool = &pools[node];
+
+    pthread_mutex_lock(&pool->lock);
+    for (int klass = 0; klass < SERLIB_NUMA_CLASSES; klass++) {
+      size_t payload = (size_t)SERLIB_NUMA_MIN_CLASS << klass;
+      if (payload <= SERLIB_NUMA_SMALL_MAX) continue;
+
+      while (pool->free[klass]) {
+        serlib_numa_block_t* block = pool->free[klass];
+        pool->free[klass] = *(serlib_numa_block_t**)(block + 1);
+        munmap(block, serlib_numa_map_size(payload));
+      }
+      pool->cached[klass] = 0;
+    }
+    pthread_mutex_unlock(&pool->lock);
+  }
+};
@@ -0,0 +1,448 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "../include/serc_ring.h"
+
+#define SERLIB_RING_FRAME_PAD 0x1
+#define SERLIB_RING_ALIGN     16
+
+/*
+ * Frame header written in front of every ser_header_t in the ring. seq
+ * holds the frame's absolute ring position + 1 once the frame is
+ * committed, so a consumer can never mistake stale bytes for a frame.
+ */
+typedef struct _serlib_ring_frame_t {
+  _Atomic unsigned long long seq;
+  unsigned int size;
+  unsigned int flags;
+} serlib_ring_frame_t;
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_ring_futex
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > addr    - _Atomic unsigned int*
+ *         > op      - int
+ *         > val     - unsigned int
+ *         > timeout - struct timespec*
+ * ----------------------------------------------------------------------
+ * Shared (cross-process) futex call on a word in the ring mapping.
+ * ----------------------------------------------------------------------
+ */
+static long serlib_ring_futex(_Atomic unsigned int* addr, int op, unsigned int val, struct timespec* timeout) {
+  return syscall(SYS_futex, (unsigned int*)addr, op, val, timeout, NULL, 0);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_ring_frame_size
+ * ----------------------------------------------------------------------
+ * params  : payload_size - int
+ * ----------------------------------------------------------------------
+ * Returns the ring bytes taken by a frame holding payload_size bytes.
+ * ----------------------------------------------------------------------
+ */
+static unsigned long long serlib_ring_frame_size(int payload_size) {
+  unsigned long long size = sizeof(serlib_ring_frame_t) + sizeof(ser_header_t) + payload_size;
+  return (size + SERLIB_RING_ALIGN - 1) & ~(unsigned long long)(SERLIB_RING_ALIGN - 1);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_ring_map
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > ring     - serlib_ring_t*
+ *         > fd       - int
+ *         > map_size - size_t
+ * ----------------------------------------------------------------------
+ * Maps a ring descriptor and fills in the local ring handle.
+ * ----------------------------------------------------------------------
+ */
+static int serlib_ring_map(serlib_ring_t* ring, int fd, size_t map_size) {
+  void* map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) {
+    printf("ERROR:: serlib - Failed to map ring memory in serlib_ring_map (%s)\n", strerror(errno));
+    return -1;
+  }
+
+  ring->ctrl = (serlib_ring_ctrl_t*) map;
+  ring->data = (char*) map + SERLIB_RING_CTRL_SIZE;
+  ring->map_size = map_size;
+  ring->fd = fd;
+
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_ring_create
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > ring     - serlib_ring_t*
+ *         > shm_name - const char* (NULL for an anonymous memfd)
+ *         > capacity - unsigned long long
+ *         > mode     - int (SERLIB_RING_SPSC / SERLIB_RING_MPSC)
+ * ----------------------------------------------------------------------
+ * Creates a shared-memory frame ring.
+ * ----------------------------------------------------------------------
+ */
+int serlib_ring_create(serlib_ring_t* ring, const char* shm_name, unsigned long long capacity, int mode) {
+  assert(sizeof(serlib_ring_ctrl_t) <= SERLIB_RING_CTRL_SIZE);
+
+  // round capacity up to a power of two
+  unsigned long long size = SERLIB_RING_MIN_SIZE;
+  while (size < capacity) size <<= 1;
+
+  int fd = shm_name
+    ? shm_open(shm_name, O_CREAT | O_RDWR, 0600)
+    : memfd_create("serlib_ring", 0);
+  if (fd < 0) {
+    printf("ERROR:: serlib - Failed to create ring memory in serlib_ring_create (%s)\n", strerror(errno));
+    return -1;
+  }
+
+  size_t map_size = SERLIB_RING_CTRL_SIZE + size;
+  if (ftruncate(fd, map_size) < 0) {
+    printf("ERROR:: serlib - Failed to size ring memory in serlib_ring_create (%s)\n", strerror(errno));
+    close(fd);
+    return -1;
+  }
+
+  if (serlib_ring_map(ring, fd, map_size) < 0) {
+    close(fd);
+    return -1;
+  }
+
+  // fresh memfd / shm pages are zeroed, so all frame seqs start invalid
+  serlib_ring_ctrl_t* ctrl = ring->ctrl;
+  ctrl->mode = mode;
+  ctrl->capacity = size;
+  atomic_init(&ctrl->head, 0);
+  atomic_init(&ctrl->tail, 0);
+  atomic_init(&ctrl->consumer_idle, 0);
+  atomic_init(&ctrl->wake_seq, 0);
+  atomic_thread_fence(memory_order_release);
+  ctrl->magic = SERLIB_RING_MAGIC;
+
+  ring->capacity = size;
+  ring->mask = size - 1;
+
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_ring_attach_fd
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > ring - serlib_ring_t*
+ *         > fd   - int
+ * ----------------------------------------------------------------------
+ * Maps an existing ring from a memfd / shm descriptor.
+ * ----------------------------------------------------------------------
+ */
+int serlib_ring_attach_fd(serlib_ring_t* ring, int fd) {
+  struct stat st;
+  if (fstat(fd, &st) < 0 || st.st_size <= SERLIB_RING_CTRL_SIZE) {
+    printf("ERROR:: serlib - Invalid ring descriptor in serlib_ring_attach_fd\n");
+    return -1;
+  }
+
+  if (serlib_ring_map(ring, fd, st.st_size) < 0) return -1;
+
+  unsigned long long capacity = ring->ctrl->capacity;
+  if (ring->ctrl->magic != SERLIB_RING_MAGIC ||
+      capacity < SERLIB_RING_MIN_SIZE || (capacity & (capacity - 1)) ||
+      capacity + SERLIB_RING_CTRL_SIZE != (unsigned long long)st.st_size
+  ) {
+    printf("ERROR:: serlib - Descriptor does not hold a ring in serlib_ring_attach_fd\n");
+    munmap(ring->ctrl, ring->map_size);
+    return -1;
+  }
+
+  ring->capacity = ring->ctrl->capacity;
+  ring->mask = ring->capacity - 1;
+
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_ring_open
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > ring     - serlib_ring_t*
+ *         > shm_name - const char*
+ * ----------------------------------------------------------------------
+ * Maps an existing ring created with a shm name.
+ * ----------------------------------------------------------------------
+ */
+int serlib_ring_open(serlib_ring_t* ring, const char* shm_name) {
+  int fd = shm_open(shm_name, O_RDWR, 0600);
+  if (fd < 0) {
+    printf("ERROR:: serlib - Failed to open ring %s in serlib_ring_open (%s)\n", shm_name, strerror(errno));
+    return -1;
+  }
+
+  if (serlib_ring_attach_fd(ring, fd) < 0) {
+    close(fd);
+    return -1;
+  }
+
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_ring_close
+ * ----------------------------------------------------------------------
+ * params  : ring - serlib_ring_t*
+ * ----------------------------------------------------------------------
+ * Unmaps a ring and closes its descriptor.
+ * ----------------------------------------------------------------------
+ */
+void serlib_ring_close(serlib_ring_t* ring) {
+  if (ring->ctrl) munmap(ring->ctrl, ring->map_size);
+  if (ring->fd >= 0) close(ring->fd);
+
+  ring->ctrl = NULL;
+  ring->data = NULL;
+  ring->fd = -1;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_ring_reserve
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > ring         - serlib_ring_t*
+ *         > payload_size - int
+ *         > slot         - serlib_ring_slot_t*
+ * ----------------------------------------------------------------------
+ * Reserves a frame for payload_size bytes.
+ * ----------------------------------------------------------------------
+ */
+int serlib_ring_reserve(serlib_ring_t* ring, int payload_size, serlib_ring_slot_t* slot) {
+  serlib_ring_ctrl_t* ctrl = ring->ctrl;
+  unsigned long long frame_size = serlib_ring_frame_size(payload_size);
+  if (payload_size < 0 || frame_size > ring->capacity) return -1;
+
+  unsigned long long head = atomic_load_explicit(&ctrl->head, memory_order_relaxed);
+  unsigned long long pad;
+
+  for (;;) {
+    // a frame never wraps, pad out the end of the ring instead
+    unsigned long long offset = head & ring->mask;
+    pad = offset + frame_size > ring->capacity ? ring->capacity - offset : 0;
+
+    unsigned long long tail = atomic_load_explicit(&ctrl->tail, memory_order_acquire);
+    if (head + pad + frame_size - tail > ring->capacity) return -1;
+
+    if (ctrl->mode == SERLIB_RING_SPSC) {
+      atomic_store_explicit(&ctrl->head, head + pad + frame_size, memory_order_relaxed);
+      break;
+    }
+
+    if (atomic_compare_exchange_weak_explicit(&ctrl->head, &head, head + pad + frame_size,
+                                              memory_order_relaxed, memory_order_relaxed)) {
+      break;
+    }
+  }
+
+  if (pad) {
+    serlib_ring_frame_t* pad_frame = (serlib_ring_frame_t*)(ring->data + (head & ring->mask));
+    pad_frame->size = pad;
+    pad_frame->flags = SERLIB_RING_FRAME_PAD;
+    atomic_store_explicit(&pad_frame->seq, head + 1, memory_order_release);
+    head += pad;
+  }
+
+  serlib_ring_frame_t* frame = (serlib_ring_frame_t*)(ring->data + (head & ring->mask));
+  frame->size = frame_size;
+  frame->flags = 0;
+
+  slot->header = (ser_header_t*)(frame + 1);
+  slot->buff = (ser_buff_t){ .buffer = (char*)(slot->header + 1), .size = payload_size, .flags = SERLIB_BUFF_FIXED, .node = -1 };
+  slot->pos = head;
+  slot->frame_size = frame_size;
+
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_ring_commit
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > ring - serlib_ring_t*
+ *         > slot - serlib_ring_slot_t*
+ * ----------------------------------------------------------------------
+ * Publishes a reserved frame.
+ * ----------------------------------------------------------------------
+ */
+void serlib_ring_commit(serlib_ring_t* ring, serlib_ring_slot_t* slot) {
+  serlib_ring_ctrl_t* ctrl = ring->ctrl;
+  serlib_ring_frame_t* frame = (serlib_ring_frame_t*)(ring->data + (slot->pos & ring->mask));
+
+  // slot views are fixed buffers; a message that overflowed its slot is
+  // published as padding so the consumer skips it instead of reading a
+  // truncated payload
+  if (serlib_buffer_error(&slot->buff) < 0) {
+    frame->flags = SERLIB_RING_FRAME_PAD;
+  }
+  slot->header->payload_size = slot->buff.next;
+
+  atomic_store_explicit(&frame->seq, slot->pos + 1, memory_order_release);
+
+  // pairs with the fence in serlib_ring_wait, so either the consumer sees
+  // this frame or we see it idle
+  atomic_thread_fence(memory_order_seq_cst);
+  if (atomic_load_explicit(&ctrl->consumer_idle, memory_order_relaxed) &&
+      atomic_exchange_explicit(&ctrl->consumer_idle, 0, memory_order_relaxed)
+  ) {
+    atomic_fetch_add_explicit(&ctrl->wake_seq, 1, memory_order_release);
+    serlib_ring_futex(&ctrl->wake_seq, FUTEX_WAKE, 1, NULL);
+  }
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_ring_send
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > ring   - serlib_ring_t*
+ *         > header - ser_header_t*
+ *         > b      - ser_buff_t*
+ * ----------------------------------------------------------------------
+ * Copies an already serialized buffer into the ring as one frame.
+ * ----------------------------------------------------------------------
+ */
+int serlib_ring_send(serlib_ring_t* ring, ser_header_t* header, ser_buff_t* b) {
+  serlib_ring_slot_t slot;
+  if (serlib_ring_reserve(ring, b->next, &slot) < 0) return -1;
+
+  *slot.header = *header;
+  memcpy(slot.buff.buffer, b->buffer, b->next);
+  slot.buff.next = b->next;
+
+  serlib_ring_commit(ring, &slot);
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_ring_peek
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > ring - serlib_ring_t*
+ *         > slot - serlib_ring_slot_t*
+ * ----------------------------------------------------------------------
+ * Gets the oldest committed frame without copying.
+ * ----------------------------------------------------------------------
+ */
+int serlib_ring_peek(serlib_ring_t* ring, serlib_ring_slot_t* slot) {
+  serlib_ring_ctrl_t* ctrl = ring->ctrl;
+  unsigned long long tail = atomic_load_explicit(&ctrl->tail, memory_order_relaxed);
+
+  for (;;) {
+    serlib_ring_frame_t* frame = (serlib_ring_frame_t*)(ring->data + (tail & ring->mask));
+    if (atomic_load_explicit(&frame->seq, memory_order_acquire) != tail + 1) return -1;
+
+    // the ring is shared with another process, so its frame sizes are
+    // checked before anything is read through them; frames never wrap
+    unsigned long long room = ring->capacity - (tail & ring->mask);
+    unsigned int size = frame->size;
+    if (size < sizeof(serlib_ring_frame_t) || size % SERLIB_RING_ALIGN || size > room) return -1;
+
+    // skip padding at the end of the ring
+    if (frame->flags & SERLIB_RING_FRAME_PAD) {
+      memset(frame, 0, size);
+      tail += size;
+      atomic_store_explicit(&ctrl->tail, tail, memory_order_release);
+      continue;
+    }
+
+    slot->header = (ser_header_t*)(frame + 1);
+    unsigned int overhead = sizeof(serlib_ring_frame_t) + sizeof(ser_header_t);
+    if (size < overhead || slot->header->payload_size > size - overhead) return -1;
+
+    slot->buff = (ser_buff_t){ .buffer = (char*)(slot->header + 1), .size = slot->header->payload_size, .flags = SERLIB_BUFF_FIXED, .node = -1 };
+    slot->pos = tail;
+    slot->frame_size = frame->size;
+
+    return 0;
+  }
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_ring_release
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > ring - serlib_ring_t*
+ *         > slot - serlib_ring_slot_t*
+ * ----------------------------------------------------------------------
+ * Returns a frame obtained from serlib_ring_peek to the producers.
+ * ----------------------------------------------------------------------
+ */
+void serlib_ring_release(serlib_ring_t* ring, serlib_ring_slot_t* slot) {
+  // later frames may start anywhere in this one, so no stale bytes may
+  // be left behind that could look like a committed frame header
+  memset(ring->data + (slot->pos & ring->mask), 0, slot->frame_size);
+  atomic_store_explicit(&ring->ctrl->tail, slot->pos + slot->frame_size, memory_order_release);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_ring_wait
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > ring       - serlib_ring_t*
+ *         > timeout_ms - int (-1 waits forever)
+ * ----------------------------------------------------------------------
+ * Blocks the consumer until a frame is available.
+ * ----------------------------------------------------------------------
+ */
+int serlib_ring_wait(serlib_ring_t* ring, int timeout_ms) {
+  serlib_ring_ctrl_t* ctrl = ring->ctrl;
+  serlib_ring_slot_t slot;
+
+  struct timespec timeout;
+  timeout.tv_sec = timeout_ms / 1000;
+  timeout.tv_nsec = (long)(timeout_ms % 1000) * 1000000;
+
+  for (;;) {
+    if (serlib_ring_peek(ring, &slot) == 0) return 0;
+
+    unsigned int wake_seq = atomic_load_explicit(&ctrl->wake_seq, memory_order_acquire);
+    atomic_store_explicit(&ctrl->consumer_idle, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+
+    // a producer may have committed before it could see us idle
+    if (serlib_ring_peek(ring, &slot) == 0) {
+      atomic_store_explicit(&ctrl->consumer_idle, 0, memory_order_relaxed);
+      return 0;
+    }
+
+    long rc = serlib_ring_futex(&ctrl->wake_seq, FUTEX_WAIT, wake_seq,
+                                timeout_ms < 0 ? NULL : &timeout);
+    if (rc < 0 && errno == ETIMEDOUT) {
+      atomic_store_explicit(&ctrl->consumer_idle, 0, memory_order_relaxed);
+      return serlib_ring_peek(ring, &slot);
+    }
+  }
+};
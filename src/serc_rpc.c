@@ -0,0 +1,1278 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "../include/serc_rpc.h"
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_read_all
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > fd     - int
+ *         > dest   - char*
+ *         > nbytes - int
+ * ----------------------------------------------------------------------
+ * Reads exactly nbytes from a stream socket.
+ * ----------------------------------------------------------------------
+ */
+static int serlib_rpc_read_all(int fd, char* dest, int nbytes) {
+  while (nbytes > 0) {
+    ssize_t n = recv(fd, dest, nbytes, 0);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return -1;
+
+    dest += n;
+    nbytes -= n;
+  }
+
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_read_header
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > fd     - int
+ *         > header - ser_header_t* (out)
+ * ----------------------------------------------------------------------
+ * Reads and deserializes one frame header from a stream socket.
+ * ----------------------------------------------------------------------
+ */
+static int serlib_rpc_read_header(int fd, ser_header_t* header) {
+  char raw[sizeof(ser_header_t)];
+  ser_buff_t view = { .buffer = raw, .size = sizeof(raw), .flags = SERLIB_BUFF_FIXED, .node = -1 };
+
+  if (serlib_rpc_read_all(fd, raw, serlib_header_get_size()) < 0) return -1;
+  serlib_deserialize_header_t(&view, header);
+
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_discard
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > fd     - int
+ *         > nbytes - unsigned int
+ * ----------------------------------------------------------------------
+ * Reads and drops the payload of a frame nobody wants.
+ * ----------------------------------------------------------------------
+ */
+static int serlib_rpc_discard(int fd, unsigned int nbytes) {
+  char discard[256];
+
+  while (nbytes) {
+    int n = nbytes < sizeof(discard) ? nbytes : sizeof(discard);
+    if (serlib_rpc_read_all(fd, discard, n) < 0) return -1;
+    nbytes -= n;
+  }
+
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_payload_reserve
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > payload - ser_buff_t*
+ *         > nbytes  - unsigned int
+ * ----------------------------------------------------------------------
+ * Resets a buffer and makes room to receive nbytes into it, through the
+ * buffer's own growth path so NUMA-bound and fixed buffers are handled.
+ * Returns SERLIB_OK or SERLIB_ERR_OVERFLOW.
+ * ----------------------------------------------------------------------
+ */
+static int serlib_rpc_payload_reserve(ser_buff_t* payload, unsigned int nbytes) {
+  if (nbytes > SERLIB_RPC_MAX_PAYLOAD_LIMIT) assert(0);
+
+  serlib_reset_buffer(payload);
+  return serlib_buffer_reserve(payload, (int)nbytes);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_read_frame
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > fd          - int
+ *         > header      - ser_header_t* (out)
+ *         > payload     - ser_buff_t* (grown to fit unless fixed)
+ *         > max_payload - unsigned int
+ * ----------------------------------------------------------------------
+ * Reads one header-framed message from a stream socket.
+ * ----------------------------------------------------------------------
+ */
+int serlib_rpc_read_frame(int fd, ser_header_t* header, ser_buff_t* payload, unsigned int max_payload) {
+  if (max_payload > SERLIB_RPC_MAX_PAYLOAD_LIMIT) assert(0);
+  if (serlib_rpc_read_header(fd, header) < 0) return -1;
+  if (header->payload_size > max_payload) return -1;
+
+  // a fixed buffer is never grown: drop the frame, keeping the stream in step
+  if (serlib_rpc_payload_reserve(payload, header->payload_size) < 0) {
+    if (serlib_rpc_discard(fd, header->payload_size) < 0) return -1;
+    return SERLIB_ERR_OVERFLOW;
+  }
+
+  return serlib_rpc_read_all(fd, payload->buffer, header->payload_size);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_write_frame
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > fd      - int
+ *         > header  - ser_header_t*
+ *         > payload - ser_buff_t*
+ * ----------------------------------------------------------------------
+ * Writes one header-framed message to a stream socket.
+ * ----------------------------------------------------------------------
+ */
+int serlib_rpc_write_frame(int fd, ser_header_t* header, ser_buff_t* payload) {
+  header->payload_size = payload->next;
+
+  char raw[sizeof(ser_header_t)];
+  ser_buff_t view = { .buffer = raw, .size = sizeof(raw), .flags = SERLIB_BUFF_FIXED, .node = -1 };
+  serlib_serialize_header_t(&view, header);
+
+  // one gathered send per frame, the payload is never copied
+  struct iovec iov[2] = {
+    { raw, view.next },
+    { payload->buffer, payload->next }
+  };
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = payload->next ? 2 : 1;
+
+  while (msg.msg_iovlen) {
+    ssize_t n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return -1;
+
+    // skip what went out, resuming mid-iovec after a short send
+    while (msg.msg_iovlen && (size_t)n >= msg.msg_iov->iov_len) {
+      n -= msg.msg_iov->iov_len;
+      msg.msg_iov++;
+      msg.msg_iovlen--;
+    }
+    if (msg.msg_iovlen) {
+      msg.msg_iov->iov_base = (char*)msg.msg_iov->iov_base + n;
+      msg.msg_iov->iov_len -= n;
+    }
+  }
+
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_table_slot
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > client  - serlib_rpc_client_t*
+ *         > call_id - unsigned int
+ * ----------------------------------------------------------------------
+ * Returns the home slot of a call id in the open-addressed table.
+ * ----------------------------------------------------------------------
+ */
+static unsigned int serlib_rpc_table_slot(serlib_rpc_client_t* client, unsigned int call_id) {
+  return (call_id * 2654435761u) & client->table_mask;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_table_find
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > client  - serlib_rpc_client_t*
+ *         > call_id - unsigned int
+ * ----------------------------------------------------------------------
+ * Returns the table slot holding call_id, or -1. Caller holds the lock.
+ * ----------------------------------------------------------------------
+ */
+static int serlib_rpc_table_find(serlib_rpc_client_t* client, unsigned int call_id) {
+  unsigned int slot = serlib_rpc_table_slot(client, call_id);
+
+  while (client->table[slot] != SERLIB_RPC_TABLE_EMPTY) {
+    if (client->calls[client->table[slot]].call_id == call_id) return slot;
+    slot = (slot + 1) & client->table_mask;
+  }
+
+  return -1;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_table_insert
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > client - serlib_rpc_client_t*
+ *         > call   - int
+ * ----------------------------------------------------------------------
+ * Inserts a call by index with linear probing. Caller holds the lock.
+ * The table is twice max_inflight, so there is always an empty slot.
+ * ----------------------------------------------------------------------
+ */
+static void serlib_rpc_table_insert(serlib_rpc_client_t* client, int call) {
+  unsigned int slot = serlib_rpc_table_slot(client, client->calls[call].call_id);
+
+  while (client->table[slot] != SERLIB_RPC_TABLE_EMPTY) {
+    slot = (slot + 1) & client->table_mask;
+  }
+
+  client->table[slot] = call;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_table_remove
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > client - serlib_rpc_client_t*
+ *         > slot   - unsigned int
+ * ----------------------------------------------------------------------
+ * Removes a slot, shifting later entries of the probe run back so no
+ * tombstones are needed. Caller holds the lock.
+ * ----------------------------------------------------------------------
+ */
+static void serlib_rpc_table_remove(serlib_rpc_client_t* client, unsigned int slot) {
+  unsigned int hole = slot;
+  unsigned int next = (slot + 1) & client->table_mask;
+
+  while (client->table[next] != SERLIB_RPC_TABLE_EMPTY) {
+    unsigned int home = serlib_rpc_table_slot(client, client->calls[client->table[next]].call_id);
+
+    // move the entry back if the hole lies between its home and it
+    if (((next - home) & client->table_mask) >= ((next - hole) & client->table_mask)) {
+      client->table[hole] = client->table[next];
+      hole = next;
+    }
+    next = (next + 1) & client->table_mask;
+  }
+
+  client->table[hole] = SERLIB_RPC_TABLE_EMPTY;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_client_init
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > client        - serlib_rpc_client_t*
+ *         > fd            - int (connected stream socket)
+ *         > tid           - unsigned int
+ *         > max_inflight  - int
+ *         > response_size - int
+ * ----------------------------------------------------------------------
+ * Initializes a pipelining RPC client over one connection.
+ * ----------------------------------------------------------------------
+ */
+void serlib_rpc_client_init(serlib_rpc_client_t* client, int fd, unsigned int tid, int max_inflight, int response_size) {
+  assert(max_inflight > 0 && response_size > 0);
+
+  unsigned int table_size = 2;
+  while (table_size < 2 * (unsigned int)max_inflight) table_size <<= 1;
+
+  client->fd = fd;
+  client->tid = tid;
+  client->next_call_id = 1;
+  client->max_inflight = max_inflight;
+  client->calls = malloc(max_inflight * sizeof(serlib_rpc_call_t));
+  client->free_calls = malloc(max_inflight * sizeof(int));
+  client->table = malloc(table_size * sizeof(int));
+  if (!client->calls || !client->free_calls || !client->table) {
+    printf("ERROR:: serlib - Failed to allocate memory for rpc client in serlib_rpc_client_init\n");
+    exit(1);
+  }
+
+  // every call gets its response buffer up front
+  for (int i = 0; i < max_inflight; i++) {
+    client->calls[i].call_id = 0;
+    client->calls[i].state = SERLIB_RPC_CALL_FREE;
+    serlib_init_buffer_of_size(&client->calls[i].response, response_size);
+    client->free_calls[i] = max_inflight - 1 - i;
+  }
+  client->free_count = max_inflight;
+
+  for (unsigned int i = 0; i < table_size; i++) client->table[i] = SERLIB_RPC_TABLE_EMPTY;
+  client->table_mask = table_size - 1;
+
+  client->max_payload = SERLIB_RPC_MAX_PAYLOAD_DEFAULT;
+  client->reading = false;
+  client->broken = false;
+  pthread_mutex_init(&client->lock, NULL);
+  pthread_mutex_init(&client->send_lock, NULL);
+  pthread_cond_init(&client->cond, NULL);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_client_destroy
+ * ----------------------------------------------------------------------
+ * params  : client - serlib_rpc_client_t*
+ * ----------------------------------------------------------------------
+ * Frees a client's call table and buffers.
+ * ----------------------------------------------------------------------
+ */
+void serlib_rpc_client_destroy(serlib_rpc_client_t* client) {
+  for (int i = 0; i < client->max_inflight; i++) {
+    serlib_free_buffer(client->calls[i].response);
+  }
+
+  free(client->calls);
+  free(client->free_calls);
+  free(client->table);
+  pthread_mutex_destroy(&client->lock);
+  pthread_mutex_destroy(&client->send_lock);
+  pthread_cond_destroy(&client->cond);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_client_set_max_payload
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > client      - serlib_rpc_client_t*
+ *         > max_payload - unsigned int
+ * ----------------------------------------------------------------------
+ * Sets the largest response payload the client accepts.
+ * ----------------------------------------------------------------------
+ */
+int serlib_rpc_client_set_max_payload(serlib_rpc_client_t* client, unsigned int max_payload) {
+  if (max_payload > SERLIB_RPC_MAX_PAYLOAD_LIMIT) return -1;
+
+  client->max_payload = max_payload;
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_client_send
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > client      - serlib_rpc_client_t*
+ *         > rpc_proc_id - unsigned int
+ *         > request     - ser_buff_t*
+ *         > call_id     - unsigned int* (out)
+ * ----------------------------------------------------------------------
+ * Sends a request without waiting for its response.
+ * ----------------------------------------------------------------------
+ */
+int serlib_rpc_client_send(serlib_rpc_client_t* client,
+                           unsigned int rpc_proc_id,
+                           ser_buff_t* request,
+                           unsigned int* call_id)
+{
+  pthread_mutex_lock(&client->lock);
+  if (client->broken || !client->free_count) {
+    pthread_mutex_unlock(&client->lock);
+    return -1;
+  }
+
+  // register the call before sending so an early response finds it
+  int call = client->free_calls[--client->free_count];
+  client->calls[call].call_id = client->next_call_id++;
+  client->calls[call].state = SERLIB_RPC_CALL_PENDING;
+  serlib_rpc_table_insert(client, call);
+  *call_id = client->calls[call].call_id;
+  pthread_mutex_unlock(&client->lock);
+
+  ser_header_t header;
+  header.tid = client->tid;
+  header.rpc_proc_id = rpc_proc_id;
+  header.rpc_call_id = *call_id;
+
+  pthread_mutex_lock(&client->send_lock);
+  int rc = serlib_rpc_write_frame(client->fd, &header, request);
+  pthread_mutex_unlock(&client->send_lock);
+
+  if (rc < 0) {
+    pthread_mutex_lock(&client->lock);
+    client->broken = true;
+    pthread_cond_broadcast(&client->cond);
+    pthread_mutex_unlock(&client->lock);
+    serlib_rpc_client_release(client, *call_id);
+    return -1;
+  }
+
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_client_read_one
+ * ----------------------------------------------------------------------
+ * params  : client - serlib_rpc_client_t*
+ * ----------------------------------------------------------------------
+ * Reads one response and routes it to its call. Called by the single
+ * reading waiter without the lock held.
+ * ----------------------------------------------------------------------
+ */
+static int serlib_rpc_client_read_one(serlib_rpc_client_t* client) {
+  ser_header_t header;
+  if (serlib_rpc_read_header(client->fd, &header) < 0) return -1;
+
+  // an oversized frame can't be skipped safely; the connection is lost
+  if (header.payload_size > client->max_payload) {
+    shutdown(client->fd, SHUT_RDWR);
+    return -1;
+  }
+
+  // claim the call under the lock, so a release or a reuse of its slot
+  // can't slip in between the check and the read
+  pthread_mutex_lock(&client->lock);
+  int slot = serlib_rpc_table_find(client, header.rpc_call_id);
+  serlib_rpc_call_t* call = slot < 0 ? NULL : &client->calls[client->table[slot]];
+  if (call && call->state == SERLIB_RPC_CALL_PENDING) {
+    call->state = SERLIB_RPC_CALL_READING;
+  } else {
+    call = NULL;
+  }
+  pthread_mutex_unlock(&client->lock);
+
+  // nobody is waiting for this call id, drop the payload
+  if (!call) return serlib_rpc_discard(client->fd, header.payload_size);
+
+  // only the single reader touches the buffer of a call that isn't done
+  ser_buff_t* response = call->response;
+  if (serlib_rpc_payload_reserve(response, header.payload_size) < 0) return -1;
+
+  if (serlib_rpc_read_all(client->fd, response->buffer, header.payload_size) < 0) return -1;
+
+  // the call may have been released, and its slot handed to a new call,
+  // while we read; then the payload is nobody's and is dropped
+  pthread_mutex_lock(&client->lock);
+  if (call->call_id == header.rpc_call_id && call->state == SERLIB_RPC_CALL_READING) {
+    call->header = header;
+    call->state = SERLIB_RPC_CALL_DONE;
+  }
+  pthread_mutex_unlock(&client->lock);
+
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_client_wait
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > client   - serlib_rpc_client_t*
+ *         > call_id  - unsigned int
+ *         > header   - ser_header_t* (out, may be NULL)
+ *         > response - ser_buff_t** (out)
+ * ----------------------------------------------------------------------
+ * Waits for the response to call_id.
+ * ----------------------------------------------------------------------
+ */
+int serlib_rpc_client_wait(serlib_rpc_client_t* client,
+                           unsigned int call_id,
+                           ser_header_t* header,
+                           ser_buff_t** response)
+{
+  pthread_mutex_lock(&client->lock);
+
+  int slot = serlib_rpc_table_find(client, call_id);
+  if (slot < 0) {
+    pthread_mutex_unlock(&client->lock);
+    return -1;
+  }
+  serlib_rpc_call_t* call = &client->calls[client->table[slot]];
+
+  while (call->state != SERLIB_RPC_CALL_DONE && !client->broken) {
+    // another waiter owns the socket, it will wake us after each frame
+    if (client->reading) {
+      pthread_cond_wait(&client->cond, &client->lock);
+      continue;
+    }
+
+    client->reading = true;
+    pthread_mutex_unlock(&client->lock);
+    int rc = serlib_rpc_client_read_one(client);
+    pthread_mutex_lock(&client->lock);
+    client->reading = false;
+    if (rc < 0) client->broken = true;
+    pthread_cond_broadcast(&client->cond);
+  }
+
+  int rc = call->state == SERLIB_RPC_CALL_DONE ? 0 : -1;
+  if (rc == 0) {
+    if (header) *header = call->header;
+    *response = call->response;
+  }
+  pthread_mutex_unlock(&client->lock);
+
+  return rc;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_client_release
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > client  - serlib_rpc_client_t*
+ *         > call_id - unsigned int
+ * ----------------------------------------------------------------------
+ * Returns a finished call and its response buffer to the client.
+ * ----------------------------------------------------------------------
+ */
+void serlib_rpc_client_release(serlib_rpc_client_t* client, unsigned int call_id) {
+  pthread_mutex_lock(&client->lock);
+
+  int slot = serlib_rpc_table_find(client, call_id);
+  if (slot >= 0) {
+    int call = client->table[slot];
+    serlib_rpc_table_remove(client, slot);
+    client->calls[call].state = SERLIB_RPC_CALL_FREE;
+    client->free_calls[client->free_count++] = call;
+  }
+
+  pthread_mutex_unlock(&client->lock);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_pool_init
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > pool     - serlib_rpc_pool_t*
+ *         > capacity - int
+ * ----------------------------------------------------------------------
+ * Initializes an empty buffer pool holding at most capacity buffers.
+ * ----------------------------------------------------------------------
+ */
+static void serlib_rpc_pool_init(serlib_rpc_pool_t* pool, int capacity) {
+  pool->buffers = malloc(capacity * sizeof(ser_buff_t*));
+  if (!pool->buffers) {
+    printf("ERROR:: serlib - Failed to allocate memory for buffer pool in serlib_rpc_pool_init\n");
+    exit(1);
+  }
+
+  pool->count = 0;
+  pool->capacity = capacity;
+  pool->high_water = SERIALIZE_BUFFER_DEFAULT_SIZE;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_pool_destroy
+ * ----------------------------------------------------------------------
+ * params  : pool - serlib_rpc_pool_t*
+ * ----------------------------------------------------------------------
+ * Frees a buffer pool and every buffer in it.
+ * ----------------------------------------------------------------------
+ */
+static void serlib_rpc_pool_destroy(serlib_rpc_pool_t* pool) {
+  while (pool->count) {
+    serlib_free_buffer(pool->buffers[--pool->count]);
+  }
+
+  free(pool->buffers);
+  pool->buffers = NULL;
+  pool->capacity = 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_pool_acquire
+ * ----------------------------------------------------------------------
+ * params  : pool - serlib_rpc_pool_t*
+ * ----------------------------------------------------------------------
+ * Pops a reset buffer, allocating one of high-water size if the pool
+ * is empty.
+ * ----------------------------------------------------------------------
+ */
+static ser_buff_t* serlib_rpc_pool_acquire(serlib_rpc_pool_t* pool) {
+  ser_buff_t* b;
+
+  if (pool->count) {
+    b = pool->buffers[--pool->count];
+    serlib_reset_buffer(b);
+    return b;
+  }
+
+  serlib_init_buffer_of_size(&b, pool->high_water);
+  return b;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_pool_release
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > pool - serlib_rpc_pool_t*
+ *         > b    - ser_buff_t*
+ *         > used - int
+ * ----------------------------------------------------------------------
+ * Records the bytes a buffer ended up holding and pushes it back. A
+ * buffer smaller than the high-water mark is grown here, off the
+ * dispatch path, so the next message of that size won't realloc. The
+ * mark is capped, and buffers past the cap are freed, so one large
+ * message doesn't pin large buffers in the pool for good.
+ * ----------------------------------------------------------------------
+ */
+static void serlib_rpc_pool_release(serlib_rpc_pool_t* pool, ser_buff_t* b, int used) {
+  if (used > pool->high_water) {
+    pool->high_water = used < SERLIB_RPC_POOL_KEEP_MAX ? used : SERLIB_RPC_POOL_KEEP_MAX;
+  }
+
+  if (pool->count == pool->capacity || b->size > SERLIB_RPC_POOL_KEEP_MAX) {
+    serlib_free_buffer(b);
+    return;
+  }
+
+  serlib_rpc_payload_reserve(b, pool->high_water);
+  pool->buffers[pool->count++] = b;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_server_init
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > server    - serlib_rpc_server_t*
+ *         > max_procs - unsigned int
+ * ----------------------------------------------------------------------
+ * Initializes a dispatch registry for procedure ids below max_procs.
+ * ----------------------------------------------------------------------
+ */
+void serlib_rpc_server_init(serlib_rpc_server_t* server, unsigned int max_procs) {
+  assert(max_procs > 0);
+
+  server->procs = calloc(max_procs, sizeof(serlib_rpc_proc_t));
+  if (!server->procs) {
+    printf("ERROR:: serlib - Failed to allocate memory for procedure table in serlib_rpc_server_init\n");
+    exit(1);
+  }
+
+  server->max_procs = max_procs;
+  server->cache = NULL;
+  server->max_payload = SERLIB_RPC_MAX_PAYLOAD_DEFAULT;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_server_destroy
+ * ----------------------------------------------------------------------
+ * params  : server - serlib_rpc_server_t*
+ * ----------------------------------------------------------------------
+ * Frees a dispatch registry and all pooled buffers.
+ * ----------------------------------------------------------------------
+ */
+void serlib_rpc_server_destroy(serlib_rpc_server_t* server) {
+  for (unsigned int i = 0; i < server->max_procs; i++) {
+    if (!server->procs[i].handler) continue;
+
+    serlib_rpc_pool_destroy(&server->procs[i].requests);
+    serlib_rpc_pool_destroy(&server->procs[i].responses);
+  }
+
+  free(server->procs);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_server_register
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > server      - serlib_rpc_server_t*
+ *         > rpc_proc_id - unsigned int
+ *         > handler     - serlib_rpc_handler_t
+ *         > ctx         - void*
+ *         > pool_size   - int
+ * ----------------------------------------------------------------------
+ * Registers the handler for a procedure id.
+ * ----------------------------------------------------------------------
+ */
+int serlib_rpc_server_register(serlib_rpc_server_t* server,
+                               unsigned int rpc_proc_id,
+                               serlib_rpc_handler_t handler,
+                               void* ctx,
+                               int pool_size)
+{
+  if (rpc_proc_id >= server->max_procs || !handler || pool_size <= 0) return -1;
+
+  serlib_rpc_proc_t* proc = &server->procs[rpc_proc_id];
+  if (proc->handler) return -1;
+
+  proc->handler = handler;
+  proc->ctx = ctx;
+  serlib_rpc_pool_init(&proc->requests, pool_size);
+  serlib_rpc_pool_init(&proc->responses, pool_size);
+
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_server_dispatch
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > server   - serlib_rpc_server_t*
+ *         > header   - ser_header_t*
+ *         > request  - ser_buff_t*
+ *         > response - ser_buff_t*
+ * ----------------------------------------------------------------------
+ * Calls the handler registered for header->rpc_proc_id.
+ * ----------------------------------------------------------------------
+ */
+int serlib_rpc_server_dispatch(serlib_rpc_server_t* server,
+                               ser_header_t* header,
+                               ser_buff_t* request,
+                               ser_buff_t* response)
+{
+  if (header->rpc_proc_id >= server->max_procs) return -1;
+
+  serlib_rpc_proc_t* proc = &server->procs[header->rpc_proc_id];
+  if (!proc->handler) return -1;
+
+  return proc->handler(header, request, response, proc->ctx);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_server_serve_one
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > server - serlib_rpc_server_t*
+ *         > fd     - int
+ * ----------------------------------------------------------------------
+ * Reads one request frame, dispatches it and writes the response.
+ * ----------------------------------------------------------------------
+ */
+int serlib_rpc_server_serve_one(serlib_rpc_server_t* server, int fd) {
+  ser_header_t header;
+  if (serlib_rpc_read_header(fd, &header) < 0) return -1;
+
+  // payload_size is the peer's word: refuse the frame rather than size
+  // a buffer from it, and drop the connection since the stream is lost
+  if (header.payload_size > server->max_payload) {
+    shutdown(fd, SHUT_RDWR);
+    return -1;
+  }
+
+  // unknown procedure: drop the request, answer with an empty payload
+  if (header.rpc_proc_id >= server->max_procs || !server->procs[header.rpc_proc_id].handler) {
+    if (serlib_rpc_discard(fd, header.payload_size) < 0) return -1;
+
+    char none;
+    ser_buff_t empty = { .buffer = &none, .size = 0, .flags = SERLIB_BUFF_FIXED, .node = -1 };
+    return serlib_rpc_write_frame(fd, &header, &empty);
+  }
+
+  // write_frame overwrites payload_size with the response's
+  unsigned int request_size = header.payload_size;
+
+  serlib_rpc_proc_t* proc = &server->procs[header.rpc_proc_id];
+  ser_buff_t* request = serlib_rpc_pool_acquire(&proc->requests);
+  ser_buff_t* response = serlib_rpc_pool_acquire(&proc->responses);
+
+  int rc = -1;
+  if (serlib_rpc_payload_reserve(request, request_size) == SERLIB_OK &&
+      serlib_rpc_read_all(fd, request->buffer, request_size) == 0
+  ) {
+    serlib_rpc_cache_t* cache = proc->cacheable ? server->cache : NULL;
+    ser_frozen_t* cached = cache
+      ? serlib_rpc_cache_lookup(cache, header.rpc_proc_id, request->buffer, request_size)
+      : NULL;
+
+    if (cached) {
+      // answer from the shared copy, the handler never runs
+      ser_buff_t view = { .buffer = cached->buffer, .size = cached->size, .next = cached->size, .flags = SERLIB_BUFF_FIXED, .node = -1 };
+      rc = serlib_rpc_write_frame(fd, &header, &view);
+      serlib_frozen_release(cached);
+    } else {
+      // an invalidation while the handler runs makes its response stale
+      unsigned long long generation = cache ? serlib_rpc_cache_generation(cache, header.rpc_proc_id) : 0;
+
+      // a failed handler answers with an empty payload and isn't cached
+      if (proc->handler(&header, request, response, proc->ctx) < 0) {
+        serlib_reset_buffer(response);
+      } else if (cache) {
+        serlib_rpc_cache_insert(cache, header.rpc_proc_id, request->buffer, request_size, response, generation);
+      }
+      rc = serlib_rpc_write_frame(fd, &header, response);
+    }
+  }
+
+  serlib_rpc_pool_release(&proc->requests, request, request_size);
+  serlib_rpc_pool_release(&proc->responses, response, response->next);
+
+  return rc;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_server_set_max_payload
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > server      - serlib_rpc_server_t*
+ *         > max_payload - unsigned int
+ * ----------------------------------------------------------------------
+ * Sets the largest request payload the server accepts.
+ * ----------------------------------------------------------------------
+ */
+int serlib_rpc_server_set_max_payload(serlib_rpc_server_t* server, unsigned int max_payload) {
+  if (max_payload > SERLIB_RPC_MAX_PAYLOAD_LIMIT) return -1;
+
+  server->max_payload = max_payload;
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_server_set_cache
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > server - serlib_rpc_server_t*
+ *         > cache  - serlib_rpc_cache_t*
+ * ----------------------------------------------------------------------
+ * Attaches a response cache to a server.
+ * ----------------------------------------------------------------------
+ */
+void serlib_rpc_server_set_cache(serlib_rpc_server_t* server, serlib_rpc_cache_t* cache) {
+  server->cache = cache;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_server_set_cacheable
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > server      - serlib_rpc_server_t*
+ *         > rpc_proc_id - unsigned int
+ *         > cacheable   - bool
+ * ----------------------------------------------------------------------
+ * Opts a procedure in or out of response caching.
+ * ----------------------------------------------------------------------
+ */
+int serlib_rpc_server_set_cacheable(serlib_rpc_server_t* server, unsigned int rpc_proc_id, bool cacheable) {
+  if (rpc_proc_id >= server->max_procs || !server->procs[rpc_proc_id].handler) return -1;
+
+  server->procs[rpc_proc_id].cacheable = cacheable;
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_cache_mix
+ * ----------------------------------------------------------------------
+ * params  : h - unsigned long long
+ * ----------------------------------------------------------------------
+ * 64-bit finalizer that spreads every input bit over the output.
+ * ----------------------------------------------------------------------
+ */
+static unsigned long long serlib_rpc_cache_mix(unsigned long long h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_cache_hash
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > rpc_proc_id - unsigned int
+ *         > payload     - char*
+ *         > size        - int
+ * ----------------------------------------------------------------------
+ * Hashes a procedure id and request payload eight bytes at a time.
+ * ----------------------------------------------------------------------
+ */
+static unsigned long long serlib_rpc_cache_hash(unsigned int rpc_proc_id, char* payload, int size) {
+  unsigned long long h = serlib_rpc_cache_mix(rpc_proc_id ^ ((unsigned long long)size << 32));
+
+  for (; size >= 8; payload += 8, size -= 8) {
+    unsigned long long k;
+    memcpy(&k, payload, 8);
+    h = (h ^ serlib_rpc_cache_mix(k)) * 0x9E3779B97F4A7C15ULL;
+  }
+
+  if (size) {
+    unsigned long long k = 0;
+    memcpy(&k, payload, size);
+    h = (h ^ serlib_rpc_cache_mix(k)) * 0x9E3779B97F4A7C15ULL;
+  }
+
+  return serlib_rpc_cache_mix(h);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_cache_find
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > cache       - serlib_rpc_cache_t*
+ *         > hash        - unsigned long long
+ *         > rpc_proc_id - unsigned int
+ *         > payload     - char*
+ *         > size        - int
+ * ----------------------------------------------------------------------
+ * Returns the table slot of a cached request, or -1. Caller holds the
+ * lock.
+ * ----------------------------------------------------------------------
+ */
+static int serlib_rpc_cache_find(serlib_rpc_cache_t* cache,
+                                 unsigned long long hash,
+                                 unsigned int rpc_proc_id,
+                                 char* payload,
+                                 int size)
+{
+  unsigned int slot = hash & cache->table_mask;
+
+  while (cache->table[slot] != SERLIB_RPC_TABLE_EMPTY) {
+    serlib_rpc_cache_entry_t* entry = &cache->entries[cache->table[slot]];
+    if (entry->hash == hash &&
+        entry->rpc_proc_id == rpc_proc_id &&
+        entry->key_size == size &&
+        memcmp(entry->key, payload, size) == 0
+    ) {
+      return slot;
+    }
+    slot = (slot + 1) & cache->table_mask;
+  }
+
+  return -1;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_cache_remove
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > cache - serlib_rpc_cache_t*
+ *         > index - int (entry index)
+ * ----------------------------------------------------------------------
+ * Drops an entry, shifting later entries of its probe run back like
+ * serlib_rpc_table_remove. Caller holds the lock.
+ * ----------------------------------------------------------------------
+ */
+static void serlib_rpc_cache_remove(serlib_rpc_cache_t* cache, int index) {
+  serlib_rpc_cache_entry_t* entry = &cache->entries[index];
+
+  unsigned int hole = entry->hash & cache->table_mask;
+  while (cache->table[hole] != index) hole = (hole + 1) & cache->table_mask;
+
+  unsigned int next = (hole + 1) & cache->table_mask;
+  while (cache->table[next] != SERLIB_RPC_TABLE_EMPTY) {
+    unsigned int home = cache->entries[cache->table[next]].hash & cache->table_mask;
+
+    // move the entry back if the hole lies between its home and it
+    if (((next - home) & cache->table_mask) >= ((next - hole) & cache->table_mask)) {
+      cache->table[hole] = cache->table[next];
+      hole = next;
+    }
+    next = (next + 1) & cache->table_mask;
+  }
+  cache->table[hole] = SERLIB_RPC_TABLE_EMPTY;
+
+  // writers still holding the response keep it alive
+  serlib_frozen_release(entry->response);
+  free(entry->key);
+
+  cache->bytes -= entry->bytes;
+  entry->response = NULL;
+  entry->key = NULL;
+  entry->used = false;
+  cache->free_entries[cache->free_count++] = index;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_cache_evict_one
+ * ----------------------------------------------------------------------
+ * params  : cache - serlib_rpc_cache_t*
+ * ----------------------------------------------------------------------
+ * Advances the CLOCK hand, clearing reference bits, until it reaches an
+ * entry that has not been hit since the last sweep, and evicts it.
+ * Caller holds the lock and the cache is not empty.
+ * ----------------------------------------------------------------------
+ */
+static void serlib_rpc_cache_evict_one(serlib_rpc_cache_t* cache) {
+  for (;;) {
+    int index = cache->hand;
+    serlib_rpc_cache_entry_t* entry = &cache->entries[index];
+    cache->hand = (cache->hand + 1) % cache->capacity;
+
+    if (!entry->used) continue;
+    if (entry->referenced) {
+      entry->referenced = false;
+      continue;
+    }
+
+    serlib_rpc_cache_remove(cache, index);
+    cache->counters.evictions++;
+    return;
+  }
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_cache_init
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > cache       - serlib_rpc_cache_t*
+ *         > max_entries - int
+ *         > max_bytes   - long long
+ * ----------------------------------------------------------------------
+ * Initializes an empty response cache.
+ * ----------------------------------------------------------------------
+ */
+void serlib_rpc_cache_init(serlib_rpc_cache_t* cache, int max_entries, long long max_bytes) {
+  assert(max_entries > 0 && max_bytes > 0);
+
+  unsigned int table_size = 2;
+  while (table_size < 2 * (unsigned int)max_entries) table_size <<= 1;
+
+  cache->entries = calloc(max_entries, sizeof(serlib_rpc_cache_entry_t));
+  cache->free_entries = malloc(max_entries * sizeof(int));
+  cache->table = malloc(table_size * sizeof(int));
+  if (!cache->entries || !cache->free_entries || !cache->table) {
+    printf("ERROR:: serlib - Failed to allocate memory for response cache in serlib_rpc_cache_init\n");
+    exit(1);
+  }
+
+  for (int i = 0; i < max_entries; i++) {
+    cache->free_entries[i] = max_entries - 1 - i;
+  }
+  for (unsigned int i = 0; i < table_size; i++) {
+    cache->table[i] = SERLIB_RPC_TABLE_EMPTY;
+  }
+
+  cache->capacity = max_entries;
+  cache->free_count = max_entries;
+  cache->table_mask = table_size - 1;
+  cache->hand = 0;
+  cache->bytes = 0;
+  cache->max_bytes = max_bytes;
+  memset(&cache->counters, 0, sizeof(cache->counters));
+  memset(cache->generations, 0, sizeof(cache->generations));
+  pthread_mutex_init(&cache->lock, NULL);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_cache_destroy
+ * ----------------------------------------------------------------------
+ * params  : cache - serlib_rpc_cache_t*
+ * ----------------------------------------------------------------------
+ * Frees a cache and drops its references to cached responses.
+ * ----------------------------------------------------------------------
+ */
+void serlib_rpc_cache_destroy(serlib_rpc_cache_t* cache) {
+  for (int i = 0; i < cache->capacity; i++) {
+    if (!cache->entries[i].used) continue;
+
+    serlib_frozen_release(cache->entries[i].response);
+    free(cache->entries[i].key);
+  }
+
+  free(cache->entries);
+  free(cache->free_entries);
+  free(cache->table);
+  pthread_mutex_destroy(&cache->lock);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_cache_lookup
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > cache       - serlib_rpc_cache_t*
+ *         > rpc_proc_id - unsigned int
+ *         > payload     - char*
+ *         > size        - int
+ * ----------------------------------------------------------------------
+ * Returns a retained cached response, or NULL.
+ * ----------------------------------------------------------------------
+ */
+ser_frozen_t* serlib_rpc_cache_lookup(serlib_rpc_cache_t* cache, unsigned int rpc_proc_id, char* payload, int size) {
+  unsigned long long hash = serlib_rpc_cache_hash(rpc_proc_id, payload, size);
+
+  pthread_mutex_lock(&cache->lock);
+  int slot = serlib_rpc_cache_find(cache, hash, rpc_proc_id, payload, size);
+  if (slot < 0) {
+    cache->counters.misses++;
+    pthread_mutex_unlock(&cache->lock);
+    return NULL;
+  }
+
+  serlib_rpc_cache_entry_t* entry = &cache->entries[cache->table[slot]];
+  entry->referenced = true;
+  serlib_frozen_retain(entry->response);
+  cache->counters.hits++;
+  pthread_mutex_unlock(&cache->lock);
+
+  return entry->response;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_cache_generation
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > cache       - serlib_rpc_cache_t*
+ *         > rpc_proc_id - unsigned int
+ * ----------------------------------------------------------------------
+ * Returns a procedure's current generation.
+ * ----------------------------------------------------------------------
+ */
+unsigned long long serlib_rpc_cache_generation(serlib_rpc_cache_t* cache, unsigned int rpc_proc_id) {
+  pthread_mutex_lock(&cache->lock);
+  unsigned long long generation = cache->generations[rpc_proc_id % SERLIB_RPC_CACHE_GENERATIONS];
+  pthread_mutex_unlock(&cache->lock);
+
+  return generation;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_cache_insert
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > cache       - serlib_rpc_cache_t*
+ *         > rpc_proc_id - unsigned int
+ *         > payload     - char*
+ *         > size        - int
+ *         > response    - ser_buff_t*
+ *         > generation  - unsigned long long
+ * ----------------------------------------------------------------------
+ * Caches a copy of the response to a request unless it is stale.
+ * ----------------------------------------------------------------------
+ */
+int serlib_rpc_cache_insert(serlib_rpc_cache_t* cache,
+                            unsigned int rpc_proc_id,
+                            char* payload,
+                            int size,
+                            ser_buff_t* response,
+                            unsigned long long generation)
+{
+  long long bytes = (long long)size + response->next;
+  if (bytes > cache->max_bytes) {
+    pthread_mutex_lock(&cache->lock);
+    cache->counters.rejected++;
+    pthread_mutex_unlock(&cache->lock);
+    return -1;
+  }
+
+  // copy the key and freeze the response before taking the lock
+  unsigned long long hash = serlib_rpc_cache_hash(rpc_proc_id, payload, size);
+  char* key = malloc(size ? size : 1);
+  if (!key) {
+    printf("ERROR:: serlib - Failed to allocate memory for cache key in serlib_rpc_cache_insert\n");
+    exit(1);
+  }
+  memcpy(key, payload, size);
+
+  ser_buff_t* copy;
+  serlib_init_buffer_of_size(&copy, response->next ? response->next : 1);
+  memcpy(copy->buffer, response->buffer, response->next);
+  copy->next = response->next;
+  ser_frozen_t* frozen = serlib_buffer_freeze(copy);
+
+  pthread_mutex_lock(&cache->lock);
+  if (cache->generations[rpc_proc_id % SERLIB_RPC_CACHE_GENERATIONS] != generation) {
+    cache->counters.stale++;
+    pthread_mutex_unlock(&cache->lock);
+    free(key);
+    serlib_frozen_release(frozen);
+    return -1;
+  }
+
+  if (serlib_rpc_cache_find(cache, hash, rpc_proc_id, payload, size) >= 0) {
+    pthread_mutex_unlock(&cache->lock);
+    free(key);
+    serlib_frozen_release(frozen);
+    return -1;
+  }
+
+  while (!cache->free_count || cache->bytes + bytes > cache->max_bytes) {
+    serlib_rpc_cache_evict_one(cache);
+  }
+
+  // new entries start unreferenced, so a one-off request is the first to go
+  int index = cache->free_entries[--cache->free_count];
+  serlib_rpc_cache_entry_t* entry = &cache->entries[index];
+  entry->hash = hash;
+  entry->rpc_proc_id = rpc_proc_id;
+  entry->key = key;
+  entry->key_size = size;
+  entry->response = frozen;
+  entry->bytes = bytes;
+  entry->used = true;
+  entry->referenced = false;
+
+  unsigned int slot = hash & cache->table_mask;
+  while (cache->table[slot] != SERLIB_RPC_TABLE_EMPTY) {
+    slot = (slot + 1) & cache->table_mask;
+  }
+  cache->table[slot] = index;
+
+  cache->bytes += bytes;
+  cache->counters.insertions++;
+  pthread_mutex_unlock(&cache->lock);
+
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_cache_invalidate
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > cache       - serlib_rpc_cache_t*
+ *         > rpc_proc_id - unsigned int
+ * ----------------------------------------------------------------------
+ * Drops every cached response of a procedure.
+ * ----------------------------------------------------------------------
+ */
+int serlib_rpc_cache_invalidate(serlib_rpc_cache_t* cache, unsigned int rpc_proc_id) {
+  int dropped = 0;
+
+  pthread_mutex_lock(&cache->lock);
+  cache->generations[rpc_proc_id % SERLIB_RPC_CACHE_GENERATIONS]++;
+
+  for (int i = 0; i < cache->capacity; i++) {
+    if (!cache->entries[i].used || cache->entries[i].rpc_proc_id != rpc_proc_id) continue;
+
+    serlib_rpc_cache_remove(cache, i);
+    dropped++;
+  }
+  pthread_mutex_unlock(&cache->lock);
+
+  return dropped;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_rpc_cache_get_counters
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > cache    - serlib_rpc_cache_t*
+ *         > counters - serlib_rpc_cache_counters_t*
+ * ----------------------------------------------------------------------
+ * Copies the cache's counters and current size.
+ * ----------------------------------------------------------------------
+ */
+void serlib_rpc_cache_get_counters(serlib_rpc_cache_t* cache, serlib_rpc_cache_counters_t* counters) {
+  pthread_mutex_lock(&cache->lock);
+  *counters = cache->counters;
+  counters->entries = cache->capacity - cache->free_count;
+  counters->bytes = cache->bytes;
+  pthread_mutex_unlock(&cache->lock);
+};
@@ -0,0 +1,518 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "../include/serc_stats.h"
+
+/*
+ * One block per live thread. Only the owning thread writes a block;
+ * relaxed atomics keep concurrent snapshots well defined without
+ * costing a locked instruction. When a thread exits, a pthread key
+ * destructor folds its counts into serlib_stats_retired and puts the
+ * block on a free list for the next new thread, so the number of blocks
+ * stays at the peak number of threads. Blocks are never freed and stay
+ * on the list of all blocks, which only grows. serlib_stats_lock orders
+ * retiring against snapshots and resets, none of them on a hot path.
+ */
+typedef struct _serlib_stats_block_t {
+  _Atomic unsigned long long counters[SERLIB_STAT_COUNT];
+  _Atomic unsigned long long histograms[SERLIB_HIST_COUNT][SERLIB_HIST_BUCKETS];
+  _Atomic long long mem_pending[SERLIB_MEM_COUNT];
+  struct _serlib_stats_block_t* next;
+  struct _serlib_stats_block_t* next_free;
+} serlib_stats_block_t;
+
+static pthread_mutex_t serlib_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t serlib_stats_once = PTHREAD_ONCE_INIT;
+static pthread_key_t serlib_stats_key;
+static serlib_stats_block_t* serlib_stats_blocks = NULL;
+static serlib_stats_block_t* serlib_stats_free = NULL;
+static serlib_stats_t serlib_stats_retired;
+static _Thread_local serlib_stats_block_t* serlib_stats_local = NULL;
+static atomic_bool serlib_stats_histograms = false;
+
+/*
+ * Memory accounting collects in each thread's block and is folded into
+ * these shared totals, and their peaks raised, only once a thread's
+ * pending bytes for a kind reach SERLIB_MEM_BATCH either way. Small
+ * allocations such as list nodes stay off the shared cache lines, and
+ * peaks are exact to within SERLIB_MEM_BATCH per thread.
+ */
+#define SERLIB_MEM_BATCH (64 * 1024)
+
+static _Atomic long long serlib_mem_live[SERLIB_MEM_COUNT + 1];
+static _Atomic long long serlib_mem_peak[SERLIB_MEM_COUNT + 1];
+
+static const char* serlib_mem_names[SERLIB_MEM_COUNT + 1] = {
+  "buffers",
+  "lists",
+  "maps",
+  "total",
+};
+
+static const char* serlib_stats_names[SERLIB_STAT_COUNT] = {
+  "buffers_created",
+  "buffers_freed",
+  "reallocs",
+  "realloc_bytes",
+  "bytes_serialized",
+  "bytes_deserialized",
+  "skips_ignored",
+  "list_nodes",
+  "overflows",
+};
+
+static const char* serlib_stats_hist_names[SERLIB_HIST_COUNT] = {
+  "serialize_ns",
+  "deserialize_ns",
+  "serialize_list_ns",
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_stats_retire
+ * ----------------------------------------------------------------------
+ * params  : arg - void* (serlib_stats_block_t*)
+ * ----------------------------------------------------------------------
+ * Thread exit destructor: folds the block's counts into the retired
+ * totals and its pending bytes into the shared live counts, then frees
+ * the block for reuse.
+ * ----------------------------------------------------------------------
+ */
+static void serlib_stats_retire(void* arg) {
+  serlib_stats_block_t* block = arg;
+
+  pthread_mutex_lock(&serlib_stats_lock);
+
+  for (int i = 0; i < SERLIB_STAT_COUNT; i++) {
+    serlib_stats_retired.counters[i] += atomic_exchange_explicit(&block->counters[i], 0, memory_order_relaxed);
+  }
+  for (int h = 0; h < SERLIB_HIST_COUNT; h++) {
+    for (int i = 0; i < SERLIB_HIST_BUCKETS; i++) {
+      serlib_stats_retired.histograms[h][i] += atomic_exchange_explicit(&block->histograms[h][i], 0, memory_order_relaxed);
+    }
+  }
+
+  // bytes still allocated outlive the thread that counted them
+  for (int i = 0; i < SERLIB_MEM_COUNT; i++) {
+    long long pending = atomic_exchange_explicit(&block->mem_pending[i], 0, memory_order_relaxed);
+    atomic_fetch_add_explicit(&serlib_mem_live[i], pending, memory_order_relaxed);
+    atomic_fetch_add_explicit(&serlib_mem_live[SERLIB_MEM_COUNT], pending, memory_order_relaxed);
+  }
+
+  block->next_free = serlib_stats_free;
+  serlib_stats_free = block;
+
+  pthread_mutex_unlock(&serlib_stats_lock);
+
+  // a later destructor that still counts something gets a fresh block
+  serlib_stats_local = NULL;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_stats_key_init
+ * ----------------------------------------------------------------------
+ * Creates the key whose destructor retires a thread's block.
+ * ----------------------------------------------------------------------
+ */
+static void serlib_stats_key_init(void) {
+  if (pthread_key_create(&serlib_stats_key, serlib_stats_retire) != 0) {
+    printf("ERROR:: serlib - Failed to create thread key in serlib_stats_key_init\n");
+    exit(1);
+  }
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_stats_block
+ * ----------------------------------------------------------------------
+ * Returns the calling thread's stats block, taking a retired one or
+ * creating one on first use.
+ * ----------------------------------------------------------------------
+ */
+static serlib_stats_block_t* serlib_stats_block(void) {
+  if (serlib_stats_local) return serlib_stats_local;
+
+  pthread_once(&serlib_stats_once, serlib_stats_key_init);
+  pthread_mutex_lock(&serlib_stats_lock);
+
+  serlib_stats_block_t* block = serlib_stats_free;
+  if (block) {
+    // zeroed when it was retired
+    serlib_stats_free = block->next_free;
+  } else {
+    block = calloc(1, sizeof(serlib_stats_block_t));
+    if (!block) {
+      printf("ERROR:: serlib - Failed to allocate memory for stats in serlib_stats_block\n");
+      exit(1);
+    }
+    block->next = serlib_stats_blocks;
+    serlib_stats_blocks = block;
+  }
+
+  pthread_mutex_unlock(&serlib_stats_lock);
+
+  pthread_setspecific(serlib_stats_key, block);
+  serlib_stats_local = block;
+  return block;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_stats_bump
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > slot - _Atomic unsigned long long*
+ *         > n    - unsigned long long
+ * ----------------------------------------------------------------------
+ * Owner-only increment: a plain load and store, no locked add.
+ * ----------------------------------------------------------------------
+ */
+static void serlib_stats_bump(_Atomic unsigned long long* slot, unsigned long long n) {
+  unsigned long long value = atomic_load_explicit(slot, memory_order_relaxed);
+  atomic_store_explicit(slot, value + n, memory_order_relaxed);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_stats_now
+ * ----------------------------------------------------------------------
+ * Returns a monotonic timestamp in ns.
+ * ----------------------------------------------------------------------
+ */
+static unsigned long long serlib_stats_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_stats_add
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > stat - serlib_stat_t
+ *         > n    - unsigned long long
+ * ----------------------------------------------------------------------
+ * Adds n to a counter in the calling thread's stats block.
+ * ----------------------------------------------------------------------
+ */
+void serlib_stats_add(serlib_stat_t stat, unsigned long long n) {
+  serlib_stats_bump(&serlib_stats_block()->counters[stat], n);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_stats_time_start
+ * ----------------------------------------------------------------------
+ * Returns a start timestamp in ns, or 0 when histograms are disabled.
+ * ----------------------------------------------------------------------
+ */
+unsigned long long serlib_stats_time_start(void) {
+  if (!atomic_load_explicit(&serlib_stats_histograms, memory_order_relaxed)) return 0;
+  return serlib_stats_now();
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_stats_time_end
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > hist  - serlib_hist_t
+ *         > start - unsigned long long
+ * ----------------------------------------------------------------------
+ * Records the time since start in a log2(ns) bucket of hist.
+ * ----------------------------------------------------------------------
+ */
+void serlib_stats_time_end(serlib_hist_t hist, unsigned long long start) {
+  if (!start) return;
+
+  unsigned long long elapsed = serlib_stats_now() - start;
+  int bucket = elapsed ? 63 - __builtin_clzll(elapsed) : 0;
+  if (bucket >= SERLIB_HIST_BUCKETS) bucket = SERLIB_HIST_BUCKETS - 1;
+
+  serlib_stats_bump(&serlib_stats_block()->histograms[hist][bucket], 1);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_stats_enable_histograms
+ * ----------------------------------------------------------------------
+ * params  : enable - bool
+ * ----------------------------------------------------------------------
+ * Turns latency histograms on or off at runtime.
+ * ----------------------------------------------------------------------
+ */
+void serlib_stats_enable_histograms(bool enable) {
+  atomic_store_explicit(&serlib_stats_histograms, enable, memory_order_relaxed);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_stats_snapshot
+ * ----------------------------------------------------------------------
+ * params  : stats - serlib_stats_t*
+ * ----------------------------------------------------------------------
+ * Sums every thread's counters and histograms into stats.
+ * ----------------------------------------------------------------------
+ */
+void serlib_stats_snapshot(serlib_stats_t* stats) {
+  pthread_mutex_lock(&serlib_stats_lock);
+  *stats = serlib_stats_retired;
+
+  // blocks on the free list were zeroed when retired
+  for (serlib_stats_block_t* block = serlib_stats_blocks; block; block = block->next) {
+    for (int i = 0; i < SERLIB_STAT_COUNT; i++) {
+      stats->counters[i] += atomic_load_explicit(&block->counters[i], memory_order_relaxed);
+    }
+    for (int h = 0; h < SERLIB_HIST_COUNT; h++) {
+      for (int i = 0; i < SERLIB_HIST_BUCKETS; i++) {
+        stats->histograms[h][i] += atomic_load_explicit(&block->histograms[h][i], memory_order_relaxed);
+      }
+    }
+  }
+
+  pthread_mutex_unlock(&serlib_stats_lock);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_stats_reset
+ * ----------------------------------------------------------------------
+ * Zeroes all counters and histograms.
+ * ----------------------------------------------------------------------
+ */
+void serlib_stats_reset(void) {
+  pthread_mutex_lock(&serlib_stats_lock);
+  memset(&serlib_stats_retired, 0, sizeof(serlib_stats_retired));
+
+  for (serlib_stats_block_t* block = serlib_stats_blocks; block; block = block->next) {
+    for (int i = 0; i < SERLIB_STAT_COUNT; i++) {
+      atomic_store_explicit(&block->counters[i], 0, memory_order_relaxed);
+    }
+    for (int h = 0; h < SERLIB_HIST_COUNT; h++) {
+      for (int i = 0; i < SERLIB_HIST_BUCKETS; i++) {
+        atomic_store_explicit(&block->histograms[h][i], 0, memory_order_relaxed);
+      }
+    }
+  }
+
+  pthread_mutex_unlock(&serlib_stats_lock);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_stats_name
+ * ----------------------------------------------------------------------
+ * params  : stat - serlib_stat_t
+ * ----------------------------------------------------------------------
+ * Returns a counter's name as used in dumps.
+ * ----------------------------------------------------------------------
+ */
+const char* serlib_stats_name(serlib_stat_t stat) {
+  return stat < SERLIB_STAT_COUNT ? serlib_stats_names[stat] : "unknown";
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_mem_raise_peak
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > index - int
+ *         > live  - long long
+ * ----------------------------------------------------------------------
+ * Raises a peak to live if live is higher.
+ * ----------------------------------------------------------------------
+ */
+static void serlib_mem_raise_peak(int index, long long live) {
+  long long peak = atomic_load_explicit(&serlib_mem_peak[index], memory_order_relaxed);
+  while (live > peak &&
+         !atomic_compare_exchange_weak_explicit(&serlib_mem_peak[index], &peak, live,
+                                                memory_order_relaxed, memory_order_relaxed));
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_mem_account
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > kind  - serlib_mem_kind_t
+ *         > bytes - long long
+ * ----------------------------------------------------------------------
+ * Adjusts the calling thread's pending byte count of a kind, folding it
+ * into the shared live count and its peak once it grows past the batch.
+ * ----------------------------------------------------------------------
+ */
+void serlib_mem_account(serlib_mem_kind_t kind, long long bytes) {
+  if (!bytes) return;
+
+  _Atomic long long* slot = &serlib_stats_block()->mem_pending[kind];
+  long long pending = atomic_load_explicit(slot, memory_order_relaxed) + bytes;
+  if (pending > -SERLIB_MEM_BATCH && pending < SERLIB_MEM_BATCH) {
+    atomic_store_explicit(slot, pending, memory_order_relaxed);
+    return;
+  }
+
+  // the pending bytes move to the shared count before it is raised, so
+  // a concurrent snapshot never counts them twice, at worst not at all
+  atomic_store_explicit(slot, 0, memory_order_relaxed);
+
+  long long live = atomic_fetch_add_explicit(&serlib_mem_live[kind], pending, memory_order_relaxed) + pending;
+  long long total = atomic_fetch_add_explicit(&serlib_mem_live[SERLIB_MEM_COUNT], pending, memory_order_relaxed) + pending;
+
+  if (pending > 0) {
+    serlib_mem_raise_peak(kind, live);
+    serlib_mem_raise_peak(SERLIB_MEM_COUNT, total);
+  }
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_mem_live_now
+ * ----------------------------------------------------------------------
+ * params  : live - long long* (SERLIB_MEM_COUNT + 1 entries)
+ * ----------------------------------------------------------------------
+ * Sums the shared live counts and every thread's pending bytes.
+ * ----------------------------------------------------------------------
+ */
+static void serlib_mem_live_now(long long* live) {
+  // under the lock, so an exiting thread's pending bytes are seen
+  // either in its block or in the shared counts, not both
+  pthread_mutex_lock(&serlib_stats_lock);
+  for (int i = 0; i <= SERLIB_MEM_COUNT; i++) {
+    live[i] = atomic_load_explicit(&serlib_mem_live[i], memory_order_relaxed);
+  }
+
+  for (serlib_stats_block_t* block = serlib_stats_blocks; block; block = block->next) {
+    for (int i = 0; i < SERLIB_MEM_COUNT; i++) {
+      long long pending = atomic_load_explicit(&block->mem_pending[i], memory_order_relaxed);
+      live[i] += pending;
+      live[SERLIB_MEM_COUNT] += pending;
+    }
+  }
+  pthread_mutex_unlock(&serlib_stats_lock);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_mem_snapshot
+ * ----------------------------------------------------------------------
+ * params  : mem - serlib_mem_t*
+ * ----------------------------------------------------------------------
+ * Copies live and peak byte counts for buffers, lists, maps and in
+ * total.
+ * ----------------------------------------------------------------------
+ */
+void serlib_mem_snapshot(serlib_mem_t* mem) {
+  long long live[SERLIB_MEM_COUNT + 1];
+  long long peak[SERLIB_MEM_COUNT + 1];
+  serlib_mem_live_now(live);
+
+  // pending bytes may put live above the shared peak; keep it so that
+  // later snapshots never report a lower peak
+  for (int i = 0; i <= SERLIB_MEM_COUNT; i++) {
+    serlib_mem_raise_peak(i, live[i]);
+    peak[i] = atomic_load_explicit(&serlib_mem_peak[i], memory_order_relaxed);
+  }
+
+  for (int i = 0; i < SERLIB_MEM_COUNT; i++) {
+    mem->live[i] = live[i];
+    mem->peak[i] = peak[i];
+  }
+  mem->total_live = live[SERLIB_MEM_COUNT];
+  mem->total_peak = peak[SERLIB_MEM_COUNT];
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_mem_reset_peak
+ * ----------------------------------------------------------------------
+ * Restarts peak tracking from the current live byte counts.
+ * ----------------------------------------------------------------------
+ */
+void serlib_mem_reset_peak(void) {
+  long long live[SERLIB_MEM_COUNT + 1];
+  serlib_mem_live_now(live);
+
+  for (int i = 0; i <= SERLIB_MEM_COUNT; i++) {
+    atomic_store_explicit(&serlib_mem_peak[i], live[i], memory_order_relaxed);
+  }
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_stats_dump
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > out  - FILE*
+ *         > json - bool
+ * ----------------------------------------------------------------------
+ * Writes a snapshot as text lines or as one JSON object.
+ * ----------------------------------------------------------------------
+ */
+void serlib_stats_dump(FILE* out, bool json) {
+  serlib_stats_t stats;
+  serlib_stats_snapshot(&stats);
+
+  serlib_mem_t mem;
+  serlib_mem_snapshot(&mem);
+
+  long long live[SERLIB_MEM_COUNT + 1];
+  long long peak[SERLIB_MEM_COUNT + 1];
+  for (int i = 0; i < SERLIB_MEM_COUNT; i++) {
+    live[i] = mem.live[i];
+    peak[i] = mem.peak[i];
+  }
+  live[SERLIB_MEM_COUNT] = mem.total_live;
+  peak[SERLIB_MEM_COUNT] = mem.total_peak;
+
+  if (!json) {
+    for (int i = 0; i < SERLIB_STAT_COUNT; i++) {
+      fprintf(out, "%s %llu\n", serlib_stats_names[i], stats.counters[i]);
+    }
+    for (int h = 0; h < SERLIB_HIST_COUNT; h++) {
+      // le buckets are cumulative; the last bucket also holds everything
+      // slower, so it only shows up under +Inf
+      unsigned long long total = 0;
+      for (int i = 0; i < SERLIB_HIST_BUCKETS; i++) {
+        total += stats.histograms[h][i];
+        if (!stats.histograms[h][i] || i == SERLIB_HIST_BUCKETS - 1) continue;
+        fprintf(out, "%s_bucket{le=\"%llu\"} %llu\n", serlib_stats_hist_names[h], 2ULL << i, total);
+      }
+      fprintf(out, "%s_bucket{le=\"+Inf\"} %llu\n", serlib_stats_hist_names[h], total);
+      fprintf(out, "%s_count %llu\n", serlib_stats_hist_names[h], total);
+    }
+    for (int i = 0; i <= SERLIB_MEM_COUNT; i++) {
+      fprintf(out, "mem_%s_live %lld\n", serlib_mem_names[i], live[i]);
+      fprintf(out, "mem_%s_peak %lld\n", serlib_mem_names[i], peak[i]);
+    }
+    return;
+  }
+
+  fprintf(out, "{\"counters\":{");
+  for (int i = 0; i < SERLIB_STAT_COUNT; i++) {
+    fprintf(out, "%s\"%s\":%llu", i ? "," : "", serlib_stats_names[i], stats.counters[i]);
+  }
+  fprintf(out, "},\"histograms\":{");
+  for (int h = 0; h < SERLIB_HIST_COUNT; h++) {
+    fprintf(out, "%s\"%s\":{", h ? "," : "", serlib_stats_hist_names[h]);
+    bool first = true;
+    for (int i = 0; i < SERLIB_HIST_BUCKETS; i++) {
+      if (!stats.histograms[h][i]) continue;
+      fprintf(out, "%s\"%llu\":%llu", first ? "" : ",", 2ULL << i, stats.histograms[h][i]);
+      first = false;
+    }
+    fprintf(out, "}");
+  }
+  fprintf(out, "},\"memory\":{");
+  for (int i = 0; i <= SERLIB_MEM_COUNT; i++) {
+    fprintf(out, "%s\"%s\":{\"live\":%lld,\"peak\":%lld}", i ? "," : "", serlib_mem_names[i], live[i], peak[i]);
+  }
+  fprintf(out, "}}\n");
+};
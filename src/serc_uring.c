@@ -0,0 +1,673 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+#include "../include/serc_uring.h"
+#include "../include/serc_stats.h"
+
+#define SERLIB_URING_BUF_GROUP 0
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_uring_enter
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > u            - serlib_uring_t*
+ *         > to_submit    - unsigned int
+ *         > min_complete - unsigned int
+ * ----------------------------------------------------------------------
+ * io_uring_enter(2) without liburing.
+ * ----------------------------------------------------------------------
+ */
+static int serlib_uring_enter(serlib_uring_t* u, unsigned int to_submit, unsigned int min_complete) {
+  unsigned int flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+
+  for (;;) {
+    long rc = syscall(__NR_io_uring_enter, u->ring_fd, to_submit, min_complete, flags, NULL, 0);
+    if (rc >= 0) return (int)rc;
+    if (errno != EINTR) return -1;
+  }
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_uring_flush
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > u        - serlib_uring_t*
+ *         > wait_for - unsigned int
+ * ----------------------------------------------------------------------
+ * Hands all queued SQEs to the kernel in one call.
+ * ----------------------------------------------------------------------
+ */
+static int serlib_uring_flush(serlib_uring_t* u, unsigned int wait_for) {
+  if (!u->sq_pending && !wait_for) return 0;
+
+  int rc = serlib_uring_enter(u, u->sq_pending, wait_for);
+  if (rc < 0) return -1;
+
+  u->sq_pending -= rc < (int)u->sq_pending ? rc : u->sq_pending;
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_uring_get_sqe
+ * ----------------------------------------------------------------------
+ * params  : u - serlib_uring_t*
+ * ----------------------------------------------------------------------
+ * Returns a zeroed SQE, flushing the queue first if it is full.
+ * ----------------------------------------------------------------------
+ */
+static struct io_uring_sqe* serlib_uring_get_sqe(serlib_uring_t* u) {
+  while (u->sq_local_tail - __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE) >= u->sq_entries) {
+    if (serlib_uring_flush(u, 0) < 0) return NULL;
+  }
+
+  struct io_uring_sqe* sqe = &u->sqes[u->sq_local_tail & *u->sq_mask];
+  memset(sqe, 0, sizeof(*sqe));
+  return sqe;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_uring_push
+ * ----------------------------------------------------------------------
+ * params  : u - serlib_uring_t*
+ * ----------------------------------------------------------------------
+ * Publishes the SQE returned by the last serlib_uring_get_sqe. It is
+ * submitted on the next serlib_uring_run.
+ * ----------------------------------------------------------------------
+ */
+static void serlib_uring_push(serlib_uring_t* u) {
+  u->sq_local_tail++;
+  u->sq_pending++;
+  __atomic_store_n(u->sq_tail, u->sq_local_tail, __ATOMIC_RELEASE);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_uring_recycle_buf
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > u   - serlib_uring_t*
+ *         > bid - unsigned short
+ * ----------------------------------------------------------------------
+ * Gives a provided receive buffer back to the kernel.
+ * ----------------------------------------------------------------------
+ */
+static void serlib_uring_recycle_buf(serlib_uring_t* u, unsigned short bid) {
+  struct io_uring_buf* buf = &u->buf_ring->bufs[u->buf_tail & (u->nbufs - 1)];
+
+  buf->addr = (unsigned long)(u->bufs + (size_t)bid * u->buf_size);
+  buf->len = u->buf_size;
+  buf->bid = bid;
+
+  u->buf_tail++;
+  __atomic_store_n(&u->buf_ring->tail, u->buf_tail, __ATOMIC_RELEASE);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_uring_init
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > u        - serlib_uring_t*
+ *         > entries  - unsigned int
+ *         > nbufs    - int (power of two)
+ *         > buf_size - int
+ * ----------------------------------------------------------------------
+ * Sets up an io_uring instance and its provided receive buffer pool.
+ * ----------------------------------------------------------------------
+ */
+int serlib_uring_init(serlib_uring_t* u, unsigned int entries, int nbufs, int buf_size) {
+  assert(nbufs > 0 && (nbufs & (nbufs - 1)) == 0 && nbufs <= 32768);
+  assert(buf_size > 0);
+  memset(u, 0, sizeof(*u));
+
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+
+  u->ring_fd = syscall(__NR_io_uring_setup, entries, &params);
+  if (u->ring_fd < 0) {
+    printf("ERROR:: serlib - io_uring_setup failed in serlib_uring_init (%s)\n", strerror(errno));
+    return -1;
+  }
+
+  u->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  u->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  u->sqes_map_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+  // newer kernels map both rings with one mmap
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    if (u->cq_map_size > u->sq_map_size) u->sq_map_size = u->cq_map_size;
+    u->cq_map_size = u->sq_map_size;
+  }
+
+  u->sq_map = mmap(NULL, u->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   u->ring_fd, IORING_OFF_SQ_RING);
+  u->cq_map = (params.features & IORING_FEAT_SINGLE_MMAP)
+    ? u->sq_map
+    : mmap(NULL, u->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+           u->ring_fd, IORING_OFF_CQ_RING);
+  u->sqes = mmap(NULL, u->sqes_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                 u->ring_fd, IORING_OFF_SQES);
+  if (u->sq_map == MAP_FAILED || u->cq_map == MAP_FAILED || u->sqes == MAP_FAILED) {
+    printf("ERROR:: serlib - Failed to map io_uring queues in serlib_uring_init (%s)\n", strerror(errno));
+    close(u->ring_fd);
+    return -1;
+  }
+
+  char* sq = u->sq_map;
+  u->sq_head = (unsigned*)(sq + params.sq_off.head);
+  u->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+  u->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+  u->sq_array = (unsigned*)(sq + params.sq_off.array);
+  u->sq_entries = params.sq_entries;
+  u->sq_local_tail = *u->sq_tail;
+  for (unsigned int i = 0; i < params.sq_entries; i++) u->sq_array[i] = i;
+
+  char* cq = u->cq_map;
+  u->cq_head = (unsigned*)(cq + params.cq_off.head);
+  u->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+  u->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+  u->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+  // fixed receive pool, registered once as a provided buffer ring
+  u->nbufs = nbufs;
+  u->buf_size = buf_size;
+  u->buf_group = SERLIB_URING_BUF_GROUP;
+  u->buf_ring_size = nbufs * sizeof(struct io_uring_buf);
+  u->buf_ring = mmap(NULL, u->buf_ring_size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+  u->bufs = malloc((size_t)nbufs * buf_size);
+  if (u->buf_ring == MAP_FAILED || !u->bufs) {
+    printf("ERROR:: serlib - Failed to allocate receive buffers in serlib_uring_init\n");
+    exit(1);
+  }
+  serlib_mem_account(SERLIB_MEM_BUFFERS, (long long)nbufs * buf_size);
+
+  struct io_uring_buf_reg reg;
+  memset(&reg, 0, sizeof(reg));
+  reg.ring_addr = (unsigned long)u->buf_ring;
+  reg.ring_entries = nbufs;
+  reg.bgid = u->buf_group;
+  if (syscall(__NR_io_uring_register, u->ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+    printf("ERROR:: serlib - Failed to register receive buffers in serlib_uring_init (%s)\n", strerror(errno));
+    serlib_uring_destroy(u);
+    return -1;
+  }
+
+  u->buf_tail = 0;
+  for (int i = 0; i < nbufs; i++) serlib_uring_recycle_buf(u, i);
+
+  // send operations come from a fixed pool
+  u->nops = 2 * params.sq_entries;
+  u->ops = calloc(u->nops, sizeof(serlib_uring_op_t));
+  if (!u->ops) {
+    printf("ERROR:: serlib - Failed to allocate operation pool in serlib_uring_init\n");
+    exit(1);
+  }
+  for (int i = 0; i < u->nops; i++) {
+    u->ops[i].next_free = i + 1 < u->nops ? &u->ops[i + 1] : NULL;
+  }
+  u->free_ops = u->ops;
+
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_uring_destroy
+ * ----------------------------------------------------------------------
+ * params  : u - serlib_uring_t*
+ * ----------------------------------------------------------------------
+ * Tears down the ring and its buffer pool.
+ * ----------------------------------------------------------------------
+ */
+void serlib_uring_destroy(serlib_uring_t* u) {
+  close(u->ring_fd);
+
+  if (u->cq_map && u->cq_map != u->sq_map) munmap(u->cq_map, u->cq_map_size);
+  if (u->sq_map) munmap(u->sq_map, u->sq_map_size);
+  if (u->sqes) munmap(u->sqes, u->sqes_map_size);
+  if (u->buf_ring) munmap(u->buf_ring, u->buf_ring_size);
+
+  if (u->bufs) serlib_mem_account(SERLIB_MEM_BUFFERS, -(long long)u->nbufs * u->buf_size);
+  free(u->bufs);
+  free(u->ops);
+  memset(u, 0, sizeof(*u));
+  u->ring_fd = -1;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_uring_conn_init
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > conn     - serlib_uring_conn_t*
+ *         > fd       - int
+ *         > on_frame - serlib_uring_frame_fn
+ *         > on_close - serlib_uring_close_fn (may be NULL)
+ *         > ctx      - void*
+ * ----------------------------------------------------------------------
+ * Initializes a connection.
+ * ----------------------------------------------------------------------
+ */
+void serlib_uring_conn_init(serlib_uring_conn_t* conn,
+                            int fd,
+                            serlib_uring_frame_fn on_frame,
+                            serlib_uring_close_fn on_close,
+                            void* ctx)
+{
+  assert(on_frame != NULL);
+
+  conn->fd = fd;
+  conn->on_frame = on_frame;
+  conn->on_close = on_close;
+  conn->ctx = ctx;
+  conn->recv_armed = 0;
+  conn->cancel_queued = 0;
+  conn->inflight = 0;
+  conn->close_err = 0;
+  conn->closed = 0;
+  conn->released = 0;
+  conn->max_payload = SERLIB_URING_MAX_PAYLOAD_DEFAULT;
+  serlib_init_buffer_of_size(&conn->partial, SERIALIZE_BUFFER_DEFAULT_SIZE);
+
+  memset(&conn->recv_op, 0, sizeof(conn->recv_op));
+  conn->recv_op.type = SERLIB_URING_OP_RECV;
+  conn->recv_op.conn = conn;
+
+  memset(&conn->cancel_op, 0, sizeof(conn->cancel_op));
+  conn->cancel_op.type = SERLIB_URING_OP_CANCEL;
+  conn->cancel_op.conn = conn;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_uring_conn_set_max_payload
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > conn        - serlib_uring_conn_t*
+ *         > max_payload - unsigned int
+ * ----------------------------------------------------------------------
+ * Sets the largest frame payload the connection accepts.
+ * ----------------------------------------------------------------------
+ */
+int serlib_uring_conn_set_max_payload(serlib_uring_conn_t* conn, unsigned int max_payload) {
+  if (max_payload > SERLIB_URING_MAX_PAYLOAD_LIMIT) return -1;
+
+  conn->max_payload = max_payload;
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_uring_conn_destroy
+ * ----------------------------------------------------------------------
+ * params  : conn - serlib_uring_conn_t*
+ * ----------------------------------------------------------------------
+ * Frees a connection's reassembly buffer.
+ * ----------------------------------------------------------------------
+ */
+void serlib_uring_conn_destroy(serlib_uring_conn_t* conn) {
+  if (conn->inflight) assert(0);
+
+  if (conn->partial) serlib_free_buffer(conn->partial);
+  conn->partial = NULL;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_uring_conn_release
+ * ----------------------------------------------------------------------
+ * params  : conn - serlib_uring_conn_t*
+ * ----------------------------------------------------------------------
+ * Frees a closed connection and calls on_close once its last operation
+ * has completed.
+ * ----------------------------------------------------------------------
+ */
+static void serlib_uring_conn_release(serlib_uring_conn_t* conn) {
+  if (!conn->closed || conn->inflight || conn->released) return;
+
+  conn->released = 1;
+  serlib_uring_conn_destroy(conn);
+
+  // nothing touches conn after this; the callback may free it
+  if (conn->on_close) conn->on_close(conn, conn->close_err, conn->ctx);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_uring_conn_close
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > u    - serlib_uring_t*
+ *         > conn - serlib_uring_conn_t*
+ * ----------------------------------------------------------------------
+ * Cancels a connection's receive and releases it once idle.
+ * ----------------------------------------------------------------------
+ */
+int serlib_uring_conn_close(serlib_uring_t* u, serlib_uring_conn_t* conn) {
+  if (conn->released) return 0;
+
+  if (!conn->closed) {
+    conn->closed = 1;
+    conn->close_err = ECANCELED;
+  }
+
+  if (conn->recv_armed && !conn->cancel_queued) {
+    struct io_uring_sqe* sqe = serlib_uring_get_sqe(u);
+    if (!sqe) return -1;
+
+    // matches the receive by the user_data it was submitted with
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = (unsigned long)&conn->recv_op;
+    sqe->user_data = (unsigned long)&conn->cancel_op;
+    serlib_uring_push(u);
+
+    conn->cancel_queued = 1;
+    conn->inflight++;
+  }
+
+  serlib_uring_conn_release(conn);
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_uring_recv
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > u    - serlib_uring_t*
+ *         > conn - serlib_uring_conn_t*
+ * ----------------------------------------------------------------------
+ * Queues a multishot receive on a connection.
+ * ----------------------------------------------------------------------
+ */
+int serlib_uring_recv(serlib_uring_t* u, serlib_uring_conn_t* conn) {
+  if (conn->recv_armed) assert(0);
+  if (conn->closed) return -1;
+
+  struct io_uring_sqe* sqe = serlib_uring_get_sqe(u);
+  if (!sqe) return -1;
+
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = conn->fd;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = u->buf_group;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->user_data = (unsigned long)&conn->recv_op;
+  serlib_uring_push(u);
+
+  conn->recv_armed = 1;
+  conn->inflight++;
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_uring_queue_send
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > u  - serlib_uring_t*
+ *         > op - serlib_uring_op_t*
+ * ----------------------------------------------------------------------
+ * Queues (or re-queues after a short send) the unsent part of a buffer.
+ * ----------------------------------------------------------------------
+ */
+static int serlib_uring_queue_send(serlib_uring_t* u, serlib_uring_op_t* op) {
+  struct io_uring_sqe* sqe = serlib_uring_get_sqe(u);
+  if (!sqe) return -1;
+
+  sqe->opcode = IORING_OP_SEND;
+  sqe->fd = op->conn->fd;
+  sqe->addr = (unsigned long)(op->b->buffer + op->sent);
+  sqe->len = op->b->next - op->sent;
+  sqe->msg_flags = MSG_NOSIGNAL;
+  sqe->user_data = (unsigned long)op;
+  serlib_uring_push(u);
+
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_uring_send
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > u    - serlib_uring_t*
+ *         > conn - serlib_uring_conn_t*
+ *         > b    - ser_buff_t*
+ *         > done - serlib_uring_send_fn (may be NULL)
+ *         > ctx  - void*
+ * ----------------------------------------------------------------------
+ * Queues a send of a serialized buffer.
+ * ----------------------------------------------------------------------
+ */
+int serlib_uring_send(serlib_uring_t* u,
+                      serlib_uring_conn_t* conn,
+                      ser_buff_t* b,
+                      serlib_uring_send_fn done,
+                      void* ctx)
+{
+  serlib_uring_op_t* op = u->free_ops;
+  if (!op || conn->closed) return -1;
+  u->free_ops = op->next_free;
+
+  op->type = SERLIB_URING_OP_SEND;
+  op->conn = conn;
+  op->b = b;
+  op->sent = 0;
+  op->done = done;
+  op->ctx = ctx;
+
+  if (serlib_uring_queue_send(u, op) < 0) {
+    op->next_free = u->free_ops;
+    u->free_ops = op;
+    return -1;
+  }
+
+  conn->inflight++;
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_uring_deliver
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > conn - serlib_uring_conn_t*
+ *         > data - char*
+ *         > len  - int
+ * ----------------------------------------------------------------------
+ * Hands every complete frame in data to on_frame, in place. Returns the
+ * bytes consumed; the rest is the start of an incomplete frame. Returns
+ * -1 as soon as a header announces a payload over max_payload.
+ * ----------------------------------------------------------------------
+ */
+static int serlib_uring_deliver(serlib_uring_conn_t* conn, char* data, int len) {
+  int header_size = serlib_header_get_size();
+  int consumed = 0;
+
+  while (len - consumed >= header_size) {
+    ser_header_t header;
+    ser_buff_t view = { .buffer = data + consumed, .size = header_size, .flags = SERLIB_BUFF_FIXED, .node = -1 };
+    serlib_deserialize_header_t(&view, &header);
+
+    // before waiting for the payload, so an oversized one is never buffered
+    if (header.payload_size > conn->max_payload) return -1;
+    if (header.payload_size > (unsigned int)(len - consumed - header_size)) break;
+
+    ser_buff_t payload = { .buffer = data + consumed + header_size, .size = header.payload_size, .flags = SERLIB_BUFF_FIXED, .node = -1 };
+    conn->on_frame(conn, &header, &payload, conn->ctx);
+    consumed += header_size + header.payload_size;
+
+    // on_frame may have closed the connection
+    if (conn->closed) break;
+  }
+
+  return consumed;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_uring_on_data
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > conn - serlib_uring_conn_t*
+ *         > data - char*
+ *         > len  - int
+ * ----------------------------------------------------------------------
+ * Decodes received bytes. Frames that arrive whole are delivered
+ * straight from the receive buffer; only frames split across receives
+ * are copied into the connection's reassembly buffer. Returns 0, or
+ * the errno to close the connection with: EMSGSIZE for a frame over
+ * max_payload, ENOMEM if the reassembly buffer could not take the bytes.
+ * ----------------------------------------------------------------------
+ */
+static int serlib_uring_on_data(serlib_uring_conn_t* conn, char* data, int len) {
+  ser_buff_t* partial = conn->partial;
+
+  if (!partial->next) {
+    int consumed = serlib_uring_deliver(conn, data, len);
+    if (consumed < 0) return EMSGSIZE;
+    if (consumed < len && !conn->closed && serlib_serialize_data(partial, data + consumed, len - consumed) != SERLIB_OK) {
+      return ENOMEM;
+    }
+    return 0;
+  }
+
+  if (serlib_serialize_data(partial, data, len) != SERLIB_OK) return ENOMEM;
+
+  int consumed = serlib_uring_deliver(conn, partial->buffer, partial->next);
+  if (consumed < 0) return EMSGSIZE;
+
+  memmove(partial->buffer, partial->buffer + consumed, partial->next - consumed);
+  partial->next -= consumed;
+  return 0;
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_uring_complete
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > u   - serlib_uring_t*
+ *         > cqe - struct io_uring_cqe*
+ * ----------------------------------------------------------------------
+ * Runs the completion handling for one CQE.
+ * ----------------------------------------------------------------------
+ */
+static void serlib_uring_complete(serlib_uring_t* u, struct io_uring_cqe* cqe) {
+  serlib_uring_op_t* op = (serlib_uring_op_t*)(unsigned long)cqe->user_data;
+  serlib_uring_conn_t* conn = op->conn;
+
+  if (op->type == SERLIB_URING_OP_CANCEL) {
+    conn->inflight--;
+    serlib_uring_conn_release(conn);
+    return;
+  }
+
+  if (op->type == SERLIB_URING_OP_RECV) {
+    if (cqe->res > 0 && (cqe->flags & IORING_CQE_F_BUFFER)) {
+      unsigned short bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+      int err = conn->closed ? 0 : serlib_uring_on_data(conn, u->bufs + (size_t)bid * u->buf_size, cqe->res);
+      serlib_uring_recycle_buf(u, bid);
+
+      // a bad frame leaves the stream unframed; drop what is buffered
+      // and shut the connection down with the reason. If the cancel
+      // can't be queued yet, closed still stops further delivery and
+      // the receive ends at the latest with the peer's EOF.
+      if (err) {
+        conn->closed = 1;
+        conn->close_err = err;
+        conn->partial->next = 0;
+        serlib_uring_conn_close(u, conn);
+      }
+    }
+
+    // still armed
+    if (cqe->flags & IORING_CQE_F_MORE) return;
+
+    conn->recv_armed = 0;
+    conn->inflight--;
+
+    // the kernel stops a multishot receive when it runs out of buffers
+    // (or for its own reasons); anything but EOF, an error or a local
+    // close re-arms it
+    if (!conn->closed && (cqe->res > 0 || cqe->res == -ENOBUFS) && serlib_uring_recv(u, conn) == 0) {
+      return;
+    }
+
+    if (!conn->closed) {
+      conn->closed = 1;
+      conn->close_err = cqe->res < 0 ? -cqe->res : 0;
+    }
+    serlib_uring_conn_release(conn);
+    return;
+  }
+
+  // send
+  if (cqe->res >= 0) {
+    op->sent += cqe->res;
+    if (op->sent < op->b->next && cqe->res > 0 && serlib_uring_queue_send(u, op) == 0) return;
+  }
+
+  int err = cqe->res < 0 ? -cqe->res : (op->sent < op->b->next ? EPIPE : 0);
+  serlib_uring_send_fn done = op->done;
+  ser_buff_t* b = op->b;
+  void* ctx = op->ctx;
+
+  op->next_free = u->free_ops;
+  u->free_ops = op;
+
+  // the send still counts as in flight during done, so a close from
+  // the callback can't release conn under it
+  if (done) done(conn, b, err, ctx);
+  conn->inflight--;
+  serlib_uring_conn_release(conn);
+};
+
+/*
+ * ----------------------------------------------------------------------
+ * function: serlib_uring_run
+ * ----------------------------------------------------------------------
+ * params  :
+ *         > u        - serlib_uring_t*
+ *         > wait_for - unsigned int
+ * ----------------------------------------------------------------------
+ * Submits queued operations and handles completions.
+ * ----------------------------------------------------------------------
+ */
+int serlib_uring_run(serlib_uring_t* u, unsigned int wait_for) {
+  if (serlib_uring_flush(u, wait_for) < 0) return -1;
+
+  int handled = 0;
+  unsigned head = *u->cq_head;
+  unsigned tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+
+  while (head != tail) {
+    struct io_uring_cqe cqe = u->cqes[head & *u->cq_mask];
+
+    // release the slot before the callback, which may queue more work
+    head++;
+    __atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+
+    serlib_uring_complete(u, &cqe);
+    handled++;
+
+    if (head == tail) tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+  }
+
+  return handled;
+};
@@ -0,0 +1,28 @@
+#ifndef __SERLIB_TEST_H__
+#define __SERLIB_TEST_H__
+
+#include <stdio.h>
+
+/*
+ * Minimal checks shared by the tests under tests/. A failed check is
+ * reported with its location and the test carries on, so one run shows
+ * every failure; SERLIB_TEST_DONE turns the count into the exit status
+ * make test stops on. Checks don't use assert, so they still run when
+ * built with -DNDEBUG.
+ */
+
+static int serlib_test_failures = 0;
+
+#define SERLIB_TEST_CHECK(cond) do {                                       \
+    if (!(cond)) {                                                         \
+      printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);               \
+      serlib_test_failures++;                                              \
+    }                                                                      \
+  } while (0)
+
+#define SERLIB_TEST_DONE(name) do {                                        \
+    printf("%s: %s\n", (name), serlib_test_failures ? "FAILED" : "ok");    \
+    return serlib_test_failures ? 1 : 0;                                   \
+  } while (0)
+
+#endif
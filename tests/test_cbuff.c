@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "../include/serc.h"
+#include "test.h"
+
+/*
+ * Concurrent append buffer: records come out of serlib_cbuff_finish
+ * whole and in reservation order across segment boundaries, from one
+ * writer or many, and a finish into a fixed buffer too small for the
+ * batch flags the overflow.
+ */
+
+#define TEST_WRITERS 4
+#define TEST_RECORDS 20000
+
+typedef struct _test_writer_t {
+  pthread_t thread;
+  ser_cbuff_t* cb;
+  unsigned int id;
+} test_writer_t;
+
+static void* writer_main(void* arg) {
+  test_writer_t* w = arg;
+
+  for (unsigned int i = 0; i < TEST_RECORDS; i++) {
+    // variable-size records so reservations straddle segment ends
+    unsigned int record[4] = { w->id, i, i * 7, 0 };
+    serlib_cbuff_append(w->cb, (char*)record, (i % 3 + 2) * sizeof(unsigned int));
+  }
+
+  return NULL;
+};
+
+static void test_single_writer(void) {
+  ser_cbuff_t cb;
+  serlib_cbuff_init(&cb, 64);
+
+  ser_buff_t* expect;
+  serlib_init_buffer_of_size(&expect, 64);
+
+  // sizes up to well past the first segments, including one record
+  // larger than several segments together
+  char data[2000];
+  for (int i = 0; i < (int)sizeof(data); i++) data[i] = (char)i;
+  for (int i = 0; i < 500; i++) {
+    int size = i == 10 ? 1000 : i % 61 + 1;
+    serlib_cbuff_append(&cb, data + i % 500, size);
+    serlib_serialize_data(expect, data + i % 500, size);
+  }
+
+  ser_buff_t* out;
+  serlib_init_buffer_of_size(&out, 64);
+  serlib_cbuff_finish(&cb, out);
+  SERLIB_TEST_CHECK(out->next == expect->next);
+  SERLIB_TEST_CHECK(memcmp(out->buffer, expect->buffer, expect->next) == 0);
+
+  // finish resets the buffer for the next batch
+  serlib_reset_buffer(out);
+  serlib_cbuff_append(&cb, "abc", 3);
+  serlib_cbuff_finish(&cb, out);
+  SERLIB_TEST_CHECK(out->next == 3 && memcmp(out->buffer, "abc", 3) == 0);
+
+  // an empty batch writes nothing
+  serlib_reset_buffer(out);
+  serlib_cbuff_finish(&cb, out);
+  SERLIB_TEST_CHECK(out->next == 0);
+
+  serlib_free_buffer(expect);
+  serlib_free_buffer(out);
+  serlib_cbuff_free(&cb);
+};
+
+static void test_many_writers(void) {
+  ser_cbuff_t cb;
+  serlib_cbuff_init(&cb, 256);
+
+  test_writer_t writers[TEST_WRITERS];
+  for (int i = 0; i < TEST_WRITERS; i++) {
+    writers[i].cb = &cb;
+    writers[i].id = i;
+    pthread_create(&writers[i].thread, NULL, writer_main, &writers[i]);
+  }
+  for (int i = 0; i < TEST_WRITERS; i++) pthread_join(writers[i].thread, NULL);
+
+  ser_buff_t* out;
+  serlib_init_buffer_of_size(&out, 64);
+  serlib_cbuff_finish(&cb, out);
+
+  // every record whole, each writer's records in the order written
+  unsigned int next[TEST_WRITERS] = { 0 };
+  int pos = 0;
+  int bad = 0;
+  while (pos + 2 * (int)sizeof(unsigned int) <= out->next && !bad) {
+    unsigned int record[4];
+    memcpy(record, out->buffer + pos, 2 * sizeof(unsigned int));
+    if (record[0] >= TEST_WRITERS || record[1] != next[record[0]]) {
+      bad = 1;
+      break;
+    }
+
+    int size = (record[1] % 3 + 2) * sizeof(unsigned int);
+    memcpy(record, out->buffer + pos, size);
+    if (size > 2 * (int)sizeof(unsigned int) && record[2] != record[1] * 7) bad = 1;
+
+    next[record[0]]++;
+    pos += size;
+  }
+
+  SERLIB_TEST_CHECK(!bad);
+  SERLIB_TEST_CHECK(pos == out->next);
+  for (int i = 0; i < TEST_WRITERS; i++) SERLIB_TEST_CHECK(next[i] == TEST_RECORDS);
+
+  serlib_free_buffer(out);
+  serlib_cbuff_free(&cb);
+};
+
+static void test_fixed_overflow(void) {
+  ser_cbuff_t cb;
+  serlib_cbuff_init(&cb, 64);
+
+  char data[100];
+  memset(data, 'z', sizeof(data));
+  for (int i = 0; i < 10; i++) serlib_cbuff_append(&cb, data, sizeof(data));
+
+  char storage[256];
+  ser_buff_t out = { .buffer = storage, .size = sizeof(storage), .flags = SERLIB_BUFF_FIXED, .node = -1 };
+  serlib_cbuff_finish(&cb, &out);
+  SERLIB_TEST_CHECK(out.flags & SERLIB_BUFF_OVERFLOW);
+  SERLIB_TEST_CHECK(out.next <= (int)sizeof(storage));
+
+  // the batch is gone either way; the next one starts clean
+  ser_buff_t* heap;
+  serlib_init_buffer_of_size(&heap, 64);
+  serlib_cbuff_append(&cb, data, 10);
+  serlib_cbuff_finish(&cb, heap);
+  SERLIB_TEST_CHECK(heap->next == 10);
+
+  serlib_free_buffer(heap);
+  serlib_cbuff_free(&cb);
+};
+
+int main(void) {
+  test_single_writer();
+  test_many_writers();
+  test_fixed_overflow();
+
+  SERLIB_TEST_DONE("test_cbuff");
+};
@@ -0,0 +1,234 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/serc.h"
+#include "../include/serc_filter.h"
+#include "test.h"
+
+/*
+ * Filtering serialized lists: predicates on integer, BYTES and VAR
+ * fields pick the same records a decoded scan would, whole records come
+ * out byte for byte as serlib_serialize_list_t writes them, projections
+ * reorder fields past variable-length ones, and truncated input or a
+ * full fixed output fails without moving either buffer.
+ */
+
+#define TEST_RECORDS 200
+
+typedef struct _test_record_t {
+  int id;
+  char name[32];
+  unsigned long long score;
+  char tag[4];
+  char note[16];
+} test_record_t;
+
+static void test_make(test_record_t* record, int i) {
+  memset(record, 0, sizeof(*record));
+  record->id = i;
+  snprintf(record->name, sizeof(record->name), i % 3 ? "user-%d" : "admin-%d", i);
+  record->score = (unsigned long long)i * 1000;
+  memcpy(record->tag, i % 2 ? "odd_" : "even", 4);
+  // every tenth note is empty
+  if (i % 10) snprintf(record->note, sizeof(record->note), "n%d", i * 7);
+};
+
+// id, name (VAR, 2-byte length), score, tag, note (VAR, 1-byte length)
+static void test_serialize_record(void* data, ser_buff_t* b) {
+  test_record_t* record = data;
+  unsigned short name_size = strlen(record->name);
+  unsigned char note_size = strlen(record->note);
+
+  serlib_serialize_data(b, (char*)&record->id, sizeof(int));
+  serlib_serialize_data(b, (char*)&name_size, sizeof(name_size));
+  serlib_serialize_data(b, record->name, name_size);
+  serlib_serialize_data(b, (char*)&record->score, sizeof(record->score));
+  serlib_serialize_data(b, record->tag, 4);
+  serlib_serialize_data(b, (char*)&note_size, sizeof(note_size));
+  serlib_serialize_data(b, record->note, note_size);
+};
+
+static serlib_field_t test_fields[] = {
+  { SERLIB_FIELD_INT, 4 },
+  { SERLIB_FIELD_VAR, 2 },
+  { SERLIB_FIELD_UINT, 8 },
+  { SERLIB_FIELD_BYTES, 4 },
+  { SERLIB_FIELD_VAR, 1 },
+};
+
+static void test_fill(list_t* list) {
+  serlib_list_new(list, sizeof(test_record_t), NULL);
+  for (int i = 0; i < TEST_RECORDS; i++) {
+    test_record_t record;
+    test_make(&record, i);
+    serlib_list_append(list, &record);
+  }
+};
+
+static void test_whole_records(void) {
+  list_t list;
+  test_fill(&list);
+
+  ser_buff_t* in;
+  serlib_init_buffer_of_size(&in, 64);
+  serlib_serialize_list_t(&list, in, test_serialize_record);
+  int in_size = in->next;
+
+  // admins with an odd tag and a score from 30000 up, by hand
+  list_t expect;
+  serlib_list_new(&expect, sizeof(test_record_t), NULL);
+  for (list_node_t* node = list.head; node; node = node->next) {
+    test_record_t* record = node->data;
+    if (record->id % 3 == 0 && record->id % 2 && record->score >= 30000) serlib_list_append(&expect, record);
+  }
+  ser_buff_t* expect_b;
+  serlib_init_buffer_of_size(&expect_b, 64);
+  serlib_serialize_list_t(&expect, expect_b, test_serialize_record);
+
+  serlib_predicate_t predicates[] = {
+    { .field = 1, .op = SERLIB_PRED_PREFIX, .bytes = "admin-", .bytes_size = 6 },
+    { .field = 3, .op = SERLIB_PRED_EQ, .bytes = "odd_", .bytes_size = 4 },
+    { .field = 2, .op = SERLIB_PRED_GE, .value = 30000 },
+  };
+  serlib_list_filter_t filter = { test_fields, 5, predicates, 3, NULL, 0 };
+
+  ser_buff_t* out;
+  serlib_init_buffer_of_size(&out, 64);
+  in->next = 0;
+  SERLIB_TEST_CHECK(serlib_list_filter(in, &filter, out) == expect.logical_length);
+  SERLIB_TEST_CHECK(in->next == in_size);
+  SERLIB_TEST_CHECK(out->next == expect_b->next && memcmp(out->buffer, expect_b->buffer, out->next) == 0);
+
+  // counting only
+  in->next = 0;
+  SERLIB_TEST_CHECK(serlib_list_filter(in, &filter, NULL) == expect.logical_length);
+
+  // no predicates keeps everything, as one run
+  serlib_list_filter_t all = { test_fields, 5, NULL, 0, NULL, 0 };
+  serlib_reset_buffer(out);
+  in->next = 0;
+  SERLIB_TEST_CHECK(serlib_list_filter(in, &all, out) == TEST_RECORDS);
+  SERLIB_TEST_CHECK(out->next == in_size && memcmp(out->buffer, in->buffer, in_size) == 0);
+
+  serlib_free_buffer(in);
+  serlib_free_buffer(out);
+  serlib_free_buffer(expect_b);
+  serlib_list_destroy(&expect);
+  serlib_list_destroy(&list);
+};
+
+static void test_var_projection(void) {
+  list_t list;
+  test_fill(&list);
+
+  ser_buff_t* in;
+  serlib_init_buffer_of_size(&in, 64);
+  serlib_serialize_list_t(&list, in, test_serialize_record);
+  in->next = 0;
+
+  // notes that aren't "n14", projected to note, id, name
+  serlib_predicate_t predicates[] = {
+    { .field = 4, .op = SERLIB_PRED_NE, .bytes = "n14", .bytes_size = 3 },
+  };
+  int projection[] = { 4, 0, 1 };
+  serlib_list_filter_t filter = { test_fields, 5, predicates, 1, projection, 3 };
+
+  ser_buff_t* out;
+  serlib_init_buffer_of_size(&out, 64);
+  SERLIB_TEST_CHECK(serlib_list_filter(in, &filter, out) == TEST_RECORDS - 1);
+
+  out->next = 0;
+  int wrong = 0;
+  for (int i = 0; i < TEST_RECORDS; i++) {
+    if (i == 2) continue;
+    test_record_t record;
+    test_make(&record, i);
+
+    unsigned char note_size = 0;
+    char note[16] = { 0 };
+    int id = -1;
+    unsigned short name_size = 0;
+    char name[32] = { 0 };
+    serlib_deserialize_data(out, (char*)&note_size, sizeof(note_size));
+    if (note_size >= sizeof(note)) { wrong++; break; }
+    serlib_deserialize_data(out, note, note_size);
+    serlib_deserialize_data(out, (char*)&id, sizeof(int));
+    serlib_deserialize_data(out, (char*)&name_size, sizeof(name_size));
+    if (name_size >= sizeof(name)) { wrong++; break; }
+    serlib_deserialize_data(out, name, name_size);
+
+    wrong += id != i || strcmp(note, record.note) != 0 || strcmp(name, record.name) != 0;
+  }
+  unsigned int sentinel = 0;
+  serlib_deserialize_data(out, (char*)&sentinel, sizeof(sentinel));
+  SERLIB_TEST_CHECK(wrong == 0 && sentinel == 0xFFFFFFFF);
+
+  // an empty VAR field matches an empty constant exactly
+  serlib_predicate_t empty[] = {
+    { .field = 4, .op = SERLIB_PRED_EQ, .bytes = "", .bytes_size = 0 },
+  };
+  serlib_list_filter_t empty_notes = { test_fields, 5, empty, 1, projection + 1, 1 };
+  in->next = 0;
+  SERLIB_TEST_CHECK(serlib_list_filter(in, &empty_notes, NULL) == TEST_RECORDS / 10);
+
+  serlib_free_buffer(in);
+  serlib_free_buffer(out);
+  serlib_list_destroy(&list);
+};
+
+static void test_malformed(void) {
+  list_t list;
+  test_fill(&list);
+
+  ser_buff_t* in;
+  serlib_init_buffer_of_size(&in, 64);
+  serlib_serialize_list_t(&list, in, test_serialize_record);
+  int in_size = in->next;
+
+  int projection[] = { 4 };
+  serlib_list_filter_t filter = { test_fields, 5, NULL, 0, projection, 1 };
+
+  ser_buff_t* out;
+  serlib_init_buffer_of_size(&out, 64);
+  serlib_serialize_data(out, "keep", 4);
+
+  // cut short: no sentinel, and a record cut in the middle
+  ser_buff_t cut = { .buffer = in->buffer, .size = in_size - 4, .flags = SERLIB_BUFF_FIXED, .node = -1 };
+  SERLIB_TEST_CHECK(serlib_list_filter(&cut, &filter, out) == -1);
+  SERLIB_TEST_CHECK(cut.next == 0 && out->next == 4);
+
+  cut.size = in_size / 2;
+  SERLIB_TEST_CHECK(serlib_list_filter(&cut, &filter, out) == -1);
+  SERLIB_TEST_CHECK(cut.next == 0 && out->next == 4);
+
+  // a VAR length running past the end
+  unsigned short huge = 0xFFFF;
+  memcpy(in->buffer + sizeof(int), &huge, sizeof(huge));
+  in->next = 0;
+  SERLIB_TEST_CHECK(serlib_list_filter(in, &filter, out) == -1);
+  SERLIB_TEST_CHECK(in->next == 0 && out->next == 4);
+  serlib_reset_buffer(in);
+  serlib_serialize_list_t(&list, in, test_serialize_record);
+
+  // a fixed output too small for every match
+  char memory[256];
+  ser_buff_t small;
+  serlib_buffer_init_fixed(&small, memory, sizeof(memory), 0);
+  serlib_serialize_data(&small, "keep", 4);
+  in->next = 0;
+  SERLIB_TEST_CHECK(serlib_list_filter(in, &filter, &small) == -1);
+  SERLIB_TEST_CHECK(in->next == 0 && small.next == 4);
+
+  serlib_free_buffer(in);
+  serlib_free_buffer(out);
+  serlib_list_destroy(&list);
+};
+
+int main(void) {
+  test_whole_records();
+  test_var_projection();
+  test_malformed();
+
+  SERLIB_TEST_DONE("test_filter");
+};
@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/serc.h"
+#include "test.h"
+
+/*
+ * Fixed-capacity buffers: writes fill the caller's memory up to the
+ * last byte and no further, an overflowing write leaves the buffer as
+ * it was and sticks in serlib_buffer_error until a reset, and the
+ * cached list serializer keeps a node dirty, with its old encoding,
+ * when the node didn't fit.
+ */
+
+static void test_overflow(void) {
+  char memory[64];
+  ser_buff_t b;
+  SERLIB_TEST_CHECK(serlib_buffer_init_fixed(&b, memory, sizeof(memory), SERLIB_FIXED_PREFAULT) == SERLIB_OK);
+  SERLIB_TEST_CHECK(b.buffer == memory && b.size == (int)sizeof(memory));
+
+  char data[64];
+  for (int i = 0; i < (int)sizeof(data); i++) data[i] = (char)i;
+
+  // exactly full is fine
+  SERLIB_TEST_CHECK(serlib_serialize_data(&b, data, 60) == SERLIB_OK);
+  int four = 4;
+  SERLIB_TEST_CHECK(serlib_serialize_data_int_ptr(&b, &four, sizeof(int)) == SERLIB_OK);
+  SERLIB_TEST_CHECK(b.next == 64 && serlib_buffer_error(&b) == SERLIB_OK);
+
+  // one byte more is not, and nothing moves
+  SERLIB_TEST_CHECK(serlib_serialize_data(&b, data, 1) == SERLIB_ERR_OVERFLOW);
+  SERLIB_TEST_CHECK(b.next == 64 && b.buffer == memory && b.size == (int)sizeof(memory));
+  SERLIB_TEST_CHECK(memcmp(memory, data, 60) == 0);
+
+  // the error sticks across later writes that would fit
+  b.next = 0;
+  SERLIB_TEST_CHECK(serlib_serialize_data(&b, data, 8) == SERLIB_OK);
+  SERLIB_TEST_CHECK(serlib_buffer_error(&b) == SERLIB_ERR_OVERFLOW);
+  SERLIB_TEST_CHECK(serlib_buffer_reserve(&b, 100) == SERLIB_ERR_OVERFLOW);
+
+  serlib_reset_buffer(&b);
+  SERLIB_TEST_CHECK(b.next == 0 && serlib_buffer_error(&b) == SERLIB_OK);
+  SERLIB_TEST_CHECK(serlib_buffer_reserve(&b, 64) == SERLIB_OK);
+
+  serlib_buffer_release_fixed(&b);
+};
+
+typedef struct _test_elem_t {
+  int id;
+  int size;
+} test_elem_t;
+
+static void test_serialize_elem(void* data, ser_buff_t* b) {
+  test_elem_t* elem = data;
+  serlib_serialize_data(b, (char*)&elem->id, sizeof(int));
+  for (int i = 0; i < elem->size; i++) serlib_serialize_data(b, (char*)&elem->id, 1);
+};
+
+static void test_cached_overflow(void) {
+  list_t list;
+  serlib_list_new(&list, sizeof(test_elem_t), NULL);
+  for (int i = 0; i < 4; i++) {
+    test_elem_t elem = { .id = i, .size = 10 };
+    serlib_list_append(&list, &elem);
+  }
+
+  ser_buff_t* heap;
+  serlib_init_buffer_of_size(&heap, 64);
+  SERLIB_TEST_CHECK(serlib_serialize_list_t_cached(&list, heap, test_serialize_elem) == SERLIB_OK);
+
+  // the second node grows past what the fixed buffer holds
+  list_node_t* node = list.head->next;
+  char* old_encoding = malloc(node->encoding_size);
+  int old_size = node->encoding_size;
+  memcpy(old_encoding, node->encoding, old_size);
+
+  test_elem_t bigger = { .id = 1, .size = 100 };
+  serlib_list_update(&list, node, &bigger);
+
+  char memory[64];
+  ser_buff_t fixed;
+  serlib_buffer_init_fixed(&fixed, memory, sizeof(memory), 0);
+  SERLIB_TEST_CHECK(serlib_serialize_list_t_cached(&list, &fixed, test_serialize_elem) == SERLIB_ERR_OVERFLOW);
+  SERLIB_TEST_CHECK(serlib_buffer_error(&fixed) == SERLIB_ERR_OVERFLOW);
+  SERLIB_TEST_CHECK(node->dirty);
+  SERLIB_TEST_CHECK(node->encoding_size == old_size && memcmp(node->encoding, old_encoding, old_size) == 0);
+
+  // a buffer with room takes the same list, and matches a plain encode
+  ser_buff_t* plain;
+  serlib_init_buffer_of_size(&plain, 64);
+  serlib_serialize_list_t(&list, plain, test_serialize_elem);
+
+  serlib_reset_buffer(heap);
+  SERLIB_TEST_CHECK(serlib_serialize_list_t_cached(&list, heap, test_serialize_elem) == SERLIB_OK);
+  SERLIB_TEST_CHECK(!node->dirty && node->encoding_size == (int)sizeof(int) + 100);
+  SERLIB_TEST_CHECK(heap->next == plain->next && memcmp(heap->buffer, plain->buffer, plain->next) == 0);
+
+  // a clean node that no longer fits fails the same way
+  serlib_reset_buffer(&fixed);
+  SERLIB_TEST_CHECK(serlib_serialize_list_t_cached(&list, &fixed, test_serialize_elem) == SERLIB_ERR_OVERFLOW);
+  SERLIB_TEST_CHECK(!node->dirty);
+
+  free(old_encoding);
+  serlib_free_buffer(heap);
+  serlib_free_buffer(plain);
+  serlib_list_destroy(&list);
+};
+
+int main(void) {
+  test_overflow();
+  test_cached_overflow();
+
+  SERLIB_TEST_DONE("test_fixed");
+};
@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "../include/serc.h"
+#include "../include/serc_stats.h"
+#include "test.h"
+
+/*
+ * Frozen buffers and slices: freezing keeps the bytes where they are,
+ * every slice holds one reference until it is released, out of bounds
+ * slices take none, frames slice into header and payload, and the
+ * memory goes back only with the last reference, also when the
+ * references are taken and dropped from several threads.
+ */
+
+#define TEST_THREADS 4
+#define TEST_ROUNDS  100000
+
+static long long test_buffers_live(void) {
+  serlib_mem_t mem;
+  serlib_mem_snapshot(&mem);
+  return mem.live[SERLIB_MEM_BUFFERS];
+};
+
+static void* test_fan_out(void* arg) {
+  ser_frozen_t* frozen = arg;
+
+  for (int i = 0; i < TEST_ROUNDS; i++) {
+    ser_slice_t slice;
+    if (serlib_slice_new(&slice, frozen, i % 100, 8) == 0) serlib_slice_release(&slice);
+  }
+
+  return NULL;
+};
+
+static void test_refcounts(void) {
+  long long live_before = test_buffers_live();
+
+  ser_buff_t* b;
+  serlib_init_buffer_of_size(&b, 256 * 1024);
+  char data[1000];
+  for (int i = 0; i < (int)sizeof(data); i++) data[i] = (char)i;
+  serlib_serialize_data(b, data, sizeof(data));
+
+  char* bytes = b->buffer;
+  ser_frozen_t* frozen = serlib_buffer_freeze(b);
+  SERLIB_TEST_CHECK(frozen->buffer == bytes && frozen->size == (int)sizeof(data));
+  SERLIB_TEST_CHECK(atomic_load(&frozen->refs) == 1);
+
+  ser_slice_t a;
+  ser_slice_t c;
+  ser_slice_t sub;
+  SERLIB_TEST_CHECK(serlib_slice_new(&a, frozen, 100, 200) == 0);
+  SERLIB_TEST_CHECK(serlib_slice_new(&c, frozen, 0, sizeof(data)) == 0);
+  SERLIB_TEST_CHECK(serlib_slice_sub(&sub, &a, 50, 10) == 0);
+  SERLIB_TEST_CHECK(atomic_load(&frozen->refs) == 4);
+  SERLIB_TEST_CHECK(sub.data == bytes + 150 && memcmp(sub.data, data + 150, 10) == 0);
+
+  // out of bounds slices fail without a reference
+  ser_slice_t bad;
+  SERLIB_TEST_CHECK(serlib_slice_new(&bad, frozen, 900, 101) == -1);
+  SERLIB_TEST_CHECK(serlib_slice_new(&bad, frozen, -1, 10) == -1);
+  SERLIB_TEST_CHECK(serlib_slice_sub(&bad, &a, 190, 11) == -1);
+  SERLIB_TEST_CHECK(atomic_load(&frozen->refs) == 4);
+
+  // the owner's reference goes first; the slices keep the bytes alive
+  serlib_frozen_release(frozen);
+  serlib_slice_release(&a);
+  SERLIB_TEST_CHECK(a.frozen == NULL && a.size == 0);
+  serlib_slice_release(&a);
+  SERLIB_TEST_CHECK(atomic_load(&frozen->refs) == 2);
+
+  ser_buff_t view;
+  char out[10];
+  serlib_slice_as_buffer(&sub, &view);
+  serlib_deserialize_data(&view, out, sizeof(out));
+  SERLIB_TEST_CHECK(memcmp(out, data + 150, sizeof(out)) == 0);
+  SERLIB_TEST_CHECK(test_buffers_live() > live_before);
+
+  serlib_slice_release(&sub);
+  serlib_slice_release(&c);
+  SERLIB_TEST_CHECK(test_buffers_live() == live_before);
+};
+
+static void test_concurrent(void) {
+  long long live_before = test_buffers_live();
+
+  ser_buff_t* b;
+  serlib_init_buffer_of_size(&b, 256);
+  serlib_serialize_data(b, (char*)&live_before, sizeof(live_before));
+  serlib_buffer_skip(b, 100);
+  ser_frozen_t* frozen = serlib_buffer_freeze(b);
+
+  pthread_t threads[TEST_THREADS];
+  for (int i = 0; i < TEST_THREADS; i++) pthread_create(&threads[i], NULL, test_fan_out, frozen);
+  for (int i = 0; i < TEST_THREADS; i++) pthread_join(threads[i], NULL);
+
+  SERLIB_TEST_CHECK(atomic_load(&frozen->refs) == 1);
+  serlib_frozen_release(frozen);
+  SERLIB_TEST_CHECK(test_buffers_live() == live_before);
+};
+
+static void test_frames(void) {
+  ser_buff_t* b;
+  serlib_init_buffer_of_size(&b, 64);
+
+  ser_header_t first = { .tid = 1, .rpc_proc_id = 2, .rpc_call_id = 3, .payload_size = 5 };
+  ser_header_t second = { .tid = 4, .rpc_proc_id = 5, .rpc_call_id = 6, .payload_size = 0 };
+  serlib_serialize_header_t(b, &first);
+  serlib_serialize_data(b, "hello", 5);
+  serlib_serialize_header_t(b, &second);
+  int frames_size = b->next;
+
+  // a third frame that claims more payload than is there
+  ser_header_t cut = { .tid = 7, .rpc_proc_id = 8, .rpc_call_id = 9, .payload_size = 100 };
+  serlib_serialize_header_t(b, &cut);
+  serlib_serialize_data(b, "x", 1);
+  ser_frozen_t* frozen = serlib_buffer_freeze(b);
+
+  ser_slice_t header;
+  ser_slice_t payload;
+  SERLIB_TEST_CHECK(serlib_slice_frame(frozen, 0, &header, &payload) == 0);
+  SERLIB_TEST_CHECK(payload.size == 5 && memcmp(payload.data, "hello", 5) == 0);
+
+  ser_buff_t view;
+  ser_header_t decoded;
+  serlib_slice_as_buffer(&header, &view);
+  serlib_deserialize_header_t(&view, &decoded);
+  SERLIB_TEST_CHECK(decoded.rpc_call_id == 3 && decoded.payload_size == 5);
+  serlib_slice_release(&header);
+  serlib_slice_release(&payload);
+
+  int offset = serlib_header_get_size() + 5;
+  SERLIB_TEST_CHECK(serlib_slice_frame(frozen, offset, &header, &payload) == 0);
+  SERLIB_TEST_CHECK(payload.size == 0);
+  serlib_slice_release(&header);
+  serlib_slice_release(&payload);
+
+  SERLIB_TEST_CHECK(serlib_slice_frame(frozen, frames_size, &header, &payload) == -1);
+  SERLIB_TEST_CHECK(serlib_slice_frame(frozen, frozen->size - 2, &header, &payload) == -1);
+  SERLIB_TEST_CHECK(atomic_load(&frozen->refs) == 1);
+
+  serlib_frozen_release(frozen);
+};
+
+int main(void) {
+  test_refcounts();
+  test_concurrent();
+  test_frames();
+
+  SERLIB_TEST_DONE("test_frozen");
+};
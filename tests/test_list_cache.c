@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/serc.h"
+#include "test.h"
+
+/*
+ * Cached list serialization: the output always matches
+ * serlib_serialize_list_t, and only nodes appended, prepended, updated
+ * or marked dirty since the last cached serialize go through the
+ * element serializer again.
+ */
+
+typedef struct _test_elem_t {
+  int id;
+  int extra;
+} test_elem_t;
+
+static int test_encodes;
+
+// variable length, so a re-encoded node can change size
+static void test_serialize_elem(void* data, ser_buff_t* b) {
+  test_elem_t* elem = data;
+  test_encodes++;
+
+  serlib_serialize_data(b, (char*)&elem->id, sizeof(int));
+  serlib_serialize_data(b, (char*)&elem->extra, sizeof(int));
+  for (int i = 0; i < elem->extra; i++) serlib_serialize_data(b, (char*)&elem->id, sizeof(int));
+};
+
+/*
+ * Returns 1 if the cached encoding of list matches the plain one, and
+ * counts in *encodes how many elements the cached pass serialized.
+ */
+static int test_matches_plain(list_t* list, int* encodes) {
+  ser_buff_t* plain;
+  ser_buff_t* cached;
+  serlib_init_buffer_of_size(&plain, 64);
+  serlib_init_buffer_of_size(&cached, 64);
+
+  serlib_serialize_list_t(list, plain, test_serialize_elem);
+
+  test_encodes = 0;
+  int rc = serlib_serialize_list_t_cached(list, cached, test_serialize_elem);
+  *encodes = test_encodes;
+
+  int same = rc == SERLIB_OK && plain->next == cached->next && memcmp(plain->buffer, cached->buffer, plain->next) == 0;
+
+  serlib_free_buffer(plain);
+  serlib_free_buffer(cached);
+  return same;
+};
+
+static void test_dirty_clean(void) {
+  list_t list;
+  serlib_list_new(&list, sizeof(test_elem_t), NULL);
+  for (int i = 0; i < 100; i++) {
+    test_elem_t elem = { .id = i, .extra = i % 4 };
+    serlib_list_append(&list, &elem);
+  }
+
+  int encodes = 0;
+
+  // first pass encodes everything, the next one nothing
+  SERLIB_TEST_CHECK(test_matches_plain(&list, &encodes) && encodes == 100);
+  SERLIB_TEST_CHECK(test_matches_plain(&list, &encodes) && encodes == 0);
+
+  // an update re-encodes that node only, even when its size changes
+  test_elem_t bigger = { .id = 1000, .extra = 9 };
+  serlib_list_update(&list, list.head->next, &bigger);
+  SERLIB_TEST_CHECK(list.head->next->dirty);
+  SERLIB_TEST_CHECK(test_matches_plain(&list, &encodes) && encodes == 1);
+  SERLIB_TEST_CHECK(!list.head->next->dirty);
+
+  // a change made in place is only picked up once marked dirty
+  ((test_elem_t*)list.tail->data)->extra = 0;
+  serlib_list_mark_dirty(list.tail);
+  SERLIB_TEST_CHECK(test_matches_plain(&list, &encodes) && encodes == 1);
+
+  // new nodes at either end start dirty
+  test_elem_t head = { .id = -1, .extra = 2 };
+  test_elem_t tail = { .id = -2, .extra = 0 };
+  serlib_list_prepend(&list, &head);
+  serlib_list_append(&list, &tail);
+  SERLIB_TEST_CHECK(test_matches_plain(&list, &encodes) && encodes == 2);
+  SERLIB_TEST_CHECK(test_matches_plain(&list, &encodes) && encodes == 0);
+
+  // and the cached bytes read back as the list
+  ser_buff_t* b;
+  serlib_init_buffer_of_size(&b, 64);
+  serlib_serialize_list_t_cached(&list, b, test_serialize_elem);
+  int written = b->next;
+  b->next = 0;
+
+  int id = 0;
+  int extra = 0;
+  int seen = 0;
+  int wrong = 0;
+  for (list_node_t* node = list.head; node; node = node->next, seen++) {
+    test_elem_t* elem = node->data;
+    serlib_deserialize_data(b, (char*)&id, sizeof(int));
+    serlib_deserialize_data(b, (char*)&extra, sizeof(int));
+    serlib_buffer_skip(b, extra * sizeof(int));
+    wrong += id != elem->id || extra != elem->extra;
+  }
+  SERLIB_TEST_CHECK(seen == 102 && wrong == 0);
+
+  unsigned int sentinel = 0;
+  serlib_deserialize_data(b, (char*)&sentinel, sizeof(unsigned int));
+  SERLIB_TEST_CHECK(sentinel == 0xFFFFFFFF && b->next == written);
+
+  serlib_free_buffer(b);
+  serlib_list_destroy(&list);
+};
+
+static void test_null_list(void) {
+  ser_buff_t* plain;
+  ser_buff_t* cached;
+  serlib_init_buffer_of_size(&plain, 64);
+  serlib_init_buffer_of_size(&cached, 64);
+
+  serlib_serialize_list_t(NULL, plain, test_serialize_elem);
+  SERLIB_TEST_CHECK(serlib_serialize_list_t_cached(NULL, cached, test_serialize_elem) == SERLIB_OK);
+  SERLIB_TEST_CHECK(plain->next == cached->next && memcmp(plain->buffer, cached->buffer, plain->next) == 0);
+
+  serlib_free_buffer(plain);
+  serlib_free_buffer(cached);
+};
+
+int main(void) {
+  test_dirty_clean();
+  test_null_list();
+
+  SERLIB_TEST_DONE("test_list_cache");
+};
@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/serc.h"
+#include "test.h"
+
+/*
+ * Chunked list serializer: for any chunk size the chunks put together
+ * are byte for byte what serlib_serialize_list_t writes, every chunk
+ * but the last is full, elements larger than a chunk resume mid-way,
+ * two chunkers over one list don't disturb each other, and the scratch
+ * buffer never grows past one element.
+ */
+
+#define TEST_ELEMENTS 500
+#define TEST_BIG      5000
+
+typedef struct _test_elem_t {
+  int id;
+  int size;
+} test_elem_t;
+
+// element i writes its header then size bytes derived from its id
+static void test_serialize_elem(void* data, ser_buff_t* b) {
+  test_elem_t* elem = data;
+  serlib_serialize_data(b, (char*)elem, sizeof(test_elem_t));
+  for (int i = 0; i < elem->size; i++) {
+    char c = (char)(elem->id + i);
+    serlib_serialize_data(b, &c, 1);
+  }
+};
+
+static void test_fill(list_t* list) {
+  serlib_list_new(list, sizeof(test_elem_t), NULL);
+  for (int i = 0; i < TEST_ELEMENTS; i++) {
+    test_elem_t elem = { .id = i, .size = i == 250 ? TEST_BIG : i % 13 };
+    serlib_list_append(list, &elem);
+  }
+};
+
+/*
+ * Runs a chunker over list with chunk_size and returns 1 if the result
+ * matches expect and every chunk but the last was full.
+ */
+static int test_chunked_matches(list_t* list, ser_buff_t* expect, int chunk_size) {
+  serlib_list_chunker_t chunker;
+  serlib_list_chunker_init(&chunker, list, test_serialize_elem);
+
+  char* chunk = malloc(chunk_size);
+  char* out = malloc(expect->next + chunk_size);
+  int total = 0;
+  int short_chunks = 0;
+  int n;
+  while ((n = serlib_serialize_list_chunk(&chunker, chunk, chunk_size)) > 0) {
+    if (total + n > expect->next) break;
+    short_chunks += n < chunk_size;
+    memcpy(out + total, chunk, n);
+    total += n;
+  }
+
+  int ok = n == 0 && total == expect->next && memcmp(out, expect->buffer, total) == 0;
+  ok = ok && short_chunks <= 1 && serlib_list_chunker_done(&chunker);
+
+  // finished stays finished
+  ok = ok && serlib_serialize_list_chunk(&chunker, chunk, chunk_size) == 0;
+
+  free(chunk);
+  free(out);
+  serlib_list_chunker_free(&chunker);
+  return ok;
+};
+
+static void test_chunk_sizes(void) {
+  list_t list;
+  test_fill(&list);
+
+  ser_buff_t* expect;
+  serlib_init_buffer_of_size(&expect, 64);
+  serlib_serialize_list_t(&list, expect, test_serialize_elem);
+
+  int sizes[] = { 1, 3, 7, 64, 1000, TEST_BIG + 100, 1 << 20 };
+  for (int i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++) {
+    SERLIB_TEST_CHECK(test_chunked_matches(&list, expect, sizes[i]));
+  }
+
+  serlib_free_buffer(expect);
+  serlib_list_destroy(&list);
+};
+
+static void test_interleaved(void) {
+  list_t list;
+  test_fill(&list);
+
+  serlib_list_chunker_t a;
+  serlib_list_chunker_t b;
+  serlib_list_chunker_init(&a, &list, test_serialize_elem);
+  serlib_list_chunker_init(&b, &list, test_serialize_elem);
+
+  ser_buff_t* out_a;
+  ser_buff_t* out_b;
+  serlib_init_buffer_of_size(&out_a, 64);
+  serlib_init_buffer_of_size(&out_b, 64);
+
+  // different chunk sizes, taken in turns
+  char chunk[97];
+  int max_scratch = 0;
+  while (!serlib_list_chunker_done(&a) || !serlib_list_chunker_done(&b)) {
+    int n = serlib_serialize_list_chunk(&a, chunk, 13);
+    serlib_serialize_data(out_a, chunk, n);
+    n = serlib_serialize_list_chunk(&b, chunk, sizeof(chunk));
+    serlib_serialize_data(out_b, chunk, n);
+
+    if (a.scratch->size > max_scratch) max_scratch = a.scratch->size;
+  }
+
+  SERLIB_TEST_CHECK(out_a->next == out_b->next);
+  SERLIB_TEST_CHECK(memcmp(out_a->buffer, out_b->buffer, out_a->next) == 0);
+
+  // the scratch only ever held one element at a time
+  int largest = sizeof(test_elem_t) + TEST_BIG;
+  SERLIB_TEST_CHECK(max_scratch >= largest && max_scratch < 2 * largest + SERIALIZE_BUFFER_DEFAULT_SIZE);
+
+  serlib_list_chunker_free(&a);
+  serlib_list_chunker_free(&b);
+  serlib_free_buffer(out_a);
+  serlib_free_buffer(out_b);
+  serlib_list_destroy(&list);
+};
+
+static void test_empty_lists(void) {
+  list_t empty;
+  serlib_list_new(&empty, sizeof(test_elem_t), NULL);
+
+  ser_buff_t* expect;
+  serlib_init_buffer_of_size(&expect, 64);
+
+  serlib_serialize_list_t(&empty, expect, test_serialize_elem);
+  SERLIB_TEST_CHECK(test_chunked_matches(&empty, expect, 3));
+
+  serlib_reset_buffer(expect);
+  serlib_serialize_list_t(NULL, expect, test_serialize_elem);
+  SERLIB_TEST_CHECK(test_chunked_matches(NULL, expect, 3));
+
+  serlib_free_buffer(expect);
+  serlib_list_destroy(&empty);
+};
+
+int main(void) {
+  test_chunk_sizes();
+  test_interleaved();
+  test_empty_lists();
+
+  SERLIB_TEST_DONE("test_list_chunker");
+};
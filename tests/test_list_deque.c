@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/serc.h"
+#include "test.h"
+
+/*
+ * Lists as deques: pushes and pops at both ends keep deque order and
+ * consistent links, popped nodes are recycled through the node cache,
+ * and splice and move_node hand nodes, and the bytes they account for,
+ * from one list to another without copying.
+ */
+
+/*
+ * Returns 1 if the list's links, length and tail agree in both
+ * directions, and fills ids (if given) with the values front to back.
+ */
+static int test_consistent(list_t* list, int* ids) {
+  int count = 0;
+  list_node_t* prev = NULL;
+  for (list_node_t* node = list->head; node; prev = node, node = node->next) {
+    if (node->prev != prev || count > list->logical_length) return 0;
+    if (ids) ids[count] = *(int*)node->data;
+    count++;
+  }
+  if (prev != list->tail || count != list->logical_length) return 0;
+
+  int back = 0;
+  for (list_node_t* node = list->tail; node; node = node->prev) back++;
+  return back == count;
+};
+
+static int test_pop_value(list_node_t* node) {
+  return node ? *(int*)node->data : -1;
+};
+
+static void test_deque_order(void) {
+  list_t list;
+  serlib_list_new(&list, sizeof(int), NULL);
+
+  SERLIB_TEST_CHECK(serlib_list_pop_head_node(&list) == NULL);
+  SERLIB_TEST_CHECK(serlib_list_pop_tail_node(&list) == NULL);
+
+  // 4 2 0 1 3 5
+  for (int i = 0; i < 6; i++) {
+    if (i % 2) serlib_list_append(&list, &i);
+    else serlib_list_prepend(&list, &i);
+  }
+
+  int ids[6];
+  int expect[6] = { 4, 2, 0, 1, 3, 5 };
+  SERLIB_TEST_CHECK(test_consistent(&list, ids) && memcmp(ids, expect, sizeof(ids)) == 0);
+
+  int value = -1;
+  serlib_list_get_head(&list, &value, false);
+  SERLIB_TEST_CHECK(value == 4 && list.logical_length == 6);
+  serlib_list_get_tail(&list, &value);
+  SERLIB_TEST_CHECK(value == 5);
+  serlib_list_get_head(&list, &value, true);
+  SERLIB_TEST_CHECK(value == 4 && list.logical_length == 5);
+
+  list_node_t* head = serlib_list_pop_head_node(&list);
+  list_node_t* tail = serlib_list_pop_tail_node(&list);
+  SERLIB_TEST_CHECK(test_pop_value(head) == 2 && test_pop_value(tail) == 5);
+  SERLIB_TEST_CHECK(head->next == NULL && head->prev == NULL && tail->next == NULL && tail->prev == NULL);
+  SERLIB_TEST_CHECK(test_consistent(&list, NULL) && list.logical_length == 3);
+
+  // detached nodes go back in at either end as they are
+  serlib_list_push_tail_node(&list, head);
+  serlib_list_push_head_node(&list, tail);
+  int again[5] = { 5, 0, 1, 3, 2 };
+  SERLIB_TEST_CHECK(test_consistent(&list, ids) && memcmp(ids, again, sizeof(again)) == 0);
+
+  // down to empty from both ends
+  int popped = 0;
+  for (;;) {
+    list_node_t* node = popped % 2 ? serlib_list_pop_tail_node(&list) : serlib_list_pop_head_node(&list);
+    if (!node) break;
+    serlib_list_release_node(&list, node);
+    popped++;
+  }
+  SERLIB_TEST_CHECK(popped == 5 && list.head == NULL && list.tail == NULL && list.logical_length == 0);
+
+  serlib_list_destroy(&list);
+};
+
+static void test_node_cache(void) {
+  list_t list;
+  serlib_list_new(&list, sizeof(int), NULL);
+  serlib_list_set_node_cache(&list, 2);
+
+  for (int i = 0; i < 4; i++) serlib_list_append(&list, &i);
+  long long held = list.bytes;
+
+  // released nodes come back on the next pushes instead of new ones
+  list_node_t* first = serlib_list_pop_head_node(&list);
+  list_node_t* second = serlib_list_pop_head_node(&list);
+  list_node_t* third = serlib_list_pop_head_node(&list);
+  serlib_list_release_node(&list, first);
+  serlib_list_release_node(&list, second);
+  serlib_list_release_node(&list, third);
+  SERLIB_TEST_CHECK(list.free_count == 2);
+  SERLIB_TEST_CHECK(list.bytes < held);
+
+  int value = 7;
+  serlib_list_append(&list, &value);
+  serlib_list_append(&list, &value);
+  SERLIB_TEST_CHECK(list.free_count == 0);
+  SERLIB_TEST_CHECK((list.tail == first || list.tail == second) && (list.tail->prev == first || list.tail->prev == second));
+  SERLIB_TEST_CHECK(*(int*)list.tail->data == 7 && list.tail->dirty);
+  SERLIB_TEST_CHECK(test_consistent(&list, NULL) && list.logical_length == 3);
+
+  serlib_list_destroy(&list);
+  SERLIB_TEST_CHECK(list.bytes == 0);
+};
+
+static void test_splice(void) {
+  list_t dest;
+  list_t src;
+  serlib_list_new(&dest, sizeof(int), NULL);
+  serlib_list_new(&src, sizeof(int), NULL);
+
+  for (int i = 0; i < 3; i++) serlib_list_append(&dest, &i);
+  for (int i = 3; i < 8; i++) serlib_list_append(&src, &i);
+
+  // a cached node in src stays with src
+  list_node_t* spare = serlib_list_pop_tail_node(&src);
+  serlib_list_release_node(&src, spare);
+
+  long long total = dest.bytes + src.bytes;
+  list_node_t* src_head = src.head;
+  serlib_list_splice(&dest, &src);
+
+  int ids[7];
+  int expect[7] = { 0, 1, 2, 3, 4, 5, 6 };
+  SERLIB_TEST_CHECK(test_consistent(&dest, ids) && memcmp(ids, expect, sizeof(expect)) == 0);
+  SERLIB_TEST_CHECK(dest.head->next->next->next == src_head);
+  SERLIB_TEST_CHECK(src.head == NULL && src.tail == NULL && src.logical_length == 0 && src.free_count == 1);
+  SERLIB_TEST_CHECK(dest.bytes + src.bytes == total);
+
+  // splicing an empty list changes nothing; into an empty one moves all
+  serlib_list_splice(&dest, &src);
+  SERLIB_TEST_CHECK(dest.logical_length == 7);
+  serlib_list_splice(&src, &dest);
+  SERLIB_TEST_CHECK(test_consistent(&src, ids) && memcmp(ids, expect, sizeof(expect)) == 0);
+  SERLIB_TEST_CHECK(dest.logical_length == 0 && dest.head == NULL && dest.bytes == 0);
+
+  // one node across, data untouched
+  list_node_t* node = serlib_list_pop_head_node(&src);
+  void* data = node->data;
+  serlib_list_move_node(&dest, &src, node);
+  SERLIB_TEST_CHECK(dest.head == node && node->data == data && *(int*)dest.head->data == 0);
+  SERLIB_TEST_CHECK(test_consistent(&dest, NULL) && test_consistent(&src, NULL));
+  SERLIB_TEST_CHECK(dest.bytes + src.bytes == total);
+
+  serlib_list_destroy(&dest);
+  serlib_list_destroy(&src);
+  SERLIB_TEST_CHECK(dest.bytes == 0 && src.bytes == 0);
+};
+
+int main(void) {
+  test_deque_order();
+  test_node_cache();
+  test_splice();
+
+  SERLIB_TEST_DONE("test_list_deque");
+};
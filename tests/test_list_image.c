@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/serc.h"
+#include "test.h"
+
+/*
+ * List images: a list opened in place, or relocated after a move,
+ * walks the same as the one written, and a corrupt header or link,
+ * also in an image already fixed up at its address, makes
+ * serlib_list_image_open fail instead of following it.
+ */
+
+#define TEST_ELEMENTS 1000
+
+typedef struct _test_elem_t {
+  long long id;
+  int value;
+} test_elem_t;
+
+static void test_fill(list_t* list) {
+  serlib_list_new(list, sizeof(test_elem_t), NULL);
+  for (int i = 0; i < TEST_ELEMENTS; i++) {
+    test_elem_t elem = { .id = i, .value = i * 3 };
+    serlib_list_append(list, &elem);
+  }
+};
+
+static long long test_id_sum;
+
+static bool test_sum_ids(void* data) {
+  test_id_sum += ((test_elem_t*)data)->id;
+  return true;
+};
+
+static void test_image_round_trip(void) {
+  list_t list;
+  test_fill(&list);
+
+  ser_buff_t* b;
+  serlib_init_buffer_of_size(&b, 64);
+  SERLIB_TEST_CHECK(serlib_serialize_list_image(&list, b) == SERLIB_OK);
+
+  int size = b->next;
+  char* image = aligned_alloc(8, (size + 7) & ~7);
+  memcpy(image, b->buffer, size);
+
+  list_t* view = serlib_list_image_open(image, size);
+  SERLIB_TEST_CHECK(view != NULL);
+  if (view) {
+    test_id_sum = 0;
+    serlib_list_iterate(view, test_sum_ids);
+    SERLIB_TEST_CHECK(view->logical_length == TEST_ELEMENTS);
+    SERLIB_TEST_CHECK(test_id_sum == (long long)TEST_ELEMENTS * (TEST_ELEMENTS - 1) / 2);
+    SERLIB_TEST_CHECK(((test_elem_t*)view->tail->data)->value == (TEST_ELEMENTS - 1) * 3);
+
+    int back = 0;
+    for (list_node_t* node = view->tail; node; node = node->prev) back++;
+    SERLIB_TEST_CHECK(back == TEST_ELEMENTS);
+
+    // opening again checks the links it already fixed up; a moved copy
+    // is relocated
+    SERLIB_TEST_CHECK(serlib_list_image_open(image, size) == view);
+
+    list_node_t* saved = view->head->next->next;
+    view->head->next->next = (list_node_t*)(image + size + 64);
+    SERLIB_TEST_CHECK(serlib_list_image_open(image, size) == NULL);
+    view->head->next->next = saved;
+    view->freeFn = free;
+    SERLIB_TEST_CHECK(serlib_list_image_open(image, size) == view && view->freeFn == NULL);
+
+    char* moved = aligned_alloc(8, (size + 7) & ~7);
+    memcpy(moved, image, size);
+    list_t* relocated = serlib_list_image_open(moved, size);
+    SERLIB_TEST_CHECK(relocated != NULL && (char*)relocated->head > moved && (char*)relocated->head < moved + size);
+    free(moved);
+  }
+
+  // a fixed buffer too small takes nothing
+  char storage[64];
+  ser_buff_t fixed = { .buffer = storage, .size = sizeof(storage), .flags = SERLIB_BUFF_FIXED, .node = -1 };
+  SERLIB_TEST_CHECK(serlib_serialize_list_image(&list, &fixed) == SERLIB_ERR_OVERFLOW && fixed.next == 0);
+
+  serlib_list_destroy(&list);
+  serlib_free_buffer(b);
+  free(image);
+};
+
+static void test_image_corrupt(void) {
+  list_t list;
+  test_fill(&list);
+
+  ser_buff_t* b;
+  serlib_init_buffer_of_size(&b, 64);
+  serlib_serialize_list_image(&list, b);
+
+  int size = b->next;
+  char* image = aligned_alloc(8, (size + 8 + 7) & ~7);
+  list_node_t* nodes = (list_node_t*)(image + sizeof(serlib_list_image_t) + ((sizeof(list_t) + 7) & ~(size_t)7));
+
+  memcpy(image, b->buffer, size);
+  SERLIB_TEST_CHECK(serlib_list_image_open(image, size - 1) == NULL);
+
+  memcpy(image, b->buffer, size);
+  ((serlib_list_image_t*)image)->magic ^= 1;
+  SERLIB_TEST_CHECK(serlib_list_image_open(image, size) == NULL);
+
+  memcpy(image, b->buffer, size);
+  ((serlib_list_image_t*)image)->node_size += 8;
+  SERLIB_TEST_CHECK(serlib_list_image_open(image, size) == NULL);
+
+  // a node link out of the image, and one out of list order
+  memcpy(image, b->buffer, size);
+  nodes[5].next = (list_node_t*)(unsigned long)(size + 4096);
+  SERLIB_TEST_CHECK(serlib_list_image_open(image, size) == NULL);
+
+  memcpy(image, b->buffer, size);
+  nodes[5].next = nodes[2].next;
+  SERLIB_TEST_CHECK(serlib_list_image_open(image, size) == NULL);
+
+  memcpy(image, b->buffer, size);
+  nodes[7].data = (void*)(unsigned long)(size - 1);
+  SERLIB_TEST_CHECK(serlib_list_image_open(image, size) == NULL);
+
+  // misaligned
+  memmove(image + 4, b->buffer, size);
+  SERLIB_TEST_CHECK(serlib_list_image_open(image + 4, size) == NULL);
+
+  // and the untouched image still opens
+  memcpy(image, b->buffer, size);
+  SERLIB_TEST_CHECK(serlib_list_image_open(image, size) != NULL);
+
+  serlib_list_destroy(&list);
+  serlib_free_buffer(b);
+  free(image);
+};
+
+int main(void) {
+  test_image_round_trip();
+  test_image_corrupt();
+
+  SERLIB_TEST_DONE("test_list_image");
+};
@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/serc.h"
+#include "test.h"
+
+/*
+ * Indexed lists: elements read back through the lazy reader match what
+ * was written, and a corrupt footer, checkpoint or delta stream makes
+ * the reader fail instead of reading outside the buffer.
+ */
+
+#define TEST_ELEMENTS 1000
+
+typedef struct _test_elem_t {
+  long long id;
+  int value;
+} test_elem_t;
+
+// variable-length encoding: the id, then id % 7 filler bytes
+static void test_serialize_elem(void* data, ser_buff_t* b) {
+  test_elem_t* elem = data;
+  serlib_serialize_data(b, (char*)&elem->id, sizeof(elem->id));
+  serlib_serialize_data(b, (char*)&elem->value, sizeof(elem->value));
+  for (int i = 0; i < elem->id % 7; i++) serlib_serialize_data(b, "x", 1);
+};
+
+static void test_deserialize_elem(void* data, ser_buff_t* b) {
+  test_elem_t* elem = data;
+  serlib_deserialize_data(b, (char*)&elem->id, sizeof(elem->id));
+  serlib_deserialize_data(b, (char*)&elem->value, sizeof(elem->value));
+  serlib_buffer_skip(b, elem->id % 7);
+};
+
+static void test_fill(list_t* list) {
+  serlib_list_new(list, sizeof(test_elem_t), NULL);
+  for (int i = 0; i < TEST_ELEMENTS; i++) {
+    test_elem_t elem = { .id = i, .value = i * 3 };
+    serlib_list_append(list, &elem);
+  }
+};
+
+static void test_reader_round_trip(void) {
+  list_t list;
+  test_fill(&list);
+
+  // a prefix in front of the list: the reader works from the footer end
+  ser_buff_t* b;
+  serlib_init_buffer_of_size(&b, 64);
+  serlib_serialize_data(b, "HDR", 3);
+  serlib_serialize_list_t_indexed(&list, b, test_serialize_elem);
+
+  serlib_list_reader_t reader;
+  SERLIB_TEST_CHECK(serlib_list_reader_open(&reader, b->buffer, b->next) == 0);
+  SERLIB_TEST_CHECK(serlib_list_reader_get_count(&reader) == TEST_ELEMENTS);
+
+  int wrong = 0;
+  for (unsigned int i = 0; i < TEST_ELEMENTS; i++) {
+    test_elem_t elem = { 0 };
+    int len = 0;
+    wrong += serlib_list_reader_get(&reader, i, test_deserialize_elem, &elem) != 0;
+    wrong += elem.id != i || elem.value != (int)i * 3;
+    wrong += !serlib_list_reader_element(&reader, i, &len) || len != 12 + (int)(i % 7);
+  }
+  SERLIB_TEST_CHECK(wrong == 0);
+
+  test_elem_t range[100];
+  SERLIB_TEST_CHECK(serlib_list_reader_get_range(&reader, 950, 100, test_deserialize_elem, range, sizeof(test_elem_t)) == 50);
+  SERLIB_TEST_CHECK(range[0].id == 950 && range[49].id == 999);
+  SERLIB_TEST_CHECK(serlib_list_reader_element(&reader, TEST_ELEMENTS, NULL) == NULL);
+
+  // the plain deserializer steps over the footer
+  b->next = 3;
+  list_t* copy = serlib_deserialize_list_t(b, sizeof(test_elem_t), test_deserialize_elem);
+  SERLIB_TEST_CHECK(copy->logical_length == TEST_ELEMENTS);
+  serlib_list_destroy(copy);
+  free(copy);
+
+  serlib_list_destroy(&list);
+  serlib_free_buffer(b);
+};
+
+static void test_reader_corrupt(void) {
+  list_t list;
+  test_fill(&list);
+
+  ser_buff_t* b;
+  serlib_init_buffer_of_size(&b, 64);
+  serlib_serialize_list_t_indexed(&list, b, test_serialize_elem);
+
+  int size = b->next;
+  char* data = malloc(size);
+  memcpy(data, b->buffer, size);
+
+  unsigned int trailer[5];
+  memcpy(trailer, data + size - sizeof(trailer), sizeof(trailer));
+  unsigned int count = trailer[0];
+  unsigned int stride = trailer[1];
+  unsigned int list_size = trailer[2];
+  unsigned int deltas_size = trailer[3];
+  char* checkpoints = data + size - sizeof(trailer) - (count + stride - 1) / stride * 8;
+  char* deltas = data + list_size + sizeof(unsigned int);
+
+  serlib_list_reader_t reader;
+  unsigned int bad = 0x7fffffff;
+  unsigned int saved;
+
+  // footer
+  SERLIB_TEST_CHECK(serlib_list_reader_open(&reader, data, size - 1) == -1);
+  SERLIB_TEST_CHECK(serlib_list_reader_open(&reader, data, 8) == -1);
+  data[size - 1] ^= 1;
+  SERLIB_TEST_CHECK(serlib_list_reader_open(&reader, data, size) == -1);
+  data[size - 1] ^= 1;
+
+  // a checkpoint offset past the list, and one past the delta stream
+  memcpy(&saved, checkpoints + 8, sizeof(saved));
+  memcpy(checkpoints + 8, &bad, sizeof(bad));
+  SERLIB_TEST_CHECK(serlib_list_reader_open(&reader, data, size) == -1);
+  memcpy(checkpoints + 8, &saved, sizeof(saved));
+
+  memcpy(&saved, checkpoints + 12, sizeof(saved));
+  memcpy(checkpoints + 12, &bad, sizeof(bad));
+  SERLIB_TEST_CHECK(serlib_list_reader_open(&reader, data, size) == -1);
+  memcpy(checkpoints + 12, &saved, sizeof(saved));
+
+  // deltas that run past the sentinel or off the end of the stream
+  SERLIB_TEST_CHECK(serlib_list_reader_open(&reader, data, size) == 0);
+  memset(deltas, 0xFF, deltas_size);
+
+  test_elem_t elem;
+  test_elem_t range[10];
+  int len;
+  SERLIB_TEST_CHECK(serlib_list_reader_element(&reader, 5, &len) == NULL);
+  SERLIB_TEST_CHECK(serlib_list_reader_get(&reader, 5, test_deserialize_elem, &elem) == -1);
+  SERLIB_TEST_CHECK(serlib_list_reader_get_range(&reader, 1, 10, test_deserialize_elem, range, sizeof(test_elem_t)) == -1);
+
+  // element 0 sits on a checkpoint, so only the walk past it fails
+  SERLIB_TEST_CHECK(serlib_list_reader_get(&reader, 0, test_deserialize_elem, &elem) == 0 && elem.id == 0);
+  SERLIB_TEST_CHECK(serlib_list_reader_get_range(&reader, 0, 10, test_deserialize_elem, range, sizeof(test_elem_t)) == 1);
+
+  serlib_list_destroy(&list);
+  serlib_free_buffer(b);
+  free(data);
+};
+
+int main(void) {
+  test_reader_round_trip();
+  test_reader_corrupt();
+
+  SERLIB_TEST_DONE("test_list_reader");
+};
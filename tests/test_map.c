@@ -0,0 +1,240 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/serc.h"
+#include "../include/serc_map.h"
+#include "test.h"
+
+/*
+ * Open-addressing map: byte-string and integer maps, tombstones
+ * included, round-trip through serlib_serialize_map_t into both
+ * serlib_deserialize_map_t and serlib_map_open, and images with a bad
+ * header, control bytes or slot offsets are refused by both.
+ */
+
+typedef struct _test_image_t {
+  char* data;
+  int size;
+} test_image_t;
+
+static test_image_t test_image_copy(ser_buff_t* b) {
+  test_image_t image;
+  image.size = b->next;
+  image.data = aligned_alloc(8, (image.size + 7) & ~7);
+  memcpy(image.data, b->buffer, image.size);
+  return image;
+};
+
+static unsigned char* test_image_ctrl(test_image_t* image) {
+  return (unsigned char*)(image->data + sizeof(serlib_map_image_t));
+};
+
+static serlib_map_slot_t* test_image_slots(test_image_t* image) {
+  serlib_map_image_t* header = (serlib_map_image_t*)image->data;
+  unsigned int ctrl_size = (header->capacity + SERLIB_MAP_GROUP + 7) & ~7u;
+  return (serlib_map_slot_t*)(image->data + sizeof(serlib_map_image_t) + ctrl_size);
+};
+
+/*
+ * Returns 1 if both load paths refuse the image.
+ */
+static int test_refused(test_image_t* image) {
+  serlib_map_t map;
+  int opened = serlib_map_open(&map, image->data, image->size);
+
+  ser_buff_t view = { .buffer = image->data, .size = image->size, .flags = SERLIB_BUFF_FIXED, .node = -1 };
+  int loaded = serlib_deserialize_map_t(&view, &map);
+  if (loaded == 0) serlib_map_free(&map);
+
+  return opened == -1 && loaded == -1;
+};
+
+static void test_bytes_round_trip(void) {
+  serlib_map_t map;
+  serlib_map_init(&map, SERLIB_MAP_KEY_BYTES, 0);
+
+  char key[32];
+  char value[64];
+  for (int i = 0; i < 1000; i++) {
+    int key_size = snprintf(key, sizeof(key), "key-%d", i);
+    int value_size = snprintf(value, sizeof(value), "value-%d-%d", i, i * i);
+    SERLIB_TEST_CHECK(serlib_map_put(&map, key, key_size, value, value_size) == 0);
+  }
+  for (int i = 0; i < 1000; i += 3) {
+    int key_size = snprintf(key, sizeof(key), "key-%d", i);
+    SERLIB_TEST_CHECK(serlib_map_remove(&map, key, key_size) == 0);
+  }
+
+  ser_buff_t* b;
+  serlib_init_buffer_of_size(&b, 64);
+  SERLIB_TEST_CHECK(serlib_serialize_map_t(b, &map) == SERLIB_OK);
+  test_image_t image = test_image_copy(b);
+
+  serlib_map_t loaded;
+  serlib_map_t opened;
+  b->next = 0;
+  SERLIB_TEST_CHECK(serlib_deserialize_map_t(b, &loaded) == 0);
+  SERLIB_TEST_CHECK(serlib_map_open(&opened, image.data, image.size) == 0);
+
+  serlib_map_t* maps[2] = { &loaded, &opened };
+  for (int m = 0; m < 2; m++) {
+    SERLIB_TEST_CHECK(serlib_map_get_count(maps[m]) == serlib_map_get_count(&map));
+
+    int missing = 0;
+    for (int i = 0; i < 1000; i++) {
+      int key_size = snprintf(key, sizeof(key), "key-%d", i);
+      int value_size = snprintf(value, sizeof(value), "value-%d-%d", i, i * i);
+
+      int found_size = -1;
+      char* found = serlib_map_get(maps[m], key, key_size, &found_size);
+      if (i % 3 == 0) {
+        missing += found != NULL;
+      } else {
+        missing += !found || found_size != value_size || memcmp(found, value, value_size) != 0;
+      }
+    }
+    SERLIB_TEST_CHECK(missing == 0);
+  }
+
+  // the loaded copy is a live map again
+  SERLIB_TEST_CHECK(serlib_map_put(&loaded, "new", 3, "x", 1) == 0);
+  SERLIB_TEST_CHECK(serlib_map_get(&loaded, "new", 3, NULL) != NULL);
+
+  serlib_map_free(&loaded);
+  serlib_map_free(&opened);
+  serlib_map_free(&map);
+  serlib_free_buffer(b);
+  free(image.data);
+};
+
+static void test_int_round_trip(void) {
+  serlib_map_t map;
+  serlib_map_init(&map, SERLIB_MAP_KEY_INT, 10);
+
+  for (unsigned long long i = 0; i < 500; i++) {
+    unsigned long long value = i * 1000003ULL;
+    SERLIB_TEST_CHECK(serlib_map_put_int(&map, i << 20, (char*)&value, sizeof(value)) == 0);
+  }
+
+  ser_buff_t* b;
+  serlib_init_buffer_of_size(&b, 64);
+  serlib_serialize_map_t(b, &map);
+  test_image_t image = test_image_copy(b);
+
+  serlib_map_t opened;
+  SERLIB_TEST_CHECK(serlib_map_open(&opened, image.data, image.size) == 0);
+
+  int wrong = 0;
+  for (unsigned long long i = 0; i < 500; i++) {
+    int size = 0;
+    char* found = serlib_map_get_int(&opened, i << 20, &size);
+    unsigned long long value = 0;
+    if (found && size == sizeof(value)) memcpy(&value, found, sizeof(value));
+    wrong += value != i * 1000003ULL;
+  }
+  SERLIB_TEST_CHECK(wrong == 0);
+  SERLIB_TEST_CHECK(serlib_map_get_int(&opened, 12345, NULL) == NULL);
+
+  // iteration visits every entry once
+  unsigned int pos = 0;
+  unsigned int seen = 0;
+  serlib_map_entry_t entry;
+  while (serlib_map_iterate(&opened, &pos, &entry)) seen++;
+  SERLIB_TEST_CHECK(seen == 500);
+
+  serlib_map_free(&opened);
+  serlib_map_free(&map);
+  serlib_free_buffer(b);
+  free(image.data);
+};
+
+static void test_corrupt_images(void) {
+  serlib_map_t map;
+  serlib_map_init(&map, SERLIB_MAP_KEY_BYTES, 10);
+  for (int i = 0; i < 10; i++) {
+    char key[8];
+    int key_size = snprintf(key, sizeof(key), "k%d", i);
+    serlib_map_put(&map, key, key_size, (char*)&i, sizeof(i));
+  }
+
+  ser_buff_t* b;
+  serlib_init_buffer_of_size(&b, 64);
+  serlib_serialize_map_t(b, &map);
+  test_image_t good = test_image_copy(b);
+  test_image_t bad = test_image_copy(b);
+  serlib_map_image_t* header = (serlib_map_image_t*)bad.data;
+  unsigned char* ctrl = test_image_ctrl(&bad);
+  unsigned int capacity = header->capacity;
+
+  SERLIB_TEST_CHECK(!test_refused(&bad));
+
+  // header
+  header->magic ^= 1;
+  SERLIB_TEST_CHECK(test_refused(&bad));
+  memcpy(bad.data, good.data, good.size);
+
+  header->capacity = capacity + 1;
+  SERLIB_TEST_CHECK(test_refused(&bad));
+  memcpy(bad.data, good.data, good.size);
+
+  bad.size = good.size - 1;
+  SERLIB_TEST_CHECK(test_refused(&bad));
+  bad.size = good.size;
+
+  // control bytes: every slot claims to be live, but count says none
+  memset(ctrl, 0x11, capacity + SERLIB_MAP_GROUP);
+  header->count = 0;
+  header->deleted = 0;
+  SERLIB_TEST_CHECK(test_refused(&bad));
+  memcpy(bad.data, good.data, good.size);
+
+  // the mirrored first group disagrees with the table
+  ctrl[capacity + 3] ^= 1;
+  SERLIB_TEST_CHECK(test_refused(&bad));
+  memcpy(bad.data, good.data, good.size);
+
+  // a byte that is neither a tag, empty nor deleted
+  for (unsigned int i = 0; i < capacity; i++) {
+    if (ctrl[i] != 0x80) continue;
+    ctrl[i] = 0x90;
+    if (i < SERLIB_MAP_GROUP) ctrl[capacity + i] = 0x90;
+    break;
+  }
+  SERLIB_TEST_CHECK(test_refused(&bad));
+  memcpy(bad.data, good.data, good.size);
+
+  // a live slot pointing outside the arena
+  serlib_map_slot_t* slots = test_image_slots(&bad);
+  for (unsigned int i = 0; i < capacity; i++) {
+    if (ctrl[i] & 0x80) continue;
+    slots[i].value_offset = 1u << 30;
+    break;
+  }
+  SERLIB_TEST_CHECK(test_refused(&bad));
+  memcpy(bad.data, good.data, good.size);
+
+  for (unsigned int i = 0; i < capacity; i++) {
+    if (ctrl[i] & 0x80) continue;
+    slots[i].key.bytes.size = header->arena_size;
+    break;
+  }
+  SERLIB_TEST_CHECK(test_refused(&bad));
+  memcpy(bad.data, good.data, good.size);
+
+  // still fine after all the restores
+  SERLIB_TEST_CHECK(!test_refused(&bad));
+
+  serlib_map_free(&map);
+  serlib_free_buffer(b);
+  free(good.data);
+  free(bad.data);
+};
+
+int main(void) {
+  test_bytes_round_trip();
+  test_int_round_trip();
+  test_corrupt_images();
+
+  SERLIB_TEST_DONE("test_map");
+};
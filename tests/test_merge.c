@@ -0,0 +1,234 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/serc.h"
+#include "../include/serc_merge.h"
+#include "test.h"
+
+/*
+ * Merging sorted serialized lists: the merged list is the elements of
+ * every run in key order, equal keys in run order, byte for byte as
+ * serlib_serialize_list_t would write them; chunked merges match the
+ * one-shot merge for any chunk size; and a run out of order, a
+ * malformed run or a full fixed output fail with out left as it was.
+ */
+
+#define TEST_RUNS 5
+
+typedef struct _test_elem_t {
+  int number;
+  char name[8];
+  int run;
+  int seq;
+} test_elem_t;
+
+// number, name (1-byte length), run, seq
+static void test_serialize_elem(void* data, ser_buff_t* b) {
+  test_elem_t* elem = data;
+  unsigned char name_size = strlen(elem->name);
+  serlib_serialize_data(b, (char*)&elem->number, sizeof(int));
+  serlib_serialize_data(b, (char*)&name_size, 1);
+  serlib_serialize_data(b, elem->name, name_size);
+  serlib_serialize_data(b, (char*)&elem->run, sizeof(int));
+  serlib_serialize_data(b, (char*)&elem->seq, sizeof(int));
+};
+
+static int test_key(char* data, int available, serlib_merge_key_t* key) {
+  if (available < (int)sizeof(int) + 1) return -1;
+  int number;
+  memcpy(&number, data, sizeof(int));
+  int name_size = (unsigned char)data[sizeof(int)];
+  int size = sizeof(int) + 1 + name_size + 2 * sizeof(int);
+  if (size > available) return -1;
+
+  key->number = number;
+  key->bytes = data + sizeof(int) + 1;
+  key->bytes_size = name_size;
+  return size;
+};
+
+static int test_compare(const void* a, const void* b) {
+  const test_elem_t* x = a;
+  const test_elem_t* y = b;
+  if (x->number != y->number) return x->number < y->number ? -1 : 1;
+  int names = strcmp(x->name, y->name);
+  if (names) return names;
+  if (x->run != y->run) return x->run - y->run;
+  return x->seq - y->seq;
+};
+
+/*
+ * Writes TEST_RUNS sorted runs, some keys shared within and across runs
+ * and one run empty, and the expected merge into expect.
+ */
+static void test_make_runs(ser_buff_t** runs, ser_buff_t* expect) {
+  test_elem_t all[TEST_RUNS * 64];
+  int count = 0;
+
+  for (int r = 0; r < TEST_RUNS; r++) {
+    int length = r == 3 ? 0 : 20 + r * 11;
+    test_elem_t* elems = all + count;
+    for (int i = 0; i < length; i++) {
+      test_elem_t* elem = &elems[i];
+      memset(elem, 0, sizeof(*elem));
+      elem->number = (i * (r + 2)) % 17;
+      snprintf(elem->name, sizeof(elem->name), "%c%s", 'a' + (i + r) % 3, i % 4 ? "x" : "");
+      elem->run = r;
+    }
+    qsort(elems, length, sizeof(test_elem_t), test_compare);
+
+    list_t list;
+    serlib_list_new(&list, sizeof(test_elem_t), NULL);
+    for (int i = 0; i < length; i++) {
+      elems[i].seq = i;
+      serlib_list_append(&list, &elems[i]);
+    }
+    serlib_init_buffer_of_size(&runs[r], 64);
+    serlib_serialize_list_t(&list, runs[r], test_serialize_elem);
+    runs[r]->next = 0;
+    serlib_list_destroy(&list);
+    count += length;
+  }
+
+  qsort(all, count, sizeof(test_elem_t), test_compare);
+  list_t merged;
+  serlib_list_new(&merged, sizeof(test_elem_t), NULL);
+  for (int i = 0; i < count; i++) serlib_list_append(&merged, &all[i]);
+  serlib_serialize_list_t(&merged, expect, test_serialize_elem);
+  serlib_list_destroy(&merged);
+};
+
+static void test_free_runs(ser_buff_t** runs) {
+  for (int r = 0; r < TEST_RUNS; r++) serlib_free_buffer(runs[r]);
+};
+
+static void test_ordering(void) {
+  ser_buff_t* runs[TEST_RUNS];
+  ser_buff_t* expect;
+  serlib_init_buffer_of_size(&expect, 64);
+  test_make_runs(runs, expect);
+
+  ser_buff_t* out;
+  serlib_init_buffer_of_size(&out, 64);
+  serlib_serialize_data(out, "keep", 4);
+  SERLIB_TEST_CHECK(serlib_merge_lists(runs, TEST_RUNS, test_key, out) == 0);
+  SERLIB_TEST_CHECK(out->next == 4 + expect->next);
+  SERLIB_TEST_CHECK(memcmp(out->buffer, "keep", 4) == 0 && memcmp(out->buffer + 4, expect->buffer, expect->next) == 0);
+
+  // every run is left just past its sentinel
+  int consumed = 1;
+  for (int r = 0; r < TEST_RUNS; r++) {
+    unsigned int sentinel = 0;
+    memcpy(&sentinel, runs[r]->buffer + runs[r]->next - sizeof(unsigned int), sizeof(unsigned int));
+    consumed = consumed && sentinel == 0xFFFFFFFF;
+  }
+  SERLIB_TEST_CHECK(consumed);
+
+  // no runs at all merge to an empty list
+  serlib_reset_buffer(out);
+  SERLIB_TEST_CHECK(serlib_merge_lists(NULL, 0, test_key, out) == 0);
+  unsigned int sentinel = 0;
+  memcpy(&sentinel, out->buffer, sizeof(unsigned int));
+  SERLIB_TEST_CHECK(out->next == sizeof(unsigned int) && sentinel == 0xFFFFFFFF);
+
+  test_free_runs(runs);
+  serlib_free_buffer(expect);
+  serlib_free_buffer(out);
+};
+
+static void test_chunked(void) {
+  int sizes[] = { 1, 5, 64, 1 << 16 };
+  for (int s = 0; s < (int)(sizeof(sizes) / sizeof(sizes[0])); s++) {
+    ser_buff_t* runs[TEST_RUNS];
+    ser_buff_t* expect;
+    serlib_init_buffer_of_size(&expect, 64);
+    test_make_runs(runs, expect);
+
+    serlib_list_merger_t merger;
+    SERLIB_TEST_CHECK(serlib_list_merger_init(&merger, runs, TEST_RUNS, test_key) == 0);
+
+    char* chunk = malloc(sizes[s]);
+    ser_buff_t* out;
+    serlib_init_buffer_of_size(&out, 64);
+    int short_chunks = 0;
+    int n;
+    while ((n = serlib_merge_list_chunk(&merger, chunk, sizes[s])) > 0) {
+      short_chunks += n < sizes[s];
+      serlib_serialize_data(out, chunk, n);
+    }
+    SERLIB_TEST_CHECK(n == 0 && short_chunks <= 1 && serlib_list_merger_done(&merger));
+    SERLIB_TEST_CHECK(out->next == expect->next && memcmp(out->buffer, expect->buffer, expect->next) == 0);
+
+    free(chunk);
+    serlib_list_merger_free(&merger);
+    test_free_runs(runs);
+    serlib_free_buffer(expect);
+    serlib_free_buffer(out);
+  }
+};
+
+static void test_rejected(void) {
+  ser_buff_t* runs[TEST_RUNS];
+  ser_buff_t* expect;
+  serlib_init_buffer_of_size(&expect, 64);
+  test_make_runs(runs, expect);
+
+  // the last element of run 1 gets a key below everything before it
+  ser_buff_t* run = runs[1];
+  serlib_merge_key_t key;
+  int last = 0;
+  unsigned int first;
+  for (int at = 0; memcpy(&first, run->buffer + at, sizeof(first)), first != 0xFFFFFFFF; at += test_key(run->buffer + at, run->size - at, &key)) {
+    last = at;
+  }
+  int below = -5;
+  SERLIB_TEST_CHECK(last > 0);
+  memcpy(run->buffer + last, &below, sizeof(int));
+
+  ser_buff_t* out;
+  serlib_init_buffer_of_size(&out, 64);
+  serlib_serialize_data(out, "keep", 4);
+  SERLIB_TEST_CHECK(serlib_merge_lists(runs, TEST_RUNS, test_key, out) == -1);
+  SERLIB_TEST_CHECK(out->next == 4);
+
+  // the chunked merge fails too, and stays failed
+  for (int r = 0; r < TEST_RUNS; r++) runs[r]->next = 0;
+  serlib_list_merger_t merger;
+  SERLIB_TEST_CHECK(serlib_list_merger_init(&merger, runs, TEST_RUNS, test_key) == 0);
+  char chunk[32];
+  int n;
+  while ((n = serlib_merge_list_chunk(&merger, chunk, sizeof(chunk))) > 0);
+  SERLIB_TEST_CHECK(n == -1 && !serlib_list_merger_done(&merger));
+  SERLIB_TEST_CHECK(serlib_merge_list_chunk(&merger, chunk, sizeof(chunk)) == -1);
+  serlib_list_merger_free(&merger);
+
+  // a run cut short in its first element is refused up front
+  for (int r = 0; r < TEST_RUNS; r++) runs[r]->next = 0;
+  ser_buff_t cut = { .buffer = runs[0]->buffer, .size = 6, .flags = SERLIB_BUFF_FIXED, .node = -1 };
+  ser_buff_t* cut_runs[] = { runs[2], &cut };
+  SERLIB_TEST_CHECK(serlib_list_merger_init(&merger, cut_runs, 2, test_key) == -1);
+  SERLIB_TEST_CHECK(serlib_merge_lists(cut_runs, 2, test_key, out) == -1 && out->next == 4);
+
+  // a fixed output too small for the merge
+  for (int r = 0; r < TEST_RUNS; r++) runs[r]->next = 0;
+  char memory[128];
+  ser_buff_t small;
+  serlib_buffer_init_fixed(&small, memory, sizeof(memory), 0);
+  serlib_serialize_data(&small, "keep", 4);
+  ser_buff_t* sorted_runs[] = { runs[0], runs[2] };
+  SERLIB_TEST_CHECK(serlib_merge_lists(sorted_runs, 2, test_key, &small) == -1);
+  SERLIB_TEST_CHECK(small.next == 4 && memcmp(memory, "keep", 4) == 0);
+
+  test_free_runs(runs);
+  serlib_free_buffer(expect);
+  serlib_free_buffer(out);
+};
+
+int main(void) {
+  test_ordering();
+  test_chunked();
+  test_rejected();
+
+  SERLIB_TEST_DONE("test_merge");
+};
@@ -0,0 +1,156 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "../include/serc.h"
+#include "../include/serc_ring.h"
+#include "test.h"
+
+/*
+ * Shared-memory frame ring: frames round-trip through reserve/commit
+ * and send, across the wrap point and through a second mapping, and a
+ * corrupt descriptor or frame is refused rather than followed.
+ */
+
+static void fill(char* data, int size, unsigned int seed) {
+  for (int i = 0; i < size; i++) data[i] = (char)(seed * 31 + i);
+};
+
+static void test_round_trip(void) {
+  serlib_ring_t ring;
+  SERLIB_TEST_CHECK(serlib_ring_create(&ring, NULL, 4096, SERLIB_RING_SPSC) == 0);
+
+  // far more bytes than the ring holds, so frames wrap many times
+  char data[1000];
+  char scratch[1000];
+  for (unsigned int i = 0; i < 2000; i++) {
+    int size = (i * 37) % sizeof(data);
+    fill(data, size, i);
+
+    serlib_ring_slot_t slot;
+    SERLIB_TEST_CHECK(serlib_ring_reserve(&ring, size, &slot) == 0);
+    slot.header->tid = 7;
+    slot.header->rpc_proc_id = 1;
+    slot.header->rpc_call_id = i;
+    SERLIB_TEST_CHECK(serlib_serialize_data(&slot.buff, data, size) == SERLIB_OK);
+    serlib_ring_commit(&ring, &slot);
+
+    serlib_ring_slot_t in;
+    SERLIB_TEST_CHECK(serlib_ring_peek(&ring, &in) == 0);
+    SERLIB_TEST_CHECK(in.header->rpc_call_id == i && in.header->tid == 7);
+    SERLIB_TEST_CHECK(in.buff.size == size);
+    serlib_deserialize_data(&in.buff, scratch, size);
+    SERLIB_TEST_CHECK(memcmp(scratch, data, size) == 0);
+    serlib_ring_release(&ring, &in);
+  }
+
+  serlib_ring_slot_t slot;
+  SERLIB_TEST_CHECK(serlib_ring_peek(&ring, &slot) == -1);
+
+  // a copied buffer arrives as one frame
+  ser_buff_t* b;
+  serlib_init_buffer_of_size(&b, 64);
+  fill(data, 300, 99);
+  serlib_serialize_data(b, data, 300);
+  ser_header_t header = { .tid = 1, .rpc_proc_id = 2, .rpc_call_id = 3 };
+  SERLIB_TEST_CHECK(serlib_ring_send(&ring, &header, b) == 0);
+  SERLIB_TEST_CHECK(serlib_ring_peek(&ring, &slot) == 0);
+  SERLIB_TEST_CHECK(slot.header->payload_size == 300 && memcmp(slot.buff.buffer, data, 300) == 0);
+  serlib_ring_release(&ring, &slot);
+  serlib_free_buffer(b);
+
+  // a slot written past its reservation is dropped, not delivered
+  SERLIB_TEST_CHECK(serlib_ring_reserve(&ring, 8, &slot) == 0);
+  SERLIB_TEST_CHECK(serlib_serialize_data(&slot.buff, data, 16) == SERLIB_ERR_OVERFLOW);
+  serlib_ring_commit(&ring, &slot);
+  SERLIB_TEST_CHECK(serlib_ring_peek(&ring, &slot) == -1);
+
+  // a full ring refuses reservations instead of overwriting
+  int reserved = 0;
+  while (serlib_ring_reserve(&ring, 100, &slot) == 0) {
+    serlib_ring_commit(&ring, &slot);
+    reserved++;
+  }
+  SERLIB_TEST_CHECK(reserved > 0 && reserved < 4096 / 100);
+
+  // a second mapping of the same descriptor sees the same frames
+  serlib_ring_t other;
+  SERLIB_TEST_CHECK(serlib_ring_attach_fd(&other, dup(ring.fd)) == 0);
+  int seen = 0;
+  while (serlib_ring_peek(&other, &slot) == 0) {
+    serlib_ring_release(&other, &slot);
+    seen++;
+  }
+  SERLIB_TEST_CHECK(seen == reserved);
+  SERLIB_TEST_CHECK(serlib_ring_peek(&ring, &slot) == -1);
+
+  serlib_ring_close(&other);
+  serlib_ring_close(&ring);
+};
+
+static void test_corrupt_descriptor(void) {
+  serlib_ring_t ring;
+
+  // not a ring at all
+  int fd = memfd_create("serlib_test", 0);
+  SERLIB_TEST_CHECK(ftruncate(fd, SERLIB_RING_CTRL_SIZE + 4096) == 0);
+  SERLIB_TEST_CHECK(serlib_ring_attach_fd(&ring, fd) == -1);
+  close(fd);
+
+  // right magic and size, but a capacity the index mask can't handle
+  fd = memfd_create("serlib_test", 0);
+  SERLIB_TEST_CHECK(ftruncate(fd, SERLIB_RING_CTRL_SIZE + 6000) == 0);
+  serlib_ring_ctrl_t ctrl;
+  memset(&ctrl, 0, sizeof(ctrl));
+  ctrl.magic = SERLIB_RING_MAGIC;
+  ctrl.capacity = 6000;
+  SERLIB_TEST_CHECK(pwrite(fd, &ctrl, sizeof(ctrl), 0) == sizeof(ctrl));
+  SERLIB_TEST_CHECK(serlib_ring_attach_fd(&ring, fd) == -1);
+  close(fd);
+};
+
+static void test_corrupt_frame(void) {
+  serlib_ring_t ring;
+  SERLIB_TEST_CHECK(serlib_ring_create(&ring, NULL, 4096, SERLIB_RING_SPSC) == 0);
+
+  char data[64];
+  fill(data, sizeof(data), 1);
+
+  serlib_ring_slot_t slot;
+  SERLIB_TEST_CHECK(serlib_ring_reserve(&ring, sizeof(data), &slot) == 0);
+  serlib_serialize_data(&slot.buff, data, sizeof(data));
+  serlib_ring_commit(&ring, &slot);
+
+  // the frame size sits just before the ser_header_t (after the seq)
+  unsigned int* frame_size = (unsigned int*)((char*)slot.header - 2 * sizeof(unsigned int));
+  unsigned int saved = *frame_size;
+
+  serlib_ring_slot_t in;
+  *frame_size = 1 << 20;
+  SERLIB_TEST_CHECK(serlib_ring_peek(&ring, &in) == -1);
+  *frame_size = 3;
+  SERLIB_TEST_CHECK(serlib_ring_peek(&ring, &in) == -1);
+  *frame_size = saved;
+
+  slot.header->payload_size = saved;
+  SERLIB_TEST_CHECK(serlib_ring_peek(&ring, &in) == -1);
+  slot.header->payload_size = sizeof(data);
+
+  SERLIB_TEST_CHECK(serlib_ring_peek(&ring, &in) == 0);
+  SERLIB_TEST_CHECK(in.buff.size == sizeof(data) && memcmp(in.buff.buffer, data, sizeof(data)) == 0);
+  serlib_ring_release(&ring, &in);
+
+  serlib_ring_close(&ring);
+};
+
+int main(void) {
+  test_round_trip();
+  test_corrupt_descriptor();
+  test_corrupt_frame();
+
+  SERLIB_TEST_DONE("test_ring");
+};
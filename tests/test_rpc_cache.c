@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "../include/serc.h"
+#include "../include/serc_rpc.h"
+#include "test.h"
+
+/*
+ * Response cache: hits need the same procedure and request bytes,
+ * invalidation drops one procedure's entries and refuses responses
+ * computed before it, references handed out survive eviction, and a
+ * server answers repeated requests to a cacheable procedure without
+ * calling its handler until the procedure is invalidated.
+ */
+
+static ser_buff_t* test_response(const char* text) {
+  ser_buff_t* b;
+  serlib_init_buffer_of_size(&b, 64);
+  serlib_serialize_data(b, (char*)text, strlen(text));
+  return b;
+};
+
+static int test_is(ser_frozen_t* frozen, const char* text) {
+  return frozen && frozen->size == (int)strlen(text) && memcmp(frozen->buffer, text, frozen->size) == 0;
+};
+
+static void test_lookup_invalidate(void) {
+  serlib_rpc_cache_t cache;
+  serlib_rpc_cache_init(&cache, 16, 1 << 20);
+
+  ser_buff_t* one = test_response("one");
+  ser_buff_t* two = test_response("two");
+  ser_buff_t* three = test_response("three");
+
+  unsigned long long gen1 = serlib_rpc_cache_generation(&cache, 1);
+  unsigned long long gen2 = serlib_rpc_cache_generation(&cache, 2);
+  SERLIB_TEST_CHECK(serlib_rpc_cache_insert(&cache, 1, "req-a", 5, one, gen1) == 0);
+  SERLIB_TEST_CHECK(serlib_rpc_cache_insert(&cache, 1, "req-b", 5, two, gen1) == 0);
+  SERLIB_TEST_CHECK(serlib_rpc_cache_insert(&cache, 2, "req-a", 5, three, gen2) == 0);
+  SERLIB_TEST_CHECK(serlib_rpc_cache_insert(&cache, 1, "req-a", 5, two, gen1) == -1);
+
+  // same bytes, different procedure, and a prefix, are different keys
+  ser_frozen_t* hit = serlib_rpc_cache_lookup(&cache, 1, "req-a", 5);
+  SERLIB_TEST_CHECK(test_is(hit, "one"));
+  ser_frozen_t* other = serlib_rpc_cache_lookup(&cache, 2, "req-a", 5);
+  SERLIB_TEST_CHECK(test_is(other, "three"));
+  SERLIB_TEST_CHECK(serlib_rpc_cache_lookup(&cache, 1, "req-", 4) == NULL);
+  SERLIB_TEST_CHECK(serlib_rpc_cache_lookup(&cache, 3, "req-a", 5) == NULL);
+  if (other) serlib_frozen_release(other);
+
+  // procedure 1 goes, procedure 2 stays; the reference we hold is fine
+  SERLIB_TEST_CHECK(serlib_rpc_cache_invalidate(&cache, 1) == 2);
+  SERLIB_TEST_CHECK(serlib_rpc_cache_lookup(&cache, 1, "req-a", 5) == NULL);
+  SERLIB_TEST_CHECK(serlib_rpc_cache_lookup(&cache, 1, "req-b", 5) == NULL);
+  other = serlib_rpc_cache_lookup(&cache, 2, "req-a", 5);
+  SERLIB_TEST_CHECK(test_is(other, "three"));
+  if (other) serlib_frozen_release(other);
+  SERLIB_TEST_CHECK(test_is(hit, "one"));
+  if (hit) serlib_frozen_release(hit);
+
+  // a response computed before the invalidation is stale
+  SERLIB_TEST_CHECK(serlib_rpc_cache_generation(&cache, 1) != gen1);
+  SERLIB_TEST_CHECK(serlib_rpc_cache_insert(&cache, 1, "req-a", 5, one, gen1) == -1);
+  SERLIB_TEST_CHECK(serlib_rpc_cache_lookup(&cache, 1, "req-a", 5) == NULL);
+  SERLIB_TEST_CHECK(serlib_rpc_cache_insert(&cache, 1, "req-a", 5, one, serlib_rpc_cache_generation(&cache, 1)) == 0);
+
+  serlib_rpc_cache_counters_t counters;
+  serlib_rpc_cache_get_counters(&cache, &counters);
+  SERLIB_TEST_CHECK(counters.stale == 1 && counters.entries == 2);
+  SERLIB_TEST_CHECK(counters.hits == 3 && counters.misses >= 5);
+
+  serlib_free_buffer(one);
+  serlib_free_buffer(two);
+  serlib_free_buffer(three);
+  serlib_rpc_cache_destroy(&cache);
+};
+
+static void test_eviction(void) {
+  serlib_rpc_cache_t cache;
+  serlib_rpc_cache_init(&cache, 4, 1 << 20);
+
+  ser_buff_t* response = test_response("value");
+  char key[16];
+  for (int i = 0; i < 10; i++) {
+    int size = snprintf(key, sizeof(key), "key-%d", i);
+    SERLIB_TEST_CHECK(serlib_rpc_cache_insert(&cache, 1, key, size, response, serlib_rpc_cache_generation(&cache, 1)) == 0);
+  }
+
+  serlib_rpc_cache_counters_t counters;
+  serlib_rpc_cache_get_counters(&cache, &counters);
+  SERLIB_TEST_CHECK(counters.entries == 4 && counters.evictions == 6);
+  SERLIB_TEST_CHECK(serlib_rpc_cache_lookup(&cache, 1, "key-0", 5) == NULL);
+
+  ser_frozen_t* held = serlib_rpc_cache_lookup(&cache, 1, "key-9", 5);
+  SERLIB_TEST_CHECK(test_is(held, "value"));
+
+  // a response larger than the byte cap is never cached
+  serlib_rpc_cache_t small;
+  serlib_rpc_cache_init(&small, 4, 8);
+  SERLIB_TEST_CHECK(serlib_rpc_cache_insert(&small, 1, "k", 1, response, serlib_rpc_cache_generation(&small, 1)) == 0);
+  SERLIB_TEST_CHECK(serlib_rpc_cache_insert(&small, 1, "long-key", 8, response, serlib_rpc_cache_generation(&small, 1)) == -1);
+  serlib_rpc_cache_destroy(&small);
+
+  // destroying the cache leaves the held reference valid
+  serlib_rpc_cache_destroy(&cache);
+  SERLIB_TEST_CHECK(test_is(held, "value"));
+  if (held) serlib_frozen_release(held);
+
+  serlib_free_buffer(response);
+};
+
+static int test_handler_calls;
+
+static int test_counting_handler(ser_header_t* header, ser_buff_t* request, ser_buff_t* response, void* ctx) {
+  test_handler_calls++;
+  serlib_serialize_data(response, (char*)&test_handler_calls, sizeof(int));
+  return 0;
+};
+
+/*
+ * Sends request through the server and returns the int it answered.
+ */
+static int test_serve(serlib_rpc_server_t* server, int* sv, const char* request) {
+  ser_buff_t* b = test_response(request);
+  ser_header_t header = { .tid = 1, .rpc_proc_id = 1, .rpc_call_id = 1 };
+  serlib_rpc_write_frame(sv[0], &header, b);
+  serlib_rpc_server_serve_one(server, sv[1]);
+
+  int answer = -1;
+  if (serlib_rpc_read_frame(sv[0], &header, b, SERLIB_RPC_MAX_PAYLOAD_DEFAULT) == 0 && header.payload_size == sizeof(int)) {
+    memcpy(&answer, b->buffer, sizeof(int));
+  }
+  serlib_free_buffer(b);
+  return answer;
+};
+
+static void test_server_cache(void) {
+  int sv[2];
+  SERLIB_TEST_CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+
+  serlib_rpc_cache_t cache;
+  serlib_rpc_cache_init(&cache, 16, 1 << 20);
+  serlib_rpc_server_t server;
+  serlib_rpc_server_init(&server, 4);
+  serlib_rpc_server_register(&server, 1, test_counting_handler, NULL, 2);
+  serlib_rpc_server_set_cache(&server, &cache);
+
+  // not opted in yet: every request runs the handler
+  test_handler_calls = 0;
+  SERLIB_TEST_CHECK(test_serve(&server, sv, "q") == 1);
+  SERLIB_TEST_CHECK(test_serve(&server, sv, "q") == 2);
+
+  SERLIB_TEST_CHECK(serlib_rpc_server_set_cacheable(&server, 1, true) == 0);
+  SERLIB_TEST_CHECK(serlib_rpc_server_set_cacheable(&server, 2, true) == -1);
+  SERLIB_TEST_CHECK(test_serve(&server, sv, "q") == 3);
+  SERLIB_TEST_CHECK(test_serve(&server, sv, "q") == 3);
+  SERLIB_TEST_CHECK(test_serve(&server, sv, "r") == 4);
+  SERLIB_TEST_CHECK(test_serve(&server, sv, "q") == 3);
+  SERLIB_TEST_CHECK(test_handler_calls == 4);
+
+  // after an invalidation the handler answers again, and is cached again
+  SERLIB_TEST_CHECK(serlib_rpc_cache_invalidate(&cache, 1) == 2);
+  SERLIB_TEST_CHECK(test_serve(&server, sv, "q") == 5);
+  SERLIB_TEST_CHECK(test_serve(&server, sv, "q") == 5);
+
+  serlib_rpc_server_destroy(&server);
+  serlib_rpc_cache_destroy(&cache);
+  close(sv[0]);
+  close(sv[1]);
+};
+
+int main(void) {
+  test_lookup_invalidate();
+  test_eviction();
+  test_server_cache();
+
+  SERLIB_TEST_DONE("test_rpc_cache");
+};
@@ -0,0 +1,244 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+
+#include "../include/serc.h"
+#include "../include/serc_rpc.h"
+#include "test.h"
+
+/*
+ * Pipelined RPC client: responses that come back out of order reach
+ * the call whose rpc_call_id they carry, responses for unknown or
+ * released calls are dropped even when the call's slot has been reused,
+ * and several threads can wait on one connection at once.
+ */
+
+#define TEST_THREADS 4
+#define TEST_CALLS   2000
+
+typedef struct _test_peer_t {
+  int fd;
+  ser_buff_t* payload;
+} test_peer_t;
+
+static void test_peer_init(test_peer_t* peer, int fd) {
+  peer->fd = fd;
+  serlib_init_buffer_of_size(&peer->payload, 64);
+};
+
+static void test_peer_free(test_peer_t* peer) {
+  serlib_free_buffer(peer->payload);
+};
+
+/*
+ * Reads one request; its payload is left in peer->payload.
+ */
+static int test_peer_read(test_peer_t* peer, ser_header_t* header) {
+  return serlib_rpc_read_frame(peer->fd, header, peer->payload, SERLIB_RPC_MAX_PAYLOAD_DEFAULT);
+};
+
+/*
+ * Answers call_id with the payload "reply-<tag>".
+ */
+static void test_peer_reply(test_peer_t* peer, unsigned int call_id, int tag) {
+  ser_buff_t* b;
+  serlib_init_buffer_of_size(&b, 64);
+  char text[32];
+  int size = snprintf(text, sizeof(text), "reply-%d", tag);
+  serlib_serialize_data(b, text, size);
+
+  ser_header_t header = { .tid = 1, .rpc_proc_id = 1, .rpc_call_id = call_id };
+  serlib_rpc_write_frame(peer->fd, &header, b);
+  serlib_free_buffer(b);
+};
+
+/*
+ * Returns 1 if the response is "reply-<tag>".
+ */
+static int test_is_reply(ser_header_t* header, ser_buff_t* response, int tag) {
+  char text[32];
+  int size = snprintf(text, sizeof(text), "reply-%d", tag);
+  return header->payload_size == (unsigned int)size && memcmp(response->buffer, text, size) == 0;
+};
+
+static void test_out_of_order(void) {
+  int sv[2];
+  SERLIB_TEST_CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+
+  serlib_rpc_client_t client;
+  serlib_rpc_client_init(&client, sv[0], 1, 4, 64);
+  test_peer_t peer;
+  test_peer_init(&peer, sv[1]);
+
+  ser_buff_t* request;
+  serlib_init_buffer_of_size(&request, 64);
+  serlib_serialize_data(request, "ping", 4);
+
+  unsigned int ids[4];
+  for (int i = 0; i < 4; i++) SERLIB_TEST_CHECK(serlib_rpc_client_send(&client, 1, request, &ids[i]) == 0);
+
+  // no call slot left
+  unsigned int extra;
+  SERLIB_TEST_CHECK(serlib_rpc_client_send(&client, 1, request, &extra) == -1);
+
+  ser_header_t header;
+  for (int i = 0; i < 4; i++) {
+    SERLIB_TEST_CHECK(test_peer_read(&peer, &header) == 0);
+    SERLIB_TEST_CHECK(header.rpc_call_id == ids[i] && header.payload_size == 4);
+  }
+
+  // answered backwards, with a response nobody asked for in between
+  test_peer_reply(&peer, 12345, -1);
+  for (int i = 3; i >= 0; i--) test_peer_reply(&peer, ids[i], i);
+
+  ser_buff_t* response;
+  for (int i = 0; i < 4; i++) {
+    SERLIB_TEST_CHECK(serlib_rpc_client_wait(&client, ids[i], &header, &response) == 0);
+    SERLIB_TEST_CHECK(header.rpc_call_id == ids[i] && test_is_reply(&header, response, i));
+    serlib_rpc_client_release(&client, ids[i]);
+  }
+
+  // a released call's late response is dropped, even though its slot
+  // now belongs to the next call
+  unsigned int abandoned;
+  unsigned int reused;
+  SERLIB_TEST_CHECK(serlib_rpc_client_send(&client, 1, request, &abandoned) == 0);
+  serlib_rpc_client_release(&client, abandoned);
+  SERLIB_TEST_CHECK(serlib_rpc_client_send(&client, 1, request, &reused) == 0);
+  SERLIB_TEST_CHECK(reused != abandoned);
+  SERLIB_TEST_CHECK(serlib_rpc_client_wait(&client, abandoned, &header, &response) == -1);
+
+  test_peer_reply(&peer, abandoned, 100);
+  test_peer_reply(&peer, reused, 200);
+  SERLIB_TEST_CHECK(serlib_rpc_client_wait(&client, reused, &header, &response) == 0);
+  SERLIB_TEST_CHECK(test_is_reply(&header, response, 200));
+  serlib_rpc_client_release(&client, reused);
+
+  // a lost connection fails the outstanding calls
+  unsigned int orphan;
+  SERLIB_TEST_CHECK(serlib_rpc_client_send(&client, 1, request, &orphan) == 0);
+  close(sv[1]);
+  SERLIB_TEST_CHECK(serlib_rpc_client_wait(&client, orphan, &header, &response) == -1);
+
+  serlib_free_buffer(request);
+  test_peer_free(&peer);
+  serlib_rpc_client_destroy(&client);
+  close(sv[0]);
+};
+
+typedef struct _test_caller_t {
+  pthread_t thread;
+  serlib_rpc_client_t* client;
+  int id;
+  int wrong;
+} test_caller_t;
+
+static void* test_caller_main(void* arg) {
+  test_caller_t* caller = arg;
+
+  ser_buff_t* request;
+  serlib_init_buffer_of_size(&request, 64);
+
+  for (int i = 0; i < TEST_CALLS; i++) {
+    int tag = caller->id * TEST_CALLS + i;
+    serlib_reset_buffer(request);
+    serlib_serialize_data(request, (char*)&tag, sizeof(tag));
+
+    unsigned int call_id;
+    ser_header_t header;
+    ser_buff_t* response;
+    if (serlib_rpc_client_send(caller->client, 1, request, &call_id) < 0 ||
+        serlib_rpc_client_wait(caller->client, call_id, &header, &response) < 0
+    ) {
+      caller->wrong++;
+      break;
+    }
+
+    caller->wrong += !test_is_reply(&header, response, tag);
+    serlib_rpc_client_release(caller->client, call_id);
+  }
+
+  serlib_free_buffer(request);
+  return NULL;
+};
+
+static void* test_echo_main(void* arg) {
+  test_peer_t* peer = arg;
+
+  // requests carry their tag; each is held back until the next one is
+  // in, so responses keep overtaking each other, or until the line has
+  // been quiet for a moment, so the last one isn't held forever
+  ser_header_t header;
+  unsigned int held_id = 0;
+  int held_tag = 0;
+  for (;;) {
+    struct pollfd pfd = { .fd = peer->fd, .events = POLLIN };
+    if (held_id && poll(&pfd, 1, 1) == 0) {
+      test_peer_reply(peer, held_id, held_tag);
+      held_id = 0;
+      continue;
+    }
+    if (test_peer_read(peer, &header) < 0) break;
+
+    int tag;
+    memcpy(&tag, peer->payload->buffer, sizeof(tag));
+    if (!held_id) {
+      held_id = header.rpc_call_id;
+      held_tag = tag;
+      continue;
+    }
+
+    test_peer_reply(peer, header.rpc_call_id, tag);
+    test_peer_reply(peer, held_id, held_tag);
+    held_id = 0;
+  }
+
+  return NULL;
+};
+
+static void test_concurrent_waiters(void) {
+  int sv[2];
+  SERLIB_TEST_CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+
+  serlib_rpc_client_t client;
+  serlib_rpc_client_init(&client, sv[0], 1, TEST_THREADS * 2, 64);
+  test_peer_t peer;
+  test_peer_init(&peer, sv[1]);
+
+  pthread_t echo;
+  pthread_create(&echo, NULL, test_echo_main, &peer);
+
+  test_caller_t callers[TEST_THREADS];
+  for (int i = 0; i < TEST_THREADS; i++) {
+    callers[i].client = &client;
+    callers[i].id = i;
+    callers[i].wrong = 0;
+    pthread_create(&callers[i].thread, NULL, test_caller_main, &callers[i]);
+  }
+
+  int wrong = 0;
+  for (int i = 0; i < TEST_THREADS; i++) {
+    pthread_join(callers[i].thread, NULL);
+    wrong += callers[i].wrong;
+  }
+  SERLIB_TEST_CHECK(wrong == 0);
+
+  shutdown(sv[0], SHUT_RDWR);
+  pthread_join(echo, NULL);
+
+  test_peer_free(&peer);
+  serlib_rpc_client_destroy(&client);
+  close(sv[0]);
+  close(sv[1]);
+};
+
+int main(void) {
+  test_out_of_order();
+  test_concurrent_waiters();
+
+  SERLIB_TEST_DONE("test_rpc_client");
+};
@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "../include/serc.h"
+#include "../include/serc_rpc.h"
+#include "../include/serc_stats.h"
+#include "test.h"
+
+/*
+ * Server dispatch: each rpc_proc_id reaches its own handler and ctx,
+ * registration refuses ids out of range or taken, and serve_one
+ * answers with the request's tid, rpc_proc_id and rpc_call_id, an
+ * empty payload for unknown procedures and failed handlers, and stops
+ * allocating once the per-procedure pools are warm.
+ */
+
+typedef struct _test_proc_ctx_t {
+  int calls;
+  int tag;
+} test_proc_ctx_t;
+
+// answers with its tag followed by the request bytes
+static int test_handler(ser_header_t* header, ser_buff_t* request, ser_buff_t* response, void* ctx) {
+  test_proc_ctx_t* proc = ctx;
+  proc->calls++;
+
+  serlib_serialize_data(response, (char*)&proc->tag, sizeof(int));
+  serlib_serialize_data(response, request->buffer, header->payload_size);
+  return 0;
+};
+
+static int test_failing_handler(ser_header_t* header, ser_buff_t* request, ser_buff_t* response, void* ctx) {
+  serlib_serialize_data(response, "partial", 7);
+  return -1;
+};
+
+static void test_dispatch(void) {
+  serlib_rpc_server_t server;
+  serlib_rpc_server_init(&server, 8);
+
+  test_proc_ctx_t first = { 0, 11 };
+  test_proc_ctx_t second = { 0, 22 };
+  SERLIB_TEST_CHECK(serlib_rpc_server_register(&server, 1, test_handler, &first, 2) == 0);
+  SERLIB_TEST_CHECK(serlib_rpc_server_register(&server, 7, test_handler, &second, 2) == 0);
+  SERLIB_TEST_CHECK(serlib_rpc_server_register(&server, 1, test_handler, &second, 2) == -1);
+  SERLIB_TEST_CHECK(serlib_rpc_server_register(&server, 8, test_handler, &second, 2) == -1);
+
+  ser_buff_t* request;
+  ser_buff_t* response;
+  serlib_init_buffer_of_size(&request, 64);
+  serlib_init_buffer_of_size(&response, 64);
+  serlib_serialize_data(request, "abc", 3);
+
+  ser_header_t header = { .tid = 1, .rpc_proc_id = 7, .rpc_call_id = 1, .payload_size = 3 };
+  SERLIB_TEST_CHECK(serlib_rpc_server_dispatch(&server, &header, request, response) == 0);
+  SERLIB_TEST_CHECK(first.calls == 0 && second.calls == 1);
+
+  int tag = 0;
+  memcpy(&tag, response->buffer, sizeof(int));
+  SERLIB_TEST_CHECK(tag == 22 && response->next == 7 && memcmp(response->buffer + 4, "abc", 3) == 0);
+
+  header.rpc_proc_id = 3;
+  SERLIB_TEST_CHECK(serlib_rpc_server_dispatch(&server, &header, request, response) == -1);
+  header.rpc_proc_id = 1000;
+  SERLIB_TEST_CHECK(serlib_rpc_server_dispatch(&server, &header, request, response) == -1);
+  SERLIB_TEST_CHECK(first.calls == 0 && second.calls == 1);
+
+  serlib_free_buffer(request);
+  serlib_free_buffer(response);
+  serlib_rpc_server_destroy(&server);
+};
+
+static long long test_buffers_live(void) {
+  serlib_mem_t mem;
+  serlib_mem_snapshot(&mem);
+  return mem.live[SERLIB_MEM_BUFFERS];
+};
+
+static void test_serve(void) {
+  int sv[2];
+  SERLIB_TEST_CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+
+  serlib_rpc_server_t server;
+  serlib_rpc_server_init(&server, 4);
+  test_proc_ctx_t proc = { 0, 33 };
+  serlib_rpc_server_register(&server, 2, test_handler, &proc, 2);
+  serlib_rpc_server_register(&server, 3, test_failing_handler, NULL, 2);
+
+  ser_buff_t* response;
+  serlib_init_buffer_of_size(&response, 64);
+
+  // client writes fit in the socket buffer, so one thread can play both
+  // ends: write the request, serve it, read the answer
+  char data[300];
+  memset(data, 'q', sizeof(data));
+  long long warm = 0;
+  int wrong = 0;
+  for (int i = 0; i < 50; i++) {
+    ser_header_t header = { .tid = 9, .rpc_proc_id = 2, .rpc_call_id = 100 + i };
+    ser_buff_t* request;
+    serlib_init_buffer_of_size(&request, 64);
+    serlib_serialize_data(request, data, i % 2 ? sizeof(data) : 10);
+    serlib_rpc_write_frame(sv[0], &header, request);
+    serlib_free_buffer(request);
+
+    if (serlib_rpc_server_serve_one(&server, sv[1]) < 0) wrong++;
+    if (serlib_rpc_read_frame(sv[0], &header, response, SERLIB_RPC_MAX_PAYLOAD_DEFAULT) < 0) wrong++;
+
+    int size = (i % 2 ? sizeof(data) : 10) + sizeof(int);
+    wrong += header.tid != 9 || header.rpc_proc_id != 2 || header.rpc_call_id != 100u + i;
+    wrong += header.payload_size != (unsigned int)size || response->buffer[size - 1] != 'q';
+
+    // the pools hold the largest buffers seen after the first two calls
+    if (i == 2) warm = test_buffers_live();
+  }
+  SERLIB_TEST_CHECK(wrong == 0 && proc.calls == 50);
+  SERLIB_TEST_CHECK(test_buffers_live() == warm);
+
+  // unknown procedure and failing handler: empty answers, same ids
+  ser_header_t header = { .tid = 9, .rpc_proc_id = 1, .rpc_call_id = 7 };
+  SERLIB_TEST_CHECK(serlib_rpc_write_frame(sv[0], &header, response) == 0);
+  SERLIB_TEST_CHECK(serlib_rpc_server_serve_one(&server, sv[1]) == 0);
+  SERLIB_TEST_CHECK(serlib_rpc_read_frame(sv[0], &header, response, SERLIB_RPC_MAX_PAYLOAD_DEFAULT) == 0);
+  SERLIB_TEST_CHECK(header.rpc_proc_id == 1 && header.rpc_call_id == 7 && header.payload_size == 0);
+
+  header.rpc_proc_id = 3;
+  header.rpc_call_id = 8;
+  serlib_rpc_write_frame(sv[0], &header, response);
+  SERLIB_TEST_CHECK(serlib_rpc_server_serve_one(&server, sv[1]) == 0);
+  SERLIB_TEST_CHECK(serlib_rpc_read_frame(sv[0], &header, response, SERLIB_RPC_MAX_PAYLOAD_DEFAULT) == 0);
+  SERLIB_TEST_CHECK(header.rpc_call_id == 8 && header.payload_size == 0);
+
+  // a request over the cap is refused without being read
+  SERLIB_TEST_CHECK(serlib_rpc_server_set_max_payload(&server, SERLIB_RPC_MAX_PAYLOAD_LIMIT + 1u) == -1);
+  SERLIB_TEST_CHECK(serlib_rpc_server_set_max_payload(&server, 64) == 0);
+  ser_buff_t* large;
+  serlib_init_buffer_of_size(&large, 128);
+  serlib_serialize_data(large, data, 65);
+  header.rpc_proc_id = 2;
+  SERLIB_TEST_CHECK(serlib_rpc_write_frame(sv[0], &header, large) == 0);
+  SERLIB_TEST_CHECK(serlib_rpc_server_serve_one(&server, sv[1]) == -1);
+  SERLIB_TEST_CHECK(serlib_rpc_read_frame(sv[0], &header, response, SERLIB_RPC_MAX_PAYLOAD_DEFAULT) == -1);
+  SERLIB_TEST_CHECK(proc.calls == 50);
+  serlib_free_buffer(large);
+
+  serlib_free_buffer(response);
+  serlib_rpc_server_destroy(&server);
+  close(sv[0]);
+  close(sv[1]);
+};
+
+int main(void) {
+  test_dispatch();
+  test_serve();
+
+  SERLIB_TEST_DONE("test_rpc_server");
+};